@@ -0,0 +1,31 @@
+#include "AtomicFile.hpp"
+
+#include "AppException.hpp"
+#include "Utf8Path.hpp"
+
+#include <fstream>
+
+namespace application
+{
+    void WriteFileAtomically(const std::string& fileName, const std::string& content)
+    {
+        const std::filesystem::path path = ToPath(fileName);
+        std::filesystem::path tempPath = path;
+        tempPath += ".tmp";
+        {
+            std::ofstream output(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+            output.write(content.data(), content.size());
+            if (!output.flush())
+                throw AppException("Could not write file " + ToUtf8(tempPath));
+        }
+
+        std::error_code error;
+        std::filesystem::rename(tempPath, path, error);
+        if (error)
+        {
+            const std::string reason = error.message();
+            std::filesystem::remove(tempPath, error);
+            throw AppException("Could not replace file " + fileName + ": " + reason);
+        }
+    }
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <string>
+
+namespace application
+{
+    /// <summary>
+    /// Writes a file aside then renames it into place, so that readers
+    /// never see it partially written.
+    /// </summary>
+    /// <param name="fileName">The file to (over)write, UTF-8 encoded.</param>
+    /// <param name="content">The new content of the file.</param>
+    /// <remarks>Throws <see cref="AppException"/> on failure.</remarks>
+    void WriteFileAtomically(const std::string& fileName, const std::string& content);
+}
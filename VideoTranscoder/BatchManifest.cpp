@@ -0,0 +1,241 @@
+#include "BatchManifest.hpp"
+#include "AppException.hpp"
+#include "Utf8Path.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+
+namespace application
+{
+    namespace fs = std::filesystem;
+
+    static bool EqualsIgnoreCase(char a, char b)
+    {
+        return std::tolower(static_cast<unsigned char>(a))
+            == std::tolower(static_cast<unsigned char>(b));
+    }
+
+    /// <summary>
+    /// Matches a file name against a pattern with wildcards '*' and '?' (case insensitive).
+    /// </summary>
+    static bool MatchesWildcard(const std::string& name, const std::string& pattern)
+    {
+        size_t idxName = 0;
+        size_t idxPattern = 0;
+        size_t starPattern = std::string::npos;
+        size_t starName = 0;
+
+        while (idxName < name.size())
+        {
+            if (idxPattern < pattern.size()
+                && (pattern[idxPattern] == '?' || EqualsIgnoreCase(pattern[idxPattern], name[idxName])))
+            {
+                ++idxName;
+                ++idxPattern;
+            }
+            else if (idxPattern < pattern.size() && pattern[idxPattern] == '*')
+            {
+                starPattern = idxPattern++;
+                starName = idxName;
+            }
+            else if (starPattern != std::string::npos)
+            {
+                // backtrack: let the last '*' swallow one more char
+                idxPattern = starPattern + 1;
+                idxName = ++starName;
+            }
+            else
+                return false;
+        }
+
+        while (idxPattern < pattern.size() && pattern[idxPattern] == '*')
+            ++idxPattern;
+
+        return idxPattern == pattern.size();
+    }
+
+    static bool IsVideoFile(const fs::path& filePath)
+    {
+        static const auto extensions = std::to_array<const char*>({
+            ".mp4", ".m4v", ".mov", ".mkv", ".avi", ".wmv", ".asf", ".ts", ".mts", ".m2ts", ".3gp"
+        });
+
+        const std::string extension = ToUtf8(filePath.extension());
+        return std::any_of(extensions.begin(), extensions.end(),
+            [&extension](const char* candidate)
+            {
+                return MatchesWildcard(extension, candidate);
+            });
+    }
+
+    static fs::path MakeOutputPath(const fs::path& inputPath, const fs::path& outputDir)
+    {
+        fs::path outputPath = outputDir / inputPath.filename();
+        outputPath.replace_extension(".mp4");
+        return outputPath;
+    }
+
+    static std::vector<BatchEntry> ListDirectory(
+        const fs::path& directory,
+        const std::string& pattern,
+        const fs::path& outputDir)
+    {
+        std::vector<BatchEntry> entries;
+        for (const fs::directory_entry& dirEntry : fs::directory_iterator(directory))
+        {
+            if (!dirEntry.is_regular_file())
+                continue;
+
+            const fs::path& inputPath = dirEntry.path();
+            if (pattern.empty() ? !IsVideoFile(inputPath)
+                                : !MatchesWildcard(ToUtf8(inputPath.filename()), pattern))
+            {
+                continue;
+            }
+
+            entries.push_back(BatchEntry{
+                ToUtf8(inputPath), ToUtf8(MakeOutputPath(inputPath, outputDir))
+            });
+        }
+
+        // directory iteration order is unspecified:
+        std::sort(entries.begin(), entries.end(),
+            [](const BatchEntry& left, const BatchEntry& right)
+            {
+                return left.inputFName < right.inputFName;
+            });
+
+        return entries;
+    }
+
+    static std::string Trim(const std::string& text)
+    {
+        auto first = text.find_first_not_of(" \t\r\n");
+        if (first == std::string::npos)
+            return std::string();
+
+        auto last = text.find_last_not_of(" \t\r\n");
+        return text.substr(first, last - first + 1);
+    }
+
+    static std::vector<BatchEntry> ReadManifest(const fs::path& manifestPath, const fs::path& outputDir)
+    {
+        std::ifstream manifest(manifestPath);
+        if (!manifest)
+            throw AppException("Could not open batch manifest " + ToUtf8(manifestPath));
+
+        std::vector<BatchEntry> entries;
+        std::string line;
+        for (unsigned int lineNumber = 1; std::getline(manifest, line); ++lineNumber)
+        {
+            line = Trim(line);
+            if (line.empty() || line[0] == '#')
+                continue;
+
+            const auto separatorPos = line.find('|');
+            const std::string input = Trim(line.substr(0, separatorPos));
+            if (input.empty())
+            {
+                std::ostringstream oss;
+                oss << "Batch manifest has no input file in line " << lineNumber;
+                throw AppException(oss.str());
+            }
+
+            const fs::path inputPath = ToPath(input);
+            fs::path outputPath;
+            if (separatorPos == std::string::npos)
+                outputPath = MakeOutputPath(inputPath, outputDir);
+            else
+                outputPath = outputDir / ToPath(Trim(line.substr(separatorPos + 1)));
+
+            entries.push_back(BatchEntry{ input, ToUtf8(outputPath) });
+        }
+
+        return entries;
+    }
+
+    /// <summary>
+    /// Identifies a file however its path is written, with the case folded as in Windows file systems.
+    /// </summary>
+    static std::string GetFileKey(const std::string& fileName)
+    {
+        std::error_code error;
+        fs::path filePath = fs::weakly_canonical(fs::absolute(ToPath(fileName)), error);
+        if (error)
+            filePath = fs::absolute(ToPath(fileName)).lexically_normal();
+
+        std::string key = ToUtf8(filePath);
+        std::transform(key.begin(), key.end(), key.begin(),
+            [](char ch) { return static_cast<char>(std::tolower(static_cast<unsigned char>(ch))); });
+        return key;
+    }
+
+    /// <summary>
+    /// Makes sure that no job of the batch writes an input or the output of another job.
+    /// </summary>
+    static void CheckOutputs(const std::vector<BatchEntry>& entries)
+    {
+        std::unordered_map<std::string, const BatchEntry*> inputs;
+        for (const BatchEntry& entry : entries)
+            inputs.emplace(GetFileKey(entry.inputFName), &entry);
+
+        std::unordered_map<std::string, const BatchEntry*> outputs;
+        for (const BatchEntry& entry : entries)
+        {
+            const std::string outputKey = GetFileKey(entry.outputFName);
+            auto input = inputs.find(outputKey);
+            if (input != inputs.end())
+            {
+                throw AppException("Batch job for " + entry.inputFName
+                    + " would overwrite the input file " + input->second->inputFName);
+            }
+
+            auto [output, inserted] = outputs.emplace(outputKey, &entry);
+            if (!inserted)
+            {
+                throw AppException("Batch jobs for " + output->second->inputFName + " and "
+                    + entry.inputFName + " would both write " + entry.outputFName);
+            }
+        }
+    }
+
+    std::vector<BatchEntry> LoadBatch(const std::string& batchSource, const std::string& outputDir)
+    {
+        const fs::path sourcePath = ToPath(batchSource);
+        const fs::path outputDirPath = ToPath(outputDir);
+
+        std::vector<BatchEntry> entries;
+        const std::string fileName = ToUtf8(sourcePath.filename());
+        if (fileName.find_first_of("*?") != std::string::npos)
+        {
+            fs::path directory = sourcePath.parent_path();
+            entries = ListDirectory(directory.empty() ? fs::path(".") : directory, fileName, outputDirPath);
+        }
+        else if (fs::is_directory(sourcePath))
+        {
+            entries = ListDirectory(sourcePath, std::string(), outputDirPath);
+        }
+        else if (fs::is_regular_file(sourcePath))
+        {
+            entries = ReadManifest(sourcePath, outputDirPath);
+        }
+        else
+            throw AppException("Batch source " + batchSource + " does not exist");
+
+        if (entries.empty())
+            throw AppException("Batch source " + batchSource + " yields no input files");
+
+        // before any job runs, because they run concurrently:
+        CheckOutputs(entries);
+
+        for (const BatchEntry& entry : entries)
+            fs::create_directories(ToPath(entry.outputFName).parent_path());
+
+        return entries;
+    }
+}
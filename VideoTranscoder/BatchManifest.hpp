@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace application
+{
+    /// <summary>
+    /// Input and output of a single job in a batch.
+    /// </summary>
+    struct BatchEntry
+    {
+        std::string inputFName;
+        std::string outputFName;
+    };
+
+    /// <summary>
+    /// Lists the jobs of a batch.
+    /// </summary>
+    /// <param name="batchSource">
+    /// Either a directory (all video files inside it are taken), a file name
+    /// pattern with wildcards '*' and '?' (e.g. "D:\videos\*.mov"), or a manifest
+    /// text file where each line is "input" or "input|output". Empty lines and
+    /// lines starting with '#' in the manifest are ignored.
+    /// </param>
+    /// <param name="outputDir">
+    /// The directory where output files are placed when the output is not explicit
+    /// or when it is given as a relative path in the manifest.
+    /// </param>
+    /// <returns>The list of jobs, all with input and output file names (UTF-8 encoded).</returns>
+    /// <remarks>
+    /// Throws <see cref="AppException"/> when the output of a job is an input of the batch or the
+    /// output of another job (as for "a.mov" and "a.mp4" in the same directory, both to "a.mp4").
+    /// </remarks>
+    std::vector<BatchEntry> LoadBatch(const std::string& batchSource, const std::string& outputDir);
+}
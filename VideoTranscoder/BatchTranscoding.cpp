@@ -0,0 +1,352 @@
+#include "BatchTranscoding.hpp"
+
+#include "AppException.hpp"
+#include "BatchManifest.hpp"
+#include "ContentFingerprint.hpp"
+#include "EncoderCalibration.hpp"
+#include "JobConsole.hpp"
+#include "JobPrediction.hpp"
+#include "JobScheduler.hpp"
+#include "Mp4Faststart.hpp"
+#include "OutputCache.hpp"
+#include "ProbeCache.hpp"
+#include "ProgressSubscribers.hpp"
+#include "TranscodeJob.hpp"
+#include "TranscodeReport.hpp"
+#include "Utf8Path.hpp"
+
+#include <MinCppXtra/traceable_exception.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+namespace application
+{
+    using namespace std::chrono;
+
+    /// <summary>
+    /// Tells what is in the inputs of the batch before any job starts, probing through the
+    /// probe cache so that only new or changed files are opened, then updates the cache.
+    /// </summary>
+    static void PlanBatch(MediaBackend& backend,
+                          const std::vector<BatchEntry>& entries,
+                          const StreamSelectionPolicy& streamSelection)
+    {
+        const auto startTime = steady_clock::now();
+        ProbeCache cache(backend.GetDataDirectory() + "/probe.cache", streamSelection);
+        auto threadScope = backend.EnterThread();
+
+        size_t cachedCount(0), failedCount(0);
+        std::array<size_t, 4> formatCounts = {};
+        nanoseconds totalDuration(0);
+        for (const BatchEntry& entry : entries)
+        {
+            const std::optional<FileIdentity> identity = GetFileIdentity(entry.inputFName);
+            if (!identity)
+            {
+                ++failedCount;
+                continue;
+            }
+
+            std::optional<CachedProbe> probe = cache.Find(*identity);
+            if (probe)
+            {
+                ++cachedCount;
+            }
+            else
+            {
+                // the job reports the failure in detail later:
+                try
+                {
+                    auto input = backend.OpenInput(entry.inputFName);
+                    probe = CachedProbe{ input->GetMediaInfo(), input->GetDuration(), input->GetStreamLayout() };
+                    cache.Store(*identity, *probe);
+                }
+                catch (mincpp::TraceableException&)
+                {
+                    ++failedCount;
+                    continue;
+                }
+            }
+
+            const auto& format = probe->info.videoProfile.format;
+            ++formatCounts[format ? static_cast<size_t>(*format) : formatCounts.size() - 1];
+            totalDuration += probe->duration;
+        }
+
+        try
+        {
+            cache.Save();
+        }
+        catch (mincpp::TraceableException& ex)
+        {
+            std::cerr << std::endl << "Could not save probe cache: " << ex.what() << std::endl;
+        }
+
+        std::cout << "Inputs have " << duration_cast<minutes>(totalDuration).count() << " min of video (";
+        for (Encoder format : { Encoder::H264_AVC, Encoder::H265_HEVC, Encoder::AV1 })
+            std::cout << formatCounts[static_cast<size_t>(format)] << ' ' << GetEncoderName(format) << ", ";
+
+        std::cout << formatCounts.back() << " other), probed in "
+            << duration_cast<milliseconds>(steady_clock::now() - startTime).count() << " ms with "
+            << cachedCount << " of " << entries.size() << " from cache";
+
+        if (failedCount > 0)
+            std::cout << " (" << failedCount << " could not be probed)";
+
+        std::cout << std::endl << std::endl;
+    }
+
+    static TranscodeReport RunJob(MediaBackend& backend,
+                                  size_t jobIdx,
+                                  size_t jobCount,
+                                  const BatchEntry& entry,
+                                  const CmdLineParams& params,
+                                  const EncoderSelection& encoderSelection,
+                                  bool useHardware,
+                                  OutputCache* outputCache,
+                                  ProgressHub& progressHub)
+    {
+        TranscodeReport result = {};
+        result.inputFName = entry.inputFName;
+        result.outputFName = entry.outputFName;
+        result.videoEncoder = params.encoder;
+        result.requestedSizeFactor = params.tgtSize;
+        const auto startTime = steady_clock::now();
+
+        try
+        {
+            auto threadScope = backend.EnterThread();
+
+            if (params.predictExcerpts > 0)
+            {
+                result.prediction = PredictJob(backend, entry.inputFName, entry.outputFName, encoderSelection,
+                                               params.tgtSize, params.predictExcerpts, params.GetTimeBudget());
+                if (result.prediction)
+                    PrintJobMessage(jobIdx, jobCount, DescribeJobPrediction(*result.prediction));
+            }
+
+            // the output is cached under the job as first decided, whatever the retunes:
+            std::string outputCacheKey;
+
+            double sizeFactor = result.prediction ? result.prediction->correctedSizeFactor : params.tgtSize;
+            while (true)
+            {
+                TranscodeJob job(backend, entry.inputFName, entry.outputFName, encoderSelection,
+                                 sizeFactor, std::nullopt, params.GetFragmentDuration(), useHardware,
+                                 result.prediction ? result.prediction->videoQualityVsSpeed : 0);
+                result.mediaDuration = job.GetDuration();
+                result.sourceInfo = job.GetSourceInfo();
+                result.settings = job.GetSettings();
+                result.videoEncoder = job.GetSettings().videoEncoder;
+
+                if (outputCache && outputCacheKey.empty())
+                {
+                    outputCacheKey = OutputCache::MakeKey(FingerprintFile(entry.inputFName),
+                        job.GetSettings(), params.streamSelection, params.faststart);
+
+                    if (outputCache->Fetch(outputCacheKey, entry.outputFName))
+                    {
+                        PrintJobMessage(jobIdx, jobCount, "output taken from cache");
+                        result.fromOutputCache = true;
+                        break;
+                    }
+                }
+
+                job.Track(progressHub, entry.inputFName);
+                if (result.prediction)
+                    job.ExpectSpeed(result.prediction->speed);
+
+                // the limit is relative to the requested target, however corrected:
+                const uint64_t targetSize = job.EstimateOutputSize(params.tgtSize);
+                if (params.sizeGuardPct > 0.0 && targetSize != 0)
+                    job.LimitSize(static_cast<uint64_t>(targetSize * (1.0 + params.sizeGuardPct / 100)));
+
+                job.Start();
+
+                try
+                {
+                    while (!job.Wait(hours(1)))
+                        continue;
+                }
+                catch (AppException& ex)
+                {
+                    const auto projectedSize = job.GetOversizeProjection();
+                    if (!projectedSize || !params.sizeRetune || result.sizeRetuneCount >= TranscodeJob::maxSizeRetunes)
+                        throw;
+
+                    sizeFactor *= (double)targetSize / *projectedSize;
+                    ++result.sizeRetuneCount;
+
+                    std::ostringstream oss;
+                    oss << ex.what() << ", restarting with target size factor " << sizeFactor;
+                    PrintJobMessage(jobIdx, jobCount, oss.str());
+                    continue;
+                }
+
+                // known for sure only once the session has resolved the topology:
+                result.hardwareAccelerated = job.IsHardwareAccelerated();
+                result.videoEncoderName = job.GetVideoEncoderName();
+                break;
+            }
+
+            if (!result.fromOutputCache)
+            {
+                if (params.faststart && !params.simulate)
+                    MoveMovieToFront(entry.outputFName);
+
+                if (outputCache)
+                {
+                    try
+                    {
+                        outputCache->Store(outputCacheKey, entry.outputFName);
+                    }
+                    catch (AppException& ex)
+                    {
+                        PrintJobMessage(jobIdx, jobCount, ex.what());
+                    }
+                }
+            }
+
+            result.succeeded = true;
+        }
+        catch (mincpp::TraceableException& ex)
+        {
+            result.errorMessage = ex.what();
+            std::lock_guard<std::mutex> lock(GetConsoleMutex());
+            std::cerr << std::endl << ex.Serialize() << std::endl;
+        }
+        catch (std::exception& ex)
+        {
+            result.errorMessage = ex.what();
+        }
+
+        result.wallTime = steady_clock::now() - startTime;
+        return result;
+    }
+
+    static void WriteReport(const TranscodeReport& report, const std::string& reportPath)
+    {
+        try
+        {
+            WriteTranscodeReport(report, GetTranscodeReportFName(reportPath, report.outputFName));
+        }
+        catch (mincpp::TraceableException& ex)
+        {
+            std::lock_guard<std::mutex> lock(GetConsoleMutex());
+            std::cerr << std::endl << ex.Serialize() << std::endl;
+        }
+    }
+
+    static void PrintSummary(
+        const std::vector<BatchEntry>& entries,
+        const std::vector<TranscodeReport>& results,
+        nanoseconds wallTime)
+    {
+        size_t qtSucceeded(0);
+        nanoseconds totalMediaDuration(0);
+
+        std::cout << std::endl << "Batch summary:" << std::endl << std::endl;
+
+        for (size_t idx = 0; idx < entries.size(); ++idx)
+        {
+            const TranscodeReport& result = results[idx];
+            std::cout << (result.succeeded ? "  OK    " : "  FAIL  ") << entries[idx].inputFName;
+
+            if (result.succeeded)
+            {
+                ++qtSucceeded;
+                totalMediaDuration += result.mediaDuration;
+
+                const double speed =
+                    (double)result.mediaDuration.count() / std::max<int64_t>(result.wallTime.count(), 1);
+
+                std::cout
+                    << " (" << duration_cast<seconds>(result.wallTime).count() << " s, "
+                    << std::fixed << std::setprecision(1) << speed << "x real time"
+                    << (result.hardwareAccelerated ? ", HW" : "")
+                    << (result.fromOutputCache ? ", cached" : "") << ')';
+            }
+            else
+                std::cout << " (" << result.errorMessage << ')';
+
+            std::cout << std::endl;
+        }
+
+        std::cout << std::endl
+            << qtSucceeded << " of " << entries.size() << " jobs succeeded in "
+            << duration_cast<seconds>(wallTime).count() << " s";
+
+        if (wallTime.count() > 0)
+        {
+            std::cout
+                << " (aggregate speed " << std::fixed << std::setprecision(1)
+                << (double)totalMediaDuration.count() / wallTime.count() << "x real time)";
+        }
+
+        std::cout << std::endl << std::endl;
+    }
+
+    bool RunBatchTranscoding(MediaBackend& backend, const CmdLineParams& params)
+    {
+        const std::vector<BatchEntry> entries = LoadBatch(params.batchSource, params.outputFName);
+
+        JobScheduler scheduler(params.maxParallelJobs);
+        std::cout << std::endl
+            << "Batch has " << entries.size() << " jobs, running up to "
+            << scheduler.GetMaxConcurrentJobs() << " at the same time" << std::endl << std::endl;
+
+        PlanBatch(backend, entries, params.streamSelection);
+
+        ProgressHub progressHub;
+        SubscribeFileWriters(progressHub, params.progressJsonFName, params.metricsFName);
+
+        // reports of several jobs go in a directory:
+        if (params.writeReport && !params.reportPath.empty())
+            std::filesystem::create_directories(ToPath(params.reportPath));
+
+        std::vector<TranscodeReport> results(entries.size());
+        const auto startTime = steady_clock::now();
+
+        const EncoderSelection encoderSelection = GetEncoderSelection(backend, params);
+
+        std::unique_ptr<OutputCache> outputCache;
+        if (params.UseOutputCache())
+            outputCache = std::make_unique<OutputCache>(params.outputCacheDir, params.GetOutputCacheLimits());
+
+        // jobs go to hardware encoders first, and the overflow to software
+        // (with automatic selection, by the capacity for the fallback encoder):
+        const uint32_t hardwareSlots = backend.GetEncoderRegistry().GetHardwareSessionCapacity(params.encoder);
+
+        scheduler.Run(entries.size(), hardwareSlots,
+            [&backend, &entries, &results, &params, &encoderSelection, &outputCache, &progressHub]
+            (size_t jobIdx, bool useHardware)
+            {
+                JobConsoleScope consoleScope(jobIdx, entries.size());
+                const BatchEntry& entry = entries[jobIdx];
+                PrintJobMessage(jobIdx, entries.size(), "starting " + entry.inputFName);
+
+                results[jobIdx] = RunJob(
+                    backend, jobIdx, entries.size(), entry, params, encoderSelection, useHardware,
+                    outputCache.get(), progressHub);
+
+                if (params.writeReport)
+                    WriteReport(results[jobIdx], params.reportPath);
+
+                PrintJobMessage(jobIdx, entries.size(),
+                    (results[jobIdx].succeeded ? "finished " : "failed ") + entry.inputFName);
+            });
+
+        PrintSummary(entries, results, steady_clock::now() - startTime);
+
+        return std::all_of(results.begin(), results.end(),
+            [](const TranscodeReport& result) { return result.succeeded; });
+    }
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "CommandLineParsing.hpp"
+#include "MediaBackend.hpp"
+
+namespace application
+{
+    /// <summary>
+    /// Transcodes all files in a batch with concurrent media sessions
+    /// and prints a summary of the results in the end.
+    /// </summary>
+    /// <param name="backend">The media backend shared by all jobs.</param>
+    /// <param name="params">The command line parameters in batch mode.</param>
+    /// <returns>Whether all jobs have succeeded.</returns>
+    bool RunBatchTranscoding(MediaBackend& backend, const CmdLineParams& params);
+}
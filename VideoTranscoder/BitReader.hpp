@@ -0,0 +1,109 @@
+#pragma once
+
+#include "AppException.hpp"
+
+#include <cinttypes>
+#include <cstddef>
+
+namespace application
+{
+    /// <summary>
+    /// Bounds checked reader of a bit string (MSB first), as in the syntax of H.264/HEVC headers.
+    /// </summary>
+    /// <remarks>
+    /// Meant to run over RBSP, after removal of emulation prevention bytes.
+    /// Throws <see cref="AppException"/> when reading past the end.
+    /// </remarks>
+    class BitReader
+    {
+    private:
+
+        const uint8_t* m_data;
+        uint64_t m_sizeInBits;
+        uint64_t m_position;
+
+        constexpr void Require(uint64_t count) const
+        {
+            if (count > m_sizeInBits - m_position)
+                throw AppException("Bit string ended unexpectedly");
+        }
+
+    public:
+
+        constexpr BitReader(const uint8_t* data, uint64_t size)
+            : m_data(data)
+            , m_sizeInBits(size * 8)
+            , m_position(0)
+        {
+        }
+
+        constexpr uint64_t GetBitsLeft() const
+        {
+            return m_sizeInBits - m_position;
+        }
+
+        constexpr bool ReadFlag()
+        {
+            Require(1);
+            const uint8_t byte = m_data[m_position >> 3];
+            const bool bit = ((byte >> (7 - (m_position & 7))) & 1) != 0;
+            ++m_position;
+            return bit;
+        }
+
+        /// <summary>
+        /// Reads an unsigned integer of fixed length, u(n) with n up to 32.
+        /// </summary>
+        constexpr uint32_t ReadBits(uint32_t count)
+        {
+            Require(count);
+            uint64_t value = 0;
+            while (count > 0)
+            {
+                // take as many bits as are left in the current byte:
+                const uint32_t bitInByte = static_cast<uint32_t>(m_position & 7);
+                const uint32_t take = (8 - bitInByte < count) ? 8 - bitInByte : count;
+                const uint8_t byte = m_data[m_position >> 3];
+                value = (value << take) | ((byte >> (8 - bitInByte - take)) & ((1U << take) - 1));
+                m_position += take;
+                count -= take;
+            }
+            return static_cast<uint32_t>(value);
+        }
+
+        constexpr void Skip(uint64_t count)
+        {
+            Require(count);
+            m_position += count;
+        }
+
+        /// <summary>
+        /// Reads an unsigned Exp-Golomb code, ue(v).
+        /// </summary>
+        constexpr uint32_t ReadUe()
+        {
+            uint32_t leadingZeros = 0;
+            while (!ReadFlag())
+            {
+                if (++leadingZeros > 31)
+                    throw AppException("Exp-Golomb code is too long");
+            }
+
+            if (leadingZeros == 0)
+                return 0;
+
+            return static_cast<uint32_t>((1ULL << leadingZeros) - 1 + ReadBits(leadingZeros));
+        }
+
+        /// <summary>
+        /// Reads a signed Exp-Golomb code, se(v).
+        /// </summary>
+        constexpr int32_t ReadSe()
+        {
+            const uint32_t codeNum = ReadUe();
+            return (codeNum & 1)
+                ? static_cast<int32_t>((codeNum + 1) / 2)
+                : -static_cast<int32_t>(codeNum / 2);
+        }
+    };
+}
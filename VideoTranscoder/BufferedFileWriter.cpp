@@ -0,0 +1,215 @@
+#include "BufferedFileWriter.hpp"
+#include "AppException.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace application
+{
+    BufferedFileWriter::BufferedFileWriter(const std::string& fileName,
+                                           const WriteBufferOptions& options,
+                                           uint64_t expectedSize)
+        : m_file(fileName)
+        , m_bufferSize(std::max<size_t>(options.bufferSize, 4096))
+        , m_position(0)
+        , m_length(0)
+        , m_closed(false)
+        , m_writing(false)
+        , m_stopping(false)
+    {
+        if (expectedSize != 0)
+            m_file.Preallocate(expectedSize);
+
+        // one buffer is being filled while the others are written:
+        const uint32_t bufferCount = std::max(options.bufferCount, 2U);
+        for (uint32_t idx = 0; idx < bufferCount; ++idx)
+        {
+            auto buffer = std::make_unique<Buffer>();
+            buffer->data = std::make_unique<uint8_t[]>(m_bufferSize);
+            m_freeBuffers.push_back(std::move(buffer));
+        }
+
+        m_writer = std::thread(&BufferedFileWriter::WriteInBackground, this);
+    }
+
+    BufferedFileWriter::~BufferedFileWriter()
+    {
+        try
+        {
+            Close();
+        }
+        catch (AppException&)
+        {
+            // the owner closes explicitly to learn about failures
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_buffersChanged.notify_all();
+        m_writer.join();
+    }
+
+    void BufferedFileWriter::WriteInBackground()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true)
+        {
+            m_buffersChanged.wait(lock, [this]() { return m_stopping || !m_pendingBuffers.empty(); });
+            if (m_pendingBuffers.empty())
+                return;
+
+            std::unique_ptr<Buffer> buffer = std::move(m_pendingBuffers.front());
+            m_pendingBuffers.pop_front();
+            m_writing = true;
+
+            // write outside the lock, so that the muxer goes on filling the next buffer:
+            if (!m_error)
+            {
+                lock.unlock();
+                try
+                {
+                    m_file.Write(buffer->offset, buffer->data.get(), buffer->size);
+                }
+                catch (...)
+                {
+                    lock.lock();
+                    m_error = std::current_exception();
+                    lock.unlock();
+                }
+                lock.lock();
+            }
+
+            m_writing = false;
+            m_freeBuffers.push_back(std::move(buffer));
+            m_buffersChanged.notify_all();
+        }
+    }
+
+    void BufferedFileWriter::ThrowIfFailed()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_error)
+            std::rethrow_exception(m_error);
+    }
+
+    void BufferedFileWriter::SubmitCurrent()
+    {
+        if (!m_current)
+            return;
+
+        if (m_current->size == 0)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_freeBuffers.push_back(std::move(m_current));
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_pendingBuffers.push_back(std::move(m_current));
+        }
+        m_buffersChanged.notify_all();
+    }
+
+    void BufferedFileWriter::StartBuffer()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_buffersChanged.wait(lock, [this]() { return !m_freeBuffers.empty(); });
+        m_current = std::move(m_freeBuffers.back());
+        m_freeBuffers.pop_back();
+        m_current->offset = m_position;
+        m_current->size = 0;
+    }
+
+    void BufferedFileWriter::WaitPendingWrites()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_buffersChanged.wait(lock, [this]() { return m_pendingBuffers.empty() && !m_writing; });
+    }
+
+    void BufferedFileWriter::Write(const void* data, size_t size)
+    {
+        if (m_closed)
+            throw AppException("Cannot write file " + m_file.GetName() + " after closing it");
+
+        ThrowIfFailed();
+
+        auto source = static_cast<const uint8_t*>(data);
+        while (size > 0)
+        {
+            // the current buffer takes writes from its start up to its fill level:
+            if (m_current && (m_position < m_current->offset
+                              || m_position > m_current->offset + m_current->size
+                              || m_position == m_current->offset + m_bufferSize))
+            {
+                SubmitCurrent();
+            }
+
+            if (!m_current)
+                StartBuffer();
+
+            const size_t bufferPos = static_cast<size_t>(m_position - m_current->offset);
+            const size_t chunk = std::min(size, m_bufferSize - bufferPos);
+            memcpy(m_current->data.get() + bufferPos, source, chunk);
+            m_current->size = std::max(m_current->size, bufferPos + chunk);
+
+            source += chunk;
+            size -= chunk;
+            m_position += chunk;
+            m_length = std::max(m_length, m_position);
+        }
+    }
+
+    void BufferedFileWriter::Seek(uint64_t position)
+    {
+        m_position = position;
+    }
+
+    void BufferedFileWriter::SetLength(uint64_t length)
+    {
+        m_length = length;
+    }
+
+    void BufferedFileWriter::Flush()
+    {
+        SubmitCurrent();
+        WaitPendingWrites();
+        ThrowIfFailed();
+    }
+
+    void BufferedFileWriter::Close()
+    {
+        if (m_closed)
+            return;
+
+        m_closed = true;
+
+        // truncate and close even if flushing fails, so that neither the
+        // reserved space nor the handle outlive the first failure:
+        std::exception_ptr error;
+        try
+        {
+            Flush();
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+
+        try
+        {
+            m_file.Truncate(m_length);
+        }
+        catch (...)
+        {
+            if (!error)
+                error = std::current_exception();
+        }
+
+        m_file.Close();
+        if (error)
+            std::rethrow_exception(error);
+    }
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include "OutputFile.hpp"
+
+#include <condition_variable>
+#include <cinttypes>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace application
+{
+    /// <summary>
+    /// How a <see cref="BufferedFileWriter"/> buffers.
+    /// </summary>
+    struct WriteBufferOptions
+    {
+        /// <summary>Size of every buffer, which is how much goes to the file in a single write.</summary>
+        size_t bufferSize = size_t(4) << 20;
+
+        /// <summary>How many buffers there are, which bounds memory and the writes in flight.</summary>
+        uint32_t bufferCount = 4;
+    };
+
+    /// <summary>
+    /// Writes a file through large buffers flushed by a background thread, coalescing
+    /// the small writes of a muxer into few large ones. Seeking back within the current
+    /// buffer (as to patch the size of a box just written) stays in memory.
+    /// </summary>
+    /// <remarks>
+    /// Writes reach the file in the order they were issued. A failure in the background
+    /// surfaces as <see cref="AppException"/> in the next call.
+    /// </remarks>
+    class BufferedFileWriter
+    {
+    private:
+
+        struct Buffer
+        {
+            std::unique_ptr<uint8_t[]> data;
+            uint64_t offset;
+            size_t size;
+        };
+
+        OutputFile m_file;
+        const size_t m_bufferSize;
+
+        uint64_t m_position;
+        uint64_t m_length;
+        bool m_closed;
+
+        /// <summary>The buffer being filled, which starts at its offset in the file.</summary>
+        std::unique_ptr<Buffer> m_current;
+
+        std::vector<std::unique_ptr<Buffer>> m_freeBuffers;
+        std::deque<std::unique_ptr<Buffer>> m_pendingBuffers;
+        bool m_writing;
+        bool m_stopping;
+        std::exception_ptr m_error;
+        std::mutex m_mutex;
+        std::condition_variable m_buffersChanged;
+        std::thread m_writer;
+
+        void WriteInBackground();
+
+        void ThrowIfFailed();
+
+        /// <summary>
+        /// Queues the current buffer for writing, if it has anything.
+        /// </summary>
+        void SubmitCurrent();
+
+        /// <summary>
+        /// Starts a buffer at the current position, waiting for one to be free if needed.
+        /// </summary>
+        void StartBuffer();
+
+        void WaitPendingWrites();
+
+    public:
+
+        /// <summary>
+        /// Creates a file and starts the background writer.
+        /// </summary>
+        /// <param name="fileName">The file to create (UTF-8 encoded), which replaces any existing one.</param>
+        /// <param name="options">How to buffer.</param>
+        /// <param name="expectedSize">
+        /// How large the file is expected to grow, to reserve the space upfront, or zero not to.
+        /// </param>
+        BufferedFileWriter(const std::string& fileName,
+                           const WriteBufferOptions& options,
+                           uint64_t expectedSize = 0);
+
+        /// <summary>
+        /// Closes the file if not closed yet, ignoring failures.
+        /// </summary>
+        ~BufferedFileWriter();
+
+        BufferedFileWriter(const BufferedFileWriter&) = delete;
+        BufferedFileWriter& operator=(const BufferedFileWriter&) = delete;
+
+        uint64_t GetPosition() const
+        {
+            return m_position;
+        }
+
+        /// <summary>
+        /// Gets the length of the file, counting what is still in the buffers.
+        /// </summary>
+        uint64_t GetLength() const
+        {
+            return m_length;
+        }
+
+        /// <summary>
+        /// Writes at the current position, which moves past the data.
+        /// </summary>
+        void Write(const void* data, size_t size);
+
+        void Seek(uint64_t position);
+
+        /// <summary>
+        /// Sets the length of the file, which takes effect when closing.
+        /// </summary>
+        void SetLength(uint64_t length);
+
+        /// <summary>
+        /// Writes everything buffered and waits for it to reach the file.
+        /// </summary>
+        void Flush();
+
+        /// <summary>
+        /// Flushes, truncates the file at its length (releasing the space reserved
+        /// beyond it) and closes it, even if flushing fails. Does nothing if already closed.
+        /// </summary>
+        void Close();
+    };
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cinttypes>
+
+#include <Windows.h>
+#include <Shlwapi.h>
+
+namespace application
+{
+    /// <summary>
+    /// State of an asynchronous read or write of a byte stream,
+    /// carried by the result given back to the caller.
+    /// </summary>
+    class ByteStreamRequest : public IUnknown
+    {
+    private:
+
+        long m_refCount;
+
+    public:
+
+        BYTE* const buffer;
+        const uint64_t offset;
+        const ULONG size;
+        ULONG bytesTransferred;
+
+        ByteStreamRequest(BYTE* buffer, uint64_t offset, ULONG size)
+            : m_refCount(0)
+            , buffer(buffer)
+            , offset(offset)
+            , size(size)
+            , bytesTransferred(0)
+        {
+        }
+
+        virtual ~ByteStreamRequest() = default;
+
+        STDMETHODIMP QueryInterface(REFIID riid, void** ppv)
+        {
+            static const QITAB qit[] =
+            {
+                { &__uuidof(IUnknown), 0 },
+                { 0 }
+            };
+            return QISearch(this, qit, riid, ppv);
+        }
+
+        STDMETHODIMP_(ULONG) AddRef()
+        {
+            return InterlockedIncrement(&m_refCount);
+        }
+
+        STDMETHODIMP_(ULONG) Release()
+        {
+            long refCount = InterlockedDecrement(&m_refCount);
+            if (refCount == 0)
+            {
+                delete this;
+            }
+            return refCount;
+        }
+    };
+}
@@ -0,0 +1,197 @@
+#include "CalibrationProfile.hpp"
+
+#include "AtomicFile.hpp"
+#include "Utf8Path.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace application
+{
+    static const char* const profileHeader = "VideoTranscoder calibration profile 1";
+
+    static constexpr ResolutionClass resolutionClasses[] = {
+        ResolutionClass::SD, ResolutionClass::HD, ResolutionClass::UHD
+    };
+
+    ResolutionClass GetResolutionClass(uint32_t width, uint32_t height)
+    {
+        // by count of samples, so that portrait and cropped frames fall in the expected class:
+        const uint64_t frameSize = static_cast<uint64_t>(width) * height;
+        if (frameSize <= 1024 * 576)
+            return ResolutionClass::SD;
+        if (frameSize <= 1920 * 1080)
+            return ResolutionClass::HD;
+        return ResolutionClass::UHD;
+    }
+
+    const char* GetResolutionClassName(ResolutionClass resolutionClass)
+    {
+        switch (resolutionClass)
+        {
+        case ResolutionClass::SD:
+            return "sd";
+        case ResolutionClass::HD:
+            return "hd";
+        default:
+            return "uhd";
+        }
+    }
+
+    void CalibrationProfile::Record(const CalibrationResult& result)
+    {
+        auto iter = std::find_if(m_results.begin(), m_results.end(),
+            [&result](const CalibrationResult& entry)
+            {
+                return entry.encoder == result.encoder && entry.resolutionClass == result.resolutionClass;
+            });
+
+        if (iter != m_results.end())
+            *iter = result;
+        else
+            m_results.push_back(result);
+    }
+
+    static bool MeetsTarget(const CalibrationResult& result)
+    {
+        // when not measured, the encoder is given the benefit of the doubt:
+        return result.bitrateRatio <= 1.0 + CalibrationProfile::bitrateTolerance;
+    }
+
+    std::optional<Encoder> CalibrationProfile::SelectEncoder(uint32_t width, uint32_t height) const
+    {
+        if (m_results.empty())
+            return std::nullopt;
+
+        // the nearest class with results, the larger one when tied (as it performs more conservatively):
+        const auto wanted = static_cast<int>(GetResolutionClass(width, height));
+        std::optional<ResolutionClass> chosenClass;
+        for (ResolutionClass resolutionClass : resolutionClasses)
+        {
+            const bool hasResults = std::any_of(m_results.begin(), m_results.end(),
+                [resolutionClass](const CalibrationResult& result) { return result.resolutionClass == resolutionClass; });
+
+            if (hasResults && (!chosenClass
+                || std::abs(static_cast<int>(resolutionClass) - wanted)
+                    <= std::abs(static_cast<int>(*chosenClass) - wanted)))
+            {
+                chosenClass = resolutionClass;
+            }
+        }
+
+        const CalibrationResult* best = nullptr;
+        for (const CalibrationResult& result : m_results)
+        {
+            if (result.resolutionClass != *chosenClass)
+                continue;
+
+            if (best == nullptr)
+            {
+                best = &result;
+            }
+            else if (MeetsTarget(result) != MeetsTarget(*best))
+            {
+                if (MeetsTarget(result))
+                    best = &result;
+            }
+            else if (MeetsTarget(result) ? result.framesPerSec > best->framesPerSec
+                                         : result.bitrateRatio < best->bitrateRatio)
+            {
+                best = &result;
+            }
+        }
+
+        return best->encoder;
+    }
+
+    std::string CalibrationProfile::Serialize(const std::string& systemFingerprint) const
+    {
+        std::ostringstream oss;
+        oss << profileHeader << '\n'
+            << "fingerprint\t" << systemFingerprint << '\n';
+
+        for (const CalibrationResult& result : m_results)
+        {
+            oss << "result\t" << GetEncoderName(result.encoder)
+                << '\t' << GetResolutionClassName(result.resolutionClass)
+                << '\t' << result.framesPerSec
+                << '\t' << result.bitrateRatio << '\n';
+        }
+
+        return oss.str();
+    }
+
+    template <typename Type, size_t Count, typename GetName>
+    static std::optional<Type> ParseName(const std::string& name, const Type (&values)[Count], GetName getName)
+    {
+        for (Type value : values)
+        {
+            if (name == getName(value))
+                return value;
+        }
+        return std::nullopt;
+    }
+
+    std::optional<CalibrationProfile> CalibrationProfile::Deserialize(const std::string& text,
+                                                                      const std::string& systemFingerprint)
+    {
+        std::istringstream iss(text);
+        std::string line;
+        if (!std::getline(iss, line) || line != profileHeader)
+            return std::nullopt;
+
+        if (!std::getline(iss, line) || line != "fingerprint\t" + systemFingerprint)
+            return std::nullopt;
+
+        static constexpr Encoder encoders[] = { Encoder::H264_AVC, Encoder::H265_HEVC, Encoder::AV1 };
+
+        CalibrationProfile profile;
+        while (std::getline(iss, line))
+        {
+            std::istringstream fields(line);
+            std::string tag, encoderName, className;
+            CalibrationResult result = {};
+            if (!std::getline(fields, tag, '\t') || tag != "result"
+                || !std::getline(fields, encoderName, '\t')
+                || !std::getline(fields, className, '\t')
+                || !(fields >> result.framesPerSec >> result.bitrateRatio))
+            {
+                return std::nullopt;
+            }
+
+            const auto encoder = ParseName(encoderName, encoders, &GetEncoderName);
+            const auto resolutionClass = ParseName(className, resolutionClasses, &GetResolutionClassName);
+            if (!encoder || !resolutionClass)
+                return std::nullopt;
+
+            result.encoder = *encoder;
+            result.resolutionClass = *resolutionClass;
+            profile.Record(result);
+        }
+
+        return profile;
+    }
+
+    CalibrationProfile LoadCalibrationProfile(const std::string& fileName, const std::string& systemFingerprint)
+    {
+        std::ifstream file(ToPath(fileName), std::ios::binary);
+        if (!file)
+            return CalibrationProfile();
+
+        std::ostringstream content;
+        content << file.rdbuf();
+        return CalibrationProfile::Deserialize(content.str(), systemFingerprint).value_or(CalibrationProfile());
+    }
+
+    void SaveCalibrationProfile(const CalibrationProfile& profile,
+                                const std::string& fileName,
+                                const std::string& systemFingerprint)
+    {
+        std::error_code error;
+        std::filesystem::create_directories(ToPath(fileName).parent_path(), error);
+        WriteFileAtomically(fileName, profile.Serialize(systemFingerprint));
+    }
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "Encoder.hpp"
+
+#include <cinttypes>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace application
+{
+    /// <summary>
+    /// Classes of frame size that encoders perform differently on.
+    /// </summary>
+    enum class ResolutionClass { SD, HD, UHD };
+
+    /// <summary>
+    /// Gets the class of a frame size: SD up to 1024x576, HD up to 1920x1080 and UHD above.
+    /// </summary>
+    ResolutionClass GetResolutionClass(uint32_t width, uint32_t height);
+
+    const char* GetResolutionClassName(ResolutionClass resolutionClass);
+
+    /// <summary>
+    /// What was measured for an encoder on a resolution class.
+    /// </summary>
+    struct CalibrationResult
+    {
+        Encoder encoder;
+        ResolutionClass resolutionClass;
+
+        /// <summary>Encoded frames per second.</summary>
+        double framesPerSec;
+
+        /// <summary>
+        /// Achieved video bitrate as a fraction of the target (above 1 when the
+        /// encoder overshoots), or zero if it could not be measured.
+        /// </summary>
+        double bitrateRatio;
+    };
+
+    /// <summary>
+    /// The encoder benchmarks of this machine, to pick encoders for jobs automatically.
+    /// </summary>
+    class CalibrationProfile
+    {
+    private:
+
+        std::vector<CalibrationResult> m_results;
+
+    public:
+
+        /// <summary>
+        /// How much an encoder can overshoot the target bitrate and still be deemed to meet it.
+        /// </summary>
+        static constexpr double bitrateTolerance = 0.1;
+
+        const std::vector<CalibrationResult>& GetResults() const
+        {
+            return m_results;
+        }
+
+        bool IsEmpty() const
+        {
+            return m_results.empty();
+        }
+
+        /// <summary>
+        /// Records a result, replacing the previous one for the same encoder and resolution class.
+        /// </summary>
+        void Record(const CalibrationResult& result);
+
+        /// <summary>
+        /// Picks the fastest encoder that meets the size target for a frame size, or else the
+        /// one closest to meet it. A resolution class without results takes the nearest one.
+        /// </summary>
+        /// <returns>The encoder, or nothing if the profile is empty.</returns>
+        std::optional<Encoder> SelectEncoder(uint32_t width, uint32_t height) const;
+
+        /// <summary>
+        /// Serializes the profile for a file.
+        /// </summary>
+        /// <param name="systemFingerprint">Identifies the OS and drivers the profile is valid for.</param>
+        std::string Serialize(const std::string& systemFingerprint) const;
+
+        /// <summary>
+        /// Deserializes the profile from the content of a file.
+        /// </summary>
+        /// <returns>The profile, or nothing if the content is malformed or for another fingerprint.</returns>
+        static std::optional<CalibrationProfile> Deserialize(const std::string& text,
+                                                             const std::string& systemFingerprint);
+    };
+
+    /// <summary>
+    /// Loads the calibration profile of this machine.
+    /// </summary>
+    /// <param name="fileName">The profile file (UTF-8 encoded).</param>
+    /// <param name="systemFingerprint">Identifies the OS and drivers in the machine.</param>
+    /// <returns>The profile, which is empty if missing or stale (measured with other OS or drivers).</returns>
+    CalibrationProfile LoadCalibrationProfile(const std::string& fileName, const std::string& systemFingerprint);
+
+    /// <summary>
+    /// Saves the calibration profile of this machine (atomically).
+    /// </summary>
+    /// <param name="profile">The profile.</param>
+    /// <param name="fileName">The profile file (UTF-8 encoded).</param>
+    /// <param name="systemFingerprint">Identifies the OS and drivers in the machine.</param>
+    void SaveCalibrationProfile(const CalibrationProfile& profile,
+                                const std::string& fileName,
+                                const std::string& systemFingerprint);
+}
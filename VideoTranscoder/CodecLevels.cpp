@@ -0,0 +1,153 @@
+#include "CodecLevels.hpp"
+
+#include <array>
+#include <cmath>
+
+namespace application
+{
+    /// <summary>
+    /// The limits of a level, in units of samples (not macroblocks) for both codecs.
+    /// </summary>
+    struct LevelLimits
+    {
+        uint32_t level;
+        const char* name;
+
+        /// <summary>Maximum picture size in luma samples.</summary>
+        uint64_t maxLumaPictureSize;
+
+        /// <summary>Maximum luma sample rate (samples/s).</summary>
+        uint64_t maxLumaSampleRate;
+
+        /// <summary>Maximum bitrate in units of 1000 bits/s (before the profile factor).</summary>
+        uint64_t maxBitrate;
+    };
+
+    // H.264 Table A-1, with MaxFS and MaxMBPS converted from macroblocks to samples:
+    static constexpr auto h264Levels = std::to_array<LevelLimits>({
+        { 10, "1",       99 * 256ULL,      1485 * 256ULL,     64 },
+        { 11, "1.1",    396 * 256ULL,      3000 * 256ULL,    192 },
+        { 12, "1.2",    396 * 256ULL,      6000 * 256ULL,    384 },
+        { 13, "1.3",    396 * 256ULL,     11880 * 256ULL,    768 },
+        { 20, "2",      396 * 256ULL,     11880 * 256ULL,   2000 },
+        { 21, "2.1",    792 * 256ULL,     19800 * 256ULL,   4000 },
+        { 22, "2.2",   1620 * 256ULL,     20250 * 256ULL,   4000 },
+        { 30, "3",     1620 * 256ULL,     40500 * 256ULL,  10000 },
+        { 31, "3.1",   3600 * 256ULL,    108000 * 256ULL,  14000 },
+        { 32, "3.2",   5120 * 256ULL,    216000 * 256ULL,  20000 },
+        { 40, "4",     8192 * 256ULL,    245760 * 256ULL,  20000 },
+        { 41, "4.1",   8192 * 256ULL,    245760 * 256ULL,  50000 },
+        { 42, "4.2",   8704 * 256ULL,    522240 * 256ULL,  50000 },
+        { 50, "5",    22080 * 256ULL,    589824 * 256ULL, 135000 },
+        { 51, "5.1",  36864 * 256ULL,    983040 * 256ULL, 240000 },
+        { 52, "5.2",  36864 * 256ULL,   2073600 * 256ULL, 240000 },
+        { 60, "6",   139264 * 256ULL,   4177920 * 256ULL, 240000 },
+        { 61, "6.1", 139264 * 256ULL,   8355840 * 256ULL, 480000 },
+        { 62, "6.2", 139264 * 256ULL,  16711680 * 256ULL, 800000 },
+    });
+
+    // HEVC Table A.8 (general limits) and A.9 (main tier):
+    static constexpr auto hevcLevels = std::to_array<LevelLimits>({
+        {  30, "1",     36864,      552960,    128 },
+        {  60, "2",    122880,     3686400,   1500 },
+        {  63, "2.1",  245760,     7372800,   3000 },
+        {  90, "3",    552960,    16588800,   6000 },
+        {  93, "3.1",  983040,    33177600,  10000 },
+        { 120, "4",   2228224,    66846720,  12000 },
+        { 123, "4.1", 2228224,   133693440,  20000 },
+        { 150, "5",   8912896,   267386880,  25000 },
+        { 153, "5.1", 8912896,   534773760,  40000 },
+        { 156, "5.2", 8912896,  1069547520,  60000 },
+        { 180, "6",  35651584,  1069547520,  60000 },
+        { 183, "6.1", 35651584, 2139095040, 120000 },
+        { 186, "6.2", 35651584, 4278190080, 240000 },
+    });
+
+    /// <summary>
+    /// Factor of the maximum bitrate for the profile the encoder is set to, on the video coding layer
+    /// because that is what the rate control of the encoder is set for: cpbBrVclFactor of H.264 High
+    /// (Table A-2, whose cpbBrNalFactor of 1500 would also admit the overhead of the NAL units)
+    /// and CpbBrVclFactor of HEVC Main/Main 10 (Table A.10).
+    /// </summary>
+    static uint64_t GetBitrateFactor(Encoder codec)
+    {
+        return codec == Encoder::H264_AVC ? 1250 : 1000;
+    }
+
+    template <size_t Count>
+    static const LevelLimits* FindLevel(const std::array<LevelLimits, Count>& levels,
+                                        uint64_t bitrateFactor,
+                                        const LevelDemand& demand,
+                                        uint32_t codedWidth,
+                                        uint32_t codedHeight)
+    {
+        const uint64_t pictureSize = static_cast<uint64_t>(codedWidth) * codedHeight;
+        const auto sampleRate = static_cast<uint64_t>(std::ceil(pictureSize * demand.frameRate));
+
+        for (const LevelLimits& limits : levels)
+        {
+            // neither dimension may exceed sqrt(8 * MaxFS), so that very thin pictures are excluded:
+            const auto maxDimension = static_cast<uint64_t>(std::sqrt(8.0 * limits.maxLumaPictureSize));
+
+            if (pictureSize <= limits.maxLumaPictureSize
+                && codedWidth <= maxDimension
+                && codedHeight <= maxDimension
+                && sampleRate <= limits.maxLumaSampleRate
+                && demand.maxBitrate <= limits.maxBitrate * bitrateFactor)
+            {
+                return &limits;
+            }
+        }
+
+        return nullptr;
+    }
+
+    static uint32_t RoundUp(uint32_t value, uint32_t multiple)
+    {
+        return (value + multiple - 1) / multiple * multiple;
+    }
+
+    uint32_t SelectCodecLevel(Encoder codec, const LevelDemand& demand)
+    {
+        const LevelLimits* limits = nullptr;
+        switch (codec)
+        {
+        case Encoder::H264_AVC: // coded in whole macroblocks
+            limits = FindLevel(h264Levels, GetBitrateFactor(codec), demand,
+                RoundUp(demand.width, 16), RoundUp(demand.height, 16));
+            break;
+
+        case Encoder::H265_HEVC: // coded in whole minimum coding blocks (8x8)
+            limits = FindLevel(hevcLevels, GetBitrateFactor(codec), demand,
+                RoundUp(demand.width, 8), RoundUp(demand.height, 8));
+            break;
+
+        default:
+            break;
+        }
+
+        return limits ? limits->level : 0;
+    }
+
+    const char* GetCodecLevelName(Encoder codec, uint32_t level)
+    {
+        if (codec == Encoder::H264_AVC)
+        {
+            for (const LevelLimits& limits : h264Levels)
+            {
+                if (limits.level == level)
+                    return limits.name;
+            }
+        }
+        else if (codec == Encoder::H265_HEVC)
+        {
+            for (const LevelLimits& limits : hevcLevels)
+            {
+                if (limits.level == level)
+                    return limits.name;
+            }
+        }
+
+        return "unknown";
+    }
+}
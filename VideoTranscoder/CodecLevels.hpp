@@ -0,0 +1,39 @@
+#pragma once
+
+#include "Encoder.hpp"
+
+#include <cinttypes>
+
+namespace application
+{
+    /// <summary>
+    /// What a stream demands from a decoder, to be checked against the limits of the codec levels.
+    /// </summary>
+    struct LevelDemand
+    {
+        uint32_t width;
+        uint32_t height;
+        double frameRate;
+
+        /// <summary>The highest bitrate the encoder may reach (bits/s).</summary>
+        uint32_t maxBitrate;
+    };
+
+    /// <summary>
+    /// Selects the lowest level of the codec whose limits (frame size, sample rate
+    /// and bitrate, as in H.264 Table A-1 and HEVC Table A.8/A.9 in main tier) admit the stream.
+    /// </summary>
+    /// <param name="codec">The codec of the output.</param>
+    /// <param name="demand">What the stream demands.</param>
+    /// <returns>
+    /// The level as coded in the bitstream (level_idc for H.264, general_level_idc for HEVC),
+    /// which is also how Media Foundation enumerates them, or zero if the codec has no levels
+    /// or none of them admits the stream.
+    /// </returns>
+    uint32_t SelectCodecLevel(Encoder codec, const LevelDemand& demand);
+
+    /// <summary>
+    /// Formats a level in the notation of the spec, such as "4.1".
+    /// </summary>
+    const char* GetCodecLevelName(Encoder codec, uint32_t level);
+}
@@ -1,5 +1,6 @@
 #include "stdafx.h"
 #include "CommandLineParsing.hpp"
+#include "EncoderSelection.hpp"
 #include <CLI11/CLI11.hpp>
 
 #include <iostream>
@@ -12,14 +13,140 @@ namespace application
     {
         CLI::App app("Hardware accelerated video transcoder");
 
-        app.add_option("-i,--input", params.inputFName, "Input video file")->required();
-        app.add_option("-o,--output", params.outputFName, "Output MP4 file")->required();
+        auto inputOption =
+            app.add_option("-i,--input", params.inputFName, "Input video file");
+
+        app.add_option("-o,--output", params.outputFName,
+            "Output MP4 file (or output directory in batch mode)");
+
+        auto batchOption =
+            app.add_option("-b,--batch", params.batchSource,
+                "Batch of input files: a directory, a wildcard pattern or a manifest"
+                " file with lines 'input' or 'input|output'")
+            ->excludes(inputOption);
+
+        params.maxParallelJobs = 0;
+        app.add_option("-j,--jobs", params.maxParallelJobs,
+            "Max count of concurrent jobs in batch mode or segments (default is automatic)")
+            ->check(CLI::Range(0, 64));
+
+        params.segmentCount = 1;
+        auto segmentsOption =
+            app.add_option("-s,--segments", params.segmentCount,
+            "Split the input at key frames in this many segments transcoded concurrently")
+            ->check(CLI::Range(1, 64))
+            ->excludes(batchOption);
+
+        params.sizeTolerancePct = 0.0;
+        app.add_option("--size-tolerance", params.sizeTolerancePct,
+            "Restart or re-encode the segments whose size exceeds the target by more than this percentage")
+            ->check(CLI::Range(1.0, 50.0))
+            ->needs(segmentsOption);
+
+        params.sizeGuardPct = 0.0;
+        auto sizeGuardOption =
+            app.add_option("--size-guard", params.sizeGuardPct,
+                "Abort a job once its projected output size exceeds the target by more than this percentage")
+            ->check(CLI::Range(1.0, 100.0))
+            ->excludes(segmentsOption);
+
+        params.sizeRetune = false;
+        app.add_flag("--retune", params.sizeRetune,
+            "Restart a job aborted by --size-guard with the target corrected by how much it overshot")
+            ->needs(sizeGuardOption);
+
+        params.fragmentSecs = 0.0;
+        app.add_option("-f,--fragment", params.fragmentSecs,
+            "Write fragmented MP4 (CMAF) with fragments of this many seconds")
+            ->check(CLI::Range(0.5, 60.0))
+            ->excludes(segmentsOption);
+
+        params.predictExcerpts = 0;
+        auto predictOption =
+            app.add_option("--predict", params.predictExcerpts,
+                "Encode this many short excerpts first, to predict size and time and correct the"
+                " bitrate before the full encode")
+            ->check(CLI::Range(2, 16));
+
+        params.timeBudgetMins = 0.0;
+        app.add_option("--time-budget", params.timeBudgetMins,
+            "Minutes a job should take at most: jobs predicted to take longer trade quality for speed")
+            ->check(CLI::PositiveNumber)
+            ->needs(predictOption);
+
+        params.faststart = false;
+        app.add_flag("--faststart", params.faststart,
+            "Move the movie header in front of the media data (in place) for playback over HTTP");
+
+        params.writeBufferMB = 4;
+        app.add_option("--write-buffer", params.writeBufferMB,
+            "Size (MB) of the buffers that coalesce the writes to the output in large ones (default is 4)")
+            ->check(CLI::Range(1, 256));
+
+        params.readAheadMB = 16;
+        app.add_option("--read-ahead", params.readAheadMB,
+            "How far (MB) to read ahead of the demuxer in the input, for slow or network storage"
+            " (default is 16, zero turns it off)")
+            ->check(CLI::Range(0, 512));
+
+        params.readAheadMemoryMB = 32;
+        app.add_option("--read-ahead-memory", params.readAheadMemoryMB,
+            "Memory (MB) that reading ahead takes at most per input (default is 32)")
+            ->check(CLI::Range(2, 1024));
+
+        auto outputCacheOption =
+            app.add_option("--output-cache", params.outputCacheDir,
+                "Keep the outputs in this directory, keyed by the content of the input and the parameters,"
+                " so that a job done before takes its output from there instead of transcoding")
+            ->excludes(segmentsOption);
+
+        params.outputCacheGB = 50;
+        app.add_option("--output-cache-size", params.outputCacheGB,
+            "Disk space (GB) the output cache takes at most, dropping the outputs used least recently"
+            " (default is 50)")
+            ->check(CLI::Range(1, 65536))
+            ->needs(outputCacheOption);
+
+        params.outputCacheDays = 30;
+        app.add_option("--output-cache-age", params.outputCacheDays,
+            "Days an output is kept in the cache since it was last used (default is 30)")
+            ->check(CLI::Range(1, 3650))
+            ->needs(outputCacheOption);
+
+        app.add_option("--audio-lang", params.streamSelection.audioLanguage,
+            "Preferred language of the audio track to keep (such as 'en' or 'deu')");
+
+        app.add_option("--audio-track", params.streamSelection.audioTrack,
+            "Zero-based index of the audio track to keep (overrides --audio-lang)");
+
+        app.add_option("--progress-json", params.progressJsonFName,
+            "Write progress samples of every job to this file as JSON lines");
+
+        app.add_option("--metrics-file", params.metricsFName,
+            "Keep the latest metrics of every job in this file (Prometheus text format)");
+
+        auto reportOption =
+            app.add_option("--report", params.reportPath,
+                "Write a JSON report of every job, next to the output or in the given"
+                " file (or directory in batch mode)")
+            ->expected(0, 1);
+
+        params.simulate = false;
+        app.add_flag("--simulate", params.simulate,
+            "Dry run with a simulated media backend (no media is transcoded)");
+
+        params.calibrate = false;
+        app.add_flag("--calibrate", params.calibrate,
+            "Benchmark the encoders on a sample of the input, for '-e auto' to pick the fastest"
+            " that meets the size target")
+            ->excludes(batchOption)
+            ->excludes(segmentsOption);
 
         std::string encoderName;
         app.add_option("-e,--encoder", encoderName,
-            "Video encoder to use (from Microsoft Media Foundation)")
-            ->required()
-            ->check(CLI::IsMember({ "hevc", "h264", "av1"}));
+            "Video encoder to use (from Microsoft Media Foundation), or 'auto' to select per job"
+            " from the calibration of this machine")
+            ->check(CLI::IsMember({ "hevc", "h264", "av1", "auto" }));
 
         app.add_option("-t,--tsf", params.tgtSize, "Target size factor")
             ->required()
@@ -38,16 +165,77 @@ namespace application
             return false;
         };
 
-        std::cout << std::endl << std::setw(25) << "input = " << params.inputFName;
+        params.writeReport = reportOption->count() > 0;
+
+        if (params.inputFName.empty() && params.batchSource.empty())
+        {
+            std::cout << "Either --input or --batch is required" << std::endl << std::endl;
+            return false;
+        }
+
+        // calibration writes no output and benchmarks every encoder:
+        if (!params.calibrate && params.outputFName.empty())
+        {
+            std::cout << "--output is required" << std::endl << std::endl;
+            return false;
+        }
+
+        if (!params.calibrate && encoderName.empty())
+        {
+            std::cout << "--encoder is required" << std::endl << std::endl;
+            return false;
+        }
+
+        if (params.calibrate)
+        {
+            std::cout << std::endl << std::setw(25) << "calibrate with = " << params.inputFName
+                << std::endl << std::setw(25) << "target size factor = " << params.tgtSize
+                << std::endl;
+
+            params.encoder = EncoderSelection::fallbackEncoder;
+            params.autoEncoder = false;
+            return true;
+        }
+
+        if (params.IsBatch())
+            std::cout << std::endl << std::setw(25) << "batch = " << params.batchSource;
+        else
+            std::cout << std::endl << std::setw(25) << "input = " << params.inputFName;
+
+        if (params.segmentCount > 1)
+            std::cout << std::endl << std::setw(25) << "segments = " << params.segmentCount;
+
+        if (params.sizeTolerancePct > 0.0)
+            std::cout << std::endl << std::setw(25) << "size tolerance = " << params.sizeTolerancePct << " %";
+
+        if (params.sizeGuardPct > 0.0)
+        {
+            std::cout << std::endl << std::setw(25) << "size guard = " << params.sizeGuardPct << " %"
+                << (params.sizeRetune ? " (retune)" : " (abort)");
+        }
+
+        if (params.fragmentSecs > 0.0)
+            std::cout << std::endl << std::setw(25) << "fragment = " << params.fragmentSecs << " s";
+
+        if (params.predictExcerpts > 0)
+            std::cout << std::endl << std::setw(25) << "predict = " << params.predictExcerpts << " excerpts";
+
+        if (params.timeBudgetMins > 0.0)
+            std::cout << std::endl << std::setw(25) << "time budget = " << params.timeBudgetMins << " min";
+
         std::cout << std::endl << std::setw(25) << "output = " << params.outputFName;
         std::cout << std::endl << std::setw(25) << "encoder = " << encoderName;
 
+        // automatic selection is resolved per job, this is what it falls back to:
+        params.autoEncoder = (encoderName == "auto");
         if (encoderName == "h264")
             params.encoder = Encoder::H264_AVC;
         else if (encoderName == "hevc")
             params.encoder = Encoder::H265_HEVC;
         else if (encoderName == "av1")
             params.encoder = Encoder::AV1;
+        else if (params.autoEncoder)
+            params.encoder = EncoderSelection::fallbackEncoder;
         else
             _ASSERTE(false);
 
@@ -1,6 +1,13 @@
 #pragma once
 
+#include "BufferedFileWriter.hpp"
 #include "Encoder.hpp"
+#include "OutputCache.hpp"
+#include "ReadAheadReader.hpp"
+#include "StreamSelection.hpp"
+
+#include <chrono>
+#include <cinttypes>
 #include <string>
 
 namespace application
@@ -8,9 +15,108 @@ namespace application
     struct CmdLineParams
     {
         Encoder encoder;
+
+        /// <summary>Whether the encoder is selected per job from the calibration of this machine.</summary>
+        bool autoEncoder;
+
+        /// <summary>Whether to calibrate the encoders with the input as sample, instead of transcoding.</summary>
+        bool calibrate;
+
         double tgtSize;
         std::string inputFName;
         std::string outputFName;
+        std::string batchSource;
+        uint32_t maxParallelJobs;
+        uint32_t segmentCount;
+        double fragmentSecs;
+
+        /// <summary>
+        /// How much (percent) a segment may exceed the target bitrate before it is
+        /// re-encoded with a corrected one, or zero not to control segment sizes.
+        /// </summary>
+        double sizeTolerancePct;
+
+        /// <summary>
+        /// How much (percent) the projected output size may exceed the target before
+        /// a job is aborted, or zero not to guard the size of jobs.
+        /// </summary>
+        double sizeGuardPct;
+
+        /// <summary>Whether a job aborted for size is restarted with a corrected target.</summary>
+        bool sizeRetune;
+
+        /// <summary>How many excerpts to encode for a prediction before every job, or zero for none.</summary>
+        uint32_t predictExcerpts;
+
+        /// <summary>How many minutes a job is expected to take at most, or zero for no limit.</summary>
+        double timeBudgetMins;
+        StreamSelectionPolicy streamSelection;
+        std::string progressJsonFName;
+        std::string metricsFName;
+        bool faststart;
+
+        /// <summary>Size (MB) of the buffers the output files are written through.</summary>
+        uint32_t writeBufferMB;
+
+        /// <summary>How far (MB) to read ahead of the demuxer in the inputs, or zero not to.</summary>
+        uint32_t readAheadMB;
+
+        /// <summary>How much memory (MB) reading ahead takes at most per input.</summary>
+        uint32_t readAheadMemoryMB;
+
+        /// <summary>Where the outputs are kept to be reused by jobs done again, or empty not to.</summary>
+        std::string outputCacheDir;
+        uint32_t outputCacheGB;
+        uint32_t outputCacheDays;
+        bool writeReport;
+        std::string reportPath;
+        bool simulate;
+
+        std::chrono::milliseconds GetFragmentDuration() const
+        {
+            return std::chrono::milliseconds(static_cast<int64_t>(fragmentSecs * 1000));
+        }
+
+        std::chrono::seconds GetTimeBudget() const
+        {
+            return std::chrono::seconds(static_cast<int64_t>(timeBudgetMins * 60));
+        }
+
+        WriteBufferOptions GetWriteBufferOptions() const
+        {
+            WriteBufferOptions options;
+            options.bufferSize = size_t(writeBufferMB) << 20;
+            return options;
+        }
+
+        ReadAheadOptions GetReadAheadOptions() const
+        {
+            ReadAheadOptions options;
+            options.window = uint64_t(readAheadMB) << 20;
+            options.memoryCap = uint64_t(readAheadMemoryMB) << 20;
+            return options;
+        }
+
+        OutputCacheLimits GetOutputCacheLimits() const
+        {
+            OutputCacheLimits limits;
+            limits.maxSize = uint64_t(outputCacheGB) << 30;
+            limits.maxAge = std::chrono::hours(24 * outputCacheDays);
+            return limits;
+        }
+
+        /// <summary>
+        /// Whether the jobs go through the output cache, which is never the case in a dry run.
+        /// </summary>
+        bool UseOutputCache() const
+        {
+            return !outputCacheDir.empty() && !simulate;
+        }
+
+        bool IsBatch() const
+        {
+            return !batchSource.empty();
+        }
     };
 
     bool ParseCommandLineArgs(int argc, char* argv[], CmdLineParams& params);
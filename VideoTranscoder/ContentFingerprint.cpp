@@ -0,0 +1,141 @@
+#include "ContentFingerprint.hpp"
+#include "InputFile.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+namespace application
+{
+    static constexpr uint64_t prime1 = 11400714785074694791ULL;
+    static constexpr uint64_t prime2 = 14029467366897019727ULL;
+    static constexpr uint64_t prime3 = 1609587929392839161ULL;
+    static constexpr uint64_t prime4 = 9650029242287828579ULL;
+    static constexpr uint64_t prime5 = 2870177450012600261ULL;
+
+    static uint64_t RotateLeft(uint64_t value, int bits)
+    {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+    static uint64_t Read64(const uint8_t* data)
+    {
+        uint64_t value;
+        memcpy(&value, data, sizeof value);
+        return value;
+    }
+
+    static uint32_t Read32(const uint8_t* data)
+    {
+        uint32_t value;
+        memcpy(&value, data, sizeof value);
+        return value;
+    }
+
+    static uint64_t Round(uint64_t accumulator, uint64_t input)
+    {
+        accumulator += input * prime2;
+        return RotateLeft(accumulator, 31) * prime1;
+    }
+
+    static uint64_t MergeRound(uint64_t hash, uint64_t accumulator)
+    {
+        hash ^= Round(0, accumulator);
+        return hash * prime1 + prime4;
+    }
+
+    uint64_t XxHash64(const void* data, size_t size, uint64_t seed)
+    {
+        auto input = static_cast<const uint8_t*>(data);
+        const uint8_t* const end = input + size;
+
+        uint64_t hash;
+        if (size >= 32)
+        {
+            uint64_t acc1 = seed + prime1 + prime2;
+            uint64_t acc2 = seed + prime2;
+            uint64_t acc3 = seed;
+            uint64_t acc4 = seed - prime1;
+            for (; end - input >= 32; input += 32)
+            {
+                acc1 = Round(acc1, Read64(input));
+                acc2 = Round(acc2, Read64(input + 8));
+                acc3 = Round(acc3, Read64(input + 16));
+                acc4 = Round(acc4, Read64(input + 24));
+            }
+
+            hash = RotateLeft(acc1, 1) + RotateLeft(acc2, 7) + RotateLeft(acc3, 12) + RotateLeft(acc4, 18);
+            hash = MergeRound(hash, acc1);
+            hash = MergeRound(hash, acc2);
+            hash = MergeRound(hash, acc3);
+            hash = MergeRound(hash, acc4);
+        }
+        else
+            hash = seed + prime5;
+
+        hash += size;
+
+        for (; end - input >= 8; input += 8)
+            hash = RotateLeft(hash ^ Round(0, Read64(input)), 27) * prime1 + prime4;
+
+        if (end - input >= 4)
+        {
+            hash = RotateLeft(hash ^ (Read32(input) * prime1), 23) * prime2 + prime3;
+            input += 4;
+        }
+
+        for (; input < end; ++input)
+            hash = RotateLeft(hash ^ (*input * prime5), 11) * prime1;
+
+        hash ^= hash >> 33;
+        hash *= prime2;
+        hash ^= hash >> 29;
+        hash *= prime3;
+        hash ^= hash >> 32;
+        return hash;
+    }
+
+    /// <summary>Size of every sampled block.</summary>
+    static constexpr size_t sampleSize = 64 * 1024;
+
+    /// <summary>How many blocks are sampled between head and tail.</summary>
+    static constexpr uint64_t strideCount = 16;
+
+    std::string FingerprintFile(const std::string& fileName)
+    {
+        const InputFile file(fileName, AccessPattern::Random);
+        const uint64_t fileSize = file.GetSize();
+
+        // small files are hashed whole, the others by head, strided blocks and tail:
+        std::vector<uint64_t> offsets;
+        if (fileSize <= (strideCount + 2) * sampleSize)
+        {
+            for (uint64_t offset = 0; offset < fileSize; offset += sampleSize)
+                offsets.push_back(offset);
+        }
+        else
+        {
+            const uint64_t stride = (fileSize - sampleSize) / (strideCount + 1);
+            for (uint64_t idx = 0; idx <= strideCount; ++idx)
+                offsets.push_back(idx * stride);
+
+            offsets.push_back(fileSize - sampleSize);
+        }
+
+        // two chains of distinct seeds, for 128 bits:
+        uint64_t hashes[2] = { XxHash64(&fileSize, sizeof fileSize, 0), XxHash64(&fileSize, sizeof fileSize, prime3) };
+        std::vector<uint8_t> block(sampleSize);
+        for (uint64_t offset : offsets)
+        {
+            const size_t length = file.Read(offset, block.data(), block.size());
+            for (uint64_t& hash : hashes)
+                hash = XxHash64(block.data(), length, hash);
+        }
+
+        std::ostringstream oss;
+        oss << std::hex << std::setfill('0') << std::setw(16) << hashes[0] << std::setw(16) << hashes[1];
+        return oss.str();
+    }
+}
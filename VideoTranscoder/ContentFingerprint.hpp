@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cinttypes>
+#include <cstddef>
+#include <string>
+
+namespace application
+{
+    /// <summary>
+    /// Computes the 64-bit hash XXH64 of a buffer.
+    /// </summary>
+    uint64_t XxHash64(const void* data, size_t size, uint64_t seed = 0);
+
+    /// <summary>
+    /// Fingerprints the content of a file without reading all of it, by hashing its size with
+    /// blocks sampled at the head, at the tail and at regular strides in between.
+    /// </summary>
+    /// <param name="fileName">The file (UTF-8 encoded).</param>
+    /// <returns>128 bits of fingerprint, as 32 hexadecimal digits.</returns>
+    /// <remarks>
+    /// An edit that leaves the size as it is and misses all sampled blocks goes unnoticed,
+    /// which is not the case of a media file encoded anew.
+    /// Throws <see cref="AppException"/> on failure.
+    /// </remarks>
+    std::string FingerprintFile(const std::string& fileName);
+}
@@ -3,4 +3,20 @@
 namespace application
 {
 	enum class Encoder { H264_AVC, H265_HEVC, AV1 };
-}
\ No newline at end of file
+
+	/// <summary>
+	/// Gets the name of the encoder as given in the command line.
+	/// </summary>
+	inline const char* GetEncoderName(Encoder encoder)
+	{
+		switch (encoder)
+		{
+		case Encoder::H264_AVC:
+			return "h264";
+		case Encoder::H265_HEVC:
+			return "hevc";
+		default:
+			return "av1";
+		}
+	}
+}
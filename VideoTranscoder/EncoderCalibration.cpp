@@ -0,0 +1,197 @@
+#include "EncoderCalibration.hpp"
+
+#include "CalibrationProfile.hpp"
+#include "Mp4Probe.hpp"
+#include "ProgressSubscribers.hpp"
+#include "TranscodeJob.hpp"
+#include "Utf8Path.hpp"
+
+#include <MinCppXtra/traceable_exception.hpp>
+
+#include <algorithm>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <optional>
+
+namespace application
+{
+    using namespace std::chrono;
+
+    PresentationRange PickCalibrationSample(
+        const std::vector<nanoseconds>& keyframeTimes,
+        nanoseconds duration,
+        nanoseconds sampleDuration)
+    {
+        if (duration <= sampleDuration)
+            return PresentationRange{ nanoseconds(0), duration };
+
+        // the last key frame not after a third of the presentation:
+        nanoseconds start(0);
+        auto iter = std::upper_bound(keyframeTimes.begin(), keyframeTimes.end(), duration / 3);
+        if (iter != keyframeTimes.begin())
+            start = *std::prev(iter);
+
+        start = std::min(start, duration - sampleDuration);
+        return PresentationRange{ start, start + sampleDuration };
+    }
+
+    std::string GetCalibrationProfileFName(const MediaBackend& backend)
+    {
+        return backend.GetDataDirectory() + "/calibration.profile";
+    }
+
+    EncoderSelection GetEncoderSelection(MediaBackend& backend, const CmdLineParams& params)
+    {
+        if (!params.autoEncoder)
+            return EncoderSelection(params.encoder);
+
+        auto profile = std::make_shared<CalibrationProfile>(LoadCalibrationProfile(
+            GetCalibrationProfileFName(backend), backend.GetEncoderRegistry().GetSystemFingerprint()));
+
+        if (profile->IsEmpty())
+        {
+            std::cout << std::endl
+                << "The encoders of this machine have not been calibrated (or drivers have changed),"
+                << " run with --calibrate to have them selected automatically. Falling back to "
+                << GetEncoderName(EncoderSelection::fallbackEncoder) << std::endl;
+        }
+
+        return EncoderSelection(std::move(profile));
+    }
+
+    /// <summary>
+    /// How long the sample of the input is.
+    /// </summary>
+    static constexpr seconds calibrationSampleDuration(10);
+
+    /// <summary>
+    /// Benchmarks an encoder on the sample.
+    /// </summary>
+    /// <returns>The result, or nothing if the sample would be copied rather than encoded.</returns>
+    static std::optional<CalibrationResult> BenchmarkEncoder(MediaBackend& backend,
+                                                             const CmdLineParams& params,
+                                                             Encoder encoder,
+                                                             const PresentationRange& range,
+                                                             const std::string& outputFName)
+    {
+        CalibrationResult result = {};
+        result.encoder = encoder;
+        uint32_t targetBitrate;
+        {
+            // declared before the job, so that it outlives the job:
+            ProgressHub progressHub;
+            auto keeper = std::make_shared<LastSampleKeeper>();
+            progressHub.Subscribe(keeper);
+
+            TranscodeJob job(backend, params.inputFName, outputFName, encoder, params.tgtSize, range);
+            if (job.GetSettings().streamCopy)
+                return std::nullopt;
+
+            job.Track(progressHub, GetEncoderName(encoder), milliseconds(100));
+            job.Start();
+
+            while (!job.Wait(hours(1)))
+                continue;
+
+            progressHub.Flush();
+            const ProgressSample lastSample =
+                keeper->GetLastSample(GetEncoderName(encoder)).value_or(ProgressSample{});
+
+            const auto& videoProfile = job.GetSourceInfo().videoProfile;
+            result.resolutionClass = GetResolutionClass(videoProfile.frameSize.width, videoProfile.frameSize.height);
+
+            const double elapsedSecs = duration<double>(lastSample.elapsedTime).count();
+            const double mediaSecs = duration<double>(range.stop - range.start).count();
+            if (videoProfile.frameRate.denominator != 0 && elapsedSecs > 0.0)
+            {
+                result.framesPerSec = mediaSecs * videoProfile.frameRate.numerator
+                    / videoProfile.frameRate.denominator / elapsedSecs;
+            }
+
+            targetBitrate = job.GetSettings().videoAvgBitrate;
+        }
+
+        // probed once the job has closed the output:
+        const auto achievedBitrate = ProbeVideoBitrate(outputFName);
+        if (achievedBitrate && targetBitrate != 0)
+            result.bitrateRatio = (double)*achievedBitrate / targetBitrate;
+
+        return result;
+    }
+
+    bool RunEncoderCalibration(MediaBackend& backend, const CmdLineParams& params)
+    {
+        PresentationRange range;
+        {
+            auto input = backend.OpenInput(params.inputFName);
+            range = PickCalibrationSample(input->GetKeyframeTimes(), input->GetDuration(), calibrationSampleDuration);
+        }
+
+        const EncoderRegistry& registry = backend.GetEncoderRegistry();
+        const std::string profileFName = GetCalibrationProfileFName(backend);
+        CalibrationProfile profile = LoadCalibrationProfile(profileFName, registry.GetSystemFingerprint());
+
+        std::error_code error;
+        std::filesystem::create_directories(ToPath(backend.GetDataDirectory()), error);
+
+        std::cout << std::endl
+            << "Benchmarking the encoders on " << duration_cast<seconds>(range.stop - range.start).count()
+            << " seconds of the input" << std::endl << std::endl;
+
+        bool calibrated = false;
+        for (Encoder encoder : { Encoder::H264_AVC, Encoder::H265_HEVC, Encoder::AV1 })
+        {
+            // without enumeration, every encoder is tried and the missing ones just fail:
+            if (!registry.GetEncoders().empty() && !registry.Knows(encoder))
+            {
+                std::cout << "  " << GetEncoderName(encoder) << ": not installed" << std::endl;
+                continue;
+            }
+
+            const std::string outputFName =
+                backend.GetDataDirectory() + "/calibration." + GetEncoderName(encoder) + ".mp4";
+            try
+            {
+                const auto result = BenchmarkEncoder(backend, params, encoder, range, outputFName);
+                if (result)
+                {
+                    profile.Record(*result);
+                    calibrated = true;
+
+                    std::cout << "  " << GetEncoderName(encoder) << " (" << GetResolutionClassName(result->resolutionClass)
+                        << "): " << std::fixed << std::setprecision(1) << result->framesPerSec << " fps, ";
+
+                    if (result->bitrateRatio > 0.0)
+                        std::cout << std::setprecision(2) << result->bitrateRatio << "x the target bitrate";
+                    else
+                        std::cout << "bitrate not measured";
+
+                    std::cout << std::endl;
+                }
+                else
+                {
+                    std::cout << "  " << GetEncoderName(encoder)
+                        << ": input would be copied rather than encoded, try a lower target size factor" << std::endl;
+                }
+            }
+            catch (mincpp::TraceableException& ex)
+            {
+                std::cout << "  " << GetEncoderName(encoder) << ": failed (" << ex.what() << ')' << std::endl;
+            }
+
+            std::filesystem::remove(ToPath(outputFName), error);
+        }
+
+        if (!calibrated)
+        {
+            std::cout << std::endl << "No encoder could be benchmarked" << std::endl << std::endl;
+            return false;
+        }
+
+        SaveCalibrationProfile(profile, profileFName, registry.GetSystemFingerprint());
+        std::cout << std::endl << "Calibration saved in " << profileFName << std::endl << std::endl;
+        return true;
+    }
+}
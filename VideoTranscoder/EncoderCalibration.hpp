@@ -0,0 +1,47 @@
+#pragma once
+
+#include "CommandLineParsing.hpp"
+#include "EncoderSelection.hpp"
+#include "MediaBackend.hpp"
+
+#include <chrono>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace application
+{
+    /// <summary>
+    /// Picks the range of a source to benchmark the encoders with: a stretch of the given
+    /// length starting at a key frame a third into the presentation, past any intro.
+    /// </summary>
+    /// <param name="keyframeTimes">Presentation times of the key frames, in ascending order.</param>
+    /// <param name="duration">The duration of the presentation.</param>
+    /// <param name="sampleDuration">The desired length of the sample.</param>
+    PresentationRange PickCalibrationSample(
+        const std::vector<std::chrono::nanoseconds>& keyframeTimes,
+        std::chrono::nanoseconds duration,
+        std::chrono::nanoseconds sampleDuration);
+
+    /// <summary>
+    /// Gets where the calibration profile of the machine is kept by the backend.
+    /// </summary>
+    /// <returns>The profile file (UTF-8 encoded).</returns>
+    std::string GetCalibrationProfileFName(const MediaBackend& backend);
+
+    /// <summary>
+    /// Gets how to select the encoder of jobs, as requested in the command line.
+    /// </summary>
+    /// <remarks>For automatic selection, warns when there is no calibration to select from.</remarks>
+    EncoderSelection GetEncoderSelection(MediaBackend& backend, const CmdLineParams& params);
+
+    /// <summary>
+    /// Benchmarks every encoder installed on a sample of the input, measuring speed and
+    /// how well it meets the target size, then records the results in the calibration
+    /// profile of the machine under the resolution class of the input.
+    /// </summary>
+    /// <param name="backend">The media backend.</param>
+    /// <param name="params">The command line parameters in calibration mode.</param>
+    /// <returns>Whether any encoder could be benchmarked.</returns>
+    bool RunEncoderCalibration(MediaBackend& backend, const CmdLineParams& params);
+}
@@ -0,0 +1,198 @@
+#include "EncoderRegistry.hpp"
+
+#include "AtomicFile.hpp"
+#include "Utf8Path.hpp"
+
+#include <MinCppXtra/traceable_exception.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+
+namespace application
+{
+    static const char* const cacheHeader = "VideoTranscoder encoder registry 2";
+
+    // the last line, without which the cache is taken for truncated:
+    static const char* const cacheTrailer = "end";
+
+    EncoderRegistry::EncoderRegistry(std::vector<EncoderCapability> encoders, std::string systemFingerprint)
+        : m_encoders(std::move(encoders))
+        , m_systemFingerprint(std::move(systemFingerprint))
+    {
+        // hardware first, keeping the order of enumeration otherwise:
+        std::stable_partition(m_encoders.begin(), m_encoders.end(),
+            [](const EncoderCapability& encoder) { return encoder.hardware; });
+    }
+
+    bool EncoderRegistry::Knows(Encoder codec) const
+    {
+        return std::any_of(m_encoders.begin(), m_encoders.end(),
+            [codec](const EncoderCapability& encoder) { return encoder.codec == codec; });
+    }
+
+    bool EncoderRegistry::HasHardwareEncoder(Encoder codec, uint32_t width, uint32_t height) const
+    {
+        return std::any_of(m_encoders.begin(), m_encoders.end(),
+            [=](const EncoderCapability& encoder)
+            {
+                // a size limit that could not be probed is not held against the encoder:
+                return encoder.codec == codec && encoder.hardware
+                    && (encoder.maxWidth == 0 || (width <= encoder.maxWidth && height <= encoder.maxHeight));
+            });
+    }
+
+    static bool EqualsIgnoringCase(const std::string& left, const std::string& right)
+    {
+        return left.size() == right.size()
+            && std::equal(left.begin(), left.end(), right.begin(),
+                [](char a, char b) { return std::toupper((unsigned char)a) == std::toupper((unsigned char)b); });
+    }
+
+    const EncoderCapability* EncoderRegistry::FindByClsid(const std::string& clsid) const
+    {
+        auto iter = std::find_if(m_encoders.begin(), m_encoders.end(),
+            [&clsid](const EncoderCapability& encoder) { return EqualsIgnoringCase(encoder.clsid, clsid); });
+
+        return iter != m_encoders.end() ? &*iter : nullptr;
+    }
+
+    uint32_t EncoderRegistry::GetHardwareSessionCapacity(Encoder codec) const
+    {
+        // without enumeration, leave it to the media session to pick hardware or not:
+        if (!Knows(codec))
+            return std::numeric_limits<uint32_t>::max();
+
+        const auto count = std::count_if(m_encoders.begin(), m_encoders.end(),
+            [codec](const EncoderCapability& encoder) { return encoder.codec == codec && encoder.hardware; });
+
+        return static_cast<uint32_t>(count) * sessionsPerHardwareEncoder;
+    }
+
+    /// <summary>
+    /// Keeps a field from breaking the line-and-tab format of the cache.
+    /// </summary>
+    static std::string Sanitize(std::string field)
+    {
+        std::replace_if(field.begin(), field.end(),
+            [](char ch) { return ch == '\t' || ch == '\r' || ch == '\n'; }, ' ');
+        return field;
+    }
+
+    std::string EncoderRegistry::Serialize(const std::string& systemFingerprint) const
+    {
+        std::ostringstream oss;
+        oss << cacheHeader << '\n'
+            << "fingerprint\t" << Sanitize(systemFingerprint) << '\n';
+
+        for (const EncoderCapability& encoder : m_encoders)
+        {
+            oss << "encoder\t" << GetEncoderName(encoder.codec)
+                << '\t' << encoder.hardware
+                << '\t' << encoder.async
+                << '\t' << encoder.maxWidth
+                << '\t' << encoder.maxHeight
+                << '\t' << Sanitize(encoder.clsid)
+                << '\t' << Sanitize(encoder.name) << '\n';
+        }
+
+        oss << cacheTrailer << '\n';
+        return oss.str();
+    }
+
+    static std::optional<Encoder> ParseEncoderName(const std::string& name)
+    {
+        for (Encoder codec : { Encoder::H264_AVC, Encoder::H265_HEVC, Encoder::AV1 })
+        {
+            if (name == GetEncoderName(codec))
+                return codec;
+        }
+        return std::nullopt;
+    }
+
+    std::optional<EncoderRegistry> EncoderRegistry::Deserialize(const std::string& text,
+                                                                const std::string& systemFingerprint)
+    {
+        std::istringstream iss(text);
+        std::string line;
+        if (!std::getline(iss, line) || line != cacheHeader)
+            return std::nullopt;
+
+        if (!std::getline(iss, line) || line != "fingerprint\t" + Sanitize(systemFingerprint))
+            return std::nullopt;
+
+        std::vector<EncoderCapability> encoders;
+        bool complete = false;
+        while (!complete && std::getline(iss, line))
+        {
+            if (line == cacheTrailer)
+            {
+                complete = true;
+                continue;
+            }
+
+            std::istringstream fields(line);
+            std::string tag, codecName;
+            EncoderCapability encoder = {};
+            if (!std::getline(fields, tag, '\t') || tag != "encoder"
+                || !std::getline(fields, codecName, '\t')
+                || !(fields >> encoder.hardware >> encoder.async >> encoder.maxWidth >> encoder.maxHeight)
+                || fields.get() != '\t'
+                || !std::getline(fields, encoder.clsid, '\t')
+                || !std::getline(fields, encoder.name))
+            {
+                return std::nullopt;
+            }
+
+            const auto codec = ParseEncoderName(codecName);
+            if (!codec)
+                return std::nullopt;
+
+            encoder.codec = *codec;
+            encoders.push_back(std::move(encoder));
+        }
+
+        // the trailer must end the content, with its line break:
+        if (!complete || iss.eof() || iss.peek() != std::char_traits<char>::eof())
+            return std::nullopt;
+
+        return EncoderRegistry(std::move(encoders), systemFingerprint);
+    }
+
+    EncoderRegistry LoadEncoderRegistry(const std::string& cacheFName,
+                                        const std::string& systemFingerprint,
+                                        const std::function<std::vector<EncoderCapability>()>& enumerate)
+    {
+        std::ifstream cacheFile(ToPath(cacheFName), std::ios::binary);
+        if (cacheFile)
+        {
+            std::ostringstream content;
+            content << cacheFile.rdbuf();
+            if (auto registry = EncoderRegistry::Deserialize(content.str(), systemFingerprint))
+                return std::move(*registry);
+        }
+
+        EncoderRegistry registry(enumerate(), systemFingerprint);
+
+        // an empty registry means enumeration failed, which is worth retrying next time:
+        if (!registry.GetEncoders().empty())
+        {
+            try
+            {
+                std::error_code error;
+                std::filesystem::create_directories(ToPath(cacheFName).parent_path(), error);
+                WriteFileAtomically(cacheFName, registry.Serialize(systemFingerprint));
+            }
+            catch (mincpp::TraceableException& ex)
+            {
+                std::cerr << std::endl << "Could not cache encoder capabilities: " << ex.what() << std::endl;
+            }
+        }
+
+        return registry;
+    }
+}
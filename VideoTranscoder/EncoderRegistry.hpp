@@ -0,0 +1,125 @@
+#pragma once
+
+#include "Encoder.hpp"
+
+#include <cinttypes>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace application
+{
+    /// <summary>
+    /// What an encoder installed in the machine is capable of.
+    /// </summary>
+    struct EncoderCapability
+    {
+        /// <summary>Friendly name, such as "NVIDIA HEVC Encoder MFT".</summary>
+        std::string name;
+
+        /// <summary>Class identifier of the encoder, such as "{966F107C-8EA2-425D-B822-E4A71BEF01D7}".</summary>
+        std::string clsid;
+
+        Encoder codec;
+        bool hardware;
+
+        /// <summary>Whether the encoder processes asynchronously (as hardware encoders usually do).</summary>
+        bool async;
+
+        /// <summary>Largest frame size the encoder accepted when probed, zero when unknown.</summary>
+        uint32_t maxWidth;
+        uint32_t maxHeight;
+    };
+
+    /// <summary>
+    /// The video encoders installed in the machine, in order of preference.
+    /// </summary>
+    class EncoderRegistry
+    {
+    private:
+
+        std::vector<EncoderCapability> m_encoders;
+        std::string m_systemFingerprint;
+
+    public:
+
+        /// <summary>
+        /// How many sessions a hardware encoder is trusted to run at the same time
+        /// (consumer GPUs often admit just a few).
+        /// </summary>
+        static constexpr uint32_t sessionsPerHardwareEncoder = 2;
+
+        EncoderRegistry() = default;
+
+        /// <summary>
+        /// Creates a new instance.
+        /// </summary>
+        /// <param name="encoders">The encoders, in order of enumeration.</param>
+        /// <param name="systemFingerprint">Identifies the OS and drivers the encoders were found with.</param>
+        explicit EncoderRegistry(std::vector<EncoderCapability> encoders,
+                                 std::string systemFingerprint = std::string());
+
+        const std::vector<EncoderCapability>& GetEncoders() const
+        {
+            return m_encoders;
+        }
+
+        /// <summary>
+        /// Gets what identifies the OS and drivers the registry is valid for,
+        /// which also applies to anything else measured about the encoders.
+        /// </summary>
+        const std::string& GetSystemFingerprint() const
+        {
+            return m_systemFingerprint;
+        }
+
+        /// <summary>
+        /// Tells whether any encoder (hardware or software) is known for the codec,
+        /// which is false when enumeration was not possible.
+        /// </summary>
+        bool Knows(Encoder codec) const;
+
+        /// <summary>
+        /// Tells whether a hardware encoder of the codec admits the given frame size.
+        /// </summary>
+        bool HasHardwareEncoder(Encoder codec, uint32_t width, uint32_t height) const;
+
+        /// <summary>
+        /// Finds an encoder by its class identifier (case insensitive).
+        /// </summary>
+        /// <returns>The encoder, or null if unknown.</returns>
+        const EncoderCapability* FindByClsid(const std::string& clsid) const;
+
+        /// <summary>
+        /// Gets how many jobs of the codec can run on hardware encoders at the same time.
+        /// </summary>
+        /// <returns>The capacity, which is unlimited for a codec the registry does not know.</returns>
+        uint32_t GetHardwareSessionCapacity(Encoder codec) const;
+
+        /// <summary>
+        /// Serializes the registry for a cache file.
+        /// </summary>
+        /// <param name="systemFingerprint">Identifies the OS and drivers the registry is valid for.</param>
+        std::string Serialize(const std::string& systemFingerprint) const;
+
+        /// <summary>
+        /// Deserializes the registry from the content of a cache file.
+        /// </summary>
+        /// <returns>The registry, or nothing if the content is malformed or for another fingerprint.</returns>
+        static std::optional<EncoderRegistry> Deserialize(const std::string& text,
+                                                          const std::string& systemFingerprint);
+    };
+
+    /// <summary>
+    /// Gets the encoder registry from a cache file, or by enumeration when the cache
+    /// is missing or stale (made for another OS or driver version), then updating the cache.
+    /// </summary>
+    /// <param name="cacheFName">The cache file (UTF-8 encoded).</param>
+    /// <param name="systemFingerprint">Identifies the OS and drivers in the machine.</param>
+    /// <param name="enumerate">Enumerates the encoders installed in the machine.</param>
+    /// <remarks>Failing to write the cache is not an error, as it only costs time on the next run.</remarks>
+    EncoderRegistry LoadEncoderRegistry(const std::string& cacheFName,
+                                        const std::string& systemFingerprint,
+                                        const std::function<std::vector<EncoderCapability>()>& enumerate);
+}
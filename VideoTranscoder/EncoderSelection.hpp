@@ -0,0 +1,61 @@
+#pragma once
+
+#include "CalibrationProfile.hpp"
+#include "Encoder.hpp"
+#include "MediaInfo.hpp"
+
+#include <memory>
+#include <optional>
+
+namespace application
+{
+    /// <summary>
+    /// The video encoder requested for jobs: either a given one, or the one the
+    /// calibration of this machine tells to be the fastest for the source.
+    /// </summary>
+    class EncoderSelection
+    {
+    private:
+
+        std::optional<Encoder> m_encoder;
+        std::shared_ptr<const CalibrationProfile> m_profile;
+
+    public:
+
+        /// <summary>
+        /// The encoder of automatic selection when the calibration has no results.
+        /// </summary>
+        static constexpr Encoder fallbackEncoder = Encoder::H265_HEVC;
+
+        EncoderSelection(Encoder encoder)
+            : m_encoder(encoder)
+        {
+        }
+
+        /// <summary>
+        /// Creates an automatic selection.
+        /// </summary>
+        /// <param name="profile">The calibration of this machine.</param>
+        explicit EncoderSelection(std::shared_ptr<const CalibrationProfile> profile)
+            : m_profile(std::move(profile))
+        {
+        }
+
+        bool IsAutomatic() const
+        {
+            return !m_encoder.has_value();
+        }
+
+        /// <summary>
+        /// Selects the encoder for a source.
+        /// </summary>
+        Encoder Select(const MediaInfo& sourceInfo) const
+        {
+            if (m_encoder)
+                return *m_encoder;
+
+            const auto& frameSize = sourceInfo.videoProfile.frameSize;
+            return m_profile->SelectEncoder(frameSize.width, frameSize.height).value_or(fallbackEncoder);
+        }
+    };
+}
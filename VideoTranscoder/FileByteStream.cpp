@@ -0,0 +1,225 @@
+#include "stdafx.h"
+#include "FileByteStream.hpp"
+
+#include "AppException.hpp"
+#include "ByteStreamRequest.hpp"
+
+#include <algorithm>
+
+namespace application
+{
+    FileByteStream::FileByteStream(std::shared_ptr<const InputFile> file, const ReadAheadOptions& readAheadOptions)
+        : m_reader(std::move(file), readAheadOptions)
+        , m_position(0)
+        , m_refCount(0)
+    {
+    }
+
+    STDMETHODIMP FileByteStream::QueryInterface(REFIID riid, void** ppv)
+    {
+        static const QITAB qit[] =
+        {
+            QITABENT(FileByteStream, IMFByteStream),
+            QITABENT(FileByteStream, IMFAsyncCallback),
+            { 0 }
+        };
+        return QISearch(this, qit, riid, ppv);
+    }
+
+    STDMETHODIMP_(ULONG) FileByteStream::AddRef()
+    {
+        return InterlockedIncrement(&m_refCount);
+    }
+
+    STDMETHODIMP_(ULONG) FileByteStream::Release()
+    {
+        long refCount = InterlockedDecrement(&m_refCount);
+        if (refCount == 0)
+        {
+            delete this;
+        }
+        return refCount;
+    }
+
+    uint64_t FileByteStream::AdvancePosition(ULONG& size)
+    {
+        std::lock_guard<std::mutex> lock(m_positionMutex);
+        const uint64_t offset = m_position;
+        const uint64_t fileSize = m_reader.GetFile().GetSize();
+        size = static_cast<ULONG>(offset < fileSize ? std::min<uint64_t>(size, fileSize - offset) : 0);
+        m_position += size;
+        return offset;
+    }
+
+    STDMETHODIMP FileByteStream::GetCapabilities(DWORD* capabilities)
+    {
+        if (capabilities == nullptr)
+            return E_POINTER;
+
+        *capabilities = MFBYTESTREAM_IS_READABLE | MFBYTESTREAM_IS_SEEKABLE;
+        return S_OK;
+    }
+
+    STDMETHODIMP FileByteStream::GetLength(QWORD* length)
+    {
+        if (length == nullptr)
+            return E_POINTER;
+
+        *length = m_reader.GetFile().GetSize();
+        return S_OK;
+    }
+
+    STDMETHODIMP FileByteStream::SetLength(QWORD length)
+    {
+        return E_ACCESSDENIED;
+    }
+
+    STDMETHODIMP FileByteStream::GetCurrentPosition(QWORD* position)
+    {
+        if (position == nullptr)
+            return E_POINTER;
+
+        std::lock_guard<std::mutex> lock(m_positionMutex);
+        *position = m_position;
+        return S_OK;
+    }
+
+    STDMETHODIMP FileByteStream::SetCurrentPosition(QWORD position)
+    {
+        std::lock_guard<std::mutex> lock(m_positionMutex);
+        m_position = position;
+        return S_OK;
+    }
+
+    STDMETHODIMP FileByteStream::IsEndOfStream(BOOL* endOfStream)
+    {
+        if (endOfStream == nullptr)
+            return E_POINTER;
+
+        std::lock_guard<std::mutex> lock(m_positionMutex);
+        *endOfStream = m_position >= m_reader.GetFile().GetSize();
+        return S_OK;
+    }
+
+    STDMETHODIMP FileByteStream::Read(BYTE* buffer, ULONG size, ULONG* bytesRead)
+    {
+        if (buffer == nullptr || bytesRead == nullptr)
+            return E_POINTER;
+
+        const uint64_t offset = AdvancePosition(size);
+        try
+        {
+            *bytesRead = static_cast<ULONG>(m_reader.Read(offset, buffer, size));
+        }
+        catch (AppException&)
+        {
+            *bytesRead = 0;
+            return E_FAIL;
+        }
+
+        return S_OK;
+    }
+
+    STDMETHODIMP FileByteStream::BeginRead(BYTE* buffer, ULONG size, IMFAsyncCallback* callback, IUnknown* state)
+    {
+        if (buffer == nullptr || callback == nullptr)
+            return E_POINTER;
+
+        // the position moves right away, so that reads issued back to back take consecutive ranges:
+        const uint64_t offset = AdvancePosition(size);
+        ComPtr<ByteStreamRequest> request(new ByteStreamRequest(buffer, offset, size));
+
+        ComPtr<IMFAsyncResult> callerResult;
+        HRESULT hr = MFCreateAsyncResult(request.Get(), callback, state, callerResult.GetAddressOf());
+        if (FAILED(hr))
+            return hr;
+
+        return MFPutWorkItem(MFASYNC_CALLBACK_QUEUE_STANDARD, this, callerResult.Get());
+    }
+
+    STDMETHODIMP FileByteStream::Invoke(IMFAsyncResult* result)
+    {
+        ComPtr<IUnknown> state;
+        ComPtr<IMFAsyncResult> callerResult;
+        ComPtr<IUnknown> object;
+        HRESULT hr = result->GetState(state.GetAddressOf());
+        if (SUCCEEDED(hr))
+            hr = state.As(&callerResult);
+        if (SUCCEEDED(hr))
+            hr = callerResult->GetObject(object.GetAddressOf());
+        if (FAILED(hr))
+            return hr;
+
+        auto request = static_cast<ByteStreamRequest*>(object.Get());
+        try
+        {
+            request->bytesTransferred = static_cast<ULONG>(m_reader.Read(request->offset, request->buffer, request->size));
+            callerResult->SetStatus(S_OK);
+        }
+        catch (AppException&)
+        {
+            callerResult->SetStatus(E_FAIL);
+        }
+
+        return MFInvokeCallback(callerResult.Get());
+    }
+
+    STDMETHODIMP FileByteStream::EndRead(IMFAsyncResult* result, ULONG* bytesRead)
+    {
+        if (result == nullptr || bytesRead == nullptr)
+            return E_POINTER;
+
+        ComPtr<IUnknown> object;
+        HRESULT hr = result->GetObject(object.GetAddressOf());
+        if (FAILED(hr))
+            return hr;
+
+        *bytesRead = static_cast<ByteStreamRequest*>(object.Get())->bytesTransferred;
+        return result->GetStatus();
+    }
+
+    STDMETHODIMP FileByteStream::Write(const BYTE* buffer, ULONG size, ULONG* bytesWritten)
+    {
+        return E_ACCESSDENIED;
+    }
+
+    STDMETHODIMP FileByteStream::BeginWrite(const BYTE* buffer, ULONG size, IMFAsyncCallback* callback, IUnknown* state)
+    {
+        return E_ACCESSDENIED;
+    }
+
+    STDMETHODIMP FileByteStream::EndWrite(IMFAsyncResult* result, ULONG* bytesWritten)
+    {
+        return E_ACCESSDENIED;
+    }
+
+    STDMETHODIMP FileByteStream::Seek(MFBYTESTREAM_SEEK_ORIGIN origin, LONGLONG offset, DWORD flags, QWORD* position)
+    {
+        std::lock_guard<std::mutex> lock(m_positionMutex);
+        const LONGLONG base = origin == msoCurrent ? static_cast<LONGLONG>(m_position) : 0;
+        if (base + offset < 0)
+            return E_INVALIDARG;
+
+        m_position = static_cast<uint64_t>(base + offset);
+        if (position != nullptr)
+            *position = m_position;
+
+        return S_OK;
+    }
+
+    STDMETHODIMP FileByteStream::Flush()
+    {
+        return S_OK;
+    }
+
+    STDMETHODIMP FileByteStream::Close()
+    {
+        // the file stays open as long as someone else shares it
+        return S_OK;
+    }
+
+    STDMETHODIMP FileByteStream::GetParameters(DWORD* pdwFlags, DWORD* pdwQueue)
+    {
+        return E_NOTIMPL;
+    }
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "ReadAheadReader.hpp"
+
+#include <memory>
+#include <mutex>
+
+#include <Windows.h>
+#include <mfobjects.h>
+#include <wrl.h>
+
+namespace application
+{
+    using namespace Microsoft::WRL;
+
+    /// <summary>
+    /// Read-only MF byte stream over an <see cref="InputFile"/>, so that the media source
+    /// reads the same open file the native parsers do, with 64-bit offsets.
+    /// </summary>
+    /// <remarks>
+    /// Asynchronous reads are positional reads run in the standard work queue, served
+    /// by a <see cref="ReadAheadReader"/> that keeps reading ahead of the demuxer.
+    /// </remarks>
+    class FileByteStream : public IMFByteStream, public IMFAsyncCallback
+    {
+    private:
+
+        ReadAheadReader m_reader;
+        uint64_t m_position;
+        mutable std::mutex m_positionMutex;
+        long m_refCount;
+
+        /// <summary>
+        /// Takes the range of the next read and moves the current position past it.
+        /// </summary>
+        uint64_t AdvancePosition(ULONG& size);
+
+    public:
+
+        /// <summary>
+        /// Creates a new instance.
+        /// </summary>
+        /// <param name="file">The file to read, which this object keeps open.</param>
+        /// <param name="readAheadOptions">How to read ahead of the demuxer.</param>
+        FileByteStream(std::shared_ptr<const InputFile> file, const ReadAheadOptions& readAheadOptions);
+
+        virtual ~FileByteStream() = default;
+
+        // IUnknown methods
+        STDMETHODIMP QueryInterface(REFIID riid, void** ppv);
+        STDMETHODIMP_(ULONG) AddRef();
+        STDMETHODIMP_(ULONG) Release();
+
+        // IMFByteStream methods
+        STDMETHODIMP GetCapabilities(DWORD* capabilities);
+        STDMETHODIMP GetLength(QWORD* length);
+        STDMETHODIMP SetLength(QWORD length);
+        STDMETHODIMP GetCurrentPosition(QWORD* position);
+        STDMETHODIMP SetCurrentPosition(QWORD position);
+        STDMETHODIMP IsEndOfStream(BOOL* endOfStream);
+        STDMETHODIMP Read(BYTE* buffer, ULONG size, ULONG* bytesRead);
+        STDMETHODIMP BeginRead(BYTE* buffer, ULONG size, IMFAsyncCallback* callback, IUnknown* state);
+        STDMETHODIMP EndRead(IMFAsyncResult* result, ULONG* bytesRead);
+        STDMETHODIMP Write(const BYTE* buffer, ULONG size, ULONG* bytesWritten);
+        STDMETHODIMP BeginWrite(const BYTE* buffer, ULONG size, IMFAsyncCallback* callback, IUnknown* state);
+        STDMETHODIMP EndWrite(IMFAsyncResult* result, ULONG* bytesWritten);
+        STDMETHODIMP Seek(MFBYTESTREAM_SEEK_ORIGIN origin, LONGLONG offset, DWORD flags, QWORD* position);
+        STDMETHODIMP Flush();
+        STDMETHODIMP Close();
+
+        // IMFAsyncCallback methods (which run the asynchronous reads)
+        STDMETHODIMP GetParameters(DWORD* pdwFlags, DWORD* pdwQueue);
+        STDMETHODIMP Invoke(IMFAsyncResult* result);
+    };
+}
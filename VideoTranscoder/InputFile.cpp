@@ -0,0 +1,320 @@
+#include "InputFile.hpp"
+#include "AppException.hpp"
+#include "Utf8Path.hpp"
+
+#ifdef _WIN32
+#   define WIN32_LEAN_AND_MEAN
+#   define NOMINMAX
+#   include <windows.h>
+#else
+#   include <cerrno>
+#   include <cstring>
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <sstream>
+
+namespace application
+{
+    static AppException CreateFileException(const char* what, const std::string& fileName)
+    {
+        std::ostringstream oss;
+        oss << "Could not " << what << " file " << fileName << ": ";
+#ifdef _WIN32
+        oss << "error code " << GetLastError();
+#else
+        oss << strerror(errno);
+#endif
+        return AppException(oss.str());
+    }
+
+    /// <summary>
+    /// How much is read at most in a single system call.
+    /// </summary>
+    static constexpr size_t maxReadChunk = size_t(1) << 30;
+
+    /////////////
+    // FileView
+    /////////////
+
+    FileView::~FileView()
+    {
+        Unmap();
+    }
+
+    FileView::FileView(FileView&& other) noexcept
+        : m_base(other.m_base)
+        , m_baseSize(other.m_baseSize)
+        , m_data(other.m_data)
+        , m_size(other.m_size)
+    {
+        other.m_base = nullptr;
+        other.m_baseSize = 0;
+        other.m_data = nullptr;
+        other.m_size = 0;
+    }
+
+    FileView& FileView::operator=(FileView&& other) noexcept
+    {
+        if (this != &other)
+        {
+            Unmap();
+            m_base = other.m_base;
+            m_baseSize = other.m_baseSize;
+            m_data = other.m_data;
+            m_size = other.m_size;
+            other.m_base = nullptr;
+            other.m_baseSize = 0;
+            other.m_data = nullptr;
+            other.m_size = 0;
+        }
+        return *this;
+    }
+
+#ifdef _WIN32
+
+    void FileView::Unmap() noexcept
+    {
+        if (m_base != nullptr)
+            UnmapViewOfFile(m_base);
+    }
+
+    void FileView::Prefetch() const noexcept
+    {
+        if (m_base == nullptr)
+            return;
+
+        WIN32_MEMORY_RANGE_ENTRY range{ m_base, m_baseSize };
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+    }
+
+    //////////////
+    // InputFile
+    //////////////
+
+    InputFile::InputFile(const std::string& fileName, AccessPattern accessPattern)
+        : m_fileName(fileName)
+        , m_size(0)
+        , m_fileHandle(INVALID_HANDLE_VALUE)
+        , m_mappingHandle(nullptr)
+    {
+        DWORD flags = FILE_ATTRIBUTE_NORMAL;
+        if (accessPattern == AccessPattern::Sequential)
+            flags |= FILE_FLAG_SEQUENTIAL_SCAN;
+        else if (accessPattern == AccessPattern::Random)
+            flags |= FILE_FLAG_RANDOM_ACCESS;
+
+        m_fileHandle = CreateFileW(ToPath(fileName).c_str(),
+            GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+            OPEN_EXISTING, flags, nullptr);
+
+        if (m_fileHandle == INVALID_HANDLE_VALUE)
+            throw CreateFileException("open", fileName);
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(m_fileHandle, &fileSize))
+        {
+            auto ex = CreateFileException("get size of", fileName);
+            Close();
+            throw ex;
+        }
+
+        m_size = static_cast<uint64_t>(fileSize.QuadPart);
+        if (m_size == 0)
+            return;
+
+        // an empty file cannot be mapped, so views of it are never requested:
+        m_mappingHandle = CreateFileMappingW(m_fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (m_mappingHandle == nullptr)
+        {
+            auto ex = CreateFileException("map", fileName);
+            Close();
+            throw ex;
+        }
+    }
+
+    void InputFile::Close() noexcept
+    {
+        if (m_mappingHandle != nullptr)
+            CloseHandle(m_mappingHandle);
+
+        if (m_fileHandle != INVALID_HANDLE_VALUE)
+            CloseHandle(m_fileHandle);
+    }
+
+    size_t InputFile::Read(uint64_t offset, void* buffer, size_t size) const
+    {
+        size_t total = 0;
+        while (total < size && offset + total < m_size)
+        {
+            // positional, so that concurrent reads do not race for the file pointer:
+            OVERLAPPED overlapped = {};
+            overlapped.Offset = static_cast<DWORD>(offset + total);
+            overlapped.OffsetHigh = static_cast<DWORD>((offset + total) >> 32);
+
+            DWORD bytesRead = 0;
+            const DWORD chunk = static_cast<DWORD>(std::min(size - total, maxReadChunk));
+            if (!ReadFile(m_fileHandle, static_cast<uint8_t*>(buffer) + total, chunk, &bytesRead, &overlapped)
+                && GetLastError() != ERROR_HANDLE_EOF)
+            {
+                throw CreateFileException("read", m_fileName);
+            }
+
+            if (bytesRead == 0)
+                break;
+
+            total += bytesRead;
+        }
+
+        return total;
+    }
+
+    static uint64_t GetAllocationGranularity()
+    {
+        SYSTEM_INFO systemInfo;
+        GetSystemInfo(&systemInfo);
+        return systemInfo.dwAllocationGranularity;
+    }
+
+    FileView InputFile::MapView(uint64_t offset, uint64_t size) const
+    {
+        if (offset >= m_size || size == 0)
+            return FileView();
+
+        static const uint64_t granularity = GetAllocationGranularity();
+        const uint64_t baseOffset = offset - offset % granularity;
+        const uint64_t end = offset + std::min(size, m_size - offset);
+        const size_t baseSize = static_cast<size_t>(end - baseOffset);
+
+        void* base = MapViewOfFile(m_mappingHandle, FILE_MAP_READ,
+            static_cast<DWORD>(baseOffset >> 32), static_cast<DWORD>(baseOffset), baseSize);
+
+        if (base == nullptr)
+            throw CreateFileException("map", m_fileName);
+
+        return FileView(base, baseSize,
+            static_cast<const uint8_t*>(base) + (offset - baseOffset), static_cast<size_t>(end - offset));
+    }
+
+    void InputFile::Prefetch(uint64_t offset, uint64_t size) const noexcept
+    {
+        // with no read-ahead call for files, prefetch a view: the pages stay in the cache after unmapping
+        try
+        {
+            MapView(offset, size).Prefetch();
+        }
+        catch (AppException&)
+        {
+            // just a hint
+        }
+    }
+
+#else
+
+    void FileView::Unmap() noexcept
+    {
+        if (m_base != nullptr)
+            munmap(m_base, m_baseSize);
+    }
+
+    void FileView::Prefetch() const noexcept
+    {
+        if (m_base != nullptr)
+            madvise(m_base, m_baseSize, MADV_WILLNEED);
+    }
+
+    //////////////
+    // InputFile
+    //////////////
+
+    InputFile::InputFile(const std::string& fileName, AccessPattern accessPattern)
+        : m_fileName(fileName)
+        , m_size(0)
+        , m_fileDescriptor(-1)
+    {
+        m_fileDescriptor = open(fileName.c_str(), O_RDONLY | O_CLOEXEC);
+        if (m_fileDescriptor < 0)
+            throw CreateFileException("open", fileName);
+
+        struct stat fileStatus;
+        if (fstat(m_fileDescriptor, &fileStatus) != 0)
+        {
+            auto ex = CreateFileException("get size of", fileName);
+            Close();
+            throw ex;
+        }
+
+        m_size = static_cast<uint64_t>(fileStatus.st_size);
+
+        if (accessPattern == AccessPattern::Sequential)
+            posix_fadvise(m_fileDescriptor, 0, 0, POSIX_FADV_SEQUENTIAL);
+        else if (accessPattern == AccessPattern::Random)
+            posix_fadvise(m_fileDescriptor, 0, 0, POSIX_FADV_RANDOM);
+    }
+
+    void InputFile::Close() noexcept
+    {
+        if (m_fileDescriptor >= 0)
+            close(m_fileDescriptor);
+    }
+
+    size_t InputFile::Read(uint64_t offset, void* buffer, size_t size) const
+    {
+        size_t total = 0;
+        while (total < size)
+        {
+            const size_t chunk = std::min(size - total, maxReadChunk);
+            const ssize_t bytesRead = pread(m_fileDescriptor,
+                static_cast<uint8_t*>(buffer) + total, chunk, static_cast<off_t>(offset + total));
+
+            if (bytesRead < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+
+                throw CreateFileException("read", m_fileName);
+            }
+
+            if (bytesRead == 0)
+                break;
+
+            total += static_cast<size_t>(bytesRead);
+        }
+
+        return total;
+    }
+
+    FileView InputFile::MapView(uint64_t offset, uint64_t size) const
+    {
+        if (offset >= m_size || size == 0)
+            return FileView();
+
+        static const uint64_t pageSize = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+        const uint64_t baseOffset = offset - offset % pageSize;
+        const uint64_t end = offset + std::min(size, m_size - offset);
+        const size_t baseSize = static_cast<size_t>(end - baseOffset);
+
+        void* base = mmap(nullptr, baseSize, PROT_READ, MAP_SHARED, m_fileDescriptor, static_cast<off_t>(baseOffset));
+        if (base == MAP_FAILED)
+            throw CreateFileException("map", m_fileName);
+
+        return FileView(base, baseSize,
+            static_cast<const uint8_t*>(base) + (offset - baseOffset), static_cast<size_t>(end - offset));
+    }
+
+    void InputFile::Prefetch(uint64_t offset, uint64_t size) const noexcept
+    {
+        posix_fadvise(m_fileDescriptor, static_cast<off_t>(offset), static_cast<off_t>(size), POSIX_FADV_WILLNEED);
+    }
+
+#endif
+
+    InputFile::~InputFile()
+    {
+        Close();
+    }
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <cinttypes>
+#include <cstddef>
+#include <string>
+
+namespace application
+{
+    /// <summary>
+    /// How a file is going to be read, so that the OS can tune read-ahead and caching.
+    /// </summary>
+    enum class AccessPattern { Normal, Sequential, Random };
+
+    /// <summary>
+    /// Read-only view of a range of a file mapped into memory.
+    /// </summary>
+    class FileView
+    {
+    private:
+
+        /// <summary>Where the mapping starts, which is aligned to the allocation granularity.</summary>
+        void* m_base;
+        size_t m_baseSize;
+
+        const uint8_t* m_data;
+        size_t m_size;
+
+        void Unmap() noexcept;
+
+    public:
+
+        FileView()
+            : m_base(nullptr)
+            , m_baseSize(0)
+            , m_data(nullptr)
+            , m_size(0)
+        {
+        }
+
+        FileView(void* base, size_t baseSize, const uint8_t* data, size_t size)
+            : m_base(base)
+            , m_baseSize(baseSize)
+            , m_data(data)
+            , m_size(size)
+        {
+        }
+
+        ~FileView();
+
+        FileView(FileView&& other) noexcept;
+        FileView& operator=(FileView&& other) noexcept;
+
+        FileView(const FileView&) = delete;
+        FileView& operator=(const FileView&) = delete;
+
+        const uint8_t* GetData() const
+        {
+            return m_data;
+        }
+
+        size_t GetSize() const
+        {
+            return m_size;
+        }
+
+        /// <summary>
+        /// Asks the OS to bring the pages of this view into memory ahead of access.
+        /// </summary>
+        void Prefetch() const noexcept;
+    };
+
+    /// <summary>
+    /// A file opened for reading, with 64-bit size and offsets, positional reads
+    /// and mapped views, so that the native parsers and the media source can share
+    /// the same open file.
+    /// </summary>
+    /// <remarks>Reads and views are thread-safe, for they do not depend on a file pointer.</remarks>
+    class InputFile
+    {
+    private:
+
+        const std::string m_fileName;
+        uint64_t m_size;
+
+#ifdef _WIN32
+        void* m_fileHandle;
+        void* m_mappingHandle;
+#else
+        int m_fileDescriptor;
+#endif
+        void Close() noexcept;
+
+    public:
+
+        /// <summary>
+        /// Opens a file.
+        /// </summary>
+        /// <param name="fileName">The file to open (UTF-8 encoded).</param>
+        /// <param name="accessPattern">How the file is going to be read.</param>
+        /// <remarks>Throws <see cref="AppException"/> on failure.</remarks>
+        explicit InputFile(const std::string& fileName, AccessPattern accessPattern = AccessPattern::Normal);
+
+        ~InputFile();
+
+        InputFile(const InputFile&) = delete;
+        InputFile& operator=(const InputFile&) = delete;
+
+        const std::string& GetName() const
+        {
+            return m_fileName;
+        }
+
+        uint64_t GetSize() const
+        {
+            return m_size;
+        }
+
+        /// <summary>
+        /// Reads from an offset of the file.
+        /// </summary>
+        /// <param name="offset">Where to read from.</param>
+        /// <param name="buffer">Receives the data.</param>
+        /// <param name="size">How much to read.</param>
+        /// <returns>How much was read, which is less than requested only at the end of the file.</returns>
+        /// <remarks>Throws <see cref="AppException"/> on failure.</remarks>
+        size_t Read(uint64_t offset, void* buffer, size_t size) const;
+
+        /// <summary>
+        /// Maps a range of the file into memory.
+        /// </summary>
+        /// <param name="offset">Where the range starts.</param>
+        /// <param name="size">How long the range is, which is clipped to the end of the file.</param>
+        /// <returns>The view, which is empty if the range is.</returns>
+        /// <remarks>Throws <see cref="AppException"/> on failure.</remarks>
+        FileView MapView(uint64_t offset, uint64_t size) const;
+
+        /// <summary>
+        /// Maps the whole file into memory.
+        /// </summary>
+        FileView MapView() const
+        {
+            return MapView(0, m_size);
+        }
+
+        /// <summary>
+        /// Hints the OS that a range of the file is going to be read soon,
+        /// so that it can start reading it into the cache.
+        /// </summary>
+        void Prefetch(uint64_t offset, uint64_t size) const noexcept;
+    };
+}
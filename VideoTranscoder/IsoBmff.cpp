@@ -0,0 +1,672 @@
+#include "IsoBmff.hpp"
+#include "AppException.hpp"
+
+#include <array>
+#include <cstring>
+#include <limits>
+
+namespace application
+{
+    void BigEndianReader::Require(uint64_t count) const
+    {
+        if (GetRemaining() < count)
+            throw AppException("Unexpected end of data in ISO base media file");
+    }
+
+    uint8_t BigEndianReader::ReadU8()
+    {
+        Require(1);
+        return *m_pos++;
+    }
+
+    uint16_t BigEndianReader::ReadU16()
+    {
+        Require(2);
+        uint16_t value = static_cast<uint16_t>((m_pos[0] << 8) | m_pos[1]);
+        m_pos += 2;
+        return value;
+    }
+
+    uint32_t BigEndianReader::ReadU24()
+    {
+        Require(3);
+        uint32_t value = (static_cast<uint32_t>(m_pos[0]) << 16) | (m_pos[1] << 8) | m_pos[2];
+        m_pos += 3;
+        return value;
+    }
+
+    uint32_t BigEndianReader::ReadU32()
+    {
+        Require(4);
+        uint32_t value = (static_cast<uint32_t>(m_pos[0]) << 24)
+            | (static_cast<uint32_t>(m_pos[1]) << 16)
+            | (static_cast<uint32_t>(m_pos[2]) << 8)
+            | m_pos[3];
+        m_pos += 4;
+        return value;
+    }
+
+    uint64_t BigEndianReader::ReadU64()
+    {
+        uint64_t high = ReadU32();
+        return (high << 32) | ReadU32();
+    }
+
+    const uint8_t* BigEndianReader::Skip(uint64_t count)
+    {
+        Require(count);
+        const uint8_t* start = m_pos;
+        m_pos += count;
+        return start;
+    }
+
+    void BigEndianWriter::WriteU8(uint8_t value)
+    {
+        m_buffer.push_back(value);
+    }
+
+    void BigEndianWriter::WriteU16(uint16_t value)
+    {
+        WriteU8(static_cast<uint8_t>(value >> 8));
+        WriteU8(static_cast<uint8_t>(value));
+    }
+
+    void BigEndianWriter::WriteU24(uint32_t value)
+    {
+        WriteU8(static_cast<uint8_t>(value >> 16));
+        WriteU16(static_cast<uint16_t>(value));
+    }
+
+    void BigEndianWriter::WriteU32(uint32_t value)
+    {
+        WriteU16(static_cast<uint16_t>(value >> 16));
+        WriteU16(static_cast<uint16_t>(value));
+    }
+
+    void BigEndianWriter::WriteU64(uint64_t value)
+    {
+        WriteU32(static_cast<uint32_t>(value >> 32));
+        WriteU32(static_cast<uint32_t>(value));
+    }
+
+    void BigEndianWriter::WriteBytes(const uint8_t* data, size_t count)
+    {
+        m_buffer.insert(m_buffer.end(), data, data + count);
+    }
+
+    void BigEndianWriter::PatchU32(size_t position, uint32_t value)
+    {
+        for (int idx = 3; idx >= 0; --idx, value >>= 8)
+            m_buffer.at(position + idx) = static_cast<uint8_t>(value);
+    }
+
+    void BigEndianWriter::PatchU64(size_t position, uint64_t value)
+    {
+        PatchU32(position, static_cast<uint32_t>(value >> 32));
+        PatchU32(position + 4, static_cast<uint32_t>(value));
+    }
+
+    size_t BigEndianWriter::BeginBox(uint32_t type)
+    {
+        const size_t position = GetPosition();
+        WriteU32(0);
+        WriteU32(type);
+        return position;
+    }
+
+    size_t BigEndianWriter::BeginFullBox(uint32_t type, uint8_t version, uint32_t flags)
+    {
+        const size_t position = BeginBox(type);
+        WriteU8(version);
+        WriteU24(flags);
+        return position;
+    }
+
+    void BigEndianWriter::EndBox(size_t boxPosition)
+    {
+        const size_t boxSize = GetPosition() - boxPosition;
+        if (boxSize > std::numeric_limits<uint32_t>::max())
+            throw AppException("Box is too large to write in ISO base media file");
+
+        PatchU32(boxPosition, static_cast<uint32_t>(boxSize));
+    }
+
+    bool ReadNextBox(BigEndianReader& reader, IsoBmffBox& box)
+    {
+        // tolerate trailing padding shorter than a box header:
+        if (reader.GetRemaining() < 8)
+            return false;
+
+        box.begin = reader.GetPosition();
+        uint64_t size = reader.ReadU32();
+        box.type = reader.ReadU32();
+
+        uint64_t headerSize = 8;
+        if (size == 1)
+        {
+            size = reader.ReadU64();
+            headerSize += 8;
+        }
+        else if (size == 0) // box extends to the end
+        {
+            size = headerSize + reader.GetRemaining();
+        }
+
+        if (box.type == MakeFourCC("uuid"))
+        {
+            reader.Skip(16);
+            headerSize += 16;
+        }
+
+        if (size < headerSize)
+            throw AppException("Invalid box size in ISO base media file");
+
+        box.payloadSize = size - headerSize;
+        box.payload = reader.Skip(box.payloadSize);
+        return true;
+    }
+
+    /// <summary>
+    /// Finds the first child box of a given type.
+    /// </summary>
+    static bool FindChildBox(const IsoBmffBox& parent, uint32_t type, IsoBmffBox& child)
+    {
+        BigEndianReader reader(parent.payload, parent.payloadSize);
+        while (ReadNextBox(reader, child))
+        {
+            if (child.type == type)
+                return true;
+        }
+        return false;
+    }
+
+    static BigEndianReader ReadFullBoxHeader(const IsoBmffBox& box, uint8_t& version)
+    {
+        BigEndianReader reader(box.payload, box.payloadSize);
+        version = reader.ReadU8();
+        reader.ReadU24(); // flags
+        return reader;
+    }
+
+    static IsoBmffTable ReadTable(const IsoBmffBox& box, uint32_t entrySize)
+    {
+        uint8_t version;
+        BigEndianReader reader = ReadFullBoxHeader(box, version);
+        IsoBmffTable table;
+        table.entryCount = reader.ReadU32();
+        table.data = reader.Skip(static_cast<uint64_t>(table.entryCount) * entrySize);
+        return table;
+    }
+
+    /// <summary>
+    /// Reads the length of an MPEG-4 descriptor (up to 4 bytes with 7 bits each).
+    /// </summary>
+    static uint32_t ReadDescriptorLength(BigEndianReader& reader)
+    {
+        uint32_t length = 0;
+        for (int idx = 0; idx < 4; ++idx)
+        {
+            uint8_t byte = reader.ReadU8();
+            length = (length << 7) | (byte & 0x7f);
+            if ((byte & 0x80) == 0)
+                break;
+        }
+        return length;
+    }
+
+    /// <summary>
+    /// Reads the object type and bitrates from the decoder configuration inside 'esds'.
+    /// </summary>
+    static void ParseEsds(const IsoBmffBox& esds, IsoBmffTrack& track)
+    {
+        uint8_t version;
+        BigEndianReader reader = ReadFullBoxHeader(esds, version);
+
+        if (reader.ReadU8() != 0x03) // ES_DescrTag
+            return;
+
+        ReadDescriptorLength(reader);
+        reader.ReadU16(); // ES_ID
+        uint8_t flags = reader.ReadU8();
+        if (flags & 0x80) // streamDependenceFlag
+            reader.ReadU16();
+        if (flags & 0x40) // URL_Flag
+            reader.Skip(reader.ReadU8());
+        if (flags & 0x20) // OCRstreamFlag
+            reader.ReadU16();
+
+        if (reader.ReadU8() != 0x04) // DecoderConfigDescrTag
+            return;
+
+        ReadDescriptorLength(reader);
+        track.objectTypeIndication = reader.ReadU8();
+        reader.ReadU8();  // streamType, upStream, reserved
+        reader.ReadU24(); // bufferSizeDB
+        const uint32_t maxBitrate = reader.ReadU32();
+        const uint32_t avgBitrate = reader.ReadU32();
+
+        // 'btrt' takes precedence:
+        if (track.avgBitrate == 0)
+        {
+            track.maxBitrate = maxBitrate;
+            track.avgBitrate = avgBitrate;
+        }
+    }
+
+    /// <summary>
+    /// Reads the boxes that follow the fixed part of a sample entry.
+    /// </summary>
+    static void ParseSampleEntryChildren(BigEndianReader& reader, IsoBmffTrack& track)
+    {
+        IsoBmffBox child;
+        while (ReadNextBox(reader, child))
+        {
+            if (child.type == MakeFourCC("btrt") && child.payloadSize >= 12)
+            {
+                BigEndianReader btrt(child.payload, child.payloadSize);
+                btrt.ReadU32(); // bufferSizeDB
+                track.maxBitrate = btrt.ReadU32();
+                track.avgBitrate = btrt.ReadU32();
+            }
+            else if (child.type == MakeFourCC("esds"))
+            {
+                ParseEsds(child, track);
+            }
+            else if (child.type == MakeFourCC("avcC") || child.type == MakeFourCC("hvcC"))
+            {
+                track.decoderConfig = child;
+            }
+            else if (child.type == MakeFourCC("wave")) // QuickTime wraps 'esds' in it
+            {
+                BigEndianReader wave(child.payload, child.payloadSize);
+                ParseSampleEntryChildren(wave, track);
+            }
+        }
+    }
+
+    static void ParseSampleDescription(const IsoBmffBox& stsd, IsoBmffTrack& track)
+    {
+        uint8_t version;
+        BigEndianReader reader = ReadFullBoxHeader(stsd, version);
+        if (reader.ReadU32() == 0)
+            return;
+
+        IsoBmffBox entry;
+        if (!ReadNextBox(reader, entry))
+            return;
+
+        track.codec = entry.type;
+
+        BigEndianReader entryReader(entry.payload, entry.payloadSize);
+        entryReader.Skip(6); // reserved
+        entryReader.ReadU16(); // data reference index
+
+        if (track.handlerType == MakeFourCC("vide"))
+        {
+            entryReader.Skip(16); // pre-defined & reserved
+            track.width = entryReader.ReadU16();
+            track.height = entryReader.ReadU16();
+            entryReader.Skip(50); // resolution, frame count, compressor name, depth, pre-defined
+            ParseSampleEntryChildren(entryReader, track);
+        }
+        else if (track.handlerType == MakeFourCC("soun"))
+        {
+            uint16_t qtVersion = entryReader.ReadU16();
+            entryReader.Skip(6); // revision & vendor
+            track.channelCount = entryReader.ReadU16();
+            track.sampleSize = entryReader.ReadU16();
+            entryReader.Skip(4); // compression id & packet size
+            track.sampleRate = entryReader.ReadU32() >> 16;
+
+            if (qtVersion == 1)
+            {
+                entryReader.Skip(16);
+            }
+            else if (qtVersion == 2)
+            {
+                entryReader.ReadU32(); // size of struct only
+                const uint64_t rateBits = entryReader.ReadU64();
+                double rate;
+                static_assert(sizeof rate == sizeof rateBits);
+                memcpy(&rate, &rateBits, sizeof rate);
+                track.sampleRate = static_cast<uint32_t>(rate);
+                track.channelCount = static_cast<uint16_t>(entryReader.ReadU32());
+                entryReader.ReadU32(); // always 0x7F000000
+                track.sampleSize = static_cast<uint16_t>(entryReader.ReadU32());
+                entryReader.Skip(12); // flags, bytes per packet, frames per packet
+            }
+
+            // sample rates that do not fit in 16 bits are given by the media timescale:
+            if (track.sampleRate == 0)
+                track.sampleRate = track.timescale;
+
+            ParseSampleEntryChildren(entryReader, track);
+        }
+    }
+
+    static void ParseSampleTable(const IsoBmffBox& stbl, IsoBmffTrack& track)
+    {
+        BigEndianReader reader(stbl.payload, stbl.payloadSize);
+        IsoBmffBox box;
+        while (ReadNextBox(reader, box))
+        {
+            switch (box.type)
+            {
+            case MakeFourCC("stsd"):
+                track.sampleDescription = box;
+                ParseSampleDescription(box, track);
+                break;
+
+            case MakeFourCC("stts"):
+                track.timeToSample = ReadTable(box, 8);
+                break;
+
+            case MakeFourCC("ctts"):
+                track.compositionOffsets = ReadTable(box, 8);
+                break;
+
+            case MakeFourCC("stss"):
+                track.syncSamples = ReadTable(box, 4);
+                track.hasSyncSampleTable = true;
+                break;
+
+            case MakeFourCC("stsc"):
+                track.sampleToChunk = ReadTable(box, 12);
+                break;
+
+            case MakeFourCC("stco"):
+                track.chunkOffsets = ReadTable(box, 4);
+                track.hasLargeChunkOffsets = false;
+                break;
+
+            case MakeFourCC("co64"):
+                track.chunkOffsets = ReadTable(box, 8);
+                track.hasLargeChunkOffsets = true;
+                break;
+
+            case MakeFourCC("stsz"):
+            {
+                uint8_t version;
+                BigEndianReader stsz = ReadFullBoxHeader(box, version);
+                track.constantSampleSize = stsz.ReadU32();
+                track.sampleCount = stsz.ReadU32();
+                if (track.constantSampleSize == 0)
+                {
+                    track.sampleSizes.entryCount = track.sampleCount;
+                    track.sampleSizes.data = stsz.Skip(static_cast<uint64_t>(track.sampleCount) * 4);
+                }
+                break;
+            }
+            }
+        }
+    }
+
+    static IsoBmffTrack ParseTrack(const IsoBmffBox& trak)
+    {
+        IsoBmffTrack track = {};
+        track.box = trak;
+
+        IsoBmffBox tkhd;
+        if (FindChildBox(trak, MakeFourCC("tkhd"), tkhd))
+        {
+            uint8_t version;
+            BigEndianReader reader = ReadFullBoxHeader(tkhd, version);
+            reader.Skip(version == 1 ? 16 : 8); // creation & modification time
+            track.trackId = reader.ReadU32();
+        }
+
+        IsoBmffBox mdia;
+        if (!FindChildBox(trak, MakeFourCC("mdia"), mdia))
+            return track;
+
+        IsoBmffBox box;
+        if (FindChildBox(mdia, MakeFourCC("mdhd"), box))
+        {
+            uint8_t version;
+            BigEndianReader reader = ReadFullBoxHeader(box, version);
+            reader.Skip(version == 1 ? 16 : 8); // creation & modification time
+            track.timescale = reader.ReadU32();
+            track.duration = (version == 1 ? reader.ReadU64() : reader.ReadU32());
+
+            // ISO-639-2/T code packed in 3 x 5 bits (QuickTime may have a Macintosh code instead):
+            const uint16_t language = reader.ReadU16() & 0x7fff;
+            if (language >= 0x400)
+            {
+                for (int shift = 10; shift >= 0; shift -= 5)
+                    track.language.push_back(static_cast<char>(((language >> shift) & 0x1f) + 0x60));
+            }
+        }
+
+        if (FindChildBox(mdia, MakeFourCC("hdlr"), box))
+        {
+            uint8_t version;
+            BigEndianReader reader = ReadFullBoxHeader(box, version);
+            reader.ReadU32(); // pre-defined
+            track.handlerType = reader.ReadU32();
+        }
+
+        IsoBmffBox minf, stbl;
+        if (FindChildBox(mdia, MakeFourCC("minf"), minf)
+            && FindChildBox(minf, MakeFourCC("stbl"), stbl))
+        {
+            ParseSampleTable(stbl, track);
+        }
+
+        return track;
+    }
+
+    static IsoBmffMovie ParseMovie(const IsoBmffBox& moov)
+    {
+        IsoBmffMovie movie = {};
+        movie.box = moov;
+
+        BigEndianReader reader(moov.payload, moov.payloadSize);
+        IsoBmffBox box;
+        while (ReadNextBox(reader, box))
+        {
+            switch (box.type)
+            {
+            case MakeFourCC("mvhd"):
+            {
+                uint8_t version;
+                BigEndianReader mvhd = ReadFullBoxHeader(box, version);
+                mvhd.Skip(version == 1 ? 16 : 8); // creation & modification time
+                movie.timescale = mvhd.ReadU32();
+                movie.duration = (version == 1 ? mvhd.ReadU64() : mvhd.ReadU32());
+                break;
+            }
+
+            case MakeFourCC("mvex"):
+                movie.isFragmented = true;
+                break;
+
+            case MakeFourCC("trak"):
+                movie.tracks.push_back(ParseTrack(box));
+                break;
+            }
+        }
+
+        return movie;
+    }
+
+    uint32_t GetSampleSize(const IsoBmffTrack& track, uint32_t sampleIdx)
+    {
+        if (track.constantSampleSize != 0)
+            return track.constantSampleSize;
+
+        if (sampleIdx >= track.sampleSizes.entryCount)
+            throw AppException("Sample index out of range in ISO base media file");
+
+        BigEndianReader reader(track.sampleSizes.data + sampleIdx * 4ULL, 4);
+        return reader.ReadU32();
+    }
+
+    IsoBmffSampleTimes::IsoBmffSampleTimes(const IsoBmffTrack& track)
+        : m_reader(track.timeToSample.data, track.timeToSample.entryCount * 8ULL)
+        , m_entriesLeft(track.timeToSample.entryCount)
+        , m_runStart(0)
+        , m_runTime(0)
+        , m_runCount(0)
+        , m_runDelta(0)
+    {
+    }
+
+    uint64_t IsoBmffSampleTimes::GetTime(uint32_t sampleIdx)
+    {
+        while (sampleIdx >= m_runStart + m_runCount && m_entriesLeft > 0)
+        {
+            m_runTime += static_cast<uint64_t>(m_runCount) * m_runDelta;
+            m_runStart += m_runCount;
+            m_runCount = m_reader.ReadU32();
+            m_runDelta = m_reader.ReadU32();
+            --m_entriesLeft;
+        }
+
+        if (sampleIdx < m_runStart || sampleIdx > m_runStart + m_runCount)
+            throw AppException("Time-to-sample table does not match sample count in ISO base media file");
+
+        return m_runTime + (sampleIdx - m_runStart) * m_runDelta;
+    }
+
+    std::vector<uint64_t> GetSampleTimes(const IsoBmffTrack& track)
+    {
+        std::vector<uint64_t> times;
+        times.reserve(static_cast<size_t>(track.sampleCount) + 1);
+
+        uint64_t time = 0;
+        BigEndianReader reader(track.timeToSample.data, track.timeToSample.entryCount * 8ULL);
+        for (uint32_t idx = 0; idx < track.timeToSample.entryCount; ++idx)
+        {
+            const uint32_t sampleCount = reader.ReadU32();
+            const uint32_t sampleDelta = reader.ReadU32();
+            for (uint32_t count = 0; count < sampleCount && times.size() < track.sampleCount; ++count)
+            {
+                times.push_back(time);
+                time += sampleDelta;
+            }
+        }
+
+        if (times.size() != track.sampleCount)
+            throw AppException("Time-to-sample table does not match sample count in ISO base media file");
+
+        times.push_back(time);
+        return times;
+    }
+
+    std::vector<IsoBmffSample> GetSamples(const IsoBmffTrack& track)
+    {
+        const std::vector<uint64_t> times = GetSampleTimes(track);
+
+        std::vector<IsoBmffSample> samples(track.sampleCount);
+        for (uint32_t idx = 0; idx < track.sampleCount; ++idx)
+        {
+            IsoBmffSample& sample = samples[idx];
+            sample.size = GetSampleSize(track, idx);
+            sample.decodeTime = times[idx];
+            sample.duration = static_cast<uint32_t>(times[idx + 1] - times[idx]);
+            sample.isSync = !track.hasSyncSampleTable;
+        }
+
+        // composition offsets (signed in version 1, but also in practice for version 0):
+        BigEndianReader ctts(track.compositionOffsets.data, track.compositionOffsets.entryCount * 8ULL);
+        for (uint32_t entryIdx = 0, sampleIdx = 0; entryIdx < track.compositionOffsets.entryCount; ++entryIdx)
+        {
+            const uint32_t sampleCount = ctts.ReadU32();
+            const auto offset = static_cast<int32_t>(ctts.ReadU32());
+            for (uint32_t count = 0; count < sampleCount && sampleIdx < track.sampleCount; ++count)
+                samples[sampleIdx++].compositionOffset = offset;
+        }
+
+        BigEndianReader stss(track.syncSamples.data, track.syncSamples.entryCount * 4ULL);
+        for (uint32_t entryIdx = 0; entryIdx < track.syncSamples.entryCount; ++entryIdx)
+        {
+            const uint32_t sampleNumber = stss.ReadU32();
+            if (sampleNumber == 0 || sampleNumber > track.sampleCount)
+                throw AppException("Sync sample out of range in ISO base media file");
+
+            samples[sampleNumber - 1].isSync = true;
+        }
+
+        // offsets from chunks:
+        const uint32_t offsetSize = track.hasLargeChunkOffsets ? 8 : 4;
+        BigEndianReader stsc(track.sampleToChunk.data, track.sampleToChunk.entryCount * 12ULL);
+        uint32_t sampleIdx = 0;
+        for (uint32_t entryIdx = 0; entryIdx < track.sampleToChunk.entryCount; ++entryIdx)
+        {
+            const uint32_t firstChunk = stsc.ReadU32();
+            const uint32_t samplesPerChunk = stsc.ReadU32();
+            stsc.ReadU32(); // sample description index
+
+            uint32_t endChunk = track.chunkOffsets.entryCount + 1;
+            if (entryIdx + 1 < track.sampleToChunk.entryCount)
+            {
+                BigEndianReader next(stsc.GetPosition(), 4);
+                endChunk = next.ReadU32();
+            }
+
+            if (firstChunk == 0 || endChunk > track.chunkOffsets.entryCount + 1)
+                throw AppException("Sample-to-chunk table out of range in ISO base media file");
+
+            for (uint32_t chunk = firstChunk; chunk < endChunk; ++chunk)
+            {
+                BigEndianReader chunkOffset(
+                    track.chunkOffsets.data + (chunk - 1) * static_cast<uint64_t>(offsetSize), offsetSize);
+
+                uint64_t offset = (offsetSize == 8 ? chunkOffset.ReadU64() : chunkOffset.ReadU32());
+                for (uint32_t count = 0; count < samplesPerChunk && sampleIdx < track.sampleCount; ++count)
+                {
+                    samples[sampleIdx].offset = offset;
+                    offset += samples[sampleIdx++].size;
+                }
+            }
+        }
+
+        if (sampleIdx != track.sampleCount)
+            throw AppException("Sample-to-chunk table does not match sample count in ISO base media file");
+
+        return samples;
+    }
+
+    bool IsIsoBmff(const uint8_t* data, uint64_t size)
+    {
+        if (size < 8)
+            return false;
+
+        static const auto topLevelTypes = std::to_array<uint32_t>({
+            MakeFourCC("ftyp"), MakeFourCC("moov"), MakeFourCC("mdat"),
+            MakeFourCC("free"), MakeFourCC("skip"), MakeFourCC("wide"), MakeFourCC("styp")
+        });
+
+        BigEndianReader reader(data, size);
+        reader.ReadU32(); // size
+        const uint32_t type = reader.ReadU32();
+        for (uint32_t candidate : topLevelTypes)
+        {
+            if (type == candidate)
+                return true;
+        }
+        return false;
+    }
+
+    IsoBmffMovie ParseIsoBmff(const uint8_t* data, uint64_t size)
+    {
+        IsoBmffBox fileType = {};
+        BigEndianReader reader(data, size);
+        IsoBmffBox box;
+        while (ReadNextBox(reader, box))
+        {
+            if (box.type == MakeFourCC("ftyp"))
+            {
+                fileType = box;
+            }
+            else if (box.type == MakeFourCC("moov"))
+            {
+                IsoBmffMovie movie = ParseMovie(box);
+                movie.fileType = fileType;
+                return movie;
+            }
+        }
+
+        throw AppException("ISO base media file has no movie box");
+    }
+}
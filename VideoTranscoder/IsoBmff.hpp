@@ -0,0 +1,325 @@
+#pragma once
+
+#include <cinttypes>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace application
+{
+    /// <summary>
+    /// Makes the 32-bit code of a box type (or any other four-character code).
+    /// </summary>
+    constexpr uint32_t MakeFourCC(const char (&code)[5])
+    {
+        return (static_cast<uint32_t>(static_cast<uint8_t>(code[0])) << 24)
+            | (static_cast<uint32_t>(static_cast<uint8_t>(code[1])) << 16)
+            | (static_cast<uint32_t>(static_cast<uint8_t>(code[2])) << 8)
+            | static_cast<uint32_t>(static_cast<uint8_t>(code[3]));
+    }
+
+    /// <summary>
+    /// Bounds checked reader of big-endian data.
+    /// </summary>
+    /// <remarks>Throws <see cref="AppException"/> when reading past the end.</remarks>
+    class BigEndianReader
+    {
+    private:
+
+        const uint8_t* m_pos;
+        const uint8_t* m_end;
+
+        void Require(uint64_t count) const;
+
+    public:
+
+        BigEndianReader(const uint8_t* data, uint64_t size)
+            : m_pos(data)
+            , m_end(data + size)
+        {
+        }
+
+        const uint8_t* GetPosition() const
+        {
+            return m_pos;
+        }
+
+        uint64_t GetRemaining() const
+        {
+            return static_cast<uint64_t>(m_end - m_pos);
+        }
+
+        uint8_t ReadU8();
+        uint16_t ReadU16();
+        uint32_t ReadU24();
+        uint32_t ReadU32();
+        uint64_t ReadU64();
+
+        /// <summary>
+        /// Skips bytes and returns where they start.
+        /// </summary>
+        const uint8_t* Skip(uint64_t count);
+    };
+
+    /// <summary>
+    /// Writer of big-endian data into a buffer.
+    /// </summary>
+    class BigEndianWriter
+    {
+    private:
+
+        std::vector<uint8_t>& m_buffer;
+
+    public:
+
+        explicit BigEndianWriter(std::vector<uint8_t>& buffer)
+            : m_buffer(buffer)
+        {
+        }
+
+        size_t GetPosition() const
+        {
+            return m_buffer.size();
+        }
+
+        void WriteU8(uint8_t value);
+        void WriteU16(uint16_t value);
+        void WriteU24(uint32_t value);
+        void WriteU32(uint32_t value);
+        void WriteU64(uint64_t value);
+        void WriteBytes(const uint8_t* data, size_t count);
+
+        /// <summary>
+        /// Overwrites a 32-bit value previously written.
+        /// </summary>
+        void PatchU32(size_t position, uint32_t value);
+
+        /// <summary>
+        /// Overwrites a 64-bit value previously written.
+        /// </summary>
+        void PatchU64(size_t position, uint64_t value);
+
+        /// <summary>
+        /// Writes the header of a box whose size is patched by <see cref="EndBox"/>.
+        /// </summary>
+        /// <returns>The position of the box, to pass to <see cref="EndBox"/>.</returns>
+        size_t BeginBox(uint32_t type);
+
+        /// <summary>
+        /// Writes the header of a full box whose size is patched by <see cref="EndBox"/>.
+        /// </summary>
+        size_t BeginFullBox(uint32_t type, uint8_t version, uint32_t flags);
+
+        void EndBox(size_t boxPosition);
+    };
+
+    /// <summary>
+    /// A box located in memory.
+    /// </summary>
+    struct IsoBmffBox
+    {
+        uint32_t type;
+
+        /// <summary>Where the box (header) starts.</summary>
+        const uint8_t* begin;
+
+        /// <summary>Where the box content starts.</summary>
+        const uint8_t* payload;
+
+        uint64_t payloadSize;
+
+        uint64_t GetSize() const
+        {
+            return static_cast<uint64_t>(payload - begin) + payloadSize;
+        }
+    };
+
+    /// <summary>
+    /// Reads the next box from a sequence of boxes.
+    /// </summary>
+    /// <param name="reader">Reader positioned at a box header.</param>
+    /// <param name="box">Receives the box, whose content is skipped by the reader.</param>
+    /// <returns>Whether there was a box to read.</returns>
+    bool ReadNextBox(BigEndianReader& reader, IsoBmffBox& box);
+
+    /// <summary>
+    /// A table of fixed-size big-endian entries in the file (as mapped in memory).
+    /// </summary>
+    struct IsoBmffTable
+    {
+        const uint8_t* data = nullptr;
+        uint32_t entryCount = 0;
+    };
+
+    /// <summary>
+    /// What matters from a track ('trak' box) for transcoding decisions.
+    /// </summary>
+    struct IsoBmffTrack
+    {
+        uint32_t trackId;
+
+        /// <summary>Handler type, such as 'vide' or 'soun'.</summary>
+        uint32_t handlerType;
+
+        uint32_t timescale;
+
+        /// <summary>Media duration in units of timescale.</summary>
+        uint64_t duration;
+
+        /// <summary>Language (ISO-639-2/T code) from 'mdhd', empty when unknown.</summary>
+        std::string language;
+
+        /// <summary>Format of the (first) sample entry, such as 'avc1' or 'mp4a'.</summary>
+        uint32_t codec;
+
+        uint16_t width;
+        uint16_t height;
+
+        /// <summary>Object type in 'esds' (such as 0x40 for MPEG-4 audio), zero when absent.</summary>
+        uint8_t objectTypeIndication;
+
+        uint16_t channelCount;
+        uint16_t sampleSize;
+        uint32_t sampleRate;
+
+        /// <summary>Bitrates declared in 'btrt' or 'esds' (bits/s), zero when absent.</summary>
+        uint32_t avgBitrate;
+        uint32_t maxBitrate;
+
+        /// <summary>'stts' entries: (sample count, sample delta).</summary>
+        IsoBmffTable timeToSample;
+
+        /// <summary>'stsz' entries (sample size), empty when all samples have constant size.</summary>
+        IsoBmffTable sampleSizes;
+
+        uint32_t constantSampleSize;
+        uint32_t sampleCount;
+
+        /// <summary>'ctts' entries: (sample count, composition offset).</summary>
+        IsoBmffTable compositionOffsets;
+
+        /// <summary>'stss' entries (1-based sample number), empty when all samples are sync samples.</summary>
+        IsoBmffTable syncSamples;
+        bool hasSyncSampleTable;
+
+        /// <summary>'stsc' entries: (first chunk, samples per chunk, sample description index).</summary>
+        IsoBmffTable sampleToChunk;
+
+        /// <summary>'stco' or 'co64' entries (chunk offset in file).</summary>
+        IsoBmffTable chunkOffsets;
+        bool hasLargeChunkOffsets;
+
+        /// <summary>The 'stsd' box.</summary>
+        IsoBmffBox sampleDescription;
+
+        /// <summary>The decoder configuration ('avcC' or 'hvcC') in the sample entry, or a box with no type if absent.</summary>
+        IsoBmffBox decoderConfig;
+
+        /// <summary>The 'trak' box.</summary>
+        IsoBmffBox box;
+    };
+
+    /// <summary>
+    /// A sample of a track, with everything from the sample tables.
+    /// </summary>
+    struct IsoBmffSample
+    {
+        /// <summary>Offset of the sample data in the file.</summary>
+        uint64_t offset;
+        uint32_t size;
+
+        /// <summary>Decoding time in units of track timescale.</summary>
+        uint64_t decodeTime;
+        uint32_t duration;
+        int32_t compositionOffset;
+        bool isSync;
+    };
+
+    /// <summary>
+    /// What matters from a movie ('moov' box) for transcoding decisions.
+    /// </summary>
+    struct IsoBmffMovie
+    {
+        uint32_t timescale;
+
+        /// <summary>Movie duration in units of timescale.</summary>
+        uint64_t duration;
+
+        /// <summary>Whether the samples are in movie fragments rather than in the sample tables.</summary>
+        bool isFragmented;
+
+        std::vector<IsoBmffTrack> tracks;
+
+        /// <summary>The 'ftyp' box, or a box with no type if absent.</summary>
+        IsoBmffBox fileType;
+
+        /// <summary>The 'moov' box.</summary>
+        IsoBmffBox box;
+    };
+
+    /// <summary>
+    /// Gets the size of a sample in a track.
+    /// </summary>
+    /// <param name="track">The track.</param>
+    /// <param name="sampleIdx">The zero-based index of the sample.</param>
+    uint32_t GetSampleSize(const IsoBmffTrack& track, uint32_t sampleIdx);
+
+    /// <summary>
+    /// Walks the decoding times of the samples in a track run by run along 'stts',
+    /// without expanding the table, which may stand for billions of samples (PCM).
+    /// </summary>
+    /// <remarks>Throws <see cref="AppException"/> if the table has fewer samples than the track.</remarks>
+    class IsoBmffSampleTimes
+    {
+    private:
+
+        BigEndianReader m_reader;
+        uint32_t m_entriesLeft;
+
+        /// <summary>The current run: index of its first sample, decoding time of it, and so on.</summary>
+        uint64_t m_runStart;
+        uint64_t m_runTime;
+        uint32_t m_runCount;
+        uint32_t m_runDelta;
+
+    public:
+
+        explicit IsoBmffSampleTimes(const IsoBmffTrack& track);
+
+        /// <summary>
+        /// Gets the decoding time of a sample, or the end of the last one for the sample count.
+        /// </summary>
+        /// <param name="sampleIdx">The zero-based index of the sample, not before the one asked last.</param>
+        /// <returns>The decoding time in units of track timescale.</returns>
+        uint64_t GetTime(uint32_t sampleIdx);
+    };
+
+    /// <summary>
+    /// Expands the decoding times of all samples in a track from 'stts'.
+    /// </summary>
+    /// <returns>The decoding times (in units of track timescale), plus the end of the last sample.</returns>
+    std::vector<uint64_t> GetSampleTimes(const IsoBmffTrack& track);
+
+    /// <summary>
+    /// Expands the sample tables of a track into the list of its samples.
+    /// </summary>
+    /// <remarks>Throws <see cref="AppException"/> if the tables are inconsistent.</remarks>
+    std::vector<IsoBmffSample> GetSamples(const IsoBmffTrack& track);
+
+    /// <summary>
+    /// Tells whether the data starts like an ISO base media file (MP4, MOV, 3GP, etc).
+    /// </summary>
+    bool IsIsoBmff(const uint8_t* data, uint64_t size);
+
+    /// <summary>
+    /// Parses the movie structure of an ISO base media file.
+    /// </summary>
+    /// <param name="data">The whole file (as mapped in memory).</param>
+    /// <param name="size">The size of the file.</param>
+    /// <returns>The movie, whose tables point into the given data.</returns>
+    /// <remarks>
+    /// Only box headers are visited at top level, so most of the media data is never touched.
+    /// Throws <see cref="AppException"/> if the structure is malformed or there is no movie.
+    /// </remarks>
+    IsoBmffMovie ParseIsoBmff(const uint8_t* data, uint64_t size);
+}
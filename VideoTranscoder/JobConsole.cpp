@@ -0,0 +1,48 @@
+#include "JobConsole.hpp"
+
+#include <iostream>
+
+namespace application
+{
+    // job of the calling thread, if the job count is not zero:
+    static thread_local size_t s_jobIdx = 0;
+    static thread_local size_t s_jobCount = 0;
+
+    std::mutex& GetConsoleMutex()
+    {
+        static std::mutex consoleMutex;
+        return consoleMutex;
+    }
+
+    JobConsoleScope::JobConsoleScope(size_t jobIdx, size_t jobCount)
+        : m_previousJobIdx(s_jobIdx)
+        , m_previousJobCount(s_jobCount)
+    {
+        s_jobIdx = jobIdx;
+        s_jobCount = jobCount;
+    }
+
+    JobConsoleScope::~JobConsoleScope()
+    {
+        s_jobIdx = m_previousJobIdx;
+        s_jobCount = m_previousJobCount;
+    }
+
+    void PrintJobMessage(const std::string& message)
+    {
+        if (s_jobCount != 0)
+        {
+            PrintJobMessage(s_jobIdx, s_jobCount, message);
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(GetConsoleMutex());
+        std::cout << std::endl << message << std::endl;
+    }
+
+    void PrintJobMessage(size_t jobIdx, size_t jobCount, const std::string& message)
+    {
+        std::lock_guard<std::mutex> lock(GetConsoleMutex());
+        std::cout << "[" << (jobIdx + 1) << '/' << jobCount << "] " << message << std::endl;
+    }
+}
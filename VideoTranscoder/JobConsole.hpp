@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+
+namespace application
+{
+    /// <summary>
+    /// Gets the mutex that every thread holds while writing to the console,
+    /// so that the lines of concurrent jobs do not interleave.
+    /// </summary>
+    std::mutex& GetConsoleMutex();
+
+    /// <summary>
+    /// Marks the calling thread as running a job among others, for as long as the object lives,
+    /// so that <see cref="PrintJobMessage"/> tells which job a message comes from.
+    /// </summary>
+    /// <remarks>
+    /// Scopes can be nested: the previous job of the thread is restored on destruction.
+    /// </remarks>
+    class JobConsoleScope
+    {
+    private:
+
+        size_t m_previousJobIdx;
+        size_t m_previousJobCount;
+
+    public:
+
+        JobConsoleScope(size_t jobIdx, size_t jobCount);
+        ~JobConsoleScope();
+
+        JobConsoleScope(const JobConsoleScope&) = delete;
+        JobConsoleScope& operator=(const JobConsoleScope&) = delete;
+    };
+
+    /// <summary>
+    /// Prints a message about the job of the calling thread, holding the console mutex.
+    /// </summary>
+    /// <remarks>
+    /// Inside a <see cref="JobConsoleScope"/> the message takes a line of its own prefixed
+    /// by "[job/count]", otherwise it is set apart by blank lines (a single job owns the console).
+    /// </remarks>
+    void PrintJobMessage(const std::string& message);
+
+    /// <summary>
+    /// Prints a message about the given job out of many, holding the console mutex.
+    /// </summary>
+    void PrintJobMessage(size_t jobIdx, size_t jobCount, const std::string& message);
+}
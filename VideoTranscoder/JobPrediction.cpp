@@ -0,0 +1,268 @@
+#include "JobPrediction.hpp"
+
+#include "JobScheduler.hpp"
+#include "Mp4Probe.hpp"
+#include "ProgressSubscribers.hpp"
+#include "TranscodeJob.hpp"
+#include "Utf8Path.hpp"
+
+#include <MinCppXtra/traceable_exception.hpp>
+
+#include <algorithm>
+#include <filesystem>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+
+namespace application
+{
+    using namespace std::chrono;
+
+    /// <summary>
+    /// How long every excerpt is.
+    /// </summary>
+    static constexpr seconds excerptDuration(6);
+
+    /// <summary>
+    /// How far the target size factor is corrected at most (either way), beyond which
+    /// the rate control of the encoder is deemed not to respond and the target missed.
+    /// </summary>
+    static constexpr double maxSizeFactorCorrection = 2.0;
+
+    std::vector<PresentationRange> PlanExcerpts(
+        const std::vector<nanoseconds>& keyframeTimes,
+        nanoseconds duration,
+        uint32_t excerptCount,
+        nanoseconds excerptDuration)
+    {
+        std::vector<PresentationRange> excerpts;
+        if (excerptCount == 0 || duration < 2 * excerptCount * excerptDuration)
+            return excerpts;
+
+        nanoseconds lastStop(0);
+        for (uint32_t idx = 0; idx < excerptCount; ++idx)
+        {
+            const nanoseconds center = duration * (2 * idx + 1) / (2 * excerptCount);
+            nanoseconds start = center - excerptDuration / 2;
+
+            // the last key frame not after the ideal start, or else the first one after the previous excerpt:
+            if (!keyframeTimes.empty())
+            {
+                auto iter = std::upper_bound(keyframeTimes.begin(), keyframeTimes.end(), start);
+                start = iter != keyframeTimes.begin() ? *std::prev(iter) : nanoseconds(0);
+
+                if (start < lastStop)
+                {
+                    iter = std::lower_bound(keyframeTimes.begin(), keyframeTimes.end(), lastStop);
+                    if (iter == keyframeTimes.end())
+                        break;
+                    start = *iter;
+                }
+            }
+
+            const nanoseconds stop = std::min(start + excerptDuration, duration);
+            if (stop <= start)
+                break;
+
+            excerpts.push_back(PresentationRange{ start, stop });
+            lastStop = stop;
+        }
+
+        return excerpts;
+    }
+
+    /// <summary>
+    /// What was measured of an excerpt.
+    /// </summary>
+    struct ExcerptResult
+    {
+        bool succeeded;
+        nanoseconds elapsedTime;
+        std::optional<uint32_t> videoBitrate;
+    };
+
+    static double ToSeconds(nanoseconds time)
+    {
+        return duration<double>(time).count();
+    }
+
+    std::optional<JobPrediction> PredictJob(MediaBackend& backend,
+                                            const std::string& inputFName,
+                                            const std::string& outputFName,
+                                            const EncoderSelection& videoEncoder,
+                                            double targetSizeFactor,
+                                            uint32_t excerptCount,
+                                            seconds timeBudget)
+    {
+        nanoseconds duration;
+        MediaInfo sourceInfo;
+        std::vector<PresentationRange> excerpts;
+        {
+            auto input = backend.OpenInput(inputFName);
+            duration = input->GetDuration();
+            sourceInfo = input->GetMediaInfo();
+            excerpts = PlanExcerpts(input->GetKeyframeTimes(), duration, excerptCount, excerptDuration);
+        }
+
+        if (excerpts.empty())
+            return std::nullopt;
+
+        const Encoder encoder = videoEncoder.Select(sourceInfo);
+        const TranscodeSettings settings = DecideTranscodeSettings(sourceInfo, encoder, targetSizeFactor);
+        if (settings.streamCopy)
+            return std::nullopt;
+
+        std::vector<std::string> excerptFNames;
+        for (size_t idx = 0; idx < excerpts.size(); ++idx)
+            excerptFNames.push_back(outputFName + ".excerpt" + std::to_string(idx) + ".mp4");
+
+        std::vector<ExcerptResult> results(excerpts.size());
+        {
+            // declared before the jobs, so that it outlives them:
+            ProgressHub progressHub;
+            auto keeper = std::make_shared<LastSampleKeeper>();
+            progressHub.Subscribe(keeper);
+
+            JobScheduler scheduler(std::min(excerptCount, JobScheduler::GetDefaultConcurrency()));
+            scheduler.Run(excerpts.size(),
+                [&](size_t idx)
+                {
+                    try
+                    {
+                        auto threadScope = backend.EnterThread();
+
+                        TranscodeJob job(backend, inputFName, excerptFNames[idx], encoder, targetSizeFactor, excerpts[idx]);
+                        job.Track(progressHub, excerptFNames[idx], milliseconds(100));
+                        job.Start();
+
+                        while (!job.Wait(hours(1)))
+                            continue;
+
+                        results[idx].succeeded = true;
+                    }
+                    catch (mincpp::TraceableException&)
+                    {
+                        // the prediction goes on with the excerpts that succeed
+                    }
+                });
+
+            progressHub.Flush();
+            for (size_t idx = 0; idx < excerpts.size(); ++idx)
+            {
+                if (auto sample = keeper->GetLastSample(excerptFNames[idx]))
+                    results[idx].elapsedTime = sample->elapsedTime;
+            }
+        }
+
+        // probed once the jobs have closed their outputs:
+        for (size_t idx = 0; idx < excerpts.size(); ++idx)
+        {
+            if (results[idx].succeeded)
+                results[idx].videoBitrate = ProbeVideoBitrate(excerptFNames[idx]);
+
+            std::error_code error;
+            std::filesystem::remove(ToPath(excerptFNames[idx]), error);
+        }
+
+        nanoseconds mediaTime(0), elapsedTime(0);
+        double videoBits = 0.0, measuredSecs = 0.0;
+        uint32_t succeededCount = 0;
+        for (size_t idx = 0; idx < excerpts.size(); ++idx)
+        {
+            const ExcerptResult& result = results[idx];
+            if (!result.succeeded)
+                continue;
+
+            ++succeededCount;
+            const nanoseconds length = excerpts[idx].stop - excerpts[idx].start;
+            mediaTime += length;
+            elapsedTime += result.elapsedTime;
+
+            if (result.videoBitrate)
+            {
+                videoBits += (double)*result.videoBitrate * ToSeconds(length);
+                measuredSecs += ToSeconds(length);
+            }
+        }
+
+        if (succeededCount == 0)
+            return std::nullopt;
+
+        JobPrediction prediction = {};
+        prediction.excerptCount = succeededCount;
+
+        // measured on concurrent excerpts, so on the conservative side for a job running alone:
+        if (elapsedTime.count() > 0)
+            prediction.speed = (double)mediaTime.count() / elapsedTime.count();
+
+        if (measuredSecs > 0.0 && settings.videoAvgBitrate != 0)
+            prediction.bitrateRatio = videoBits / measuredSecs / settings.videoAvgBitrate;
+
+        // correct the target by what the encoder over- or undershoots, within reason:
+        prediction.correctedSizeFactor = targetSizeFactor;
+        if (prediction.bitrateRatio > 0.0)
+        {
+            const double corrected = targetSizeFactor / prediction.bitrateRatio;
+            prediction.correctedSizeFactor = std::clamp(corrected,
+                targetSizeFactor / maxSizeFactorCorrection,
+                std::min(targetSizeFactor * maxSizeFactorCorrection, 1.0));
+
+            prediction.missesSizeTarget = prediction.correctedSizeFactor != corrected;
+        }
+
+        const double videoBitrate = (double)sourceInfo.videoProfile.avgBitrate * prediction.correctedSizeFactor
+            * (prediction.bitrateRatio > 0.0 ? prediction.bitrateRatio : 1.0);
+
+        prediction.outputSize = static_cast<uint64_t>(
+            (videoBitrate / 8 + settings.audioAvgBytesPerSec) * ToSeconds(duration));
+
+        std::error_code error;
+        const auto inputSize = std::filesystem::file_size(ToPath(inputFName), error);
+        if (!error && inputSize != 0)
+            prediction.compressionRatio = (double)prediction.outputSize / inputSize;
+
+        if (prediction.speed > 0.0)
+            prediction.encodeTime = duration_cast<nanoseconds>(duration / prediction.speed);
+
+        // trade quality for speed in proportion to how much the budget is exceeded:
+        prediction.videoQualityVsSpeed = settings.videoQualityVsSpeed;
+        if (timeBudget.count() > 0 && prediction.encodeTime > timeBudget)
+        {
+            prediction.missesTimeBudget = true;
+            prediction.videoQualityVsSpeed = std::max(1U, static_cast<uint32_t>(
+                settings.videoQualityVsSpeed * ToSeconds(timeBudget) / ToSeconds(prediction.encodeTime)));
+        }
+
+        return prediction;
+    }
+
+    std::string DescribeJobPrediction(const JobPrediction& prediction)
+    {
+        std::ostringstream oss;
+        oss << std::fixed << std::setprecision(1)
+            << "predicted from " << prediction.excerptCount << " excerpts: output "
+            << prediction.outputSize / 1e6 << " MB";
+
+        if (prediction.compressionRatio > 0.0)
+            oss << std::setprecision(2) << " (" << prediction.compressionRatio << " of input)";
+
+        oss << std::setprecision(1) << ", encode time "
+            << duration_cast<seconds>(prediction.encodeTime).count() << " s at "
+            << prediction.speed << "x real time";
+
+        if (prediction.bitrateRatio > 0.0)
+        {
+            oss << std::setprecision(2) << ", bitrate " << prediction.bitrateRatio
+                << "x the target (size factor corrected to " << std::setprecision(3)
+                << prediction.correctedSizeFactor << ')';
+        }
+
+        if (prediction.missesSizeTarget)
+            oss << " - WILL MISS THE SIZE TARGET";
+
+        if (prediction.missesTimeBudget)
+            oss << " - OVER THE TIME BUDGET (quality vs speed lowered to " << prediction.videoQualityVsSpeed << ')';
+
+        return oss.str();
+    }
+}
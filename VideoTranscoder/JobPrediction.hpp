@@ -0,0 +1,98 @@
+#pragma once
+
+#include "EncoderSelection.hpp"
+#include "MediaBackend.hpp"
+
+#include <chrono>
+#include <cinttypes>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace application
+{
+    /// <summary>
+    /// What is expected of a job, extrapolated from excerpts of its input encoded beforehand.
+    /// </summary>
+    struct JobPrediction
+    {
+        /// <summary>How many excerpts were encoded.</summary>
+        uint32_t excerptCount;
+
+        /// <summary>
+        /// Achieved video bitrate of the excerpts as a fraction of the target
+        /// (above 1 when the encoder overshoots), or zero if it could not be measured.
+        /// </summary>
+        double bitrateRatio;
+
+        /// <summary>Transcoding speed of the excerpts as a multiple of real time.</summary>
+        double speed;
+
+        /// <summary>Target size factor to request, so that the output lands on the one requested.</summary>
+        double correctedSizeFactor;
+
+        /// <summary>"Quality vs speed" for the video encoder, lowered if the time budget is short.</summary>
+        uint32_t videoQualityVsSpeed;
+
+        /// <summary>Size of the output, once corrected.</summary>
+        uint64_t outputSize;
+
+        /// <summary>Size of the output as a fraction of the input, or zero if the input size is unknown.</summary>
+        double compressionRatio;
+
+        /// <summary>How long the whole job takes, at the speed of the excerpts.</summary>
+        std::chrono::nanoseconds encodeTime;
+
+        /// <summary>Whether the output is not going to meet the size target even with correction.</summary>
+        bool missesSizeTarget;
+
+        /// <summary>Whether the job is going to take longer than its time budget.</summary>
+        bool missesTimeBudget;
+    };
+
+    /// <summary>
+    /// Spreads excerpts across a presentation, each one at the middle of an equal
+    /// part of it and starting at a key frame.
+    /// </summary>
+    /// <param name="keyframeTimes">Presentation times of the key frames, in ascending order.</param>
+    /// <param name="duration">The duration of the presentation.</param>
+    /// <param name="excerptCount">How many excerpts are desired.</param>
+    /// <param name="excerptDuration">The length of every excerpt.</param>
+    /// <returns>
+    /// The excerpts in ascending order without overlap, or none when the presentation is too short
+    /// for excerpts to be worth it (less than twice their total length).
+    /// </returns>
+    std::vector<PresentationRange> PlanExcerpts(
+        const std::vector<std::chrono::nanoseconds>& keyframeTimes,
+        std::chrono::nanoseconds duration,
+        uint32_t excerptCount,
+        std::chrono::nanoseconds excerptDuration);
+
+    /// <summary>
+    /// Predicts the outcome of a job by encoding short excerpts of its input in parallel,
+    /// then decides the corrections to apply to the full encode.
+    /// </summary>
+    /// <param name="backend">The media backend.</param>
+    /// <param name="inputFName">The input file (UTF-8 encoded).</param>
+    /// <param name="outputFName">The output of the job (UTF-8 encoded), next to which excerpts are written.</param>
+    /// <param name="videoEncoder">The video encoder of the job.</param>
+    /// <param name="targetSizeFactor">The target size factor requested for the job.</param>
+    /// <param name="excerptCount">How many excerpts to encode.</param>
+    /// <param name="timeBudget">How long the job may take, or zero for no limit.</param>
+    /// <returns>
+    /// The prediction, or nothing if the input is too short, would be copied rather than
+    /// encoded, or no excerpt could be encoded.
+    /// </returns>
+    std::optional<JobPrediction> PredictJob(MediaBackend& backend,
+                                            const std::string& inputFName,
+                                            const std::string& outputFName,
+                                            const EncoderSelection& videoEncoder,
+                                            double targetSizeFactor,
+                                            uint32_t excerptCount,
+                                            std::chrono::seconds timeBudget);
+
+    /// <summary>
+    /// Describes a prediction in one line for the console.
+    /// </summary>
+    std::string DescribeJobPrediction(const JobPrediction& prediction);
+}
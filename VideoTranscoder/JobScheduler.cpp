@@ -0,0 +1,85 @@
+#include "JobScheduler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace application
+{
+    JobScheduler::JobScheduler(uint32_t maxConcurrentJobs)
+        : m_maxConcurrentJobs(maxConcurrentJobs > 0 ? maxConcurrentJobs : GetDefaultConcurrency())
+    {
+    }
+
+    uint32_t JobScheduler::GetDefaultConcurrency()
+    {
+        const uint32_t qtCores = std::thread::hardware_concurrency();
+        return std::clamp(qtCores / 4, 1U, 4U);
+    }
+
+    void JobScheduler::Run(size_t jobCount, const std::function<void(size_t jobIdx)>& job) const
+    {
+        Run(jobCount, 0, [&job](size_t jobIdx, bool) { job(jobIdx); });
+    }
+
+    void JobScheduler::Run(size_t jobCount,
+                           uint32_t hardwareSlots,
+                           const std::function<void(size_t jobIdx, bool useHardware)>& job) const
+    {
+        std::atomic<size_t> nextJobIdx(0);
+        std::exception_ptr firstFailure;
+        std::mutex failureMutex;
+
+        uint32_t freeHardwareSlots = hardwareSlots;
+        std::mutex slotsMutex;
+
+        auto worker = [&]()
+        {
+            size_t jobIdx;
+            while ((jobIdx = nextJobIdx.fetch_add(1)) < jobCount)
+            {
+                bool useHardware = false;
+                {
+                    std::lock_guard<std::mutex> lock(slotsMutex);
+                    if (freeHardwareSlots > 0)
+                    {
+                        --freeHardwareSlots;
+                        useHardware = true;
+                    }
+                }
+
+                try
+                {
+                    job(jobIdx, useHardware);
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(failureMutex);
+                    if (!firstFailure)
+                        firstFailure = std::current_exception();
+                }
+
+                if (useHardware)
+                {
+                    std::lock_guard<std::mutex> lock(slotsMutex);
+                    ++freeHardwareSlots;
+                }
+            }
+        };
+
+        const size_t qtWorkers = std::min<size_t>(m_maxConcurrentJobs, jobCount);
+        std::vector<std::thread> workers;
+        workers.reserve(qtWorkers);
+        for (size_t idx = 0; idx < qtWorkers; ++idx)
+            workers.emplace_back(worker);
+
+        for (std::thread& thread : workers)
+            thread.join();
+
+        if (firstFailure)
+            std::rethrow_exception(firstFailure);
+    }
+}
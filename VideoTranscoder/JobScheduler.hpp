@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cinttypes>
+#include <functional>
+
+namespace application
+{
+    /// <summary>
+    /// Runs a list of jobs in worker threads, while capping how many of them
+    /// are running at the same time (each job holds an encoder session).
+    /// </summary>
+    class JobScheduler
+    {
+    private:
+
+        const uint32_t m_maxConcurrentJobs;
+
+    public:
+
+        /// <summary>
+        /// Creates a new instance.
+        /// </summary>
+        /// <param name="maxConcurrentJobs">
+        /// How many jobs can run at the same time, or zero to use <see cref="GetDefaultConcurrency"/>.
+        /// </param>
+        explicit JobScheduler(uint32_t maxConcurrentJobs);
+
+        /// <summary>
+        /// Gets a sensible cap for concurrent encoder sessions on this machine.
+        /// </summary>
+        /// <remarks>
+        /// Each encoder session is already multi-threaded, and hardware encoders
+        /// usually admit only a handful of simultaneous sessions.
+        /// </remarks>
+        static uint32_t GetDefaultConcurrency();
+
+        uint32_t GetMaxConcurrentJobs() const
+        {
+            return m_maxConcurrentJobs;
+        }
+
+        /// <summary>
+        /// Runs the jobs in the order of their indexes and blocks until all of them are done.
+        /// </summary>
+        /// <param name="jobCount">How many jobs there are.</param>
+        /// <param name="job">The job to run, given its index in [0, jobCount).</param>
+        /// <remarks>
+        /// Jobs are expected to handle their own failures. If one throws anyway,
+        /// the remaining jobs still run and the first exception is rethrown at the end.
+        /// </remarks>
+        void Run(size_t jobCount, const std::function<void(size_t jobIdx)>& job) const;
+
+        /// <summary>
+        /// Runs the jobs like <see cref="Run"/>, but placing them on hardware encoders
+        /// while there are slots left, and on software encoders otherwise.
+        /// </summary>
+        /// <param name="jobCount">How many jobs there are.</param>
+        /// <param name="hardwareSlots">How many jobs can run on hardware encoders at the same time.</param>
+        /// <param name="job">
+        /// The job to run, given its index in [0, jobCount) and whether it holds a hardware slot.
+        /// </param>
+        /// <remarks>A job releases its hardware slot when done, for the next job to take.</remarks>
+        void Run(size_t jobCount,
+                 uint32_t hardwareSlots,
+                 const std::function<void(size_t jobIdx, bool useHardware)>& job) const;
+    };
+}
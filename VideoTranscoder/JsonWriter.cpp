@@ -0,0 +1,126 @@
+#include "JsonWriter.hpp"
+
+#include <cmath>
+#include <iomanip>
+
+namespace application
+{
+    std::string EscapeJson(const std::string& text)
+    {
+        std::ostringstream oss;
+        for (char ch : text)
+        {
+            switch (ch)
+            {
+            case '"':
+                oss << "\\\"";
+                break;
+            case '\\':
+                oss << "\\\\";
+                break;
+            case '\n':
+                oss << "\\n";
+                break;
+            case '\r':
+                oss << "\\r";
+                break;
+            case '\t':
+                oss << "\\t";
+                break;
+            default:
+                if (static_cast<unsigned char>(ch) < 0x20)
+                    oss << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)ch << std::dec;
+                else
+                    oss << ch;
+            }
+        }
+        return oss.str();
+    }
+
+    JsonWriter::JsonWriter(bool indented)
+        : m_indented(indented)
+    {
+        m_output << std::setprecision(6);
+    }
+
+    void JsonWriter::WriteKey(const char* key)
+    {
+        if (!m_emptyScopes.empty())
+        {
+            if (!m_emptyScopes.back())
+                m_output << ',';
+
+            m_emptyScopes.back() = false;
+        }
+
+        if (m_indented && !m_emptyScopes.empty())
+            m_output << '\n' << std::string(2 * m_emptyScopes.size(), ' ');
+
+        if (key != nullptr)
+            m_output << '"' << EscapeJson(key) << (m_indented ? "\": " : "\":");
+    }
+
+    JsonWriter& JsonWriter::BeginObject(const char* key)
+    {
+        WriteKey(key);
+        m_output << '{';
+        m_emptyScopes.push_back(true);
+        return *this;
+    }
+
+    JsonWriter& JsonWriter::EndObject()
+    {
+        const bool empty = m_emptyScopes.back();
+        m_emptyScopes.pop_back();
+
+        if (m_indented && !empty)
+            m_output << '\n' << std::string(2 * m_emptyScopes.size(), ' ');
+
+        m_output << '}';
+        return *this;
+    }
+
+    JsonWriter& JsonWriter::Write(const char* key, const std::string& value)
+    {
+        WriteKey(key);
+        m_output << '"' << EscapeJson(value) << '"';
+        return *this;
+    }
+
+    JsonWriter& JsonWriter::Write(const char* key, const char* value)
+    {
+        return Write(key, std::string(value));
+    }
+
+    JsonWriter& JsonWriter::Write(const char* key, double value)
+    {
+        // JSON has no representation for these:
+        if (!std::isfinite(value))
+            return WriteNull(key);
+
+        WriteKey(key);
+        m_output << value;
+        return *this;
+    }
+
+    JsonWriter& JsonWriter::Write(const char* key, uint64_t value)
+    {
+        WriteKey(key);
+        m_output << value;
+        return *this;
+    }
+
+    JsonWriter& JsonWriter::Write(const char* key, bool value)
+    {
+        WriteKey(key);
+        m_output << (value ? "true" : "false");
+        return *this;
+    }
+
+    JsonWriter& JsonWriter::WriteNull(const char* key)
+    {
+        WriteKey(key);
+        m_output << "null";
+        return *this;
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cinttypes>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace application
+{
+    /// <summary>
+    /// Escapes text to be placed between quotes in JSON.
+    /// </summary>
+    std::string EscapeJson(const std::string& text);
+
+    /// <summary>
+    /// Writes JSON text incrementally, taking care of separators and indentation.
+    /// </summary>
+    class JsonWriter
+    {
+    private:
+
+        std::ostringstream m_output;
+        std::vector<bool> m_emptyScopes;
+        const bool m_indented;
+
+        void WriteKey(const char* key);
+
+    public:
+
+        /// <summary>
+        /// Creates a new instance.
+        /// </summary>
+        /// <param name="indented">Whether to write in several indented lines (otherwise compact).</param>
+        JsonWriter(bool indented);
+
+        JsonWriter& BeginObject(const char* key = nullptr);
+
+        JsonWriter& EndObject();
+
+        JsonWriter& Write(const char* key, const std::string& value);
+
+        JsonWriter& Write(const char* key, const char* value);
+
+        JsonWriter& Write(const char* key, double value);
+
+        JsonWriter& Write(const char* key, uint64_t value);
+
+        JsonWriter& Write(const char* key, uint32_t value)
+        {
+            return Write(key, static_cast<uint64_t>(value));
+        }
+
+        JsonWriter& Write(const char* key, bool value);
+
+        JsonWriter& WriteNull(const char* key);
+
+        /// <summary>
+        /// Gets the text written so far.
+        /// </summary>
+        std::string GetText() const
+        {
+            return m_output.str();
+        }
+    };
+}
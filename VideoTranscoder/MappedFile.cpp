@@ -0,0 +1,15 @@
+#include "MappedFile.hpp"
+
+namespace application
+{
+    MappedFile::MappedFile(const std::string& fileName)
+        : MappedFile(std::make_shared<const InputFile>(fileName))
+    {
+    }
+
+    MappedFile::MappedFile(std::shared_ptr<const InputFile> file)
+        : m_file(std::move(file))
+        , m_view(m_file->MapView())
+    {
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "InputFile.hpp"
+
+#include <cinttypes>
+#include <memory>
+#include <string>
+
+namespace application
+{
+    /// <summary>
+    /// Read-only view of a whole file mapped into memory.
+    /// </summary>
+    class MappedFile
+    {
+    private:
+
+        const std::shared_ptr<const InputFile> m_file;
+        const FileView m_view;
+
+    public:
+
+        /// <summary>
+        /// Opens and maps a file.
+        /// </summary>
+        /// <param name="fileName">The file to map (UTF-8 encoded).</param>
+        explicit MappedFile(const std::string& fileName);
+
+        /// <summary>
+        /// Maps a file already open, which this object keeps open.
+        /// </summary>
+        explicit MappedFile(std::shared_ptr<const InputFile> file);
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        const uint8_t* GetData() const
+        {
+            return m_view.GetData();
+        }
+
+        uint64_t GetSize() const
+        {
+            return m_file->GetSize();
+        }
+    };
+}
@@ -0,0 +1,198 @@
+#pragma once
+
+#include "EncoderRegistry.hpp"
+#include "MediaInfo.hpp"
+#include "StreamSelection.hpp"
+#include "TranscodeSettings.hpp"
+
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace application
+{
+    /// <summary>
+    /// A range of the source presentation to transcode.
+    /// </summary>
+    struct PresentationRange
+    {
+        std::chrono::nanoseconds start;
+        std::chrono::nanoseconds stop;
+    };
+
+    /// <summary>
+    /// Receives notifications of a session, in a thread of the media backend
+    /// (so implementations must return quickly and be thread-safe).
+    /// </summary>
+    class SessionObserver
+    {
+    public:
+
+        virtual ~SessionObserver() = default;
+
+        /// <summary>
+        /// The pipeline has started running.
+        /// </summary>
+        virtual void OnStarted() = 0;
+
+        /// <summary>
+        /// Periodic report of the position in the source presentation.
+        /// </summary>
+        /// <param name="position">The current position.</param>
+        /// <param name="elapsedTime">Time since the session has started.</param>
+        virtual void OnPosition(std::chrono::nanoseconds position, std::chrono::nanoseconds elapsedTime) = 0;
+    };
+
+    /// <summary>
+    /// A running (or ready to run) transcoding session in the media backend.
+    /// </summary>
+    class TranscodeSession
+    {
+    public:
+
+        virtual ~TranscodeSession() = default;
+
+        /// <summary>
+        /// Tells whether the pipeline of this session has been resolved to hardware encoding.
+        /// </summary>
+        virtual bool IsHardwareAccelerated() const = 0;
+
+        /// <summary>
+        /// Gets the name of the video encoder in the pipeline of this session.
+        /// </summary>
+        /// <returns>The name, or empty if not known yet or streams are copied without encoding.</returns>
+        virtual std::string GetVideoEncoderName() const = 0;
+
+        /// <summary>
+        /// Sets who is notified of the session events, which must be done before starting.
+        /// </summary>
+        /// <param name="observer">The observer, which must outlive the session.</param>
+        /// <param name="interval">How often the position is reported.</param>
+        virtual void Observe(SessionObserver& observer, std::chrono::milliseconds interval) = 0;
+
+        /// <summary>
+        /// Starts transcoding asynchronously.
+        /// </summary>
+        virtual void Start() = 0;
+
+        /// <summary>
+        /// Waits for transcoding to finish.
+        /// </summary>
+        /// <param name="timeout">How long to wait at most.</param>
+        /// <returns>Whether transcoding is finished (otherwise timed out).</returns>
+        /// <remarks>Throws <see cref="AppException"/> if transcoding has failed.</remarks>
+        virtual bool Wait(std::chrono::milliseconds timeout) = 0;
+
+        /// <summary>
+        /// Stops transcoding before the end (from any thread, the observer included),
+        /// leaving the output incomplete. Waiting then throws <see cref="AppException"/>.
+        /// </summary>
+        virtual void Abort() = 0;
+
+        /// <summary>
+        /// Gets the current position of transcoding in the source presentation.
+        /// </summary>
+        virtual std::chrono::nanoseconds GetPosition() const = 0;
+
+        /// <summary>
+        /// Gets how much has been written to the output so far.
+        /// </summary>
+        virtual uint64_t GetBytesWritten() const = 0;
+    };
+
+    /// <summary>
+    /// An input file opened in the media backend.
+    /// </summary>
+    class MediaInput
+    {
+    public:
+
+        virtual ~MediaInput() = default;
+
+        /// <summary>
+        /// Get the media source duration.
+        /// </summary>
+        /// <returns>The duration of the media reproduction.</returns>
+        virtual std::chrono::nanoseconds GetDuration() const = 0;
+
+        /// <summary>
+        /// Get information from this media source.
+        /// </summary>
+        /// <returns>Audio & video information.</returns>
+        virtual MediaInfo GetMediaInfo() const = 0;
+
+        /// <summary>
+        /// Describes the streams of the source, with the ones chosen for transcoding.
+        /// </summary>
+        virtual StreamLayout GetStreamLayout() const = 0;
+
+        /// <summary>
+        /// Get the presentation times of the key frames in the video stream.
+        /// </summary>
+        /// <returns>The times in ascending order, or nothing if unknown.</returns>
+        virtual std::vector<std::chrono::nanoseconds> GetKeyframeTimes() const = 0;
+
+        /// <summary>
+        /// Builds the transcode profile and pipeline for this input.
+        /// </summary>
+        /// <param name="sourceInfo">Information previously obtained from this input.</param>
+        /// <param name="settings">The encoding parameters.</param>
+        /// <param name="outputFName">The output MP4 file (UTF-8 encoded).</param>
+        /// <param name="range">The range of the source to transcode, or nothing for the whole of it.</param>
+        /// <returns>A session ready to start.</returns>
+        /// <remarks>The session must not outlive this object.</remarks>
+        virtual std::unique_ptr<TranscodeSession> CreateSession(
+            const MediaInfo& sourceInfo,
+            const TranscodeSettings& settings,
+            const std::string& outputFName,
+            const std::optional<PresentationRange>& range) = 0;
+    };
+
+    /// <summary>
+    /// Abstraction of the library that does the actual media work, so the logic
+    /// deciding about jobs does not depend on Microsoft Media Foundation.
+    /// </summary>
+    class MediaBackend
+    {
+    public:
+
+        /// <summary>
+        /// Keeps the calling thread prepared to use the backend while alive.
+        /// </summary>
+        class ThreadScope
+        {
+        public:
+
+            virtual ~ThreadScope() = default;
+        };
+
+        virtual ~MediaBackend() = default;
+
+        /// <summary>
+        /// Prepares the calling (worker) thread to use the backend.
+        /// </summary>
+        /// <returns>An object to be kept alive while the thread uses the backend.</returns>
+        virtual std::unique_ptr<ThreadScope> EnterThread() const = 0;
+
+        /// <summary>
+        /// Opens an input file.
+        /// </summary>
+        /// <param name="inputFName">The input file (UTF-8 encoded).</param>
+        virtual std::unique_ptr<MediaInput> OpenInput(const std::string& inputFName) = 0;
+
+        /// <summary>
+        /// Gets the video encoders available to the backend (enumerated once and then cached).
+        /// </summary>
+        /// <remarks>Thread-safe.</remarks>
+        virtual const EncoderRegistry& GetEncoderRegistry() = 0;
+
+        /// <summary>
+        /// Gets the directory where what is learned about this machine is kept
+        /// (such as caches and calibration), which might not exist yet.
+        /// </summary>
+        /// <returns>The directory (UTF-8 encoded).</returns>
+        virtual std::string GetDataDirectory() const = 0;
+    };
+}
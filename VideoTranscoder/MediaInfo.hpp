@@ -1,6 +1,9 @@
 #pragma once
 
+#include "Encoder.hpp"
+
 #include <cinttypes>
+#include <optional>
 
 namespace application
 {
@@ -12,6 +15,9 @@ namespace application
             uint32_t samplesPerSec;
             uint32_t numChannels;
             uint32_t avgBytesPerSec;
+
+            /// <summary>Whether the stream is AAC, which MP4 can carry as it is.</summary>
+            bool isAac;
         }
         audioProfile;
 
@@ -32,6 +38,39 @@ namespace application
             frameRate;
 
             uint32_t avgBitrate;
+
+            /// <summary>Peak bitrate over a window of 1 s, or zero when unknown.</summary>
+            uint32_t peakBitrate;
+
+            /// <summary>Format of the stream, if it is one the encoders can produce.</summary>
+            std::optional<Encoder> format;
+
+            /// <summary>
+            /// How the stream is coded, as declared in its parameter sets.
+            /// </summary>
+            struct Coding
+            {
+                /// <summary>profile_idc (H.264) or general_profile_idc (HEVC).</summary>
+                uint32_t profileIdc;
+
+                /// <summary>level_idc (H.264, 10 times the level) or general_level_idc (HEVC, 30 times the level).</summary>
+                uint32_t levelIdc;
+
+                bool highTier;
+
+                /// <summary>0 for monochrome, 1 for 4:2:0, 2 for 4:2:2, 3 for 4:4:4.</summary>
+                uint32_t chromaFormatIdc;
+
+                uint32_t bitDepthLuma;
+                uint32_t bitDepthChroma;
+                bool progressive;
+
+                /// <summary>Transfer characteristics (ITU-T H.273), such as 16 for PQ or 18 for HLG.</summary>
+                uint32_t transferCharacteristics;
+            };
+
+            /// <summary>Known only when the parameter sets could be parsed natively.</summary>
+            std::optional<Coding> coding;
         }
         videoProfile;
 	};
@@ -6,6 +6,7 @@
 #include <MinCppXtra/win32_errors.hpp>
 
 #include "AppException.hpp"
+#include "MfEncoderRegistry.hpp"
 
 namespace application
 {
@@ -19,10 +20,17 @@ namespace application
         return S_OK;
     }
 
-    MediaSession::MediaSession()
+    MediaSession::MediaSession(const EncoderRegistry& encoderRegistry)
         : m_refCount(0)
         , m_hrStatus(S_OK)
         , m_closedSessionEventHandle(nullptr)
+        , m_positionTimer(*this)
+        , m_observer(nullptr)
+        , m_observerInterval(0)
+        , m_timerKey(0)
+        , m_ended(false)
+        , m_encoderRegistry(encoderRegistry)
+        , m_topologyResolved(false)
     {
         CHECK("create media session",
             MFCreateMediaSession(nullptr, m_mfMediaSession.GetAddressOf()));
@@ -40,6 +48,8 @@ namespace application
 
     MediaSession::~MediaSession()
     {
+        StopPositionReports();
+
         LOG("shutdown media session", m_mfMediaSession->Shutdown());
         CloseHandle(m_closedSessionEventHandle);
     }
@@ -96,11 +106,45 @@ namespace application
 
             switch (meType)
             {
+            case MESessionTopologyStatus:
+                if (MFGetAttributeUINT32(mfMediaEvent.Get(), MF_EVENT_TOPOLOGY_STATUS, MF_TOPOSTATUS_INVALID)
+                    == MF_TOPOSTATUS_READY)
+                {
+                    OnTopologyReady();
+                }
+                break;
+
+            case MESessionStarted:
+                m_startTime = std::chrono::steady_clock::now();
+                if (m_observer != nullptr)
+                {
+                    m_observer->OnStarted();
+
+                    std::lock_guard<std::mutex> lock(m_reportMutex);
+                    SchedulePositionReport();
+                }
+                break;
+
             case MESessionEnded:
+                {
+                    std::lock_guard<std::mutex> lock(m_reportMutex);
+                    m_ended = true;
+                    if (m_observer != nullptr)
+                    {
+                        if (m_timerKey != 0)
+                        {
+                            LOG("cancel position report", MFCancelWorkItem(m_timerKey));
+                            m_timerKey = 0;
+                        }
+                        ReportPosition();
+                    }
+                }
                 LOG("close media session", m_mfMediaSession->Close());
                 break;
 
             case MESessionClosed:
+                // no report may reach the observer once the waiting owner is released:
+                StopPositionReports();
                 SetEvent(m_closedSessionEventHandle);
                 break;
             }
@@ -121,13 +165,127 @@ namespace application
         return S_OK;
     }
 
-    void MediaSession::StartEncodingSession(const ComPtr<IMFTopology>& topology)
+    void MediaSession::SetObserver(SessionObserver& observer, std::chrono::milliseconds interval)
+    {
+        m_observer = &observer;
+        m_observerInterval = interval;
+    }
+
+    void MediaSession::OnTopologyReady()
+    {
+        // only the full topology has the transforms actually chosen by the topology loader:
+        ComPtr<IMFTopology> fullTopology;
+        CHECK("get full topology of media session",
+            m_mfMediaSession->GetFullTopology(MFSESSION_GETFULLTOPOLOGY_CURRENT, 0, fullTopology.GetAddressOf()));
+
+        std::optional<EncoderCapability> videoEncoder = FindVideoEncoder(fullTopology, m_encoderRegistry);
+
+        std::lock_guard<std::mutex> lock(m_topologyMutex);
+        m_videoEncoder = std::move(videoEncoder);
+        m_topologyResolved = true;
+    }
+
+    bool MediaSession::IsTopologyResolved() const
+    {
+        std::lock_guard<std::mutex> lock(m_topologyMutex);
+        return m_topologyResolved;
+    }
+
+    std::optional<EncoderCapability> MediaSession::GetVideoEncoder() const
+    {
+        std::lock_guard<std::mutex> lock(m_topologyMutex);
+        return m_videoEncoder;
+    }
+
+    void MediaSession::SchedulePositionReport()
+    {
+        // called with the report mutex held, which the timer takes before reading the key:
+        // negative timeout means milliseconds from now:
+        CHECK("schedule position report",
+            MFScheduleWorkItem(&m_positionTimer, nullptr, -m_observerInterval.count(), &m_timerKey));
+    }
+
+    void MediaSession::ReportPosition()
+    {
+        m_observer->OnPosition(GetEncodingPosition(), std::chrono::steady_clock::now() - m_startTime);
+    }
+
+    void MediaSession::StopPositionReports()
+    {
+        std::lock_guard<std::mutex> lock(m_reportMutex);
+        m_ended = true;
+        if (m_timerKey != 0)
+        {
+            LOG("cancel position report", MFCancelWorkItem(m_timerKey));
+            m_timerKey = 0;
+        }
+    }
+
+    STDMETHODIMP MediaSession::PositionTimer::QueryInterface(REFIID riid, void** ppv)
+    {
+        static const QITAB qit[] =
+        {
+            QITABENT(PositionTimer, IMFAsyncCallback),
+            { 0 }
+        };
+        return QISearch(this, qit, riid, ppv);
+    }
+
+    STDMETHODIMP_(ULONG) MediaSession::PositionTimer::AddRef()
+    {
+        return m_owner.AddRef();
+    }
+
+    STDMETHODIMP_(ULONG) MediaSession::PositionTimer::Release()
+    {
+        return m_owner.Release();
+    }
+
+    STDMETHODIMP MediaSession::PositionTimer::GetParameters(DWORD* pdwFlags, DWORD* pdwQueue)
+    {
+        return E_NOTIMPL;
+    }
+
+    STDMETHODIMP MediaSession::PositionTimer::Invoke(IMFAsyncResult* result)
+    {
+        // the timer is also invoked when cancelled:
+        if (FAILED(result->GetStatus()))
+            return S_OK;
+
+        // the session cannot end while reporting, but the observer may abort it (without locking):
+        std::lock_guard<std::mutex> lock(m_owner.m_reportMutex);
+        m_owner.m_timerKey = 0;
+        if (m_owner.m_ended)
+            return S_OK;
+
+        try
+        {
+            m_owner.ReportPosition();
+            if (!m_owner.m_ended)
+                m_owner.SchedulePositionReport();
+        }
+        catch (AppException& ex)
+        {
+            std::cerr << std::endl << ex.Serialize() << std::endl;
+        }
+
+        return S_OK;
+    }
+
+    void MediaSession::StartEncodingSession(
+        const ComPtr<IMFTopology>& topology, std::chrono::nanoseconds startPosition)
     {
         CHECK("set topology in media session",
             m_mfMediaSession->SetTopology(0, topology.Get()));
 
         PROPVARIANT varStart;
         PropVariantInit(&varStart);
+        if (startPosition.count() > 0)
+        {
+            // start position in units of 100 ns:
+            varStart.vt = VT_I8;
+            varStart.hVal.QuadPart = startPosition.count() / 100;
+        }
         CHECK("start media session", m_mfMediaSession->Start(&GUID_NULL, &varStart));
     }
 
@@ -138,6 +296,17 @@ namespace application
         return std::chrono::nanoseconds(mfTime * 100);
     }
 
+    void MediaSession::Abort()
+    {
+        // not locking, for the observer may abort from a position report; the
+        // timer stops rescheduling itself once ended, and closing cancels it:
+        if (m_ended.exchange(true))
+            return;
+
+        m_hrStatus = E_ABORT;
+        LOG("close media session", m_mfMediaSession->Close());
+    }
+
     HRESULT MediaSession::Wait(std::chrono::milliseconds timeout) const
     {
         DWORD waitResult = WaitForSingleObject(
@@ -1,6 +1,12 @@
 #pragma once
 
+#include "EncoderRegistry.hpp"
+#include "MediaBackend.hpp"
+
+#include <atomic>
 #include <chrono>
+#include <mutex>
+#include <optional>
 
 #include <Windows.h>
 #include <mfobjects.h>
@@ -14,15 +20,74 @@ namespace application
     {
     private:
 
+        /// <summary>
+        /// Callback of the work queue timer that reports the position to the observer.
+        /// </summary>
+        class PositionTimer : public IMFAsyncCallback
+        {
+        private:
+
+            MediaSession& m_owner;
+
+        public:
+
+            PositionTimer(MediaSession& owner)
+                : m_owner(owner)
+            {
+            }
+
+            // IUnknown methods (lifetime is that of the owner)
+            STDMETHODIMP QueryInterface(REFIID riid, void** ppv);
+            STDMETHODIMP_(ULONG) AddRef();
+            STDMETHODIMP_(ULONG) Release();
+
+            // IMFAsyncCallback methods
+            STDMETHODIMP GetParameters(DWORD* pdwFlags, DWORD* pdwQueue);
+            STDMETHODIMP Invoke(IMFAsyncResult* result);
+        };
+
         ComPtr<IMFMediaSession> m_mfMediaSession;
         ComPtr<IMFPresentationClock> m_presentationClock;
         HRESULT m_hrStatus;
         HANDLE  m_closedSessionEventHandle;
         long    m_refCount;
 
+        PositionTimer m_positionTimer;
+        SessionObserver* m_observer;
+        std::chrono::milliseconds m_observerInterval;
+        std::chrono::steady_clock::time_point m_startTime;
+        MFWORKITEM_KEY m_timerKey;
+        std::atomic<bool> m_ended;
+
+        /// <summary>
+        /// Serializes the reports of the timer with the end of the session, and guards the timer key.
+        /// </summary>
+        std::mutex m_reportMutex;
+
+        const EncoderRegistry& m_encoderRegistry;
+        std::optional<EncoderCapability> m_videoEncoder;
+        bool m_topologyResolved;
+        mutable std::mutex m_topologyMutex;
+
+        void OnTopologyReady();
+
+        void SchedulePositionReport();
+
+        void ReportPosition();
+
+        /// <summary>
+        /// Cancels the position reports, waiting for one in progress to finish.
+        /// </summary>
+        void StopPositionReports();
+
     public:
 
-        MediaSession();
+        /// <summary>
+        /// Creates a new instance.
+        /// </summary>
+        /// <param name="encoderRegistry">The encoders in the machine, which must outlive this object.</param>
+        explicit MediaSession(const EncoderRegistry& encoderRegistry);
+
         virtual ~MediaSession();
 
         // IUnknown methods
@@ -34,10 +99,33 @@ namespace application
         STDMETHODIMP GetParameters(DWORD* pdwFlags, DWORD* pdwQueue);
         STDMETHODIMP Invoke(IMFAsyncResult* result);
 
-        void StartEncodingSession(const ComPtr<IMFTopology>& topology);
+        /// <summary>
+        /// Sets who is notified of the session events, which must be done before starting.
+        /// </summary>
+        void SetObserver(SessionObserver& observer, std::chrono::milliseconds interval);
+
+        void StartEncodingSession(
+            const ComPtr<IMFTopology>& topology,
+            std::chrono::nanoseconds startPosition = std::chrono::nanoseconds(0));
 
         std::chrono::nanoseconds GetEncodingPosition() const;
 
+        /// <summary>
+        /// Tells whether the session has resolved the topology, instantiating all transforms.
+        /// </summary>
+        bool IsTopologyResolved() const;
+
+        /// <summary>
+        /// Gets the video encoder the session has resolved the topology to.
+        /// </summary>
+        /// <returns>The encoder, or nothing if not resolved yet or there is no encoder.</returns>
+        std::optional<EncoderCapability> GetVideoEncoder() const;
+
+        /// <summary>
+        /// Closes the session before the end, so that waiting returns E_ABORT.
+        /// </summary>
+        void Abort();
+
         HRESULT Wait(std::chrono::milliseconds timeout) const;
     };
 }
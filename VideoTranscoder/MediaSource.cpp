@@ -1,56 +1,43 @@
 #include "stdafx.h"
 #include "MediaSource.hpp"
 
+#include <algorithm>
 #include <chrono>
-#include <fcntl.h>
-#include <io.h>
-#include <iostream>
+#include <iomanip>
 #include <Shlwapi.h>
 #include <sstream>
+#include <vector>
 
 #include "AppException.hpp"
+#include "FileByteStream.hpp"
+#include "JobConsole.hpp"
 #include "MediaInfo.hpp"
 
+#include <MinCppXtra/win32_api_strings.hpp>
+
 namespace application
 {
-    static uint32_t GetFileSize(const std::wstring& filePath)
-    {
-        int fd;
-        errno_t rc = _wsopen_s(&fd, filePath.c_str(), _O_RDONLY | _O_BINARY, _SH_DENYNO, 0);
-
-        if (rc != 0)
-        {
-            char buffer[256];
-
-            if (strerror_s(buffer, sizeof buffer, rc) != 0)
-            {
-                snprintf(buffer, sizeof buffer,
-                    "(secondary failure prevented retrieval of further details about error code %d)", rc);
-            }
-        
-            std::ostringstream oss;
-            oss << "Could not open file to assess its size: " << buffer;
-            throw AppException(oss.str());
-        }
-
-        auto fileSize = _filelength(fd);
-        _close(fd);
-        return static_cast<uint32_t> (fileSize);
-    }
-
-    MediaSource::MediaSource(const std::wstring& mediaFilePath)
-        : m_fileSize(GetFileSize(mediaFilePath))
+    MediaSource::MediaSource(std::shared_ptr<const InputFile> inputFile,
+                             const StreamSelectionPolicy& streamSelectionPolicy,
+                             const ReadAheadOptions& readAheadOptions)
+        : m_fileSize(inputFile->GetSize())
+        , m_streamSelectionPolicy(streamSelectionPolicy)
     {
         ComPtr<IMFSourceResolver> sourceResolver;
         CHECK("create source resolver",
             MFCreateSourceResolver(sourceResolver.GetAddressOf()));
 
+        // the URL is only a hint of the container format, by the file extension:
+        const std::wstring url = mincpp::Win32ApiStrings::ToUtf16(inputFile->GetName());
+        ComPtr<IMFByteStream> byteStream(new FileByteStream(std::move(inputFile), readAheadOptions));
+
         ComPtr<IUnknown> source;
         MF_OBJECT_TYPE objectType = MF_OBJECT_INVALID;
 
         CHECK("create media source",
-            sourceResolver->CreateObjectFromURL(
-                mediaFilePath.c_str(),
+            sourceResolver->CreateObjectFromByteStream(
+                byteStream.Get(),
+                url.c_str(),
                 MF_RESOLUTION_MEDIASOURCE,
                 NULL,
                 &objectType,
@@ -59,6 +46,21 @@ namespace application
         CHECK("get IMFMediaSource interface",
             source->QueryInterface(
                 IID_PPV_ARGS(m_mfMediaSource.GetAddressOf())));
+
+        try
+        {
+            CHECK("create presentation descriptor",
+                m_mfMediaSource->CreatePresentationDescriptor(m_presentationDescriptor.GetAddressOf()));
+
+            m_streams = DescribeStreams();
+            m_streamChoice = application::ChooseStreams(m_streams, m_streamSelectionPolicy);
+        }
+        catch (...)
+        {
+            // no destructor to shut it down:
+            m_mfMediaSource->Shutdown();
+            throw;
+        }
     }
 
     MediaSource::~MediaSource()
@@ -66,18 +68,9 @@ namespace application
         LOG("shutdown media source", m_mfMediaSource->Shutdown());
     }
 
-    ComPtr<IMFPresentationDescriptor> MediaSource::GetPresentationDescriptor() const
+    std::chrono::nanoseconds MediaSource::GetDuration(
+        const ComPtr<IMFPresentationDescriptor>& presentationDescriptor)
     {
-        ComPtr<IMFPresentationDescriptor> presentationDescriptor;
-        CHECK("create presentation descriptor",
-            m_mfMediaSource->CreatePresentationDescriptor(presentationDescriptor.GetAddressOf()));
-        return presentationDescriptor;
-    }
-
-    std::chrono::nanoseconds MediaSource::GetDuration() const
-    {
-        ComPtr<IMFPresentationDescriptor> presentationDescriptor = GetPresentationDescriptor();
-
         uint64_t duration;
         CHECK("get media source duration",
             presentationDescriptor->GetUINT64(MF_PD_DURATION, &duration));
@@ -85,22 +78,101 @@ namespace application
         return std::chrono::nanoseconds(duration * 100);
     }
 
-    MediaInfo MediaSource::GetMediaInfo() const
+    std::chrono::nanoseconds MediaSource::GetDuration() const
     {
-        MediaInfo info = {};
-        ComPtr<IMFPresentationDescriptor> presentationDescriptor = GetPresentationDescriptor();
+        return GetDuration(m_presentationDescriptor);
+    }
+
+    static SourceStream DescribeStream(const ComPtr<IMFStreamDescriptor>& streamDescriptor)
+    {
+        SourceStream stream = {};
+
+        DWORD streamId;
+        CHECK("get source stream identifier", streamDescriptor->GetStreamIdentifier(&streamId));
+        stream.id = streamId;
+
+        ComPtr<IMFMediaTypeHandler> mediaTypeHandler;
+        CHECK("get media type handler for source stream",
+            streamDescriptor->GetMediaTypeHandler(mediaTypeHandler.GetAddressOf()));
+
+        GUID majorType;
+        CHECK("get major type of source stream", mediaTypeHandler->GetMajorType(&majorType));
+
+        ComPtr<IMFMediaType> mediaType;
+        CHECK("get media type of source stream",
+            mediaTypeHandler->GetCurrentMediaType(mediaType.GetAddressOf()));
+
+        if (majorType == MFMediaType_Video)
+        {
+            stream.kind = SourceStream::Kind::Video;
+            LOG("get info (frame size) from source video stream",
+                MFGetAttributeSize(mediaType.Get(), MF_MT_FRAME_SIZE, &stream.width, &stream.height));
+
+            if (FAILED(mediaType->GetUINT32(MF_MT_AVG_BITRATE, &stream.bitrate)))
+                stream.bitrate = 0;
+        }
+        else if (majorType == MFMediaType_Audio)
+            stream.kind = SourceStream::Kind::Audio;
+        else
+            stream.kind = SourceStream::Kind::Other;
 
+        wchar_t* language = nullptr;
+        UINT32 length;
+        if (SUCCEEDED(streamDescriptor->GetAllocatedString(MF_SD_LANGUAGE, &language, &length)))
+        {
+            stream.language = mincpp::Win32ApiStrings::ToUtf8(language);
+            CoTaskMemFree(language);
+        }
+
+        return stream;
+    }
+
+    std::vector<SourceStream> MediaSource::DescribeStreams() const
+    {
         DWORD streamCount;
         CHECK("get source stream count",
-            presentationDescriptor->GetStreamDescriptorCount(&streamCount));
+            m_presentationDescriptor->GetStreamDescriptorCount(&streamCount));
 
-        // iterate over streams:
+        std::vector<SourceStream> streams;
         for (DWORD streamIdx = 0; streamIdx < streamCount; ++streamIdx)
         {
             BOOL selected;
             ComPtr<IMFStreamDescriptor> streamDescriptor;
             CHECK("get source stream descriptor",
-                presentationDescriptor->GetStreamDescriptorByIndex(
+                m_presentationDescriptor->GetStreamDescriptorByIndex(
+                    streamIdx, &selected, streamDescriptor.GetAddressOf()));
+
+            streams.push_back(DescribeStream(streamDescriptor));
+        }
+
+        return streams;
+    }
+
+    void MediaSource::AdoptStreamChoice(const std::vector<SourceStream>& streams, const StreamChoice& choice)
+    {
+        m_streamChoice = MapStreamChoice(streams, choice, m_streams);
+    }
+
+    StreamLayout MediaSource::GetStreamLayout() const
+    {
+        return DescribeStreamLayout(m_streams, m_streamChoice);
+    }
+
+    MediaInfo MediaSource::GetMediaInfo() const
+    {
+        MediaInfo info = {};
+
+        // iterate over the chosen streams:
+        for (std::optional<size_t> chosenIdx : { m_streamChoice.video, m_streamChoice.audio })
+        {
+            if (!chosenIdx)
+                continue;
+
+            const auto streamIdx = static_cast<DWORD>(*chosenIdx);
+            BOOL selected;
+            ComPtr<IMFStreamDescriptor> streamDescriptor;
+            CHECK("get source stream descriptor",
+                m_presentationDescriptor->GetStreamDescriptorByIndex(
                     streamIdx, &selected, streamDescriptor.GetAddressOf()));
 
             ComPtr<IMFMediaTypeHandler> mediaTypeHandler;
@@ -128,22 +200,20 @@ namespace application
                         &info.videoProfile.frameRate.numerator,
                         &info.videoProfile.frameRate.denominator));
                 
-                // average bit rate not available?
-                if (FAILED(mediaType->GetUINT32(MF_MT_AVG_BITRATE, &info.videoProfile.avgBitrate)))
+                GUID subtype;
+                if (SUCCEEDED(mediaType->GetGUID(MF_MT_SUBTYPE, &subtype)))
                 {
-                    // estimate using file size:
-                    info.videoProfile.avgBitrate =
-                        static_cast<UINT32> (
-                            0.98 * m_fileSize * 8 /
-                                std::chrono::duration_cast<std::chrono::seconds>(GetDuration()).count()
-                        );
-
-                    std::cout << std::endl
-                        << "Average bitrate not available in source: estimated as "
-                        << std::fixed << std::setprecision(1)
-                        << ((float)info.videoProfile.avgBitrate / (8 * 1024))
-                        << " KB/s" << std::endl;
+                    if (subtype == MFVideoFormat_H264 || subtype == MFVideoFormat_H264_ES)
+                        info.videoProfile.format = Encoder::H264_AVC;
+                    else if (subtype == MFVideoFormat_HEVC || subtype == MFVideoFormat_HEVC_ES)
+                        info.videoProfile.format = Encoder::H265_HEVC;
+                    else if (subtype == MFVideoFormat_AV1)
+                        info.videoProfile.format = Encoder::AV1;
                 }
+
+                // average bit rate not available? (estimated below)
+                if (FAILED(mediaType->GetUINT32(MF_MT_AVG_BITRATE, &info.videoProfile.avgBitrate)))
+                    info.videoProfile.avgBitrate = 0;
             }
             else if (majorType == MFMediaType_Audio)
             {
@@ -158,9 +228,32 @@ namespace application
 
                 CHECK("get info (avg Bps) from source audio stream",
                     mediaType->GetUINT32(MF_MT_AUDIO_AVG_BYTES_PER_SECOND, &info.audioProfile.avgBytesPerSec));
+
+                GUID subtype;
+                info.audioProfile.isAac =
+                    SUCCEEDED(mediaType->GetGUID(MF_MT_SUBTYPE, &subtype)) && subtype == MFAudioFormat_AAC;
             }
         }
 
+        if (info.videoProfile.avgBitrate == 0)
+        {
+            // estimate using file size, minus the audio stream:
+            const std::chrono::duration<double> duration = GetDuration(m_presentationDescriptor);
+            if (duration.count() <= 0.0)
+                throw AppException("Cannot estimate bitrate of source video without duration");
+
+            const double totalBitrate = 0.98 * (double)m_fileSize * 8 / duration.count();
+            const double audioBitrate = 8.0 * info.audioProfile.avgBytesPerSec;
+            info.videoProfile.avgBitrate =
+                static_cast<uint32_t> (std::max(totalBitrate - audioBitrate, totalBitrate / 2));
+
+            std::ostringstream oss;
+            oss << "Average bitrate not available in source: estimated as "
+                << std::fixed << std::setprecision(1)
+                << ((float)info.videoProfile.avgBitrate / (8 * 1024)) << " KB/s";
+            PrintJobMessage(oss.str());
+        }
+
         return info;
     }
 }
\ No newline at end of file
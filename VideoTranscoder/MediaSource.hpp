@@ -1,9 +1,13 @@
 #pragma once
 
 #include "MediaInfo.hpp"
+#include "ReadAheadReader.hpp"
+#include "StreamSelection.hpp"
 
 #include <chrono>
+#include <memory>
 #include <string>
+#include <vector>
 #include <wrl.h>
 
 namespace application
@@ -17,19 +21,35 @@ namespace application
 	{
 	private:
 
-		const uint32_t m_fileSize;
+		const uint64_t m_fileSize;
+
+		const StreamSelectionPolicy m_streamSelectionPolicy;
 
 		ComPtr<IMFMediaSource> m_mfMediaSource;
 
-		ComPtr<IMFPresentationDescriptor> GetPresentationDescriptor() const;
+		/// <summary>The presentation descriptor, whose stream indexes all of the choices refer to.</summary>
+		ComPtr<IMFPresentationDescriptor> m_presentationDescriptor;
+
+		std::vector<SourceStream> m_streams;
+
+		StreamChoice m_streamChoice;
+
+		std::vector<SourceStream> DescribeStreams() const;
+
+		static std::chrono::nanoseconds GetDuration(
+			const ComPtr<IMFPresentationDescriptor>& presentationDescriptor);
 
 	public:
 
 		/// <summary>
 		/// Creates a new instance.
 		/// </summary>
-		/// <param name="mediaFilePath">The path of the media source file.</param>
-		MediaSource(const std::wstring& mediaFilePath);
+		/// <param name="inputFile">The media source file, which is read through a byte stream of its own.</param>
+		/// <param name="streamSelectionPolicy">How to choose the streams to transcode.</param>
+		/// <param name="readAheadOptions">How the byte stream reads ahead of the demuxer.</param>
+		MediaSource(std::shared_ptr<const InputFile> inputFile,
+					const StreamSelectionPolicy& streamSelectionPolicy,
+					const ReadAheadOptions& readAheadOptions);
 
 		~MediaSource();
 
@@ -47,7 +67,30 @@ namespace application
 		/// <summary>
 		/// Get information from this media source.
 		/// </summary>
-		/// <returns>Audio & video information.</returns>
+		/// <returns>Audio & video information (of the chosen streams).</returns>
 		MediaInfo GetMediaInfo() const;
+
+		/// <summary>
+		/// Gets the streams to transcode, chosen according to the policy unless adopted from elsewhere.
+		/// </summary>
+		/// <returns>The indexes of the chosen streams in the presentation descriptor.</returns>
+		StreamChoice ChooseStreams() const
+		{
+			return m_streamChoice;
+		}
+
+		/// <summary>
+		/// Adopts the choice of streams made on another list of them (by the native probe),
+		/// so that the streams transcoded are the ones described.
+		/// </summary>
+		/// <param name="streams">The streams the choice indexes.</param>
+		/// <param name="choice">The choice to adopt.</param>
+		/// <remarks>Throws <see cref="AppException"/> if a chosen stream is not in this source.</remarks>
+		void AdoptStreamChoice(const std::vector<SourceStream>& streams, const StreamChoice& choice);
+
+		/// <summary>
+		/// Describes the streams of the source, with the ones chosen according to the policy.
+		/// </summary>
+		StreamLayout GetStreamLayout() const;
 	};
 }
@@ -0,0 +1,283 @@
+#include "stdafx.h"
+#include "MfBackend.hpp"
+
+#include "AppException.hpp"
+#include "JobConsole.hpp"
+#include "MediaSession.hpp"
+#include "MediaSource.hpp"
+#include "MfEncoderRegistry.hpp"
+#include "Mp4Probe.hpp"
+#include "OutputByteStream.hpp"
+#include "TranscodeProfile.hpp"
+#include "TranscodeTopology.hpp"
+#include "Utf8Path.hpp"
+
+#include <filesystem>
+#include <optional>
+
+namespace application
+{
+    using namespace Microsoft::WRL;
+
+    class MfThreadScope : public MediaBackend::ThreadScope
+    {
+    private:
+
+        ComThreadScope m_comThreadScope;
+    };
+
+    /// <summary>
+    /// Estimates how large the output of a session grows, from the data rates it is encoded
+    /// at (or the rates of the source when copying streams), with some room for the container.
+    /// </summary>
+    static uint64_t EstimateOutputSize(
+        const MediaInfo& sourceInfo, const TranscodeSettings& settings, std::chrono::nanoseconds duration)
+    {
+        const double bytesPerSec = settings.streamCopy
+            ? sourceInfo.videoProfile.avgBitrate / 8.0 + sourceInfo.audioProfile.avgBytesPerSec
+            : settings.videoAvgBitrate / 8.0 + settings.audioAvgBytesPerSec;
+
+        const double seconds = std::chrono::duration<double>(duration).count();
+        return static_cast<uint64_t>(bytesPerSec * seconds * 1.05);
+    }
+
+    /// <summary>
+    /// Session with MF transcode profile, topology and media session.
+    /// </summary>
+    /// <remarks>
+    /// The topology refers to the media source, hence this object
+    /// must not outlive the <see cref="MfInput"/> that created it.
+    /// </remarks>
+    class MfSession : public TranscodeSession
+    {
+    private:
+
+        std::unique_ptr<TranscodeProfile> m_transcodeProfile;
+        std::unique_ptr<TranscodeTopology> m_transcodeTopology;
+        ComPtr<MediaSession> m_mediaSession;
+        ComPtr<OutputByteStream> m_outputStream;
+        std::chrono::nanoseconds m_startPosition;
+
+    public:
+
+        MfSession(
+            const MediaSource& mediaSource,
+            const MediaInfo& sourceInfo,
+            const TranscodeSettings& settings,
+            const std::string& outputFName,
+            const std::optional<PresentationRange>& range,
+            const EncoderRegistry& encoderRegistry,
+            const WriteBufferOptions& writeBufferOptions)
+            : m_mediaSession(new MediaSession(encoderRegistry))
+            , m_startPosition(0)
+        {
+            const auto duration = range ? range->stop - range->start : mediaSource.GetDuration();
+            m_outputStream = new OutputByteStream(
+                outputFName, writeBufferOptions, EstimateOutputSize(sourceInfo, settings, duration));
+
+            if (settings.streamCopy)
+            {
+                PrintJobMessage("Source video is already in the requested format and data rate:"
+                                " streams will be copied without re-encoding");
+
+                if (settings.fragmentDuration.count() > 0)
+                    PrintJobMessage("Fragments will start at the key frames of the source");
+
+                m_transcodeTopology = std::make_unique<TranscodeTopology>(
+                    mediaSource.GetMfObject(), mediaSource.ChooseStreams(), m_outputStream,
+                    settings.fragmentDuration.count() > 0);
+            }
+            else
+            {
+                m_transcodeProfile = std::make_unique<TranscodeProfile>(sourceInfo, settings);
+                m_transcodeTopology = std::make_unique<TranscodeTopology>(
+                    mediaSource.GetMfObject(), mediaSource.ChooseStreams(),
+                    m_transcodeProfile->GetMfObject(), m_outputStream, settings.audioCopy);
+            }
+
+            if (range)
+            {
+                m_transcodeTopology->SetStopPosition(range->stop);
+                m_startPosition = range->start;
+            }
+        }
+
+        bool IsHardwareAccelerated() const override
+        {
+            // once the session has resolved the topology, that is what tells for sure:
+            if (m_mediaSession->IsTopologyResolved())
+            {
+                const auto videoEncoder = m_mediaSession->GetVideoEncoder();
+                return videoEncoder && videoEncoder->hardware;
+            }
+
+            return m_transcodeTopology->IsHardwareAccelerated();
+        }
+
+        std::string GetVideoEncoderName() const override
+        {
+            const auto videoEncoder = m_mediaSession->GetVideoEncoder();
+            return videoEncoder ? videoEncoder->name : std::string();
+        }
+
+        void Observe(SessionObserver& observer, std::chrono::milliseconds interval) override
+        {
+            m_mediaSession->SetObserver(observer, interval);
+        }
+
+        void Start() override
+        {
+            m_mediaSession->StartEncodingSession(m_transcodeTopology->GetMfObject(), m_startPosition);
+        }
+
+        bool Wait(std::chrono::milliseconds timeout) override
+        {
+            HRESULT hr = m_mediaSession->Wait(timeout);
+            if (hr == E_PENDING)
+                return false;
+
+            // what remains buffered must be in the file before anyone else opens it,
+            // and the file must be closed even when the session failed:
+            const HRESULT hrClose = m_outputStream->Close();
+            CHECK("transcode media", hr);
+            CHECK("close output file", hrClose);
+            return true;
+        }
+
+        void Abort() override
+        {
+            m_mediaSession->Abort();
+        }
+
+        std::chrono::nanoseconds GetPosition() const override
+        {
+            return m_mediaSession->GetEncodingPosition();
+        }
+
+        uint64_t GetBytesWritten() const override
+        {
+            // the sink writes the media data as it goes, so the output grows with the position:
+            return m_outputStream->GetWrittenLength();
+        }
+    };
+
+    /// <summary>
+    /// Input file, probed natively when possible and opened as MF media source on demand.
+    /// </summary>
+    class MfInput : public MediaInput
+    {
+    private:
+
+        const std::shared_ptr<const InputFile> m_inputFile;
+        const StreamSelectionPolicy m_streamSelectionPolicy;
+        const std::optional<ProbeResult> m_nativeProbe;
+        const EncoderRegistry& m_encoderRegistry;
+        const WriteBufferOptions m_writeBufferOptions;
+        const ReadAheadOptions m_readAheadOptions;
+        std::unique_ptr<MediaSource> m_mediaSource;
+
+        const MediaSource& GetMediaSource()
+        {
+            if (!m_mediaSource)
+            {
+                m_mediaSource = std::make_unique<MediaSource>(
+                    m_inputFile, m_streamSelectionPolicy, m_readAheadOptions);
+
+                // transcode the streams the native probe described, whatever order MF lists them in:
+                if (m_nativeProbe)
+                    m_mediaSource->AdoptStreamChoice(m_nativeProbe->streams, m_nativeProbe->layout.choice);
+            }
+            return *m_mediaSource;
+        }
+
+    public:
+
+        MfInput(const std::string& inputFName,
+                const StreamSelectionPolicy& streamSelectionPolicy,
+                const EncoderRegistry& encoderRegistry,
+                const WriteBufferOptions& writeBufferOptions,
+                const ReadAheadOptions& readAheadOptions)
+            : m_inputFile(std::make_shared<const InputFile>(inputFName))
+            , m_streamSelectionPolicy(streamSelectionPolicy)
+            , m_nativeProbe(ProbeMp4File(m_inputFile, streamSelectionPolicy))
+            , m_encoderRegistry(encoderRegistry)
+            , m_writeBufferOptions(writeBufferOptions)
+            , m_readAheadOptions(readAheadOptions)
+        {
+            // container not supported by native probe?
+            if (!m_nativeProbe)
+                GetMediaSource();
+        }
+
+        std::chrono::nanoseconds GetDuration() const override
+        {
+            return m_nativeProbe ? m_nativeProbe->duration : m_mediaSource->GetDuration();
+        }
+
+        MediaInfo GetMediaInfo() const override
+        {
+            return m_nativeProbe ? m_nativeProbe->info : m_mediaSource->GetMediaInfo();
+        }
+
+        StreamLayout GetStreamLayout() const override
+        {
+            return m_nativeProbe ? m_nativeProbe->layout : m_mediaSource->GetStreamLayout();
+        }
+
+        std::vector<std::chrono::nanoseconds> GetKeyframeTimes() const override
+        {
+            return m_nativeProbe ? m_nativeProbe->keyframeTimes : std::vector<std::chrono::nanoseconds>();
+        }
+
+        std::unique_ptr<TranscodeSession> CreateSession(
+            const MediaInfo& sourceInfo,
+            const TranscodeSettings& settings,
+            const std::string& outputFName,
+            const std::optional<PresentationRange>& range) override
+        {
+            return std::make_unique<MfSession>(
+                GetMediaSource(), sourceInfo, settings, outputFName, range,
+                m_encoderRegistry, m_writeBufferOptions);
+        }
+    };
+
+    MfBackend::MfBackend(const StreamSelectionPolicy& streamSelectionPolicy,
+                         const WriteBufferOptions& writeBufferOptions,
+                         const ReadAheadOptions& readAheadOptions)
+        : m_streamSelectionPolicy(streamSelectionPolicy)
+        , m_writeBufferOptions(writeBufferOptions)
+        , m_readAheadOptions(readAheadOptions)
+    {
+    }
+
+    std::unique_ptr<MediaBackend::ThreadScope> MfBackend::EnterThread() const
+    {
+        return std::make_unique<MfThreadScope>();
+    }
+
+    std::unique_ptr<MediaInput> MfBackend::OpenInput(const std::string& inputFName)
+    {
+        return std::make_unique<MfInput>(inputFName, m_streamSelectionPolicy,
+            GetEncoderRegistry(), m_writeBufferOptions, m_readAheadOptions);
+    }
+
+    const EncoderRegistry& MfBackend::GetEncoderRegistry()
+    {
+        std::call_once(m_encoderRegistryLoaded, [this]()
+        {
+            m_encoderRegistry = LoadMfEncoderRegistry(GetDataDirectory() + "/encoders.cache");
+        });
+
+        return *m_encoderRegistry;
+    }
+
+    std::string MfBackend::GetDataDirectory() const
+    {
+        wchar_t buffer[MAX_PATH];
+        const DWORD length = GetEnvironmentVariableW(L"LOCALAPPDATA", buffer, MAX_PATH);
+        if (length == 0 || length >= MAX_PATH)
+            return ToUtf8(std::filesystem::temp_directory_path() / L"VideoTranscoder");
+
+        return ToUtf8(std::filesystem::path(buffer) / L"VideoTranscoder");
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "BufferedFileWriter.hpp"
+#include "MediaBackend.hpp"
+#include "MmfLibScope.hpp"
+#include "ReadAheadReader.hpp"
+#include "StreamSelection.hpp"
+
+#include <mutex>
+#include <optional>
+
+namespace application
+{
+    /// <summary>
+    /// Media backend implemented with Microsoft Media Foundation.
+    /// </summary>
+    class MfBackend : public MediaBackend
+    {
+    private:
+
+        MmfLibScope m_mmfLibScope;
+        const StreamSelectionPolicy m_streamSelectionPolicy;
+        const WriteBufferOptions m_writeBufferOptions;
+        const ReadAheadOptions m_readAheadOptions;
+        std::optional<EncoderRegistry> m_encoderRegistry;
+        std::once_flag m_encoderRegistryLoaded;
+
+    public:
+
+        /// <summary>
+        /// Creates a new instance.
+        /// </summary>
+        /// <param name="streamSelectionPolicy">How to choose the streams to transcode in all inputs.</param>
+        /// <param name="writeBufferOptions">How to buffer the writing of all outputs.</param>
+        /// <param name="readAheadOptions">How to read ahead in all inputs.</param>
+        MfBackend(const StreamSelectionPolicy& streamSelectionPolicy,
+                  const WriteBufferOptions& writeBufferOptions,
+                  const ReadAheadOptions& readAheadOptions);
+
+        std::unique_ptr<ThreadScope> EnterThread() const override;
+
+        std::unique_ptr<MediaInput> OpenInput(const std::string& inputFName) override;
+
+        const EncoderRegistry& GetEncoderRegistry() override;
+
+        std::string GetDataDirectory() const override;
+    };
+}
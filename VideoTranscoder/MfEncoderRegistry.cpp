@@ -0,0 +1,283 @@
+#include "stdafx.h"
+#include "MfEncoderRegistry.hpp"
+
+#include "AppException.hpp"
+
+#include <MinCppXtra/win32_api_strings.hpp>
+
+#include <dxgi.h>
+#include <mftransform.h>
+
+#include <array>
+#include <iomanip>
+#include <sstream>
+
+namespace application
+{
+    static const GUID& GetSubtype(Encoder codec)
+    {
+        switch (codec)
+        {
+        case Encoder::H264_AVC:
+            return MFVideoFormat_H264;
+        case Encoder::H265_HEVC:
+            return MFVideoFormat_HEVC;
+        default:
+            return MFVideoFormat_AV1;
+        }
+    }
+
+    static std::optional<Encoder> GetEncoderOfSubtype(const GUID& subtype)
+    {
+        for (Encoder codec : { Encoder::H264_AVC, Encoder::H265_HEVC, Encoder::AV1 })
+        {
+            if (subtype == GetSubtype(codec))
+                return codec;
+        }
+        return std::nullopt;
+    }
+
+    static std::string GetStringAttribute(IMFAttributes* attributes, REFGUID key)
+    {
+        wchar_t* value = nullptr;
+        UINT32 length;
+        if (FAILED(attributes->GetAllocatedString(key, &value, &length)))
+            return std::string();
+
+        std::string result = mincpp::Win32ApiStrings::ToUtf8(value);
+        CoTaskMemFree(value);
+        return result;
+    }
+
+    static std::string ToString(const GUID& guid)
+    {
+        wchar_t buffer[40];
+        if (StringFromGUID2(guid, buffer, 40) == 0)
+            return std::string();
+
+        return mincpp::Win32ApiStrings::ToUtf8(buffer);
+    }
+
+    /// <summary>
+    /// Probes the largest frame size of an encoder, by offering it output types from large to small.
+    /// </summary>
+    static void ProbeMaxFrameSize(IMFActivate* activate, EncoderCapability& encoder)
+    {
+        ComPtr<IMFTransform> transform;
+        if (FAILED(activate->ActivateObject(IID_PPV_ARGS(transform.GetAddressOf()))))
+            return;
+
+        // asynchronous MFTs refuse any call until unlocked:
+        ComPtr<IMFAttributes> attributes;
+        if (encoder.async && SUCCEEDED(transform->GetAttributes(attributes.GetAddressOf())))
+            LOG("unlock asynchronous encoder", attributes->SetUINT32(MF_TRANSFORM_ASYNC_UNLOCK, TRUE));
+
+        static const auto frameSizes = std::to_array<std::pair<uint32_t, uint32_t>>({
+            { 8192, 4320 }, { 7680, 4320 }, { 4096, 2304 }, { 3840, 2160 }, { 2560, 1440 }, { 1920, 1080 }
+        });
+
+        for (auto [width, height] : frameSizes)
+        {
+            ComPtr<IMFMediaType> mediaType;
+            if (FAILED(MFCreateMediaType(mediaType.GetAddressOf()))
+                || FAILED(mediaType->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Video))
+                || FAILED(mediaType->SetGUID(MF_MT_SUBTYPE, GetSubtype(encoder.codec)))
+                || FAILED(MFSetAttributeSize(mediaType.Get(), MF_MT_FRAME_SIZE, width, height))
+                || FAILED(MFSetAttributeRatio(mediaType.Get(), MF_MT_FRAME_RATE, 30, 1))
+                || FAILED(mediaType->SetUINT32(MF_MT_AVG_BITRATE, 10'000'000))
+                || FAILED(mediaType->SetUINT32(MF_MT_INTERLACE_MODE, MFVideoInterlace_Progressive)))
+            {
+                break;
+            }
+
+            if (SUCCEEDED(transform->SetOutputType(0, mediaType.Get(), 0)))
+            {
+                encoder.maxWidth = width;
+                encoder.maxHeight = height;
+                break;
+            }
+        }
+
+        LOG("shutdown encoder", activate->ShutdownObject());
+    }
+
+    std::vector<EncoderCapability> EnumerateEncoderMfts()
+    {
+        std::vector<EncoderCapability> encoders;
+
+        for (Encoder codec : { Encoder::H264_AVC, Encoder::H265_HEVC, Encoder::AV1 })
+        {
+            MFT_REGISTER_TYPE_INFO outputType{ MFMediaType_Video, GetSubtype(codec) };
+            IMFActivate** activates = nullptr;
+            UINT32 count = 0;
+
+            HRESULT hr = MFTEnumEx(MFT_CATEGORY_VIDEO_ENCODER,
+                MFT_ENUM_FLAG_SYNCMFT | MFT_ENUM_FLAG_ASYNCMFT | MFT_ENUM_FLAG_HARDWARE | MFT_ENUM_FLAG_SORTANDFILTER,
+                nullptr,
+                &outputType,
+                &activates,
+                &count);
+
+            if (FAILED(hr))
+            {
+                LOG("enumerate video encoders", hr);
+                continue;
+            }
+
+            for (UINT32 idx = 0; idx < count; ++idx)
+            {
+                IMFActivate* activate = activates[idx];
+
+                EncoderCapability encoder = {};
+                encoder.codec = codec;
+                encoder.name = GetStringAttribute(activate, MFT_FRIENDLY_NAME_Attribute);
+
+                GUID clsid;
+                if (SUCCEEDED(activate->GetGUID(MFT_TRANSFORM_CLSID_Attribute, &clsid)))
+                    encoder.clsid = ToString(clsid);
+
+                const UINT32 flags = MFGetAttributeUINT32(activate, MF_TRANSFORM_FLAGS_Attribute, 0);
+                encoder.hardware = (flags & MFT_ENUM_FLAG_HARDWARE) != 0;
+                encoder.async = (flags & MFT_ENUM_FLAG_ASYNCMFT) != 0;
+
+                ProbeMaxFrameSize(activate, encoder);
+                encoders.push_back(std::move(encoder));
+                activate->Release();
+            }
+
+            CoTaskMemFree(activates);
+        }
+
+        return encoders;
+    }
+
+    static std::string GetOsBuild()
+    {
+        const wchar_t* const keyPath = L"SOFTWARE\\Microsoft\\Windows NT\\CurrentVersion";
+
+        wchar_t build[32] = L"";
+        DWORD size = sizeof build;
+        RegGetValueW(HKEY_LOCAL_MACHINE, keyPath, L"CurrentBuildNumber", RRF_RT_REG_SZ, nullptr, build, &size);
+
+        DWORD revision = 0;
+        size = sizeof revision;
+        RegGetValueW(HKEY_LOCAL_MACHINE, keyPath, L"UBR", RRF_RT_REG_DWORD, nullptr, &revision, &size);
+
+        return mincpp::Win32ApiStrings::ToUtf8(build) + '.' + std::to_string(revision);
+    }
+
+    std::string GetSystemFingerprint()
+    {
+        std::ostringstream oss;
+        oss << "os " << GetOsBuild();
+
+        ComPtr<IDXGIFactory1> factory;
+        HRESULT hr = CreateDXGIFactory1(IID_PPV_ARGS(factory.GetAddressOf()));
+        if (FAILED(hr))
+        {
+            LOG("create DXGI factory", hr);
+            return oss.str();
+        }
+
+        ComPtr<IDXGIAdapter1> adapter;
+        for (UINT idx = 0; factory->EnumAdapters1(idx, adapter.ReleaseAndGetAddressOf()) != DXGI_ERROR_NOT_FOUND; ++idx)
+        {
+            DXGI_ADAPTER_DESC1 desc;
+            if (FAILED(adapter->GetDesc1(&desc)) || (desc.Flags & DXGI_ADAPTER_FLAG_SOFTWARE) != 0)
+                continue;
+
+            oss << "; gpu " << std::hex << std::setfill('0')
+                << std::setw(4) << desc.VendorId << ':' << std::setw(4) << desc.DeviceId << std::dec;
+
+            // the version of the user mode driver, in 4 parts of 16 bits:
+            LARGE_INTEGER driverVersion;
+            if (SUCCEEDED(adapter->CheckInterfaceSupport(__uuidof(IDXGIDevice), &driverVersion)))
+            {
+                oss << " driver "
+                    << HIWORD(driverVersion.HighPart) << '.' << LOWORD(driverVersion.HighPart) << '.'
+                    << HIWORD(driverVersion.LowPart) << '.' << LOWORD(driverVersion.LowPart);
+            }
+        }
+
+        return oss.str();
+    }
+
+    EncoderRegistry LoadMfEncoderRegistry(const std::string& cacheFName)
+    {
+        return LoadEncoderRegistry(cacheFName, GetSystemFingerprint(), &EnumerateEncoderMfts);
+    }
+
+    bool IsHardwareTransform(const ComPtr<IUnknown>& object)
+    {
+        // the URL of the device is set in the attributes of the transform, or else of its activation object:
+        ComPtr<IMFAttributes> attributes;
+        ComPtr<IMFTransform> transform;
+        if (SUCCEEDED(object.As(&transform)))
+        {
+            if (FAILED(transform->GetAttributes(attributes.GetAddressOf())))
+                return false;
+        }
+        else if (FAILED(object.As(&attributes)))
+            return false;
+
+        UINT32 length;
+        return SUCCEEDED(attributes->GetStringLength(MFT_ENUM_HARDWARE_URL_Attribute, &length));
+    }
+
+    std::optional<EncoderCapability> FindVideoEncoder(const ComPtr<IMFTopology>& topology,
+                                                      const EncoderRegistry& registry)
+    {
+        WORD nodeCount;
+        CHECK("get topology nodes count", topology->GetNodeCount(&nodeCount));
+        for (WORD idxNode = 0; idxNode < nodeCount; ++idxNode)
+        {
+            ComPtr<IMFTopologyNode> node;
+            CHECK("get topology node", topology->GetNode(idxNode, node.GetAddressOf()));
+
+            MF_TOPOLOGY_TYPE type;
+            CHECK("get topology node type", node->GetNodeType(&type));
+            if (type != MF_TOPOLOGY_TRANSFORM_NODE)
+                continue;
+
+            ComPtr<IUnknown> object;
+            ComPtr<IMFTransform> transform;
+            if (FAILED(node->GetObject(object.GetAddressOf())) || FAILED(object.As(&transform)))
+                continue;
+
+            // the video encoder is the transform that outputs one of the encoded formats:
+            ComPtr<IMFMediaType> outputType;
+            GUID subtype;
+            if (FAILED(transform->GetOutputCurrentType(0, outputType.GetAddressOf()))
+                || FAILED(outputType->GetGUID(MF_MT_SUBTYPE, &subtype)))
+            {
+                continue;
+            }
+
+            const std::optional<Encoder> codec = GetEncoderOfSubtype(subtype);
+            if (!codec)
+                continue;
+
+            EncoderCapability encoder = {};
+            encoder.codec = *codec;
+
+            GUID clsid;
+            if (SUCCEEDED(node->GetGUID(MF_TOPONODE_TRANSFORM_OBJECTID, &clsid)))
+            {
+                encoder.clsid = ToString(clsid);
+                if (const EncoderCapability* known = registry.FindByClsid(encoder.clsid))
+                    encoder = *known;
+            }
+
+            // what the transform itself tells prevails over the registry:
+            encoder.hardware = IsHardwareTransform(object);
+
+            ComPtr<IMFAttributes> attributes;
+            if (encoder.name.empty() && SUCCEEDED(transform->GetAttributes(attributes.GetAddressOf())))
+                encoder.name = GetStringAttribute(attributes.Get(), MFT_FRIENDLY_NAME_Attribute);
+
+            return encoder;
+        }
+
+        return std::nullopt;
+    }
+}
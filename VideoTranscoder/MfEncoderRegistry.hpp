@@ -0,0 +1,48 @@
+#pragma once
+
+#include "EncoderRegistry.hpp"
+
+#include <mfobjects.h>
+#include <wrl.h>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace application
+{
+    using namespace Microsoft::WRL;
+
+    /// <summary>
+    /// Enumerates the video encoder MFTs (hardware and software) for the codecs of this application,
+    /// probing each one for the largest frame size it accepts.
+    /// </summary>
+    /// <remarks>Failures are logged and leave out the encoders they affect.</remarks>
+    std::vector<EncoderCapability> EnumerateEncoderMfts();
+
+    /// <summary>
+    /// Identifies the OS build and the display adapters with their driver versions,
+    /// which determine what encoders there are.
+    /// </summary>
+    std::string GetSystemFingerprint();
+
+    /// <summary>
+    /// Gets the encoder registry of this machine, from cache if still valid.
+    /// </summary>
+    /// <param name="cacheFName">The cache file (UTF-8 encoded).</param>
+    EncoderRegistry LoadMfEncoderRegistry(const std::string& cacheFName);
+
+    /// <summary>
+    /// Tells whether a transform (or its activation object) runs on hardware.
+    /// </summary>
+    bool IsHardwareTransform(const ComPtr<IUnknown>& object);
+
+    /// <summary>
+    /// Finds the video encoder in a topology resolved by the media session.
+    /// </summary>
+    /// <param name="topology">The full topology, with all transforms instantiated.</param>
+    /// <param name="registry">The encoders known in the machine, to identify the one in use.</param>
+    /// <returns>The encoder in use, or nothing if there is none (such as when streams are copied).</returns>
+    std::optional<EncoderCapability> FindVideoEncoder(const ComPtr<IMFTopology>& topology,
+                                                      const EncoderRegistry& registry);
+}
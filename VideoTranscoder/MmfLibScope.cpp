@@ -22,4 +22,20 @@ namespace application
         LOG("shutdown MF library", MFShutdown());
         CoUninitialize();
     }
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="ComThreadScope"/> class.
+    /// </summary>
+    ComThreadScope::ComThreadScope()
+    {
+        CHECK("initialize COM library in worker thread", CoInitializeEx(nullptr, COINIT_MULTITHREADED));
+    }
+
+    /// <summary>
+    /// Finalizes an instance of the <see cref="ComThreadScope"/> class.
+    /// </summary>
+    ComThreadScope::~ComThreadScope()
+    {
+        CoUninitialize();
+    }
 }
\ No newline at end of file
@@ -12,4 +12,16 @@ namespace application
         MmfLibScope();
         ~MmfLibScope();
     };
+
+    /// <summary>
+    /// Uses RAII to initialize and finalize COM library in worker threads,
+    /// which share the MF library initialized by <see cref="MmfLibScope"/>.
+    /// </summary>
+    class ComThreadScope
+    {
+    public:
+
+        ComThreadScope();
+        ~ComThreadScope();
+    };
 }
@@ -0,0 +1,143 @@
+#include "Mp4Concatenation.hpp"
+#include "AppException.hpp"
+#include "IsoBmff.hpp"
+#include "MappedFile.hpp"
+#include "Mp4Writer.hpp"
+#include "NalScanner.hpp"
+#include "ParameterSets.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+namespace application
+{
+    /// <summary>
+    /// Tells whether two tracks can be joined in a single track.
+    /// </summary>
+    static bool AreTracksCompatible(const IsoBmffTrack& left, const IsoBmffTrack& right)
+    {
+        return left.handlerType == right.handlerType
+            && left.timescale == right.timescale
+            && left.sampleDescription.payloadSize == right.sampleDescription.payloadSize
+            && std::memcmp(left.sampleDescription.payload,
+                           right.sampleDescription.payload,
+                           static_cast<size_t>(left.sampleDescription.payloadSize)) == 0;
+    }
+
+    /// <summary>
+    /// Tells whether a video sample is a picture that decodes on its own, as its NAL units say
+    /// rather than the sync sample table, when the track is H.264 or HEVC (otherwise it is assumed).
+    /// </summary>
+    static bool IsRandomAccessSample(const IsoBmffTrack& track, const Mp4WriterSample& sample)
+    {
+        if (track.decoderConfig.type == 0)
+            return true;
+
+        const DecoderConfiguration config = ParseDecoderConfiguration(track.decoderConfig);
+        const std::vector<NalUnit> nalUnits =
+            ScanLengthPrefixed(sample.data, sample.size, config.nalLengthSize, config.codec);
+
+        return std::any_of(nalUnits.begin(), nalUnits.end(),
+            [&config](const NalUnit& nal) { return IsRandomAccessNal(nal.type, config.codec); });
+    }
+
+    void ConcatenateMp4Files(const std::vector<std::string>& partFNames, const std::string& outputFName)
+    {
+        if (partFNames.empty())
+            throw AppException("There are no files to concatenate");
+
+        std::vector<std::unique_ptr<MappedFile>> files;
+        std::vector<IsoBmffMovie> movies;
+        for (const std::string& partFName : partFNames)
+        {
+            files.push_back(std::make_unique<MappedFile>(partFName));
+            const MappedFile& file = *files.back();
+            movies.push_back(ParseIsoBmff(file.GetData(), file.GetSize()));
+
+            const IsoBmffMovie& movie = movies.back();
+            if (movie.isFragmented)
+                throw AppException("Cannot concatenate fragmented MP4 file " + partFName);
+
+            if (movie.tracks.size() != movies.front().tracks.size())
+                throw AppException("Cannot concatenate files with different tracks: " + partFName);
+
+            for (size_t trackIdx = 0; trackIdx < movie.tracks.size(); ++trackIdx)
+            {
+                if (!AreTracksCompatible(movie.tracks[trackIdx], movies.front().tracks[trackIdx]))
+                    throw AppException("Cannot concatenate files with different encoding: " + partFName);
+            }
+        }
+
+        const IsoBmffMovie& movieTemplate = movies.front();
+
+        // the timeline of the video is the reference for the other tracks:
+        size_t refTrackIdx = 0;
+        for (size_t trackIdx = 0; trackIdx < movieTemplate.tracks.size(); ++trackIdx)
+        {
+            if (movieTemplate.tracks[trackIdx].handlerType == MakeFourCC("vide"))
+            {
+                refTrackIdx = trackIdx;
+                break;
+            }
+        }
+
+        std::vector<Mp4WriterTrack> tracks(movieTemplate.tracks.size());
+        std::vector<uint64_t> trackDurations(tracks.size(), 0);
+        for (size_t partIdx = 0; partIdx < movies.size(); ++partIdx)
+        {
+            const MappedFile& file = *files[partIdx];
+            for (size_t trackIdx = 0; trackIdx < tracks.size(); ++trackIdx)
+            {
+                const size_t firstSampleIdx = tracks[trackIdx].samples.size();
+                for (const IsoBmffSample& sample : GetSamples(movies[partIdx].tracks[trackIdx]))
+                {
+                    if (sample.offset + sample.size > file.GetSize())
+                        throw AppException("Sample out of file bounds in " + partFNames[partIdx]);
+
+                    tracks[trackIdx].samples.push_back(Mp4WriterSample{
+                        file.GetData() + sample.offset,
+                        sample.size,
+                        sample.duration,
+                        sample.compositionOffset,
+                        sample.isSync
+                    });
+
+                    trackDurations[trackIdx] += sample.duration;
+                }
+
+                // otherwise the video cannot be decoded from the join up to the next key frame:
+                const auto& samples = tracks[trackIdx].samples;
+                if (trackIdx == refTrackIdx && samples.size() > firstSampleIdx
+                    && movieTemplate.tracks[refTrackIdx].handlerType == MakeFourCC("vide")
+                    && !IsRandomAccessSample(movies[partIdx].tracks[trackIdx], samples[firstSampleIdx]))
+                {
+                    throw AppException("Cannot concatenate file whose video does not start with a key frame: "
+                        + partFNames[partIdx]);
+                }
+            }
+
+            // stretch or shrink the last sample of each track to end along with the video:
+            const double refEndInSecs = static_cast<double>(trackDurations[refTrackIdx])
+                / movieTemplate.tracks[refTrackIdx].timescale;
+
+            for (size_t trackIdx = 0; trackIdx < tracks.size(); ++trackIdx)
+            {
+                auto& samples = tracks[trackIdx].samples;
+                if (trackIdx == refTrackIdx || samples.empty())
+                    continue;
+
+                const auto refEnd = static_cast<int64_t>(refEndInSecs * movieTemplate.tracks[trackIdx].timescale);
+                const int64_t lastSampleDuration =
+                    samples.back().duration + refEnd - static_cast<int64_t>(trackDurations[trackIdx]);
+
+                const auto adjustedDuration = static_cast<uint32_t>(std::max<int64_t>(lastSampleDuration, 1));
+                trackDurations[trackIdx] += adjustedDuration;
+                trackDurations[trackIdx] -= samples.back().duration;
+                samples.back().duration = adjustedDuration;
+            }
+        }
+
+        WriteMp4File(outputFName, movieTemplate, tracks);
+    }
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace application
+{
+    /// <summary>
+    /// Concatenates MP4 files with the same track layout and encoding (such as segments
+    /// of a video transcoded independently with the same settings) without re-encoding.
+    /// </summary>
+    /// <param name="partFNames">The files to concatenate, in presentation order (UTF-8 encoded).</param>
+    /// <param name="outputFName">The output MP4 file (UTF-8 encoded).</param>
+    /// <remarks>
+    /// The timeline of each track is resynchronized to the video at every join, so small
+    /// differences in length between the streams of a part do not accumulate as drift.
+    /// The video of every part must start with a key frame, which is checked in the bitstream.
+    /// Throws <see cref="AppException"/> if the parts are not compatible or on failure.
+    /// </remarks>
+    void ConcatenateMp4Files(const std::vector<std::string>& partFNames, const std::string& outputFName);
+}
@@ -0,0 +1,291 @@
+#include "Mp4Faststart.hpp"
+#include "AppException.hpp"
+#include "IsoBmff.hpp"
+#include "Utf8Path.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <vector>
+
+namespace application
+{
+    /// <summary>
+    /// Size of the blocks in which media data is shifted.
+    /// </summary>
+    static const uint64_t shiftBlockSize = 8 * 1024 * 1024;
+
+    struct TopLevelBox
+    {
+        uint32_t type;
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    static void ReadAt(std::fstream& file, uint64_t offset, uint8_t* data, uint64_t count)
+    {
+        file.seekg(static_cast<std::streamoff>(offset));
+        file.read(reinterpret_cast<char*>(data), static_cast<std::streamsize>(count));
+        if (!file)
+            throw AppException("Could not read MP4 file to move the movie box");
+    }
+
+    static void WriteAt(std::fstream& file, uint64_t offset, const uint8_t* data, uint64_t count)
+    {
+        file.seekp(static_cast<std::streamoff>(offset));
+        file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(count));
+        if (!file)
+            throw AppException("Could not write MP4 file to move the movie box");
+    }
+
+    /// <summary>
+    /// Lists the top level boxes, reading only their headers.
+    /// </summary>
+    static std::vector<TopLevelBox> ScanTopLevelBoxes(std::fstream& file, uint64_t fileSize)
+    {
+        std::vector<TopLevelBox> boxes;
+        uint64_t offset = 0;
+        while (fileSize - offset >= 8)
+        {
+            uint8_t header[16];
+            ReadAt(file, offset, header, 8);
+
+            BigEndianReader reader(header, sizeof header);
+            TopLevelBox box = { 0, offset, reader.ReadU32() };
+            box.type = reader.ReadU32();
+
+            if (box.size == 1)
+            {
+                ReadAt(file, offset + 8, header + 8, 8);
+                box.size = reader.ReadU64();
+            }
+            else if (box.size == 0) // box extends to the end
+                box.size = fileSize - offset;
+
+            if (box.size < 8 || box.size > fileSize - offset)
+                throw AppException("Invalid box size in MP4 file (truncated?)");
+
+            boxes.push_back(box);
+            offset += box.size;
+        }
+        return boxes;
+    }
+
+    /// <summary>
+    /// Copies the movie box, replacing the chunk offset tables with mapped offsets
+    /// (in 64 bits where 32 are no longer enough).
+    /// </summary>
+    static void RewriteMovieBoxes(BigEndianReader& reader,
+                                  BigEndianWriter& writer,
+                                  const std::function<uint64_t(uint64_t)>& mapOffset)
+    {
+        IsoBmffBox box;
+        while (ReadNextBox(reader, box))
+        {
+            switch (box.type)
+            {
+            case MakeFourCC("moov"):
+            case MakeFourCC("trak"):
+            case MakeFourCC("mdia"):
+            case MakeFourCC("minf"):
+            case MakeFourCC("stbl"):
+            {
+                const size_t boxPosition = writer.BeginBox(box.type);
+                BigEndianReader childReader(box.payload, box.payloadSize);
+                RewriteMovieBoxes(childReader, writer, mapOffset);
+                writer.EndBox(boxPosition);
+                break;
+            }
+
+            case MakeFourCC("stco"):
+            case MakeFourCC("co64"):
+            {
+                BigEndianReader tableReader(box.payload, box.payloadSize);
+                tableReader.ReadU32(); // version & flags
+                const uint32_t entryCount = tableReader.ReadU32();
+
+                std::vector<uint64_t> offsets(entryCount);
+                for (uint64_t& offset : offsets)
+                {
+                    offset = mapOffset(box.type == MakeFourCC("co64")
+                        ? tableReader.ReadU64() : tableReader.ReadU32());
+                }
+
+                const bool needs64bits = std::any_of(offsets.begin(), offsets.end(),
+                    [](uint64_t offset) { return offset > std::numeric_limits<uint32_t>::max(); });
+
+                const size_t boxPosition = writer.BeginFullBox(MakeFourCC(needs64bits ? "co64" : "stco"), 0, 0);
+                writer.WriteU32(entryCount);
+                for (uint64_t offset : offsets)
+                {
+                    if (needs64bits)
+                        writer.WriteU64(offset);
+                    else
+                        writer.WriteU32(static_cast<uint32_t>(offset));
+                }
+                writer.EndBox(boxPosition);
+                break;
+            }
+
+            default:
+                writer.WriteBytes(box.begin, static_cast<size_t>(box.GetSize()));
+            }
+        }
+    }
+
+    /// <summary>
+    /// Moves a range of the file to a later position, copying backwards in blocks
+    /// aligned to the block size, because source and destination may overlap.
+    /// </summary>
+    static void ShiftForward(std::fstream& file, uint64_t from, uint64_t count, uint64_t to, std::vector<uint8_t>& buffer)
+    {
+        if (to == from)
+            return;
+
+        if (to < from)
+            throw AppException("Cannot shift media data backwards when moving the movie box");
+
+        uint64_t end = from + count;
+        while (end > from)
+        {
+            const uint64_t blockStart = std::max(from, (end - 1) / shiftBlockSize * shiftBlockSize);
+            ReadAt(file, blockStart, buffer.data(), end - blockStart);
+            WriteAt(file, blockStart + (to - from), buffer.data(), end - blockStart);
+            end = blockStart;
+        }
+    }
+
+    static std::vector<uint8_t> MakeFreeBoxHeader(uint64_t size)
+    {
+        std::vector<uint8_t> header;
+        BigEndianWriter writer(header);
+        writer.WriteU32(static_cast<uint32_t>(size));
+        writer.WriteU32(MakeFourCC("free"));
+        return header;
+    }
+
+    bool MoveMovieToFront(const std::string& fileName)
+    {
+        const std::filesystem::path filePath = ToPath(fileName);
+        const uint64_t fileSize = std::filesystem::file_size(filePath);
+
+        std::fstream file(filePath, std::ios::in | std::ios::out | std::ios::binary);
+        if (!file)
+            throw AppException("Could not open MP4 file to move the movie box: " + fileName);
+
+        const std::vector<TopLevelBox> boxes = ScanTopLevelBoxes(file, fileSize);
+
+        auto moovIter = std::find_if(boxes.begin(), boxes.end(),
+            [](const TopLevelBox& box) { return box.type == MakeFourCC("moov"); });
+
+        if (moovIter == boxes.end())
+            throw AppException("There is no movie box in MP4 file " + fileName);
+
+        auto mdatIter = std::find_if(boxes.begin(), boxes.end(),
+            [](const TopLevelBox& box) { return box.type == MakeFourCC("mdat"); });
+
+        // nothing to do with movie already in front, or with fragments?
+        const bool isFragmented = std::any_of(boxes.begin(), boxes.end(),
+            [](const TopLevelBox& box) { return box.type == MakeFourCC("moof"); });
+
+        if (mdatIter == boxes.end() || moovIter < mdatIter || isFragmented)
+            return false;
+
+        const TopLevelBox moov = *moovIter;
+        const uint64_t dataStart = mdatIter->offset;
+        const uint64_t moovEnd = moov.offset + moov.size;
+
+        std::vector<uint8_t> moovBytes(static_cast<size_t>(moov.size));
+        ReadAt(file, moov.offset, moovBytes.data(), moov.size);
+
+        // free space right in front of the media data can take the movie as it is:
+        if (mdatIter != boxes.begin())
+        {
+            const TopLevelBox& gap = *(mdatIter - 1);
+            if ((gap.type == MakeFourCC("free") || gap.type == MakeFourCC("skip"))
+                && (gap.size == moov.size || gap.size >= moov.size + 8))
+            {
+                WriteAt(file, gap.offset, moovBytes.data(), moov.size);
+
+                if (gap.size > moov.size)
+                {
+                    const auto header = MakeFreeBoxHeader(gap.size - moov.size);
+                    WriteAt(file, gap.offset + moov.size, header.data(), header.size());
+                }
+
+                // the old movie becomes free space, or goes away at the end:
+                if (moovEnd == fileSize)
+                {
+                    file.close();
+                    std::filesystem::resize_file(filePath, moov.offset);
+                }
+                else
+                {
+                    const auto header = MakeFreeBoxHeader(moov.size);
+                    WriteAt(file, moov.offset, header.data(), header.size());
+                }
+                return true;
+            }
+        }
+
+        // The layout becomes [prefix][moov][free][data before old moov][data after old moov],
+        // but the new size of the movie depends on the offsets it has (32 or 64 bits). It takes
+        // a slot never smaller than the old movie, padded with a free box if needed, so that
+        // the media data only shifts forward and the file never has to shrink:
+        std::vector<uint8_t> newMoovBytes;
+        uint64_t slotSize = moov.size;
+        for (int attempt = 0; attempt < 4; ++attempt)
+        {
+            auto mapOffset = [=](uint64_t offset) -> uint64_t
+            {
+                if (offset < dataStart)
+                    return offset;
+
+                if (offset < moov.offset)
+                    return offset + slotSize;
+
+                if (offset >= moovEnd)
+                    return offset + slotSize - moov.size;
+
+                throw AppException("Chunk offset points into the movie box");
+            };
+
+            newMoovBytes.clear();
+            BigEndianWriter writer(newMoovBytes);
+            BigEndianReader reader(moovBytes.data(), moovBytes.size());
+            RewriteMovieBoxes(reader, writer, mapOffset);
+
+            // fits the slot, with no room left or room for a free box?
+            if (newMoovBytes.size() == slotSize || newMoovBytes.size() + 8 <= slotSize)
+                break;
+
+            // otherwise grow the slot (larger offsets only ever make the movie grow too):
+            if (newMoovBytes.size() > slotSize)
+                slotSize = newMoovBytes.size();
+            else
+                slotSize = newMoovBytes.size() + 8;
+        }
+
+        const uint64_t newMoovSize = newMoovBytes.size();
+        if (newMoovSize != slotSize && newMoovSize + 8 > slotSize)
+            throw AppException("Could not lay out the movie box in front of the media data");
+
+        std::vector<uint8_t> buffer(static_cast<size_t>(shiftBlockSize));
+        ShiftForward(file, moovEnd, fileSize - moovEnd, moovEnd + slotSize - moov.size, buffer);
+        ShiftForward(file, dataStart, moov.offset - dataStart, dataStart + slotSize, buffer);
+        WriteAt(file, dataStart, newMoovBytes.data(), newMoovSize);
+
+        if (slotSize > newMoovSize)
+        {
+            const auto header = MakeFreeBoxHeader(slotSize - newMoovSize);
+            WriteAt(file, dataStart + newMoovSize, header.data(), header.size());
+        }
+
+        file.flush();
+        if (!file)
+            throw AppException("Could not write MP4 file to move the movie box");
+
+        return true;
+    }
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+
+namespace application
+{
+    /// <summary>
+    /// Moves the movie box of an MP4 file in front of the media data, in place, so that
+    /// players can start over HTTP before the whole file has been downloaded.
+    /// </summary>
+    /// <param name="fileName">The MP4 file (UTF-8 encoded).</param>
+    /// <returns>Whether the file has been changed (otherwise the movie already was in front).</returns>
+    /// <remarks>
+    /// Only the chunk offsets in the movie box are rewritten, then the media data is shifted
+    /// in large blocks (unless there is free space in front to take the movie), which reads and
+    /// writes the media data once but needs no extra disk space. A movie that gets smaller (with
+    /// 32-bit offsets in place of 64-bit ones) is followed by a free box, so the media data never
+    /// shifts backwards. The file is corrupted if this is interrupted. Throws <see cref="AppException"/> on failure.
+    /// </remarks>
+    bool MoveMovieToFront(const std::string& fileName);
+}
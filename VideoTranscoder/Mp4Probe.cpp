@@ -0,0 +1,400 @@
+#include "Mp4Probe.hpp"
+#include "AppException.hpp"
+#include "IsoBmff.hpp"
+#include "MappedFile.hpp"
+#include "ParameterSets.hpp"
+
+#include <MinCppXtra/traceable_exception.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <new>
+#include <numeric>
+#include <vector>
+
+namespace application
+{
+    using namespace std::chrono;
+
+    static nanoseconds ToNanoseconds(uint64_t duration, uint32_t timescale)
+    {
+        if (timescale == 0)
+            return nanoseconds(0);
+
+        // split to avoid overflow of 64 bits with long durations and large timescales:
+        const uint64_t wholeSecs = duration / timescale;
+        const uint64_t remainder = duration % timescale;
+        return nanoseconds(wholeSecs * 1'000'000'000ULL + remainder * 1'000'000'000ULL / timescale);
+    }
+
+    /// <summary>
+    /// Takes the frame rate from the most frequent sample duration in 'stts'.
+    /// </summary>
+    static bool GetFrameRate(const IsoBmffTrack& track, MediaInfo::VideoProfile& videoInfo)
+    {
+        std::map<uint32_t, uint64_t> countByDelta;
+        BigEndianReader reader(track.timeToSample.data, track.timeToSample.entryCount * 8ULL);
+        for (uint32_t idx = 0; idx < track.timeToSample.entryCount; ++idx)
+        {
+            const uint32_t sampleCount = reader.ReadU32();
+            const uint32_t sampleDelta = reader.ReadU32();
+            if (sampleDelta != 0)
+                countByDelta[sampleDelta] += sampleCount;
+        }
+
+        if (countByDelta.empty() || track.timescale == 0)
+            return false;
+
+        auto iterMostFrequent = std::max_element(countByDelta.begin(), countByDelta.end(),
+            [](const auto& left, const auto& right) { return left.second < right.second; });
+
+        const uint32_t delta = iterMostFrequent->first;
+        const uint32_t divisor = std::gcd(track.timescale, delta);
+        videoInfo.frameRate.numerator = track.timescale / divisor;
+        videoInfo.frameRate.denominator = delta / divisor;
+        return true;
+    }
+
+    /// <summary>
+    /// Calculates the exact average bitrate of a track from its sample tables.
+    /// </summary>
+    /// <returns>Whether the track has a duration to calculate the bitrate.</returns>
+    static bool CalculateAverageBitrate(const IsoBmffTrack& track, uint32_t& avgBitrate)
+    {
+        const uint64_t trackDuration = IsoBmffSampleTimes(track).GetTime(track.sampleCount);
+        if (trackDuration == 0 || track.timescale == 0)
+            return false;
+
+        // constant sample size (PCM) has no 'stsz' entries and possibly billions of samples:
+        uint64_t totalBytes = static_cast<uint64_t>(track.constantSampleSize) * track.sampleCount;
+        if (track.constantSampleSize == 0)
+        {
+            if (track.sampleSizes.entryCount < track.sampleCount)
+                throw AppException("Sample size table does not match sample count in ISO base media file");
+
+            BigEndianReader stsz(track.sampleSizes.data, track.sampleCount * 4ULL);
+            for (uint32_t idx = 0; idx < track.sampleCount; ++idx)
+                totalBytes += stsz.ReadU32();
+        }
+
+        // split to avoid overflow of 64 bits with large files and timescales:
+        const uint64_t avg = totalBytes / trackDuration * 8 * track.timescale
+            + totalBytes % trackDuration * 8 * track.timescale / trackDuration;
+
+        avgBitrate = static_cast<uint32_t>(std::min<uint64_t>(avg, std::numeric_limits<uint32_t>::max()));
+        return true;
+    }
+
+    /// <summary>
+    /// Calculates the peak bitrate of a track over a sliding window of 1 s, walking
+    /// the sample tables with one cursor at each end of the window.
+    /// </summary>
+    /// <param name="avgBitrate">The average bitrate, which the peak is never below.</param>
+    static uint32_t CalculatePeakBitrate(const IsoBmffTrack& track, uint32_t avgBitrate)
+    {
+        const uint64_t window = track.timescale;
+
+        // a clip shorter than the window has no peak other than its average:
+        if (IsoBmffSampleTimes(track).GetTime(track.sampleCount) < window)
+            return avgBitrate;
+
+        IsoBmffSampleTimes windowEnds(track);
+        IsoBmffSampleTimes windowStarts(track);
+        uint64_t windowBytes = 0;
+        uint64_t peakWindowBytes = 0;
+        uint32_t firstInWindow = 0;
+        uint64_t firstTime = windowStarts.GetTime(0);
+
+        for (uint32_t idx = 0; idx < track.sampleCount; ++idx)
+        {
+            windowBytes += GetSampleSize(track, idx);
+
+            const uint64_t time = windowEnds.GetTime(idx);
+            while (time - firstTime >= window)
+            {
+                windowBytes -= GetSampleSize(track, firstInWindow);
+                firstTime = windowStarts.GetTime(++firstInWindow);
+            }
+
+            peakWindowBytes = std::max(peakWindowBytes, windowBytes);
+        }
+
+        return static_cast<uint32_t>(std::min<uint64_t>(std::max<uint64_t>(peakWindowBytes * 8, avgBitrate),
+                                                        std::numeric_limits<uint32_t>::max()));
+    }
+
+    static std::optional<Encoder> GetVideoFormat(uint32_t codec)
+    {
+        switch (codec)
+        {
+        case MakeFourCC("avc1"):
+        case MakeFourCC("avc3"):
+            return Encoder::H264_AVC;
+
+        case MakeFourCC("hvc1"):
+        case MakeFourCC("hev1"):
+            return Encoder::H265_HEVC;
+
+        case MakeFourCC("av01"):
+            return Encoder::AV1;
+
+        default:
+            return std::nullopt;
+        }
+    }
+
+    static bool IsAac(const IsoBmffTrack& track)
+    {
+        // MPEG-4 audio, or MPEG-2 AAC (main, LC, SSR profiles):
+        return track.codec == MakeFourCC("mp4a")
+            && (track.objectTypeIndication == 0x40
+                || (track.objectTypeIndication >= 0x66 && track.objectTypeIndication <= 0x68));
+    }
+
+    /// <summary>
+    /// Parses the parameter sets in the decoder configuration of the track, if any.
+    /// </summary>
+    /// <returns>The active sequence parameter set, or nothing if unavailable or malformed.</returns>
+    static std::optional<SequenceParameterSet> ParseVideoCoding(const IsoBmffTrack& track)
+    {
+        if (track.decoderConfig.type == 0)
+            return std::nullopt;
+
+        try
+        {
+            const DecoderConfiguration config = ParseDecoderConfiguration(track.decoderConfig);
+            if (config.sequenceParameterSets.empty())
+                return std::nullopt;
+
+            const NalUnit& nal = config.sequenceParameterSets.front();
+            return ParseSequenceParameterSet(config.data + nal.offset, nal.size, config.codec);
+        }
+        catch (mincpp::TraceableException&)
+        {
+            // the container still tells enough to proceed
+            return std::nullopt;
+        }
+    }
+
+    static bool FillVideoProfile(const IsoBmffTrack& track, MediaInfo::VideoProfile& videoInfo)
+    {
+        videoInfo.frameSize.width = track.width;
+        videoInfo.frameSize.height = track.height;
+        videoInfo.format = GetVideoFormat(track.codec);
+
+        const std::optional<SequenceParameterSet> sps = ParseVideoCoding(track);
+        if (sps)
+        {
+            videoInfo.coding = MediaInfo::VideoProfile::Coding{
+                sps->profileIdc,
+                sps->levelIdc,
+                sps->highTier,
+                sps->chromaFormatIdc,
+                sps->bitDepthLuma,
+                sps->bitDepthChroma,
+                sps->progressive,
+                sps->transferCharacteristics
+            };
+
+            // the sample entry often has the coded size rather than the cropped one:
+            videoInfo.frameSize.width = sps->width;
+            videoInfo.frameSize.height = sps->height;
+        }
+
+        if (!GetFrameRate(track, videoInfo))
+        {
+            // without sample durations, fall back to the timing in VUI:
+            if (!sps || sps->numUnitsInTick == 0 || sps->timeScale == 0)
+                return false;
+
+            // H.264 ticks are fields, so a frame takes 2 of them:
+            const uint32_t ticksPerFrame = (videoInfo.format == Encoder::H264_AVC) ? 2 : 1;
+            const uint64_t numerator = sps->timeScale;
+            const uint64_t denominator = static_cast<uint64_t>(sps->numUnitsInTick) * ticksPerFrame;
+            const uint64_t divisor = std::gcd(numerator, denominator);
+            videoInfo.frameRate.numerator = static_cast<uint32_t>(numerator / divisor);
+            videoInfo.frameRate.denominator = static_cast<uint32_t>(denominator / divisor);
+        }
+
+        // the bitrate declared in the container is only the fallback:
+        if (CalculateAverageBitrate(track, videoInfo.avgBitrate))
+        {
+            videoInfo.peakBitrate = CalculatePeakBitrate(track, videoInfo.avgBitrate);
+        }
+        else
+        {
+            videoInfo.avgBitrate = track.avgBitrate;
+            videoInfo.peakBitrate = track.maxBitrate;
+        }
+
+        return videoInfo.avgBitrate != 0;
+    }
+
+    /// <summary>
+    /// Lists the presentation times of the sync samples in a track.
+    /// </summary>
+    static std::vector<nanoseconds> ListKeyframeTimes(const IsoBmffTrack& track)
+    {
+        std::vector<uint32_t> syncSampleIdxs;
+        if (track.hasSyncSampleTable)
+        {
+            BigEndianReader stss(track.syncSamples.data, track.syncSamples.entryCount * 4ULL);
+            for (uint32_t entryIdx = 0; entryIdx < track.syncSamples.entryCount; ++entryIdx)
+            {
+                const uint32_t sampleNumber = stss.ReadU32();
+                if (sampleNumber != 0 && sampleNumber <= track.sampleCount)
+                    syncSampleIdxs.push_back(sampleNumber - 1);
+            }
+            std::sort(syncSampleIdxs.begin(), syncSampleIdxs.end());
+        }
+        else
+        {
+            syncSampleIdxs.resize(track.sampleCount);
+            std::iota(syncSampleIdxs.begin(), syncSampleIdxs.end(), 0);
+        }
+
+        // walk 'stts' and 'ctts' along with the (sorted) sync samples to get their composition times:
+        IsoBmffSampleTimes times(track);
+        std::vector<nanoseconds> keyframeTimes;
+        keyframeTimes.reserve(syncSampleIdxs.size());
+        BigEndianReader ctts(track.compositionOffsets.data, track.compositionOffsets.entryCount * 8ULL);
+        uint32_t entryIdx = 0;
+        uint64_t entryEnd = 0;
+        int32_t offset = 0;
+        for (uint32_t sampleIdx : syncSampleIdxs)
+        {
+            while (sampleIdx >= entryEnd && entryIdx < track.compositionOffsets.entryCount)
+            {
+                entryEnd += ctts.ReadU32();
+                offset = static_cast<int32_t>(ctts.ReadU32());
+                ++entryIdx;
+            }
+
+            if (sampleIdx >= entryEnd)
+                offset = 0;
+
+            const int64_t time = static_cast<int64_t>(times.GetTime(sampleIdx)) + offset;
+            keyframeTimes.push_back(ToNanoseconds(static_cast<uint64_t>(std::max<int64_t>(time, 0)), track.timescale));
+        }
+
+        std::sort(keyframeTimes.begin(), keyframeTimes.end());
+        return keyframeTimes;
+    }
+
+    static bool FillAudioProfile(const IsoBmffTrack& track, MediaInfo::AudioProfile& audioInfo)
+    {
+        audioInfo.bitsPerSample = track.sampleSize;
+        audioInfo.samplesPerSec = track.sampleRate;
+        audioInfo.numChannels = track.channelCount;
+        audioInfo.isAac = IsAac(track);
+
+        if (track.avgBitrate != 0)
+        {
+            audioInfo.avgBytesPerSec = track.avgBitrate / 8;
+        }
+        else
+        {
+            uint32_t avgBitrate(0);
+            if (CalculateAverageBitrate(track, avgBitrate))
+                audioInfo.avgBytesPerSec = avgBitrate / 8;
+        }
+
+        return audioInfo.avgBytesPerSec != 0;
+    }
+
+    std::optional<ProbeResult> ProbeMp4File(const std::string& inputFName, const StreamSelectionPolicy& policy)
+    {
+        std::shared_ptr<const InputFile> inputFile;
+        try
+        {
+            inputFile = std::make_shared<const InputFile>(inputFName, AccessPattern::Random);
+        }
+        catch (mincpp::TraceableException&)
+        {
+            return std::nullopt;
+        }
+
+        return ProbeMp4File(inputFile, policy);
+    }
+
+    std::optional<ProbeResult> ProbeMp4File(const std::shared_ptr<const InputFile>& inputFile,
+                                            const StreamSelectionPolicy& policy)
+    {
+        try
+        {
+            MappedFile file(inputFile);
+            if (!IsIsoBmff(file.GetData(), file.GetSize()))
+                return std::nullopt;
+
+            const IsoBmffMovie movie = ParseIsoBmff(file.GetData(), file.GetSize());
+
+            std::vector<SourceStream> streams;
+            std::vector<const IsoBmffTrack*> streamTracks;
+            for (const IsoBmffTrack& track : movie.tracks)
+            {
+                if (track.sampleCount == 0)
+                    continue;
+
+                SourceStream stream = {};
+                if (track.handlerType == MakeFourCC("vide"))
+                    stream.kind = SourceStream::Kind::Video;
+                else if (track.handlerType == MakeFourCC("soun"))
+                    stream.kind = SourceStream::Kind::Audio;
+                else
+                    stream.kind = SourceStream::Kind::Other;
+
+                stream.id = track.trackId;
+                stream.width = track.width;
+                stream.height = track.height;
+                stream.bitrate = track.avgBitrate;
+                stream.language = track.language;
+                streams.push_back(stream);
+                streamTracks.push_back(&track);
+            }
+
+            const StreamChoice choice = ChooseStreams(streams, policy);
+            const IsoBmffTrack* videoTrack = choice.video ? streamTracks[*choice.video] : nullptr;
+            const IsoBmffTrack* audioTrack = choice.audio ? streamTracks[*choice.audio] : nullptr;
+
+            // samples in movie fragments are not supported:
+            if (videoTrack == nullptr || movie.isFragmented)
+                return std::nullopt;
+
+            ProbeResult result = {};
+            result.layout = DescribeStreamLayout(streams, choice);
+            result.streams = std::move(streams);
+            result.duration = ToNanoseconds(movie.duration, movie.timescale);
+            if (result.duration.count() == 0)
+                result.duration = ToNanoseconds(videoTrack->duration, videoTrack->timescale);
+
+            if (!FillVideoProfile(*videoTrack, result.info.videoProfile))
+                return std::nullopt;
+
+            if (audioTrack != nullptr && !FillAudioProfile(*audioTrack, result.info.audioProfile))
+                return std::nullopt;
+
+            result.keyframeTimes = ListKeyframeTimes(*videoTrack);
+
+            return result;
+        }
+        catch (mincpp::TraceableException&)
+        {
+            // leave it to the media backend to handle files this parser cannot
+            return std::nullopt;
+        }
+        catch (std::bad_alloc&)
+        {
+            return std::nullopt;
+        }
+    }
+
+    std::optional<uint32_t> ProbeVideoBitrate(const std::string& fileName)
+    {
+        const auto probe = ProbeMp4File(fileName, StreamSelectionPolicy{});
+        if (probe && probe->info.videoProfile.avgBitrate != 0)
+            return probe->info.videoProfile.avgBitrate;
+
+        return std::nullopt;
+    }
+}
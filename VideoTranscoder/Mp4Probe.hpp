@@ -0,0 +1,54 @@
+#pragma once
+
+#include "InputFile.hpp"
+#include "MediaInfo.hpp"
+#include "StreamSelection.hpp"
+
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace application
+{
+    /// <summary>
+    /// What a probe finds out about an input file.
+    /// </summary>
+    struct ProbeResult
+    {
+        MediaInfo info;
+        std::chrono::nanoseconds duration;
+        StreamLayout layout;
+
+        /// <summary>The tracks that have samples, which the stream choice in the layout indexes.</summary>
+        std::vector<SourceStream> streams;
+
+        /// <summary>Presentation times of the sync samples in the video track, in ascending order.</summary>
+        std::vector<std::chrono::nanoseconds> keyframeTimes;
+    };
+
+    /// <summary>
+    /// Probes an MP4/MOV file natively, by reading only the boxes of the movie structure.
+    /// </summary>
+    /// <param name="inputFName">The input file (UTF-8 encoded).</param>
+    /// <param name="policy">How to choose the tracks to describe.</param>
+    /// <returns>
+    /// The media information, or nothing if the file is not an ISO base media file
+    /// or its layout is not supported (such as fragmented files).
+    /// </returns>
+    std::optional<ProbeResult> ProbeMp4File(const std::string& inputFName, const StreamSelectionPolicy& policy);
+
+    /// <summary>
+    /// Probes an MP4/MOV file natively, as <see cref="ProbeMp4File"/> does, but from a file already open.
+    /// </summary>
+    std::optional<ProbeResult> ProbeMp4File(const std::shared_ptr<const InputFile>& inputFile,
+                                            const StreamSelectionPolicy& policy);
+
+    /// <summary>
+    /// Gets the average bitrate of the video in an MP4 file (such as an output), when it can be probed.
+    /// </summary>
+    /// <param name="fileName">The MP4 file (UTF-8 encoded).</param>
+    /// <returns>The bitrate (bits/s), or nothing if the file is missing or cannot be probed.</returns>
+    std::optional<uint32_t> ProbeVideoBitrate(const std::string& fileName);
+}
@@ -0,0 +1,486 @@
+#include "Mp4Writer.hpp"
+#include "AppException.hpp"
+#include "Utf8Path.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+
+namespace application
+{
+    namespace
+    {
+        /// <summary>
+        /// How much media data (in time) is interleaved per chunk.
+        /// </summary>
+        constexpr double chunkDurationInSecs = 1.0;
+
+        /// <summary>
+        /// A run of consecutive samples of a track stored contiguously in the output.
+        /// </summary>
+        struct Chunk
+        {
+            size_t trackIdx;
+            size_t firstSampleIdx;
+            size_t sampleCount;
+            double startTimeInSecs;
+            uint64_t size;
+            uint64_t offset;
+        };
+
+        /// <summary>
+        /// Everything needed to regenerate the boxes of one track.
+        /// </summary>
+        struct TrackLayout
+        {
+            const IsoBmffTrack* source;
+            const Mp4WriterTrack* target;
+            std::vector<const Chunk*> chunks;
+
+            /// <summary>Media duration in units of track timescale.</summary>
+            uint64_t duration;
+
+            /// <summary>Track duration in units of movie timescale.</summary>
+            uint64_t durationInMovieTimescale;
+        };
+
+        /// <summary>
+        /// Splits the samples of all tracks in chunks and orders them by time.
+        /// </summary>
+        std::vector<Chunk> ArrangeChunks(
+            const IsoBmffMovie& movie, const std::vector<Mp4WriterTrack>& tracks)
+        {
+            std::vector<Chunk> chunks;
+            for (size_t trackIdx = 0; trackIdx < tracks.size(); ++trackIdx)
+            {
+                const auto& samples = tracks[trackIdx].samples;
+                const uint32_t timescale = movie.tracks[trackIdx].timescale;
+                const auto maxChunkDuration = static_cast<uint64_t>(chunkDurationInSecs * timescale);
+
+                uint64_t time = 0;
+                size_t sampleIdx = 0;
+                while (sampleIdx < samples.size())
+                {
+                    Chunk chunk = {};
+                    chunk.trackIdx = trackIdx;
+                    chunk.firstSampleIdx = sampleIdx;
+                    chunk.startTimeInSecs = static_cast<double>(time) / timescale;
+
+                    uint64_t chunkDuration = 0;
+                    do
+                    {
+                        chunk.size += samples[sampleIdx].size;
+                        chunkDuration += samples[sampleIdx].duration;
+                        ++sampleIdx;
+                    } while (sampleIdx < samples.size() && chunkDuration < maxChunkDuration);
+
+                    chunk.sampleCount = sampleIdx - chunk.firstSampleIdx;
+                    time += chunkDuration;
+                    chunks.push_back(chunk);
+                }
+            }
+
+            std::stable_sort(chunks.begin(), chunks.end(),
+                [](const Chunk& left, const Chunk& right)
+                {
+                    return left.startTimeInSecs < right.startTimeInSecs;
+                });
+
+            return chunks;
+        }
+
+        /// <summary>
+        /// Writes the box header and content as in the source.
+        /// </summary>
+        void CopyBox(BigEndianWriter& writer, const IsoBmffBox& box)
+        {
+            writer.WriteBytes(box.begin, static_cast<size_t>(box.GetSize()));
+        }
+
+        /// <summary>
+        /// Copies a full box carrying a duration field, replacing the duration.
+        /// </summary>
+        /// <param name="durationOffsetV0">Offset of the 32-bit duration in the box content (version 0).</param>
+        /// <param name="durationOffsetV1">Offset of the 64-bit duration in the box content (version 1).</param>
+        void CopyBoxWithDuration(BigEndianWriter& writer,
+                                 const IsoBmffBox& box,
+                                 uint64_t duration,
+                                 size_t durationOffsetV0,
+                                 size_t durationOffsetV1)
+        {
+            const size_t boxPosition = writer.GetPosition();
+            const size_t payloadPosition = boxPosition + static_cast<size_t>(box.payload - box.begin);
+            CopyBox(writer, box);
+
+            const uint8_t version = box.payloadSize > 0 ? box.payload[0] : 0;
+            if (version == 1 && box.payloadSize >= durationOffsetV1 + 8)
+            {
+                writer.PatchU64(payloadPosition + durationOffsetV1, duration);
+            }
+            else if (version == 0 && box.payloadSize >= durationOffsetV0 + 4)
+            {
+                writer.PatchU32(payloadPosition + durationOffsetV0, static_cast<uint32_t>(
+                    std::min<uint64_t>(duration, std::numeric_limits<uint32_t>::max())));
+            }
+            else
+                throw AppException("Unsupported version of box with duration in ISO base media file");
+        }
+
+        /// <summary>
+        /// Copies an edit list, stretching its (first) edit with media to the new track duration.
+        /// </summary>
+        void CopyEditList(BigEndianWriter& writer, const IsoBmffBox& box, uint64_t trackDuration)
+        {
+            BigEndianReader reader(box.payload, box.payloadSize);
+            const uint8_t version = reader.ReadU8();
+            reader.ReadU24(); // flags
+            const uint32_t entryCount = reader.ReadU32();
+
+            struct Edit
+            {
+                uint64_t segmentDuration;
+                int64_t mediaTime;
+                uint32_t mediaRate;
+            };
+
+            std::vector<Edit> edits(entryCount);
+            uint64_t otherEditsDuration = 0;
+            Edit* mediaEdit = nullptr;
+            for (Edit& edit : edits)
+            {
+                edit.segmentDuration = (version == 1 ? reader.ReadU64() : reader.ReadU32());
+                edit.mediaTime = (version == 1
+                    ? static_cast<int64_t>(reader.ReadU64())
+                    : static_cast<int32_t>(reader.ReadU32()));
+                edit.mediaRate = reader.ReadU32();
+
+                if (mediaEdit == nullptr && edit.mediaTime != -1)
+                    mediaEdit = &edit;
+                else
+                    otherEditsDuration += edit.segmentDuration;
+            }
+
+            if (mediaEdit != nullptr)
+            {
+                mediaEdit->segmentDuration =
+                    trackDuration > otherEditsDuration ? trackDuration - otherEditsDuration : 0;
+            }
+
+            const size_t elst = writer.BeginFullBox(MakeFourCC("elst"), 1, 0);
+            writer.WriteU32(entryCount);
+            for (const Edit& edit : edits)
+            {
+                writer.WriteU64(edit.segmentDuration);
+                writer.WriteU64(static_cast<uint64_t>(edit.mediaTime));
+                writer.WriteU32(edit.mediaRate);
+            }
+            writer.EndBox(elst);
+        }
+
+        /// <summary>
+        /// Writes the sample tables generated from the samples to write.
+        /// </summary>
+        void WriteSampleTables(BigEndianWriter& writer, const TrackLayout& layout, bool useLargeOffsets)
+        {
+            const auto& samples = layout.target->samples;
+
+            // time-to-sample, run-length encoded:
+            std::vector<std::pair<uint32_t, uint32_t>> runs;
+            for (const auto& sample : samples)
+            {
+                if (!runs.empty() && runs.back().second == sample.duration)
+                    ++runs.back().first;
+                else
+                    runs.emplace_back(1, sample.duration);
+            }
+
+            const size_t stts = writer.BeginFullBox(MakeFourCC("stts"), 0, 0);
+            writer.WriteU32(static_cast<uint32_t>(runs.size()));
+            for (const auto& [count, delta] : runs)
+            {
+                writer.WriteU32(count);
+                writer.WriteU32(delta);
+            }
+            writer.EndBox(stts);
+
+            // composition offsets, only if there is any reordering:
+            const bool hasCompositionOffsets = std::any_of(samples.begin(), samples.end(),
+                [](const Mp4WriterSample& sample) { return sample.compositionOffset != 0; });
+
+            if (hasCompositionOffsets)
+            {
+                const bool hasNegativeOffsets = std::any_of(samples.begin(), samples.end(),
+                    [](const Mp4WriterSample& sample) { return sample.compositionOffset < 0; });
+
+                runs.clear();
+                for (const auto& sample : samples)
+                {
+                    const auto offset = static_cast<uint32_t>(sample.compositionOffset);
+                    if (!runs.empty() && runs.back().second == offset)
+                        ++runs.back().first;
+                    else
+                        runs.emplace_back(1, offset);
+                }
+
+                const size_t ctts = writer.BeginFullBox(MakeFourCC("ctts"), hasNegativeOffsets ? 1 : 0, 0);
+                writer.WriteU32(static_cast<uint32_t>(runs.size()));
+                for (const auto& [count, offset] : runs)
+                {
+                    writer.WriteU32(count);
+                    writer.WriteU32(offset);
+                }
+                writer.EndBox(ctts);
+            }
+
+            // sync samples, only if not all of them are:
+            const bool allSync = std::all_of(samples.begin(), samples.end(),
+                [](const Mp4WriterSample& sample) { return sample.isSync; });
+
+            if (!allSync)
+            {
+                const size_t stss = writer.BeginFullBox(MakeFourCC("stss"), 0, 0);
+                const size_t entryCountPosition = writer.GetPosition();
+                writer.WriteU32(0);
+                uint32_t entryCount = 0;
+                for (size_t idx = 0; idx < samples.size(); ++idx)
+                {
+                    if (samples[idx].isSync)
+                    {
+                        writer.WriteU32(static_cast<uint32_t>(idx + 1));
+                        ++entryCount;
+                    }
+                }
+                writer.PatchU32(entryCountPosition, entryCount);
+                writer.EndBox(stss);
+            }
+
+            // sample sizes:
+            const bool constantSize = !samples.empty() && std::all_of(samples.begin(), samples.end(),
+                [&samples](const Mp4WriterSample& sample) { return sample.size == samples.front().size; });
+
+            const size_t stsz = writer.BeginFullBox(MakeFourCC("stsz"), 0, 0);
+            writer.WriteU32(constantSize ? samples.front().size : 0);
+            writer.WriteU32(static_cast<uint32_t>(samples.size()));
+            if (!constantSize)
+            {
+                for (const auto& sample : samples)
+                    writer.WriteU32(sample.size);
+            }
+            writer.EndBox(stsz);
+
+            // sample-to-chunk, run-length encoded:
+            const size_t stsc = writer.BeginFullBox(MakeFourCC("stsc"), 0, 0);
+            const size_t entryCountPosition = writer.GetPosition();
+            writer.WriteU32(0);
+            uint32_t entryCount = 0;
+            size_t prevSampleCount = 0;
+            for (size_t chunkIdx = 0; chunkIdx < layout.chunks.size(); ++chunkIdx)
+            {
+                const size_t sampleCount = layout.chunks[chunkIdx]->sampleCount;
+                if (sampleCount != prevSampleCount)
+                {
+                    writer.WriteU32(static_cast<uint32_t>(chunkIdx + 1));
+                    writer.WriteU32(static_cast<uint32_t>(sampleCount));
+                    writer.WriteU32(1); // sample description index
+                    prevSampleCount = sampleCount;
+                    ++entryCount;
+                }
+            }
+            writer.PatchU32(entryCountPosition, entryCount);
+            writer.EndBox(stsc);
+
+            // chunk offsets:
+            const size_t stco = writer.BeginFullBox(MakeFourCC(useLargeOffsets ? "co64" : "stco"), 0, 0);
+            writer.WriteU32(static_cast<uint32_t>(layout.chunks.size()));
+            for (const Chunk* chunk : layout.chunks)
+            {
+                if (useLargeOffsets)
+                    writer.WriteU64(chunk->offset);
+                else
+                    writer.WriteU32(static_cast<uint32_t>(chunk->offset));
+            }
+            writer.EndBox(stco);
+        }
+
+        /// <summary>
+        /// Writes a container box copied from the template, replacing what
+        /// depends on the samples (durations and sample tables).
+        /// </summary>
+        void WriteContainer(BigEndianWriter& writer,
+                            const IsoBmffBox& container,
+                            const IsoBmffMovie& movie,
+                            uint64_t movieDuration,
+                            const std::vector<TrackLayout>& layouts,
+                            const TrackLayout* layout,
+                            bool useLargeOffsets)
+        {
+            const size_t boxPosition = writer.BeginBox(container.type);
+
+            size_t trackIdx = 0;
+            BigEndianReader reader(container.payload, container.payloadSize);
+            IsoBmffBox box;
+            while (ReadNextBox(reader, box))
+            {
+                switch (box.type)
+                {
+                case MakeFourCC("trak"):
+                    WriteContainer(writer, box, movie, movieDuration,
+                                   layouts, &layouts.at(trackIdx++), useLargeOffsets);
+                    break;
+
+                case MakeFourCC("edts"):
+                case MakeFourCC("mdia"):
+                case MakeFourCC("minf"):
+                    WriteContainer(writer, box, movie, movieDuration, layouts, layout, useLargeOffsets);
+                    break;
+
+                case MakeFourCC("stbl"):
+                {
+                    const size_t stbl = writer.BeginBox(box.type);
+                    CopyBox(writer, layout->source->sampleDescription);
+                    WriteSampleTables(writer, *layout, useLargeOffsets);
+                    writer.EndBox(stbl);
+                    break;
+                }
+
+                case MakeFourCC("mvhd"):
+                    CopyBoxWithDuration(writer, box, movieDuration, 16, 24);
+                    break;
+
+                case MakeFourCC("tkhd"):
+                    CopyBoxWithDuration(writer, box, layout->durationInMovieTimescale, 20, 28);
+                    break;
+
+                case MakeFourCC("mdhd"):
+                    CopyBoxWithDuration(writer, box, layout->duration, 16, 24);
+                    break;
+
+                case MakeFourCC("elst"):
+                    CopyEditList(writer, box, layout->durationInMovieTimescale);
+                    break;
+
+                case MakeFourCC("mvex"):
+                    break; // the output is not fragmented
+
+                default:
+                    CopyBox(writer, box);
+                    break;
+                }
+            }
+
+            writer.EndBox(boxPosition);
+        }
+
+    }// end of anonymous namespace
+
+    void WriteMp4File(
+        const std::string& outputFName,
+        const IsoBmffMovie& movieTemplate,
+        const std::vector<Mp4WriterTrack>& tracks)
+    {
+        if (tracks.size() != movieTemplate.tracks.size())
+            throw AppException("Tracks to write do not match the movie template");
+
+        std::vector<Chunk> chunks = ArrangeChunks(movieTemplate, tracks);
+
+        uint64_t mediaDataSize = 0;
+        for (const Chunk& chunk : chunks)
+            mediaDataSize += chunk.size;
+
+        std::vector<TrackLayout> layouts(tracks.size());
+        uint64_t movieDuration = 0;
+        for (size_t trackIdx = 0; trackIdx < tracks.size(); ++trackIdx)
+        {
+            TrackLayout& layout = layouts[trackIdx];
+            layout.source = &movieTemplate.tracks[trackIdx];
+            layout.target = &tracks[trackIdx];
+
+            if (layout.source->timescale == 0)
+                throw AppException("Track has no timescale in ISO base media file");
+
+            layout.duration = 0;
+            for (const auto& sample : tracks[trackIdx].samples)
+                layout.duration += sample.duration;
+
+            layout.durationInMovieTimescale = static_cast<uint64_t>(
+                static_cast<double>(layout.duration) * movieTemplate.timescale / layout.source->timescale);
+
+            movieDuration = std::max(movieDuration, layout.durationInMovieTimescale);
+        }
+
+        for (const Chunk& chunk : chunks)
+            layouts[chunk.trackIdx].chunks.push_back(&chunk);
+
+        std::vector<uint8_t> header;
+        BigEndianWriter writer(header);
+        if (movieTemplate.fileType.begin != nullptr)
+        {
+            CopyBox(writer, movieTemplate.fileType);
+        }
+        else
+        {
+            const size_t ftyp = writer.BeginBox(MakeFourCC("ftyp"));
+            writer.WriteU32(MakeFourCC("isom"));
+            writer.WriteU32(0x200);
+            writer.WriteU32(MakeFourCC("isom"));
+            writer.WriteU32(MakeFourCC("mp41"));
+            writer.EndBox(ftyp);
+        }
+
+        const size_t fileTypeSize = header.size();
+        const bool useLargeMediaDataBox = mediaDataSize + 8 > std::numeric_limits<uint32_t>::max();
+        const uint64_t mediaDataHeaderSize = useLargeMediaDataBox ? 16 : 8;
+
+        // The size of the movie box depends on the width of the chunk offsets,
+        // but not on their values, so lay it out once to learn where media data starts:
+        const uint64_t maxMovieBoxSize = 64ULL << 20;
+        const bool useLargeOffsets =
+            fileTypeSize + maxMovieBoxSize + mediaDataHeaderSize + mediaDataSize
+                > std::numeric_limits<uint32_t>::max();
+
+        WriteContainer(writer, movieTemplate.box, movieTemplate, movieDuration, layouts, nullptr, useLargeOffsets);
+
+        uint64_t offset = header.size() + mediaDataHeaderSize;
+        for (Chunk& chunk : chunks)
+        {
+            chunk.offset = offset;
+            offset += chunk.size;
+        }
+
+        header.resize(fileTypeSize);
+        WriteContainer(writer, movieTemplate.box, movieTemplate, movieDuration, layouts, nullptr, useLargeOffsets);
+
+        if (useLargeMediaDataBox)
+        {
+            writer.WriteU32(1);
+            writer.WriteU32(MakeFourCC("mdat"));
+            writer.WriteU64(mediaDataHeaderSize + mediaDataSize);
+        }
+        else
+        {
+            writer.WriteU32(static_cast<uint32_t>(mediaDataHeaderSize + mediaDataSize));
+            writer.WriteU32(MakeFourCC("mdat"));
+        }
+
+        // a new file rather than truncating the old, which may be a hard link shared elsewhere:
+        std::error_code error;
+        std::filesystem::remove(ToPath(outputFName), error);
+
+        std::ofstream output(ToPath(outputFName), std::ios::binary | std::ios::trunc);
+        if (!output)
+            throw AppException("Could not create output file " + outputFName);
+
+        output.write(reinterpret_cast<const char*>(header.data()), header.size());
+        for (const Chunk& chunk : chunks)
+        {
+            const auto& samples = tracks[chunk.trackIdx].samples;
+            for (size_t idx = chunk.firstSampleIdx; idx < chunk.firstSampleIdx + chunk.sampleCount; ++idx)
+                output.write(reinterpret_cast<const char*>(samples[idx].data), samples[idx].size);
+        }
+
+        output.close();
+        if (!output)
+            throw AppException("Failed to write output file " + outputFName);
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "IsoBmff.hpp"
+
+#include <cinttypes>
+#include <string>
+#include <vector>
+
+namespace application
+{
+    /// <summary>
+    /// A sample to write, whose data lives elsewhere in memory.
+    /// </summary>
+    struct Mp4WriterSample
+    {
+        const uint8_t* data;
+        uint32_t size;
+
+        /// <summary>Duration in units of track timescale.</summary>
+        uint32_t duration;
+        int32_t compositionOffset;
+        bool isSync;
+    };
+
+    /// <summary>
+    /// The samples to write in a track.
+    /// </summary>
+    struct Mp4WriterTrack
+    {
+        std::vector<Mp4WriterSample> samples;
+    };
+
+    /// <summary>
+    /// Writes a (non-fragmented) MP4 file with the movie box ahead of the media data,
+    /// so playback can start before the whole file is downloaded.
+    /// </summary>
+    /// <param name="outputFName">The output file (UTF-8 encoded).</param>
+    /// <param name="movieTemplate">
+    /// The movie whose boxes are copied into the output, except for the sample tables
+    /// and durations, which are generated from the given samples.
+    /// </param>
+    /// <param name="tracks">The samples of each track, in the same order of the template.</param>
+    /// <remarks>Throws <see cref="AppException"/> on failure.</remarks>
+    void WriteMp4File(
+        const std::string& outputFName,
+        const IsoBmffMovie& movieTemplate,
+        const std::vector<Mp4WriterTrack>& tracks);
+}
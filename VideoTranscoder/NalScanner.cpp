@@ -0,0 +1,313 @@
+#include "NalScanner.hpp"
+#include "AppException.hpp"
+
+#include <bit>
+#include <string>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+#   define NAL_SCANNER_X86
+#   include <immintrin.h>
+#   ifdef _MSC_VER
+#       include <intrin.h>
+#   endif
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#   define NAL_SCANNER_NEON
+#   include <arm_neon.h>
+#endif
+
+// GCC and Clang only emit AVX2 in functions so marked, whereas MSVC always can:
+#if defined(NAL_SCANNER_X86) && (defined(__GNUC__) || defined(__clang__))
+#   define TARGET_AVX2 __attribute__((target("avx2")))
+#   define TARGET_SSE2 __attribute__((target("sse2")))
+#else
+#   define TARGET_AVX2
+#   define TARGET_SSE2
+#endif
+
+namespace application
+{
+    /// <summary>
+    /// Finds the first occurrence of the bytes 00 00 X.
+    /// </summary>
+    /// <returns>Where the pattern starts, or the end if not found.</returns>
+    typedef const uint8_t* (*FindPatternFn)(const uint8_t* begin, const uint8_t* end, uint8_t third);
+
+    static const uint8_t* FindPatternScalar(const uint8_t* begin, const uint8_t* end, uint8_t third)
+    {
+        const uint8_t* pos = begin;
+        while (end - pos > 2)
+        {
+            // when the 3rd byte is neither 0 nor X, the pattern cannot start at any of the 3 bytes:
+            if (pos[2] != 0 && pos[2] != third)
+                pos += 3;
+            else if (pos[0] == 0 && pos[1] == 0 && pos[2] == third)
+                return pos;
+            else
+                ++pos;
+        }
+        return end;
+    }
+
+#ifdef NAL_SCANNER_X86
+
+    TARGET_SSE2
+    static const uint8_t* FindPatternSse2(const uint8_t* begin, const uint8_t* end, uint8_t third)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i thirdByte = _mm_set1_epi8(static_cast<char>(third));
+
+        // compare 16 positions at once, with loads shifted by 1 and 2 bytes:
+        const uint8_t* pos = begin;
+        for (; end - pos >= 18; pos += 16)
+        {
+            const __m128i byte0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+            const __m128i byte1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos + 1));
+            const __m128i byte2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos + 2));
+
+            const __m128i match = _mm_and_si128(
+                _mm_and_si128(_mm_cmpeq_epi8(byte0, zero), _mm_cmpeq_epi8(byte1, zero)),
+                _mm_cmpeq_epi8(byte2, thirdByte));
+
+            const auto mask = static_cast<uint32_t>(_mm_movemask_epi8(match));
+            if (mask != 0)
+                return pos + std::countr_zero(mask);
+        }
+        return FindPatternScalar(pos, end, third);
+    }
+
+    TARGET_AVX2
+    static const uint8_t* FindPatternAvx2(const uint8_t* begin, const uint8_t* end, uint8_t third)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i thirdByte = _mm256_set1_epi8(static_cast<char>(third));
+
+        const uint8_t* pos = begin;
+        for (; end - pos >= 34; pos += 32)
+        {
+            const __m256i byte0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pos));
+            const __m256i byte1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pos + 1));
+            const __m256i byte2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pos + 2));
+
+            const __m256i match = _mm256_and_si256(
+                _mm256_and_si256(_mm256_cmpeq_epi8(byte0, zero), _mm256_cmpeq_epi8(byte1, zero)),
+                _mm256_cmpeq_epi8(byte2, thirdByte));
+
+            const auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(match));
+            if (mask != 0)
+                return pos + std::countr_zero(mask);
+        }
+        return FindPatternSse2(pos, end, third);
+    }
+
+    static bool IsAvx2Supported()
+    {
+#   ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+            return false;
+
+        // OS must save the YMM registers (OSXSAVE and XCR0 bits):
+        __cpuid(info, 1);
+        const bool osxsave = (info[2] & (1 << 27)) != 0;
+        if (!osxsave || (_xgetbv(0) & 0x6) != 0x6)
+            return false;
+
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#   else
+        return __builtin_cpu_supports("avx2");
+#   endif
+    }
+
+#endif // NAL_SCANNER_X86
+
+#ifdef NAL_SCANNER_NEON
+
+    static const uint8_t* FindPatternNeon(const uint8_t* begin, const uint8_t* end, uint8_t third)
+    {
+        const uint8x16_t zero = vdupq_n_u8(0);
+        const uint8x16_t thirdByte = vdupq_n_u8(third);
+
+        const uint8_t* pos = begin;
+        for (; end - pos >= 18; pos += 16)
+        {
+            const uint8x16_t match = vandq_u8(
+                vandq_u8(vceqq_u8(vld1q_u8(pos), zero), vceqq_u8(vld1q_u8(pos + 1), zero)),
+                vceqq_u8(vld1q_u8(pos + 2), thirdByte));
+
+            // no movemask in NEON: locate the match among the 16 positions in scalar code
+            if (vmaxvq_u8(match) != 0)
+                return FindPatternScalar(pos, pos + 18, third);
+        }
+        return FindPatternScalar(pos, end, third);
+    }
+
+#endif // NAL_SCANNER_NEON
+
+    const char* GetSimdLevelName(SimdLevel level)
+    {
+        switch (level)
+        {
+        case SimdLevel::Sse2:
+            return "SSE2";
+        case SimdLevel::Avx2:
+            return "AVX2";
+        case SimdLevel::Neon:
+            return "NEON";
+        default:
+            return "scalar";
+        }
+    }
+
+    SimdLevel GetSupportedSimdLevel()
+    {
+        static const SimdLevel supportedLevel = []()
+        {
+#if defined(NAL_SCANNER_X86)
+            if (IsAvx2Supported())
+                return SimdLevel::Avx2;
+#   if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+            return SimdLevel::Sse2;
+#   else
+            return SimdLevel::Scalar;
+#   endif
+#elif defined(NAL_SCANNER_NEON)
+            return SimdLevel::Neon;
+#else
+            return SimdLevel::Scalar;
+#endif
+        }();
+
+        return supportedLevel;
+    }
+
+    static FindPatternFn GetFindPattern(SimdLevel level)
+    {
+        switch (level)
+        {
+        case SimdLevel::Scalar:
+            return &FindPatternScalar;
+#ifdef NAL_SCANNER_X86
+        case SimdLevel::Sse2:
+            return &FindPatternSse2;
+        case SimdLevel::Avx2:
+            if (IsAvx2Supported())
+                return &FindPatternAvx2;
+            break;
+#endif
+#ifdef NAL_SCANNER_NEON
+        case SimdLevel::Neon:
+            return &FindPatternNeon;
+#endif
+        default:
+            break;
+        }
+        throw AppException(std::string("Instruction set not supported: ") + GetSimdLevelName(level));
+    }
+
+    uint8_t GetNalType(uint8_t header, Encoder codec)
+    {
+        switch (codec)
+        {
+        case Encoder::H264_AVC:
+            return header & 0x1F;
+        case Encoder::H265_HEVC:
+            return (header >> 1) & 0x3F;
+        default:
+            throw AppException("Codec has no NAL units");
+        }
+    }
+
+    bool IsRandomAccessNal(uint8_t type, Encoder codec)
+    {
+        return codec == Encoder::H264_AVC
+            ? type == 5                 // IDR
+            : type >= 16 && type <= 23; // BLA, IDR, CRA (and reserved IRAP)
+    }
+
+    bool IsParameterSetNal(uint8_t type, Encoder codec)
+    {
+        return codec == Encoder::H264_AVC
+            ? type == 7 || type == 8              // SPS, PPS
+            : type == 32 || type == 33 || type == 34; // VPS, SPS, PPS
+    }
+
+    std::vector<NalUnit> ScanAnnexB(const uint8_t* data, uint64_t size, Encoder codec, SimdLevel level)
+    {
+        const FindPatternFn findPattern = GetFindPattern(level);
+        const uint8_t* const end = data + size;
+
+        std::vector<NalUnit> nalUnits;
+        const uint8_t* startCode = findPattern(data, end, 1);
+        while (startCode != end)
+        {
+            const uint8_t* nalBegin = startCode + 3;
+            startCode = findPattern(nalBegin, end, 1);
+
+            // zeros before the next start code belong to it (4-byte form) or are trailing padding:
+            const uint8_t* nalEnd = startCode;
+            while (nalEnd > nalBegin && nalEnd[-1] == 0)
+                --nalEnd;
+
+            if (nalEnd > nalBegin)
+            {
+                nalUnits.push_back(NalUnit{
+                    static_cast<uint64_t>(nalBegin - data),
+                    static_cast<uint64_t>(nalEnd - nalBegin),
+                    GetNalType(*nalBegin, codec)
+                });
+            }
+        }
+        return nalUnits;
+    }
+
+    std::vector<NalUnit> ScanLengthPrefixed(const uint8_t* data, uint64_t size, uint32_t lengthSize, Encoder codec)
+    {
+        if (lengthSize != 1 && lengthSize != 2 && lengthSize != 4)
+            throw AppException("Invalid size of NAL unit length prefix");
+
+        std::vector<NalUnit> nalUnits;
+        uint64_t offset = 0;
+        while (size - offset >= lengthSize)
+        {
+            uint64_t nalSize = 0;
+            for (uint32_t idx = 0; idx < lengthSize; ++idx)
+                nalSize = (nalSize << 8) | data[offset + idx];
+
+            offset += lengthSize;
+            if (nalSize > size - offset)
+                throw AppException("NAL unit length goes past the end of the sample");
+
+            if (nalSize > 0)
+                nalUnits.push_back(NalUnit{ offset, nalSize, GetNalType(data[offset], codec) });
+
+            offset += nalSize;
+        }
+        return nalUnits;
+    }
+
+    std::vector<uint8_t> ExtractRbsp(const uint8_t* nal, uint64_t size, SimdLevel level)
+    {
+        const FindPatternFn findPattern = GetFindPattern(level);
+        const uint8_t* const end = nal + size;
+
+        std::vector<uint8_t> rbsp;
+        rbsp.reserve(static_cast<size_t>(size));
+
+        // copy everything but the 03 in each 00 00 03:
+        const uint8_t* pos = nal;
+        while (true)
+        {
+            const uint8_t* emulation = findPattern(pos, end, 3);
+            if (emulation == end)
+            {
+                rbsp.insert(rbsp.end(), pos, end);
+                return rbsp;
+            }
+
+            rbsp.insert(rbsp.end(), pos, emulation + 2);
+            pos = emulation + 3;
+        }
+    }
+}
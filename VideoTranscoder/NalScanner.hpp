@@ -0,0 +1,91 @@
+#pragma once
+
+#include "Encoder.hpp"
+
+#include <cinttypes>
+#include <vector>
+
+namespace application
+{
+    /// <summary>
+    /// Instruction sets the NAL scanner can search with.
+    /// </summary>
+    enum class SimdLevel { Scalar, Sse2, Avx2, Neon };
+
+    const char* GetSimdLevelName(SimdLevel level);
+
+    /// <summary>
+    /// Gets the best instruction set supported by the CPU running this process.
+    /// </summary>
+    SimdLevel GetSupportedSimdLevel();
+
+    /// <summary>
+    /// A NAL unit located in a buffer.
+    /// </summary>
+    struct NalUnit
+    {
+        /// <summary>Where the NAL unit header starts (past the start code or length prefix).</summary>
+        uint64_t offset;
+
+        /// <summary>Size of the NAL unit, header included.</summary>
+        uint64_t size;
+
+        uint8_t type;
+    };
+
+    /// <summary>
+    /// Gets the type of a NAL unit from the first byte of its header.
+    /// </summary>
+    /// <param name="header">The first byte of the NAL unit header.</param>
+    /// <param name="codec">Either H.264 or HEVC.</param>
+    uint8_t GetNalType(uint8_t header, Encoder codec);
+
+    /// <summary>
+    /// Tells whether a NAL unit type starts a picture that can be decoded on its own
+    /// (IDR in H.264, IRAP in HEVC).
+    /// </summary>
+    bool IsRandomAccessNal(uint8_t type, Encoder codec);
+
+    /// <summary>
+    /// Tells whether a NAL unit type is a parameter set (SPS and PPS, and VPS in HEVC).
+    /// </summary>
+    bool IsParameterSetNal(uint8_t type, Encoder codec);
+
+    /// <summary>
+    /// Locates the NAL units in a byte stream delimited by start codes (Annex B).
+    /// </summary>
+    /// <param name="data">The byte stream.</param>
+    /// <param name="size">Size of the byte stream.</param>
+    /// <param name="codec">Either H.264 or HEVC.</param>
+    /// <param name="level">The instruction set to search with.</param>
+    /// <returns>The NAL units in order of appearance.</returns>
+    std::vector<NalUnit> ScanAnnexB(const uint8_t* data,
+                                    uint64_t size,
+                                    Encoder codec,
+                                    SimdLevel level = GetSupportedSimdLevel());
+
+    /// <summary>
+    /// Locates the NAL units in a sample of MP4, where each is prefixed by its length.
+    /// </summary>
+    /// <param name="data">The sample data.</param>
+    /// <param name="size">Size of the sample.</param>
+    /// <param name="lengthSize">Size of the length prefix (1, 2 or 4 bytes), as in avcC/hvcC.</param>
+    /// <param name="codec">Either H.264 or HEVC.</param>
+    /// <returns>The NAL units in order of appearance.</returns>
+    /// <remarks>Throws <see cref="AppException"/> if a length goes past the end.</remarks>
+    std::vector<NalUnit> ScanLengthPrefixed(const uint8_t* data,
+                                            uint64_t size,
+                                            uint32_t lengthSize,
+                                            Encoder codec);
+
+    /// <summary>
+    /// Removes the emulation prevention bytes from a NAL unit, so that its
+    /// syntax elements can be parsed (raw byte sequence payload).
+    /// </summary>
+    /// <param name="nal">The NAL unit.</param>
+    /// <param name="size">Size of the NAL unit.</param>
+    /// <param name="level">The instruction set to search with.</param>
+    std::vector<uint8_t> ExtractRbsp(const uint8_t* nal,
+                                     uint64_t size,
+                                     SimdLevel level = GetSupportedSimdLevel());
+}
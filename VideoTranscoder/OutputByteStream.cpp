@@ -0,0 +1,222 @@
+#include "stdafx.h"
+#include "OutputByteStream.hpp"
+
+#include "AppException.hpp"
+#include "ByteStreamRequest.hpp"
+
+#include <iostream>
+
+namespace application
+{
+    OutputByteStream::OutputByteStream(const std::string& fileName,
+                                       const WriteBufferOptions& options,
+                                       uint64_t expectedSize)
+        : m_writer(fileName, options, expectedSize)
+        , m_refCount(0)
+    {
+    }
+
+    uint64_t OutputByteStream::GetWrittenLength() const
+    {
+        std::lock_guard<std::mutex> lock(m_writerMutex);
+        return m_writer.GetLength();
+    }
+
+    STDMETHODIMP OutputByteStream::QueryInterface(REFIID riid, void** ppv)
+    {
+        static const QITAB qit[] =
+        {
+            QITABENT(OutputByteStream, IMFByteStream),
+            { 0 }
+        };
+        return QISearch(this, qit, riid, ppv);
+    }
+
+    STDMETHODIMP_(ULONG) OutputByteStream::AddRef()
+    {
+        return InterlockedIncrement(&m_refCount);
+    }
+
+    STDMETHODIMP_(ULONG) OutputByteStream::Release()
+    {
+        long refCount = InterlockedDecrement(&m_refCount);
+        if (refCount == 0)
+        {
+            delete this;
+        }
+        return refCount;
+    }
+
+    HRESULT OutputByteStream::WriteBuffered(const BYTE* buffer, ULONG size)
+    {
+        try
+        {
+            std::lock_guard<std::mutex> lock(m_writerMutex);
+            m_writer.Write(buffer, size);
+        }
+        catch (AppException& ex)
+        {
+            std::cerr << std::endl << ex.Serialize() << std::endl;
+            return E_FAIL;
+        }
+
+        return S_OK;
+    }
+
+    STDMETHODIMP OutputByteStream::GetCapabilities(DWORD* capabilities)
+    {
+        if (capabilities == nullptr)
+            return E_POINTER;
+
+        *capabilities = MFBYTESTREAM_IS_WRITABLE | MFBYTESTREAM_IS_SEEKABLE;
+        return S_OK;
+    }
+
+    STDMETHODIMP OutputByteStream::GetLength(QWORD* length)
+    {
+        if (length == nullptr)
+            return E_POINTER;
+
+        *length = GetWrittenLength();
+        return S_OK;
+    }
+
+    STDMETHODIMP OutputByteStream::SetLength(QWORD length)
+    {
+        std::lock_guard<std::mutex> lock(m_writerMutex);
+        m_writer.SetLength(length);
+        return S_OK;
+    }
+
+    STDMETHODIMP OutputByteStream::GetCurrentPosition(QWORD* position)
+    {
+        if (position == nullptr)
+            return E_POINTER;
+
+        std::lock_guard<std::mutex> lock(m_writerMutex);
+        *position = m_writer.GetPosition();
+        return S_OK;
+    }
+
+    STDMETHODIMP OutputByteStream::SetCurrentPosition(QWORD position)
+    {
+        std::lock_guard<std::mutex> lock(m_writerMutex);
+        m_writer.Seek(position);
+        return S_OK;
+    }
+
+    STDMETHODIMP OutputByteStream::IsEndOfStream(BOOL* endOfStream)
+    {
+        if (endOfStream == nullptr)
+            return E_POINTER;
+
+        std::lock_guard<std::mutex> lock(m_writerMutex);
+        *endOfStream = m_writer.GetPosition() >= m_writer.GetLength();
+        return S_OK;
+    }
+
+    STDMETHODIMP OutputByteStream::Read(BYTE* buffer, ULONG size, ULONG* bytesRead)
+    {
+        return E_ACCESSDENIED;
+    }
+
+    STDMETHODIMP OutputByteStream::BeginRead(BYTE* buffer, ULONG size, IMFAsyncCallback* callback, IUnknown* state)
+    {
+        return E_ACCESSDENIED;
+    }
+
+    STDMETHODIMP OutputByteStream::EndRead(IMFAsyncResult* result, ULONG* bytesRead)
+    {
+        return E_ACCESSDENIED;
+    }
+
+    STDMETHODIMP OutputByteStream::Write(const BYTE* buffer, ULONG size, ULONG* bytesWritten)
+    {
+        if (buffer == nullptr || bytesWritten == nullptr)
+            return E_POINTER;
+
+        HRESULT hr = WriteBuffered(buffer, size);
+        *bytesWritten = SUCCEEDED(hr) ? size : 0;
+        return hr;
+    }
+
+    STDMETHODIMP OutputByteStream::BeginWrite(const BYTE* buffer, ULONG size, IMFAsyncCallback* callback, IUnknown* state)
+    {
+        if (buffer == nullptr || callback == nullptr)
+            return E_POINTER;
+
+        // copying into the buffer is all it takes, the writing to the file goes on in the background:
+        ComPtr<ByteStreamRequest> request(new ByteStreamRequest(nullptr, 0, size));
+        const HRESULT writeStatus = WriteBuffered(buffer, size);
+        request->bytesTransferred = SUCCEEDED(writeStatus) ? size : 0;
+
+        ComPtr<IMFAsyncResult> callerResult;
+        HRESULT hr = MFCreateAsyncResult(request.Get(), callback, state, callerResult.GetAddressOf());
+        if (FAILED(hr))
+            return hr;
+
+        callerResult->SetStatus(writeStatus);
+        return MFInvokeCallback(callerResult.Get());
+    }
+
+    STDMETHODIMP OutputByteStream::EndWrite(IMFAsyncResult* result, ULONG* bytesWritten)
+    {
+        if (result == nullptr || bytesWritten == nullptr)
+            return E_POINTER;
+
+        ComPtr<IUnknown> object;
+        HRESULT hr = result->GetObject(object.GetAddressOf());
+        if (FAILED(hr))
+            return hr;
+
+        *bytesWritten = static_cast<ByteStreamRequest*>(object.Get())->bytesTransferred;
+        return result->GetStatus();
+    }
+
+    STDMETHODIMP OutputByteStream::Seek(MFBYTESTREAM_SEEK_ORIGIN origin, LONGLONG offset, DWORD flags, QWORD* position)
+    {
+        std::lock_guard<std::mutex> lock(m_writerMutex);
+        const LONGLONG base = origin == msoCurrent ? static_cast<LONGLONG>(m_writer.GetPosition()) : 0;
+        if (base + offset < 0)
+            return E_INVALIDARG;
+
+        m_writer.Seek(static_cast<uint64_t>(base + offset));
+        if (position != nullptr)
+            *position = m_writer.GetPosition();
+
+        return S_OK;
+    }
+
+    STDMETHODIMP OutputByteStream::Flush()
+    {
+        try
+        {
+            std::lock_guard<std::mutex> lock(m_writerMutex);
+            m_writer.Flush();
+        }
+        catch (AppException& ex)
+        {
+            std::cerr << std::endl << ex.Serialize() << std::endl;
+            return E_FAIL;
+        }
+
+        return S_OK;
+    }
+
+    STDMETHODIMP OutputByteStream::Close()
+    {
+        // called by the sink when finalized, and by the session once done (which is then a no-op):
+        try
+        {
+            std::lock_guard<std::mutex> lock(m_writerMutex);
+            m_writer.Close();
+        }
+        catch (AppException& ex)
+        {
+            std::cerr << std::endl << ex.Serialize() << std::endl;
+            return E_FAIL;
+        }
+
+        return S_OK;
+    }
+}
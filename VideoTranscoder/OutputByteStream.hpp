@@ -0,0 +1,73 @@
+#pragma once
+
+#include "BufferedFileWriter.hpp"
+
+#include <memory>
+#include <mutex>
+
+#include <Windows.h>
+#include <mfobjects.h>
+#include <wrl.h>
+
+namespace application
+{
+    using namespace Microsoft::WRL;
+
+    /// <summary>
+    /// Write-only MF byte stream for the output of the media sink, which coalesces its
+    /// small writes into large ones made in the background by a <see cref="BufferedFileWriter"/>.
+    /// </summary>
+    /// <remarks>
+    /// Asynchronous writes complete as soon as the data is buffered.
+    /// </remarks>
+    class OutputByteStream : public IMFByteStream
+    {
+    private:
+
+        BufferedFileWriter m_writer;
+        mutable std::mutex m_writerMutex;
+        long m_refCount;
+
+        HRESULT WriteBuffered(const BYTE* buffer, ULONG size);
+
+    public:
+
+        /// <summary>
+        /// Creates a new instance, which creates the file.
+        /// </summary>
+        /// <param name="fileName">The output file (UTF-8 encoded), which replaces any existing one.</param>
+        /// <param name="options">How to buffer the writes.</param>
+        /// <param name="expectedSize">How large the output is expected to be, to reserve space, or zero not to.</param>
+        /// <remarks>Throws <see cref="AppException"/> on failure.</remarks>
+        OutputByteStream(const std::string& fileName, const WriteBufferOptions& options, uint64_t expectedSize);
+
+        virtual ~OutputByteStream() = default;
+
+        /// <summary>
+        /// Gets the length of the output so far, counting what is still buffered.
+        /// </summary>
+        uint64_t GetWrittenLength() const;
+
+        // IUnknown methods
+        STDMETHODIMP QueryInterface(REFIID riid, void** ppv);
+        STDMETHODIMP_(ULONG) AddRef();
+        STDMETHODIMP_(ULONG) Release();
+
+        // IMFByteStream methods
+        STDMETHODIMP GetCapabilities(DWORD* capabilities);
+        STDMETHODIMP GetLength(QWORD* length);
+        STDMETHODIMP SetLength(QWORD length);
+        STDMETHODIMP GetCurrentPosition(QWORD* position);
+        STDMETHODIMP SetCurrentPosition(QWORD position);
+        STDMETHODIMP IsEndOfStream(BOOL* endOfStream);
+        STDMETHODIMP Read(BYTE* buffer, ULONG size, ULONG* bytesRead);
+        STDMETHODIMP BeginRead(BYTE* buffer, ULONG size, IMFAsyncCallback* callback, IUnknown* state);
+        STDMETHODIMP EndRead(IMFAsyncResult* result, ULONG* bytesRead);
+        STDMETHODIMP Write(const BYTE* buffer, ULONG size, ULONG* bytesWritten);
+        STDMETHODIMP BeginWrite(const BYTE* buffer, ULONG size, IMFAsyncCallback* callback, IUnknown* state);
+        STDMETHODIMP EndWrite(IMFAsyncResult* result, ULONG* bytesWritten);
+        STDMETHODIMP Seek(MFBYTESTREAM_SEEK_ORIGIN origin, LONGLONG offset, DWORD flags, QWORD* position);
+        STDMETHODIMP Flush();
+        STDMETHODIMP Close();
+    };
+}
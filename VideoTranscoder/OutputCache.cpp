@@ -0,0 +1,156 @@
+#include "OutputCache.hpp"
+
+#include "AppException.hpp"
+#include "ContentFingerprint.hpp"
+#include "Utf8Path.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+namespace application
+{
+    namespace fs = std::filesystem;
+
+    OutputCache::OutputCache(const std::string& directory, const OutputCacheLimits& limits)
+        : m_directory(ToPath(directory))
+        , m_limits(limits)
+    {
+        std::error_code error;
+        fs::create_directories(m_directory, error);
+        if (error)
+            throw AppException("Could not create output cache directory " + directory + ": " + error.message());
+    }
+
+    std::string OutputCache::MakeKey(const std::string& inputFingerprint,
+                                     const TranscodeSettings& settings,
+                                     const StreamSelectionPolicy& streamSelection,
+                                     bool faststart)
+    {
+        // everything that makes a difference in the output, which excludes whether hardware is
+        // allowed (where it runs) and the target size factor (already in the data rates):
+        std::ostringstream oss;
+        oss << "encoder " << GetEncoderName(settings.videoEncoder)
+            << "\nstream_copy " << settings.streamCopy
+            << "\nvideo_bitrate " << settings.videoAvgBitrate
+            << "\nvideo_peak_bitrate " << settings.videoPeakBitrate
+            << "\nquality_vs_speed " << settings.videoQualityVsSpeed
+            << "\naudio_bytes_per_sec " << settings.audioAvgBytesPerSec
+            << "\naudio_copy " << settings.audioCopy
+            << "\nfragment_ms " << settings.fragmentDuration.count()
+            << "\ngop_size " << settings.videoGopSize
+            << "\nbit_depth " << settings.videoBitDepth
+            << "\nlevel " << settings.videoLevel
+            << "\naudio_language " << streamSelection.audioLanguage
+            << "\naudio_track " << (streamSelection.audioTrack ? std::to_string(*streamSelection.audioTrack) : "-")
+            << "\nfaststart " << faststart;
+
+        const std::string parameters = oss.str();
+        std::ostringstream key;
+        key << inputFingerprint << '-'
+            << std::hex << std::setfill('0') << std::setw(16) << XxHash64(parameters.data(), parameters.size());
+        return key.str();
+    }
+
+    fs::path OutputCache::GetEntryPath(const std::string& key) const
+    {
+        return m_directory / (key + ".mp4");
+    }
+
+    /// <summary>
+    /// Makes a file at a path with the content of another, as a hard link when possible.
+    /// </summary>
+    static void LinkOrCopy(const fs::path& from, const fs::path& to, std::error_code& error)
+    {
+        fs::create_hard_link(from, to, error);
+        if (error)
+            fs::copy_file(from, to, fs::copy_options::overwrite_existing, error);
+    }
+
+    bool OutputCache::Fetch(const std::string& key, const std::string& outputFName)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        const fs::path entryPath = GetEntryPath(key);
+        std::error_code error;
+        if (!fs::is_regular_file(entryPath, error))
+            return false;
+
+        const fs::path outputPath = ToPath(outputFName);
+        fs::remove(outputPath, error);
+        LinkOrCopy(entryPath, outputPath, error);
+        if (error)
+            throw AppException("Could not take output " + outputFName + " from cache: " + error.message());
+
+        // the time of last write tells the last use, for eviction:
+        fs::last_write_time(entryPath, fs::file_time_type::clock::now(), error);
+        return true;
+    }
+
+    void OutputCache::Store(const std::string& key, const std::string& outputFName)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // aside first, so that a concurrent fetch never finds it partially copied:
+        const fs::path entryPath = GetEntryPath(key);
+        fs::path tempPath = entryPath;
+        tempPath += ".tmp";
+
+        std::error_code error;
+        fs::remove(tempPath, error);
+        LinkOrCopy(ToPath(outputFName), tempPath, error);
+        if (!error)
+            fs::rename(tempPath, entryPath, error);
+
+        if (error)
+        {
+            const std::string reason = error.message();
+            fs::remove(tempPath, error);
+            throw AppException("Could not keep output " + outputFName + " in cache: " + reason);
+        }
+
+        fs::last_write_time(entryPath, fs::file_time_type::clock::now(), error);
+        Evict();
+    }
+
+    void OutputCache::Evict()
+    {
+        struct Entry
+        {
+            fs::path path;
+            uint64_t size;
+            fs::file_time_type lastUse;
+        };
+
+        std::vector<Entry> entries;
+        std::error_code error;
+        for (fs::directory_iterator iter(m_directory, error), end; !error && iter != end; iter.increment(error))
+        {
+            if (iter->path().extension() != ".mp4" || !iter->is_regular_file(error))
+                continue;
+
+            Entry entry{ iter->path(), iter->file_size(error), iter->last_write_time(error) };
+            if (!error)
+                entries.push_back(std::move(entry));
+        }
+
+        // least recently used first:
+        std::sort(entries.begin(), entries.end(),
+            [](const Entry& left, const Entry& right) { return left.lastUse < right.lastUse; });
+
+        uint64_t totalSize = 0;
+        for (const Entry& entry : entries)
+            totalSize += entry.size;
+
+        const auto oldest = fs::file_time_type::clock::now() - m_limits.maxAge;
+        for (const Entry& entry : entries)
+        {
+            if (entry.lastUse >= oldest && totalSize <= m_limits.maxSize)
+                break;
+
+            if (fs::remove(entry.path, error))
+                totalSize -= entry.size;
+        }
+    }
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "StreamSelection.hpp"
+#include "TranscodeSettings.hpp"
+
+#include <chrono>
+#include <cinttypes>
+#include <filesystem>
+#include <mutex>
+#include <string>
+
+namespace application
+{
+    /// <summary>
+    /// How much an <see cref="OutputCache"/> keeps.
+    /// </summary>
+    struct OutputCacheLimits
+    {
+        /// <summary>How much disk space the cached outputs take at most.</summary>
+        uint64_t maxSize = uint64_t(50) << 30;
+
+        /// <summary>How long a cached output is kept since it was last used.</summary>
+        std::chrono::hours maxAge = std::chrono::hours(30 * 24);
+    };
+
+    /// <summary>
+    /// Cache of outputs addressed by the content of the input and the parameters of the job,
+    /// so that a job submitted again takes the output produced before instead of encoding it anew.
+    /// </summary>
+    /// <remarks>
+    /// Outputs enter and leave the cache as hard links when the file system allows, otherwise
+    /// as copies. The outputs used least recently go first once the cache exceeds its limits.
+    /// Thread-safe.
+    /// </remarks>
+    class OutputCache
+    {
+    private:
+
+        const std::filesystem::path m_directory;
+        const OutputCacheLimits m_limits;
+        std::mutex m_mutex;
+
+        std::filesystem::path GetEntryPath(const std::string& key) const;
+
+        void Evict();
+
+    public:
+
+        /// <summary>
+        /// Creates a new instance, which creates the directory if missing.
+        /// </summary>
+        /// <param name="directory">Where the cached outputs are kept (UTF-8 encoded).</param>
+        /// <param name="limits">How much the cache keeps.</param>
+        /// <remarks>Throws <see cref="AppException"/> on failure.</remarks>
+        OutputCache(const std::string& directory, const OutputCacheLimits& limits);
+
+        OutputCache(const OutputCache&) = delete;
+        OutputCache& operator=(const OutputCache&) = delete;
+
+        /// <summary>
+        /// Makes the key of the output of a job.
+        /// </summary>
+        /// <param name="inputFingerprint">The fingerprint of the content of the input.</param>
+        /// <param name="settings">The encoding parameters of the job.</param>
+        /// <param name="streamSelection">How the streams of the input are chosen.</param>
+        /// <param name="faststart">Whether the movie header of the output is moved in front.</param>
+        static std::string MakeKey(const std::string& inputFingerprint,
+                                   const TranscodeSettings& settings,
+                                   const StreamSelectionPolicy& streamSelection,
+                                   bool faststart);
+
+        /// <summary>
+        /// Puts the cached output of a key in place of an output file.
+        /// </summary>
+        /// <returns>Whether the cache had an output for the key.</returns>
+        /// <remarks>Throws <see cref="AppException"/> if the output could not be put in place.</remarks>
+        bool Fetch(const std::string& key, const std::string& outputFName);
+
+        /// <summary>
+        /// Keeps an output file in the cache under a key, then evicts what exceeds the limits.
+        /// </summary>
+        /// <remarks>Throws <see cref="AppException"/> on failure.</remarks>
+        void Store(const std::string& key, const std::string& outputFName);
+    };
+}
@@ -0,0 +1,165 @@
+#include "OutputFile.hpp"
+#include "AppException.hpp"
+#include "Utf8Path.hpp"
+
+#ifdef _WIN32
+#   define WIN32_LEAN_AND_MEAN
+#   define NOMINMAX
+#   include <windows.h>
+#else
+#   include <cerrno>
+#   include <cstring>
+#   include <fcntl.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <sstream>
+
+namespace application
+{
+    static AppException CreateFileException(const char* what, const std::string& fileName)
+    {
+        std::ostringstream oss;
+        oss << "Could not " << what << " file " << fileName << ": ";
+#ifdef _WIN32
+        oss << "error code " << GetLastError();
+#else
+        oss << strerror(errno);
+#endif
+        return AppException(oss.str());
+    }
+
+    /// <summary>
+    /// How much is written at most in a single system call.
+    /// </summary>
+    static constexpr size_t maxWriteChunk = size_t(1) << 30;
+
+#ifdef _WIN32
+
+    OutputFile::OutputFile(const std::string& fileName)
+        : m_fileName(fileName)
+        , m_fileHandle(INVALID_HANDLE_VALUE)
+    {
+        // a new file rather than truncating the old, which may be a hard link shared elsewhere:
+        DeleteFileW(ToPath(fileName).c_str());
+
+        m_fileHandle = CreateFileW(ToPath(fileName).c_str(),
+            GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+            CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+        if (m_fileHandle == INVALID_HANDLE_VALUE)
+            throw CreateFileException("create", fileName);
+    }
+
+    void OutputFile::Write(uint64_t offset, const void* data, size_t size)
+    {
+        size_t total = 0;
+        while (total < size)
+        {
+            // positional, so that concurrent writes do not race for the file pointer:
+            OVERLAPPED overlapped = {};
+            overlapped.Offset = static_cast<DWORD>(offset + total);
+            overlapped.OffsetHigh = static_cast<DWORD>((offset + total) >> 32);
+
+            DWORD bytesWritten = 0;
+            const DWORD chunk = static_cast<DWORD>(std::min(size - total, maxWriteChunk));
+            if (!WriteFile(m_fileHandle, static_cast<const uint8_t*>(data) + total, chunk, &bytesWritten, &overlapped))
+                throw CreateFileException("write", m_fileName);
+
+            total += bytesWritten;
+        }
+    }
+
+    bool OutputFile::Preallocate(uint64_t size) noexcept
+    {
+        FILE_ALLOCATION_INFO allocationInfo;
+        allocationInfo.AllocationSize.QuadPart = static_cast<LONGLONG>(size);
+        return SetFileInformationByHandle(
+            m_fileHandle, FileAllocationInfo, &allocationInfo, sizeof allocationInfo) != FALSE;
+    }
+
+    void OutputFile::Truncate(uint64_t size)
+    {
+        FILE_END_OF_FILE_INFO endOfFileInfo;
+        endOfFileInfo.EndOfFile.QuadPart = static_cast<LONGLONG>(size);
+        if (!SetFileInformationByHandle(m_fileHandle, FileEndOfFileInfo, &endOfFileInfo, sizeof endOfFileInfo))
+            throw CreateFileException("truncate", m_fileName);
+    }
+
+    void OutputFile::Close() noexcept
+    {
+        if (m_fileHandle != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(m_fileHandle);
+            m_fileHandle = INVALID_HANDLE_VALUE;
+        }
+    }
+
+#else
+
+    OutputFile::OutputFile(const std::string& fileName)
+        : m_fileName(fileName)
+        , m_fileDescriptor(-1)
+    {
+        // a new file rather than truncating the old, which may be a hard link shared elsewhere:
+        unlink(fileName.c_str());
+
+        m_fileDescriptor = open(fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (m_fileDescriptor < 0)
+            throw CreateFileException("create", fileName);
+    }
+
+    void OutputFile::Write(uint64_t offset, const void* data, size_t size)
+    {
+        size_t total = 0;
+        while (total < size)
+        {
+            const size_t chunk = std::min(size - total, maxWriteChunk);
+            const ssize_t bytesWritten = pwrite(m_fileDescriptor,
+                static_cast<const uint8_t*>(data) + total, chunk, static_cast<off_t>(offset + total));
+
+            if (bytesWritten < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+
+                throw CreateFileException("write", m_fileName);
+            }
+
+            total += static_cast<size_t>(bytesWritten);
+        }
+    }
+
+    bool OutputFile::Preallocate(uint64_t size) noexcept
+    {
+#ifdef __linux__
+        return fallocate(m_fileDescriptor, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(size)) == 0;
+#else
+        return false;
+#endif
+    }
+
+    void OutputFile::Truncate(uint64_t size)
+    {
+        if (ftruncate(m_fileDescriptor, static_cast<off_t>(size)) != 0)
+            throw CreateFileException("truncate", m_fileName);
+    }
+
+    void OutputFile::Close() noexcept
+    {
+        if (m_fileDescriptor >= 0)
+        {
+            close(m_fileDescriptor);
+            m_fileDescriptor = -1;
+        }
+    }
+
+#endif
+
+    OutputFile::~OutputFile()
+    {
+        Close();
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cinttypes>
+#include <cstddef>
+#include <string>
+
+namespace application
+{
+    /// <summary>
+    /// A file created for writing, with 64-bit offsets and positional writes.
+    /// </summary>
+    /// <remarks>Writes are thread-safe, for they do not depend on a file pointer.</remarks>
+    class OutputFile
+    {
+    private:
+
+        const std::string m_fileName;
+
+#ifdef _WIN32
+        void* m_fileHandle;
+#else
+        int m_fileDescriptor;
+#endif
+
+    public:
+
+        /// <summary>
+        /// Creates a file, replacing any file with the same name.
+        /// </summary>
+        /// <param name="fileName">The file to create (UTF-8 encoded), which replaces any existing one.</param>
+        /// <remarks>Throws <see cref="AppException"/> on failure.</remarks>
+        explicit OutputFile(const std::string& fileName);
+
+        ~OutputFile();
+
+        OutputFile(const OutputFile&) = delete;
+        OutputFile& operator=(const OutputFile&) = delete;
+
+        const std::string& GetName() const
+        {
+            return m_fileName;
+        }
+
+        /// <summary>
+        /// Writes at an offset of the file.
+        /// </summary>
+        /// <remarks>Throws <see cref="AppException"/> on failure.</remarks>
+        void Write(uint64_t offset, const void* data, size_t size);
+
+        /// <summary>
+        /// Reserves space for the file to grow into without changing its size,
+        /// so that the file system can lay it out contiguously.
+        /// </summary>
+        /// <returns>Whether the space could be reserved (this being only an optimization).</returns>
+        bool Preallocate(uint64_t size) noexcept;
+
+        /// <summary>
+        /// Sets the size of the file, which also releases the space reserved beyond it.
+        /// </summary>
+        /// <remarks>Throws <see cref="AppException"/> on failure.</remarks>
+        void Truncate(uint64_t size);
+
+        /// <summary>
+        /// Closes the file, which cannot be written afterwards.
+        /// </summary>
+        void Close() noexcept;
+    };
+}
@@ -0,0 +1,564 @@
+#include "ParameterSets.hpp"
+#include "AppException.hpp"
+#include "BitReader.hpp"
+
+#include <algorithm>
+
+namespace application
+{
+    /// <summary>
+    /// Gets the RBSP of a parameter set, past its NAL unit header.
+    /// </summary>
+    static std::vector<uint8_t> GetPayload(const uint8_t* nal, uint64_t size, Encoder codec)
+    {
+        const uint64_t headerSize = (codec == Encoder::H265_HEVC) ? 2 : 1;
+        if (size <= headerSize)
+            throw AppException("Parameter set is truncated");
+
+        return ExtractRbsp(nal + headerSize, size - headerSize);
+    }
+
+    static void SkipH264ScalingList(BitReader& reader, uint32_t size)
+    {
+        int32_t lastScale = 8;
+        int32_t nextScale = 8;
+        for (uint32_t idx = 0; idx < size; ++idx)
+        {
+            if (nextScale != 0)
+                nextScale = (lastScale + reader.ReadSe() + 256) % 256;
+
+            lastScale = (nextScale == 0) ? lastScale : nextScale;
+        }
+    }
+
+    static void SkipHevcScalingListData(BitReader& reader)
+    {
+        for (uint32_t sizeId = 0; sizeId < 4; ++sizeId)
+        {
+            for (uint32_t matrixId = 0; matrixId < 6; matrixId += (sizeId == 3) ? 3 : 1)
+            {
+                if (!reader.ReadFlag()) // scaling_list_pred_mode_flag
+                {
+                    reader.ReadUe(); // scaling_list_pred_matrix_id_delta
+                    continue;
+                }
+
+                const uint32_t coefCount = std::min(64U, 1U << (4 + (sizeId << 1)));
+                if (sizeId > 1)
+                    reader.ReadSe(); // scaling_list_dc_coef_minus8
+
+                for (uint32_t idx = 0; idx < coefCount; ++idx)
+                    reader.ReadSe(); // scaling_list_delta_coef
+            }
+        }
+    }
+
+    /// <summary>
+    /// Reads the colour description and timing from VUI, which start alike in H.264 and HEVC
+    /// up to the chroma location.
+    /// </summary>
+    static void ReadVuiColour(BitReader& reader, SequenceParameterSet& sps)
+    {
+        if (reader.ReadFlag()) // aspect_ratio_info_present_flag
+        {
+            if (reader.ReadBits(8) == 255) // aspect_ratio_idc = EXTENDED_SAR
+                reader.Skip(32); // sar_width, sar_height
+        }
+
+        if (reader.ReadFlag()) // overscan_info_present_flag
+            reader.Skip(1);
+
+        if (reader.ReadFlag()) // video_signal_type_present_flag
+        {
+            reader.Skip(3); // video_format
+            sps.fullRange = reader.ReadFlag();
+            if (reader.ReadFlag()) // colour_description_present_flag
+            {
+                sps.colourPrimaries = reader.ReadBits(8);
+                sps.transferCharacteristics = reader.ReadBits(8);
+                sps.matrixCoefficients = reader.ReadBits(8);
+            }
+        }
+
+        if (reader.ReadFlag()) // chroma_loc_info_present_flag
+        {
+            reader.ReadUe();
+            reader.ReadUe();
+        }
+    }
+
+    static SequenceParameterSet ParseH264Sps(BitReader& reader)
+    {
+        SequenceParameterSet sps = {};
+        sps.profileIdc = reader.ReadBits(8);
+        reader.Skip(8); // constraint flags
+        sps.levelIdc = reader.ReadBits(8);
+        sps.id = reader.ReadUe();
+        sps.chromaFormatIdc = 1;
+        sps.bitDepthLuma = 8;
+        sps.bitDepthChroma = 8;
+        sps.colourPrimaries = sps.transferCharacteristics = sps.matrixCoefficients = 2;
+
+        bool separateColourPlanes = false;
+        switch (sps.profileIdc)
+        {
+        case 100: case 110: case 122: case 244: case 44:
+        case 83: case 86: case 118: case 128: case 138: case 139: case 134: case 135:
+            sps.chromaFormatIdc = reader.ReadUe();
+            if (sps.chromaFormatIdc == 3)
+                separateColourPlanes = reader.ReadFlag();
+
+            sps.bitDepthLuma = 8 + reader.ReadUe();
+            sps.bitDepthChroma = 8 + reader.ReadUe();
+            reader.Skip(1); // qpprime_y_zero_transform_bypass_flag
+
+            if (reader.ReadFlag()) // seq_scaling_matrix_present_flag
+            {
+                const uint32_t listCount = (sps.chromaFormatIdc != 3) ? 8 : 12;
+                for (uint32_t idx = 0; idx < listCount; ++idx)
+                {
+                    if (reader.ReadFlag()) // seq_scaling_list_present_flag
+                        SkipH264ScalingList(reader, idx < 6 ? 16 : 64);
+                }
+            }
+            break;
+        }
+
+        if (sps.chromaFormatIdc > 3 || sps.bitDepthLuma > 14 || sps.bitDepthChroma > 14)
+            throw AppException("Sequence parameter set is malformed");
+
+        reader.ReadUe(); // log2_max_frame_num_minus4
+        switch (reader.ReadUe()) // pic_order_cnt_type
+        {
+        case 0:
+            reader.ReadUe(); // log2_max_pic_order_cnt_lsb_minus4
+            break;
+        case 1:
+        {
+            reader.Skip(1); // delta_pic_order_always_zero_flag
+            reader.ReadSe(); // offset_for_non_ref_pic
+            reader.ReadSe(); // offset_for_top_to_bottom_field
+            const uint32_t cycleLength = reader.ReadUe();
+            if (cycleLength > 255)
+                throw AppException("Sequence parameter set is malformed");
+
+            for (uint32_t idx = 0; idx < cycleLength; ++idx)
+                reader.ReadSe(); // offset_for_ref_frame
+            break;
+        }
+        default:
+            break;
+        }
+
+        reader.ReadUe(); // max_num_ref_frames
+        reader.Skip(1); // gaps_in_frame_num_value_allowed_flag
+        const uint32_t widthInMbs = reader.ReadUe() + 1;
+        const uint32_t heightInMapUnits = reader.ReadUe() + 1;
+        sps.progressive = reader.ReadFlag(); // frame_mbs_only_flag
+        if (!sps.progressive)
+            reader.Skip(1); // mb_adaptive_frame_field_flag
+
+        reader.Skip(1); // direct_8x8_inference_flag
+
+        const uint32_t fieldFactor = sps.progressive ? 1 : 2;
+        sps.width = widthInMbs * 16;
+        sps.height = heightInMapUnits * 16 * fieldFactor;
+
+        if (reader.ReadFlag()) // frame_cropping_flag
+        {
+            // crop units depend on chroma subsampling (ChromaArrayType):
+            const uint32_t chromaArrayType = separateColourPlanes ? 0 : sps.chromaFormatIdc;
+            const uint32_t cropUnitX = (chromaArrayType == 1 || chromaArrayType == 2) ? 2 : 1;
+            const uint32_t cropUnitY = ((chromaArrayType == 1) ? 2 : 1) * fieldFactor;
+
+            const uint32_t left = reader.ReadUe();
+            const uint32_t right = reader.ReadUe();
+            const uint32_t top = reader.ReadUe();
+            const uint32_t bottom = reader.ReadUe();
+            const uint64_t cropX = static_cast<uint64_t>(cropUnitX) * (left + right);
+            const uint64_t cropY = static_cast<uint64_t>(cropUnitY) * (top + bottom);
+            if (cropX >= sps.width || cropY >= sps.height)
+                throw AppException("Sequence parameter set has invalid cropping");
+
+            sps.width -= static_cast<uint32_t>(cropX);
+            sps.height -= static_cast<uint32_t>(cropY);
+        }
+
+        if (reader.ReadFlag()) // vui_parameters_present_flag
+        {
+            ReadVuiColour(reader, sps);
+            if (reader.ReadFlag()) // timing_info_present_flag
+            {
+                sps.numUnitsInTick = reader.ReadBits(32);
+                sps.timeScale = reader.ReadBits(32);
+            }
+        }
+
+        return sps;
+    }
+
+    /// <summary>
+    /// Reads profile_tier_level() with the general profile present.
+    /// </summary>
+    static void ReadHevcProfileTierLevel(BitReader& reader,
+                                         uint32_t maxSubLayersMinus1,
+                                         SequenceParameterSet& sps)
+    {
+        reader.Skip(2); // general_profile_space
+        sps.highTier = reader.ReadFlag();
+        sps.profileIdc = reader.ReadBits(5);
+        reader.Skip(32); // general_profile_compatibility_flag[32]
+        sps.progressive = reader.ReadFlag(); // general_progressive_source_flag
+        const bool interlaced = reader.ReadFlag();
+        sps.progressive = sps.progressive || !interlaced;
+        reader.Skip(2 + 43 + 1); // non_packed, frame_only, constraint flags, inbld/reserved
+        sps.levelIdc = reader.ReadBits(8);
+
+        bool subLayerProfilePresent[8] = {};
+        bool subLayerLevelPresent[8] = {};
+        for (uint32_t idx = 0; idx < maxSubLayersMinus1; ++idx)
+        {
+            subLayerProfilePresent[idx] = reader.ReadFlag();
+            subLayerLevelPresent[idx] = reader.ReadFlag();
+        }
+
+        if (maxSubLayersMinus1 > 0)
+            reader.Skip(2 * (8 - maxSubLayersMinus1)); // reserved_zero_2bits
+
+        for (uint32_t idx = 0; idx < maxSubLayersMinus1; ++idx)
+        {
+            if (subLayerProfilePresent[idx])
+                reader.Skip(88);
+
+            if (subLayerLevelPresent[idx])
+                reader.Skip(8);
+        }
+    }
+
+    /// <summary>
+    /// Skips st_ref_pic_set() in a SPS, keeping track of the number of pictures in each set,
+    /// which later sets can be predicted from.
+    /// </summary>
+    static void SkipHevcShortTermRefPicSet(BitReader& reader, uint32_t setIdx, std::vector<uint32_t>& numDeltaPocs)
+    {
+        if (setIdx != 0 && reader.ReadFlag()) // inter_ref_pic_set_prediction_flag
+        {
+            reader.Skip(1); // delta_rps_sign
+            reader.ReadUe(); // abs_delta_rps_minus1
+
+            // in a SPS, the reference set is always the previous one:
+            uint32_t count = 0;
+            for (uint32_t idx = 0; idx <= numDeltaPocs[setIdx - 1]; ++idx)
+            {
+                const bool usedByCurrPic = reader.ReadFlag();
+                const bool useDelta = usedByCurrPic || reader.ReadFlag();
+                if (useDelta)
+                    ++count;
+            }
+            numDeltaPocs[setIdx] = count;
+            return;
+        }
+
+        const uint32_t numNegative = reader.ReadUe();
+        const uint32_t numPositive = reader.ReadUe();
+        if (numNegative > 16 || numPositive > 16)
+            throw AppException("Sequence parameter set has invalid reference picture set");
+
+        for (uint32_t idx = 0; idx < numNegative + numPositive; ++idx)
+        {
+            reader.ReadUe(); // delta_poc_sX_minus1
+            reader.Skip(1); // used_by_curr_pic_sX_flag
+        }
+        numDeltaPocs[setIdx] = numNegative + numPositive;
+    }
+
+    static SequenceParameterSet ParseHevcSps(BitReader& reader)
+    {
+        SequenceParameterSet sps = {};
+        sps.colourPrimaries = sps.transferCharacteristics = sps.matrixCoefficients = 2;
+
+        reader.Skip(4); // sps_video_parameter_set_id
+        const uint32_t maxSubLayersMinus1 = reader.ReadBits(3);
+        reader.Skip(1); // sps_temporal_id_nesting_flag
+        if (maxSubLayersMinus1 > 6)
+            throw AppException("Sequence parameter set is malformed");
+
+        ReadHevcProfileTierLevel(reader, maxSubLayersMinus1, sps);
+        sps.id = reader.ReadUe();
+        sps.chromaFormatIdc = reader.ReadUe();
+        if (sps.chromaFormatIdc > 3)
+            throw AppException("Sequence parameter set is malformed");
+
+        const bool separateColourPlanes = (sps.chromaFormatIdc == 3) && reader.ReadFlag();
+        sps.width = reader.ReadUe();
+        sps.height = reader.ReadUe();
+
+        if (reader.ReadFlag()) // conformance_window_flag
+        {
+            const uint32_t chromaArrayType = separateColourPlanes ? 0 : sps.chromaFormatIdc;
+            const uint32_t subWidth = (chromaArrayType == 1 || chromaArrayType == 2) ? 2 : 1;
+            const uint32_t subHeight = (chromaArrayType == 1) ? 2 : 1;
+
+            const uint32_t left = reader.ReadUe();
+            const uint32_t right = reader.ReadUe();
+            const uint32_t top = reader.ReadUe();
+            const uint32_t bottom = reader.ReadUe();
+            const uint64_t cropX = static_cast<uint64_t>(subWidth) * (left + right);
+            const uint64_t cropY = static_cast<uint64_t>(subHeight) * (top + bottom);
+            if (cropX >= sps.width || cropY >= sps.height)
+                throw AppException("Sequence parameter set has invalid conformance window");
+
+            sps.width -= static_cast<uint32_t>(cropX);
+            sps.height -= static_cast<uint32_t>(cropY);
+        }
+
+        sps.bitDepthLuma = 8 + reader.ReadUe();
+        sps.bitDepthChroma = 8 + reader.ReadUe();
+        const uint32_t log2MaxPocLsb = 4 + reader.ReadUe();
+        if (sps.bitDepthLuma > 16 || sps.bitDepthChroma > 16 || log2MaxPocLsb > 16)
+            throw AppException("Sequence parameter set is malformed");
+
+        const bool subLayerOrderingInfo = reader.ReadFlag();
+        for (uint32_t idx = subLayerOrderingInfo ? 0 : maxSubLayersMinus1; idx <= maxSubLayersMinus1; ++idx)
+        {
+            reader.ReadUe(); // sps_max_dec_pic_buffering_minus1
+            reader.ReadUe(); // sps_max_num_reorder_pics
+            reader.ReadUe(); // sps_max_latency_increase_plus1
+        }
+
+        reader.ReadUe(); // log2_min_luma_coding_block_size_minus3
+        reader.ReadUe(); // log2_diff_max_min_luma_coding_block_size
+        reader.ReadUe(); // log2_min_luma_transform_block_size_minus2
+        reader.ReadUe(); // log2_diff_max_min_luma_transform_block_size
+        reader.ReadUe(); // max_transform_hierarchy_depth_inter
+        reader.ReadUe(); // max_transform_hierarchy_depth_intra
+
+        if (reader.ReadFlag() && reader.ReadFlag()) // scaling_list_enabled_flag, sps_scaling_list_data_present_flag
+            SkipHevcScalingListData(reader);
+
+        reader.Skip(2); // amp_enabled_flag, sample_adaptive_offset_enabled_flag
+        if (reader.ReadFlag()) // pcm_enabled_flag
+        {
+            reader.Skip(8); // pcm_sample_bit_depth_luma_minus1, pcm_sample_bit_depth_chroma_minus1
+            reader.ReadUe(); // log2_min_pcm_luma_coding_block_size_minus3
+            reader.ReadUe(); // log2_diff_max_min_pcm_luma_coding_block_size
+            reader.Skip(1); // pcm_loop_filter_disabled_flag
+        }
+
+        const uint32_t numShortTermRefPicSets = reader.ReadUe();
+        if (numShortTermRefPicSets > 64)
+            throw AppException("Sequence parameter set is malformed");
+
+        std::vector<uint32_t> numDeltaPocs(numShortTermRefPicSets);
+        for (uint32_t idx = 0; idx < numShortTermRefPicSets; ++idx)
+            SkipHevcShortTermRefPicSet(reader, idx, numDeltaPocs);
+
+        if (reader.ReadFlag()) // long_term_ref_pics_present_flag
+        {
+            const uint32_t numLongTermRefPics = reader.ReadUe();
+            if (numLongTermRefPics > 32)
+                throw AppException("Sequence parameter set is malformed");
+
+            reader.Skip(static_cast<uint64_t>(numLongTermRefPics) * (log2MaxPocLsb + 1));
+        }
+
+        reader.Skip(2); // sps_temporal_mvp_enabled_flag, strong_intra_smoothing_enabled_flag
+
+        if (reader.ReadFlag()) // vui_parameters_present_flag
+        {
+            ReadVuiColour(reader, sps);
+            reader.Skip(1); // neutral_chroma_indication_flag
+            if (reader.ReadFlag()) // field_seq_flag
+                sps.progressive = false;
+
+            reader.Skip(1); // frame_field_info_present_flag
+            if (reader.ReadFlag()) // default_display_window_flag
+            {
+                for (int idx = 0; idx < 4; ++idx)
+                    reader.ReadUe();
+            }
+
+            if (reader.ReadFlag()) // vui_timing_info_present_flag
+            {
+                sps.numUnitsInTick = reader.ReadBits(32);
+                sps.timeScale = reader.ReadBits(32);
+            }
+        }
+
+        return sps;
+    }
+
+    SequenceParameterSet ParseSequenceParameterSet(const uint8_t* nal, uint64_t size, Encoder codec)
+    {
+        const std::vector<uint8_t> rbsp = GetPayload(nal, size, codec);
+        BitReader reader(rbsp.data(), rbsp.size());
+
+        switch (codec)
+        {
+        case Encoder::H264_AVC:
+            return ParseH264Sps(reader);
+        case Encoder::H265_HEVC:
+            return ParseHevcSps(reader);
+        default:
+            throw AppException("Codec has no sequence parameter set");
+        }
+    }
+
+    PictureParameterSet ParsePictureParameterSet(const uint8_t* nal, uint64_t size, Encoder codec)
+    {
+        const std::vector<uint8_t> rbsp = GetPayload(nal, size, codec);
+        BitReader reader(rbsp.data(), rbsp.size());
+
+        PictureParameterSet pps = {};
+        pps.id = reader.ReadUe();
+        pps.spsId = reader.ReadUe();
+
+        if (codec == Encoder::H264_AVC)
+        {
+            pps.cabac = reader.ReadFlag(); // entropy_coding_mode_flag
+            return pps;
+        }
+
+        pps.cabac = true;
+        reader.Skip(1 + 1 + 3 + 1 + 1); // dependent slices, output flag, extra bits, sign hiding, cabac init
+        reader.ReadUe(); // num_ref_idx_l0_default_active_minus1
+        reader.ReadUe(); // num_ref_idx_l1_default_active_minus1
+        reader.ReadSe(); // init_qp_minus26
+        reader.Skip(2); // constrained_intra_pred_flag, transform_skip_enabled_flag
+        if (reader.ReadFlag()) // cu_qp_delta_enabled_flag
+            reader.ReadUe(); // diff_cu_qp_delta_depth
+
+        reader.ReadSe(); // pps_cb_qp_offset
+        reader.ReadSe(); // pps_cr_qp_offset
+        reader.Skip(4); // slice chroma QP offsets, weighted pred & bipred, transquant bypass
+        pps.tilesEnabled = reader.ReadFlag();
+        pps.entropyCodingSync = reader.ReadFlag();
+        return pps;
+    }
+
+    VideoParameterSet ParseVideoParameterSet(const uint8_t* nal, uint64_t size)
+    {
+        const std::vector<uint8_t> rbsp = GetPayload(nal, size, Encoder::H265_HEVC);
+        BitReader reader(rbsp.data(), rbsp.size());
+
+        VideoParameterSet vps = {};
+        vps.id = reader.ReadBits(4);
+        reader.Skip(2 + 6); // base layer flags, vps_max_layers_minus1
+        const uint32_t maxSubLayersMinus1 = reader.ReadBits(3);
+        if (maxSubLayersMinus1 > 6)
+            throw AppException("Video parameter set is malformed");
+
+        vps.maxSubLayers = maxSubLayersMinus1 + 1;
+        reader.Skip(1 + 16); // vps_temporal_id_nesting_flag, vps_reserved_0xffff_16bits
+
+        SequenceParameterSet unused = {};
+        ReadHevcProfileTierLevel(reader, maxSubLayersMinus1, unused);
+
+        const bool subLayerOrderingInfo = reader.ReadFlag();
+        for (uint32_t idx = subLayerOrderingInfo ? 0 : maxSubLayersMinus1; idx <= maxSubLayersMinus1; ++idx)
+        {
+            reader.ReadUe();
+            reader.ReadUe();
+            reader.ReadUe();
+        }
+
+        const uint32_t maxLayerId = reader.ReadBits(6);
+        const uint32_t numLayerSets = reader.ReadUe() + 1;
+        if (numLayerSets > 1024)
+            throw AppException("Video parameter set is malformed");
+
+        reader.Skip(static_cast<uint64_t>(numLayerSets - 1) * (maxLayerId + 1)); // layer_id_included_flag
+
+        if (reader.ReadFlag()) // vps_timing_info_present_flag
+        {
+            vps.numUnitsInTick = reader.ReadBits(32);
+            vps.timeScale = reader.ReadBits(32);
+        }
+
+        return vps;
+    }
+
+    /// <summary>
+    /// Reads a NAL unit prefixed by its 16-bit length, as in decoder configuration records.
+    /// </summary>
+    static NalUnit ReadConfigNalUnit(BigEndianReader& reader, const uint8_t* base, Encoder codec)
+    {
+        const uint16_t size = reader.ReadU16();
+        if (size == 0)
+            throw AppException("Decoder configuration has an empty parameter set");
+
+        const uint8_t* nal = reader.Skip(size);
+        return NalUnit{ static_cast<uint64_t>(nal - base), size, GetNalType(*nal, codec) };
+    }
+
+    static void ParseAvcConfiguration(BigEndianReader& reader, DecoderConfiguration& config)
+    {
+        reader.Skip(4); // version, profile, compatibility, level
+        config.nalLengthSize = (reader.ReadU8() & 0x03) + 1;
+
+        const uint8_t spsCount = reader.ReadU8() & 0x1F;
+        for (uint8_t idx = 0; idx < spsCount; ++idx)
+            config.sequenceParameterSets.push_back(ReadConfigNalUnit(reader, config.data, config.codec));
+
+        const uint8_t ppsCount = reader.ReadU8();
+        for (uint8_t idx = 0; idx < ppsCount; ++idx)
+            config.pictureParameterSets.push_back(ReadConfigNalUnit(reader, config.data, config.codec));
+    }
+
+    static void ParseHevcConfiguration(BigEndianReader& reader, DecoderConfiguration& config)
+    {
+        reader.Skip(21); // version, profile, tier, level, etc
+        config.nalLengthSize = (reader.ReadU8() & 0x03) + 1;
+
+        const uint8_t arrayCount = reader.ReadU8();
+        for (uint8_t arrayIdx = 0; arrayIdx < arrayCount; ++arrayIdx)
+        {
+            const uint8_t nalType = reader.ReadU8() & 0x3F;
+            const uint16_t nalCount = reader.ReadU16();
+            for (uint16_t idx = 0; idx < nalCount; ++idx)
+            {
+                const NalUnit nal = ReadConfigNalUnit(reader, config.data, config.codec);
+                switch (nalType)
+                {
+                case 32:
+                    config.videoParameterSets.push_back(nal);
+                    break;
+                case 33:
+                    config.sequenceParameterSets.push_back(nal);
+                    break;
+                case 34:
+                    config.pictureParameterSets.push_back(nal);
+                    break;
+                default: // SEI
+                    break;
+                }
+            }
+        }
+    }
+
+    DecoderConfiguration ParseDecoderConfiguration(const IsoBmffBox& box)
+    {
+        DecoderConfiguration config = {};
+        config.data = box.payload;
+
+        BigEndianReader reader(box.payload, box.payloadSize);
+        if (box.type == MakeFourCC("avcC"))
+        {
+            config.codec = Encoder::H264_AVC;
+            ParseAvcConfiguration(reader, config);
+        }
+        else if (box.type == MakeFourCC("hvcC"))
+        {
+            config.codec = Encoder::H265_HEVC;
+            ParseHevcConfiguration(reader, config);
+        }
+        else
+            throw AppException("Box is not a supported decoder configuration");
+
+        // a length size of 3 bytes is reserved:
+        if (config.nalLengthSize == 3)
+            throw AppException("Decoder configuration has invalid NAL unit length size");
+
+        return config;
+    }
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "Encoder.hpp"
+#include "IsoBmff.hpp"
+#include "NalScanner.hpp"
+
+#include <cinttypes>
+#include <vector>
+
+namespace application
+{
+    /// <summary>
+    /// What matters from a sequence parameter set (H.264 or HEVC) for transcoding decisions.
+    /// </summary>
+    struct SequenceParameterSet
+    {
+        uint32_t id;
+
+        /// <summary>profile_idc (H.264) or general_profile_idc (HEVC).</summary>
+        uint32_t profileIdc;
+
+        /// <summary>level_idc (H.264, 10 times the level) or general_level_idc (HEVC, 30 times the level).</summary>
+        uint32_t levelIdc;
+
+        /// <summary>Whether the HEVC stream is in high tier (always false for H.264).</summary>
+        bool highTier;
+
+        /// <summary>chroma_format_idc: 0 for monochrome, 1 for 4:2:0, 2 for 4:2:2, 3 for 4:4:4.</summary>
+        uint32_t chromaFormatIdc;
+
+        uint32_t bitDepthLuma;
+        uint32_t bitDepthChroma;
+
+        /// <summary>Whether the pictures are frames rather than fields.</summary>
+        bool progressive;
+
+        /// <summary>Size of the pictures after cropping (conformance window).</summary>
+        uint32_t width;
+        uint32_t height;
+
+        /// <summary>Timing from VUI, zero when absent.</summary>
+        uint32_t numUnitsInTick;
+        uint32_t timeScale;
+
+        /// <summary>Colour description from VUI (code points of ITU-T H.273), 2 when unspecified.</summary>
+        uint32_t colourPrimaries;
+        uint32_t transferCharacteristics;
+        uint32_t matrixCoefficients;
+        bool fullRange;
+    };
+
+    /// <summary>
+    /// What matters from a picture parameter set (H.264 or HEVC).
+    /// </summary>
+    struct PictureParameterSet
+    {
+        uint32_t id;
+        uint32_t spsId;
+
+        /// <summary>Whether the entropy coding is CABAC (always true for HEVC).</summary>
+        bool cabac;
+
+        /// <summary>Whether pictures are split in tiles (HEVC only).</summary>
+        bool tilesEnabled;
+
+        /// <summary>Whether entropy coding is synchronized for wavefront parallel processing (HEVC only).</summary>
+        bool entropyCodingSync;
+    };
+
+    /// <summary>
+    /// What matters from a video parameter set (HEVC only).
+    /// </summary>
+    struct VideoParameterSet
+    {
+        uint32_t id;
+        uint32_t maxSubLayers;
+
+        /// <summary>Timing, zero when absent.</summary>
+        uint32_t numUnitsInTick;
+        uint32_t timeScale;
+    };
+
+    /// <summary>
+    /// The content of a decoder configuration record ('avcC' or 'hvcC' box).
+    /// </summary>
+    struct DecoderConfiguration
+    {
+        Encoder codec;
+
+        /// <summary>Size of the length prefix of NAL units in the samples (1, 2 or 4 bytes).</summary>
+        uint32_t nalLengthSize;
+
+        /// <summary>The parameter set NAL units (with header), each one pointing into the box.</summary>
+        std::vector<NalUnit> videoParameterSets;
+        std::vector<NalUnit> sequenceParameterSets;
+        std::vector<NalUnit> pictureParameterSets;
+
+        /// <summary>Where the offsets of the parameter sets are relative to.</summary>
+        const uint8_t* data;
+    };
+
+    /// <summary>
+    /// Parses a sequence parameter set.
+    /// </summary>
+    /// <param name="nal">The NAL unit, starting with its header, still with emulation prevention bytes.</param>
+    /// <param name="size">The size of the NAL unit.</param>
+    /// <param name="codec">Either H.264 or HEVC.</param>
+    /// <remarks>Throws <see cref="AppException"/> if the syntax is malformed or unsupported.</remarks>
+    SequenceParameterSet ParseSequenceParameterSet(const uint8_t* nal, uint64_t size, Encoder codec);
+
+    /// <summary>
+    /// Parses the start of a picture parameter set.
+    /// </summary>
+    /// <remarks>Throws <see cref="AppException"/> if the syntax is malformed.</remarks>
+    PictureParameterSet ParsePictureParameterSet(const uint8_t* nal, uint64_t size, Encoder codec);
+
+    /// <summary>
+    /// Parses the start of a video parameter set (HEVC).
+    /// </summary>
+    /// <remarks>Throws <see cref="AppException"/> if the syntax is malformed.</remarks>
+    VideoParameterSet ParseVideoParameterSet(const uint8_t* nal, uint64_t size);
+
+    /// <summary>
+    /// Parses a decoder configuration record.
+    /// </summary>
+    /// <param name="box">The 'avcC' or 'hvcC' box.</param>
+    /// <remarks>Throws <see cref="AppException"/> if the box is malformed or of another type.</remarks>
+    DecoderConfiguration ParseDecoderConfiguration(const IsoBmffBox& box);
+}
@@ -0,0 +1,344 @@
+#include "ProbeCache.hpp"
+
+#include "AppException.hpp"
+#include "AtomicFile.hpp"
+#include "Utf8Path.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+namespace application
+{
+    static_assert(sizeof(ProbeCache::Record) == 144, "layout of probe cache records must not change");
+
+    /// <summary>
+    /// Layout of the start of the cache file, followed by the index and the records.
+    /// </summary>
+    struct TableHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t recordSize;
+        uint64_t recordCount;
+
+        /// <summary>How many slots the index has (a power of 2), each one holding one plus the index of a record.</summary>
+        uint64_t indexSize;
+    };
+
+    static const char tableMagic[8] = { 'V', 'T', 'P', 'R', 'O', 'B', 'E', '\0' };
+    static constexpr uint32_t tableVersion = 1;
+
+    static uint64_t GetRecordsOffset(uint64_t indexSize)
+    {
+        const uint64_t offset = sizeof(TableHeader) + indexSize * sizeof(uint32_t);
+        return (offset + 7) & ~uint64_t(7);
+    }
+
+    /// <summary>
+    /// FNV-1a, which is plenty for telling apart the paths of a library.
+    /// </summary>
+    static uint64_t Hash(const std::string& text, uint64_t hash = 14695981039346656037ULL)
+    {
+        for (unsigned char ch : text)
+        {
+            hash ^= ch;
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    static uint64_t HashPath(const std::string& canonicalPath)
+    {
+        // zero marks an empty slot:
+        return std::max<uint64_t>(Hash(canonicalPath), 1);
+    }
+
+    static uint64_t HashPolicy(const StreamSelectionPolicy& policy)
+    {
+        return Hash(policy.audioTrack ? std::to_string(*policy.audioTrack) : std::string("-"),
+                    Hash(policy.audioLanguage + '\n'));
+    }
+
+    std::optional<FileIdentity> GetFileIdentity(const std::string& fileName)
+    {
+        const std::filesystem::path path = ToPath(fileName);
+        std::error_code error;
+        const auto canonicalPath = std::filesystem::canonical(path, error);
+        if (error)
+            return std::nullopt;
+
+        FileIdentity identity;
+        identity.canonicalPath = ToUtf8(canonicalPath);
+        identity.size = std::filesystem::file_size(canonicalPath, error);
+        if (error)
+            return std::nullopt;
+
+        const auto lastWriteTime = std::filesystem::last_write_time(canonicalPath, error);
+        if (error)
+            return std::nullopt;
+
+        identity.lastWriteTime = static_cast<int64_t>(lastWriteTime.time_since_epoch().count());
+        return identity;
+    }
+
+    static ProbeCache::Record ToRecord(const FileIdentity& file, uint64_t policyHash, const CachedProbe& probe)
+    {
+        ProbeCache::Record record = {};
+        record.pathHash = HashPath(file.canonicalPath);
+        record.fileSize = file.size;
+        record.lastWriteTime = file.lastWriteTime;
+        record.policyHash = policyHash;
+        record.duration = probe.duration.count();
+
+        const auto& video = probe.info.videoProfile;
+        record.width = video.frameSize.width;
+        record.height = video.frameSize.height;
+        record.frameRateNumerator = video.frameRate.numerator;
+        record.frameRateDenominator = video.frameRate.denominator;
+        record.videoAvgBitrate = video.avgBitrate;
+        record.videoPeakBitrate = video.peakBitrate;
+        record.videoFormat = video.format ? static_cast<uint32_t>(*video.format) + 1 : 0;
+        if (video.coding)
+        {
+            record.hasCoding = 1;
+            record.profileIdc = video.coding->profileIdc;
+            record.levelIdc = video.coding->levelIdc;
+            record.highTier = video.coding->highTier;
+            record.chromaFormatIdc = video.coding->chromaFormatIdc;
+            record.bitDepthLuma = video.coding->bitDepthLuma;
+            record.bitDepthChroma = video.coding->bitDepthChroma;
+            record.progressive = video.coding->progressive;
+            record.transferCharacteristics = video.coding->transferCharacteristics;
+        }
+
+        const auto& audio = probe.info.audioProfile;
+        record.bitsPerSample = audio.bitsPerSample;
+        record.samplesPerSec = audio.samplesPerSec;
+        record.numChannels = audio.numChannels;
+        record.audioAvgBytesPerSec = audio.avgBytesPerSec;
+        record.isAac = audio.isAac;
+
+        record.videoStreamCount = probe.layout.videoCount;
+        record.audioStreamCount = probe.layout.audioCount;
+        record.otherStreamCount = probe.layout.otherCount;
+        record.chosenVideo = probe.layout.choice.video ? static_cast<uint32_t>(*probe.layout.choice.video) + 1 : 0;
+        record.chosenAudio = probe.layout.choice.audio ? static_cast<uint32_t>(*probe.layout.choice.audio) + 1 : 0;
+        return record;
+    }
+
+    static CachedProbe ToProbe(const ProbeCache::Record& record)
+    {
+        CachedProbe probe = {};
+        probe.duration = std::chrono::nanoseconds(record.duration);
+
+        auto& video = probe.info.videoProfile;
+        video.frameSize.width = record.width;
+        video.frameSize.height = record.height;
+        video.frameRate.numerator = record.frameRateNumerator;
+        video.frameRate.denominator = record.frameRateDenominator;
+        video.avgBitrate = record.videoAvgBitrate;
+        video.peakBitrate = record.videoPeakBitrate;
+        if (record.videoFormat != 0)
+            video.format = static_cast<Encoder>(record.videoFormat - 1);
+
+        if (record.hasCoding != 0)
+        {
+            MediaInfo::VideoProfile::Coding coding;
+            coding.profileIdc = record.profileIdc;
+            coding.levelIdc = record.levelIdc;
+            coding.highTier = record.highTier != 0;
+            coding.chromaFormatIdc = record.chromaFormatIdc;
+            coding.bitDepthLuma = record.bitDepthLuma;
+            coding.bitDepthChroma = record.bitDepthChroma;
+            coding.progressive = record.progressive != 0;
+            coding.transferCharacteristics = record.transferCharacteristics;
+            video.coding = coding;
+        }
+
+        auto& audio = probe.info.audioProfile;
+        audio.bitsPerSample = record.bitsPerSample;
+        audio.samplesPerSec = record.samplesPerSec;
+        audio.numChannels = record.numChannels;
+        audio.avgBytesPerSec = record.audioAvgBytesPerSec;
+        audio.isAac = record.isAac != 0;
+
+        probe.layout.videoCount = record.videoStreamCount;
+        probe.layout.audioCount = record.audioStreamCount;
+        probe.layout.otherCount = record.otherStreamCount;
+        if (record.chosenVideo != 0)
+            probe.layout.choice.video = record.chosenVideo - 1;
+        if (record.chosenAudio != 0)
+            probe.layout.choice.audio = record.chosenAudio - 1;
+
+        return probe;
+    }
+
+    ProbeCache::ProbeCache(const std::string& fileName, const StreamSelectionPolicy& policy)
+        : m_fileName(fileName)
+        , m_policyHash(HashPolicy(policy))
+        , m_index(nullptr)
+        , m_indexMask(0)
+        , m_records(nullptr)
+        , m_recordCount(0)
+    {
+        Load();
+    }
+
+    void ProbeCache::Load()
+    {
+        m_table.reset();
+        m_index = nullptr;
+        m_indexMask = 0;
+        m_records = nullptr;
+        m_recordCount = 0;
+
+        std::error_code error;
+        if (!std::filesystem::exists(ToPath(m_fileName), error))
+            return;
+
+        // a table that is not valid is as good as none, for it is only a cache:
+        try
+        {
+            auto table = std::make_unique<MappedFile>(m_fileName);
+            if (table->GetSize() < sizeof(TableHeader))
+                return;
+
+            const auto header = reinterpret_cast<const TableHeader*>(table->GetData());
+            if (memcmp(header->magic, tableMagic, sizeof tableMagic) != 0
+                || header->version != tableVersion
+                || header->recordSize != sizeof(Record)
+                || header->indexSize == 0
+                || (header->indexSize & (header->indexSize - 1)) != 0
+                || header->recordCount >= header->indexSize
+                || table->GetSize() != GetRecordsOffset(header->indexSize) + header->recordCount * sizeof(Record))
+            {
+                return;
+            }
+
+            m_index = reinterpret_cast<const uint32_t*>(table->GetData() + sizeof(TableHeader));
+            m_indexMask = header->indexSize - 1;
+            m_records = reinterpret_cast<const Record*>(table->GetData() + GetRecordsOffset(header->indexSize));
+            m_recordCount = header->recordCount;
+            m_table = std::move(table);
+        }
+        catch (AppException&)
+        {
+            m_index = nullptr;
+            m_indexMask = 0;
+            m_records = nullptr;
+            m_recordCount = 0;
+        }
+    }
+
+    const ProbeCache::Record* ProbeCache::FindInTable(uint64_t pathHash) const
+    {
+        if (!m_table)
+            return nullptr;
+
+        for (uint64_t slot = pathHash & m_indexMask; m_index[slot] != 0; slot = (slot + 1) & m_indexMask)
+        {
+            const uint64_t recordIdx = m_index[slot] - 1;
+            if (recordIdx >= m_recordCount)
+                return nullptr;
+
+            if (m_records[recordIdx].pathHash == pathHash)
+                return &m_records[recordIdx];
+        }
+
+        return nullptr;
+    }
+
+    std::optional<CachedProbe> ProbeCache::Find(const FileIdentity& file) const
+    {
+        const uint64_t pathHash = HashPath(file.canonicalPath);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const auto update = m_updates.find(pathHash);
+        const Record* record = (update != m_updates.end()) ? &update->second : FindInTable(pathHash);
+
+        if (record == nullptr
+            || record->fileSize != file.size
+            || record->lastWriteTime != file.lastWriteTime
+            || record->policyHash != m_policyHash)
+        {
+            return std::nullopt;
+        }
+
+        return ToProbe(*record);
+    }
+
+    void ProbeCache::Store(const FileIdentity& file, const CachedProbe& probe)
+    {
+        const Record record = ToRecord(file, m_policyHash, probe);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_updates[record.pathHash] = record;
+    }
+
+    void ProbeCache::Save()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_updates.empty())
+            return;
+
+        // the records of the table that were not probed again, followed by the new ones:
+        std::vector<Record> records;
+        records.reserve(m_recordCount + m_updates.size());
+        for (uint64_t recordIdx = 0; recordIdx < m_recordCount; ++recordIdx)
+        {
+            if (m_updates.find(m_records[recordIdx].pathHash) == m_updates.end())
+                records.push_back(m_records[recordIdx]);
+        }
+
+        for (const auto& entry : m_updates)
+            records.push_back(entry.second);
+
+        // keep the index at most half full, for short probe sequences:
+        uint64_t indexSize = 16;
+        while (indexSize < records.size() * 2)
+            indexSize *= 2;
+
+        std::string content(GetRecordsOffset(indexSize) + records.size() * sizeof(Record), '\0');
+
+        TableHeader header = {};
+        memcpy(header.magic, tableMagic, sizeof tableMagic);
+        header.version = tableVersion;
+        header.recordSize = sizeof(Record);
+        header.recordCount = records.size();
+        header.indexSize = indexSize;
+        memcpy(content.data(), &header, sizeof header);
+
+        auto index = reinterpret_cast<uint32_t*>(content.data() + sizeof(TableHeader));
+        for (size_t recordIdx = 0; recordIdx < records.size(); ++recordIdx)
+        {
+            uint64_t slot = records[recordIdx].pathHash & (indexSize - 1);
+            while (index[slot] != 0)
+                slot = (slot + 1) & (indexSize - 1);
+
+            index[slot] = static_cast<uint32_t>(recordIdx + 1);
+        }
+
+        memcpy(content.data() + GetRecordsOffset(indexSize), records.data(), records.size() * sizeof(Record));
+
+        // the mapping has to go before the file can be replaced:
+        m_table.reset();
+        m_recordCount = 0;
+
+        std::error_code error;
+        std::filesystem::create_directories(ToPath(m_fileName).parent_path(), error);
+        try
+        {
+            WriteFileAtomically(m_fileName, content);
+        }
+        catch (AppException&)
+        {
+            Load();
+            throw;
+        }
+
+        m_updates.clear();
+        Load();
+    }
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+#include "MappedFile.hpp"
+#include "MediaInfo.hpp"
+#include "StreamSelection.hpp"
+
+#include <chrono>
+#include <cinttypes>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace application
+{
+    /// <summary>
+    /// What is kept about an input file in the probe cache.
+    /// </summary>
+    struct CachedProbe
+    {
+        MediaInfo info;
+        std::chrono::nanoseconds duration;
+        StreamLayout layout;
+    };
+
+    /// <summary>
+    /// Identifies the content of a file by where it is, how large it is and when it was last written.
+    /// </summary>
+    struct FileIdentity
+    {
+        std::string canonicalPath;
+        uint64_t size;
+        int64_t lastWriteTime;
+    };
+
+    /// <summary>
+    /// Gets the identity of a file.
+    /// </summary>
+    /// <param name="fileName">The file (UTF-8 encoded).</param>
+    /// <returns>The identity, or nothing if the file does not exist.</returns>
+    std::optional<FileIdentity> GetFileIdentity(const std::string& fileName);
+
+    /// <summary>
+    /// Persistent cache of probes of input files, so that files probed before do not have
+    /// to be opened again unless they have changed (in size or time of last write).
+    /// </summary>
+    /// <remarks>
+    /// The cache file is a table of fixed size records with an open addressing index,
+    /// which is looked up mapped into memory, without parsing. The records are keyed by
+    /// a 64-bit hash of the canonical path, and hold the size and time of last write
+    /// of the file along with a hash of the stream selection policy, which all must match.
+    /// New probes stay in memory until saved. Lookups and updates are thread-safe.
+    /// </remarks>
+    class ProbeCache
+    {
+    public:
+
+        /// <summary>
+        /// A record in the table, as laid out in the file.
+        /// </summary>
+        struct Record
+        {
+            uint64_t pathHash;
+            uint64_t fileSize;
+            int64_t lastWriteTime;
+            uint64_t policyHash;
+            int64_t duration;
+
+            uint32_t width;
+            uint32_t height;
+            uint32_t frameRateNumerator;
+            uint32_t frameRateDenominator;
+            uint32_t videoAvgBitrate;
+            uint32_t videoPeakBitrate;
+
+            /// <summary>One plus the encoder of the video format, or zero if none produces it.</summary>
+            uint32_t videoFormat;
+
+            uint32_t hasCoding;
+            uint32_t profileIdc;
+            uint32_t levelIdc;
+            uint32_t highTier;
+            uint32_t chromaFormatIdc;
+            uint32_t bitDepthLuma;
+            uint32_t bitDepthChroma;
+            uint32_t progressive;
+            uint32_t transferCharacteristics;
+
+            uint32_t bitsPerSample;
+            uint32_t samplesPerSec;
+            uint32_t numChannels;
+            uint32_t audioAvgBytesPerSec;
+            uint32_t isAac;
+
+            uint32_t videoStreamCount;
+            uint32_t audioStreamCount;
+            uint32_t otherStreamCount;
+
+            /// <summary>One plus the index of the chosen stream, or zero if none.</summary>
+            uint32_t chosenVideo;
+            uint32_t chosenAudio;
+        };
+
+    private:
+
+        const std::string m_fileName;
+        const uint64_t m_policyHash;
+
+        std::unique_ptr<MappedFile> m_table;
+        const uint32_t* m_index;
+        uint64_t m_indexMask;
+        const Record* m_records;
+        uint64_t m_recordCount;
+
+        /// <summary>Records probed since the table was loaded, by hash of path.</summary>
+        std::unordered_map<uint64_t, Record> m_updates;
+        mutable std::mutex m_mutex;
+
+        void Load();
+
+        const Record* FindInTable(uint64_t pathHash) const;
+
+    public:
+
+        /// <summary>
+        /// Loads the cache from a file, if there is a valid one.
+        /// </summary>
+        /// <param name="fileName">The cache file (UTF-8 encoded).</param>
+        /// <param name="policy">How the streams are chosen, which the cached media information depends on.</param>
+        ProbeCache(const std::string& fileName, const StreamSelectionPolicy& policy);
+
+        ProbeCache(const ProbeCache&) = delete;
+        ProbeCache& operator=(const ProbeCache&) = delete;
+
+        /// <summary>
+        /// Looks up a file in the cache.
+        /// </summary>
+        /// <returns>What the cache has about the file, or nothing if the file has changed since.</returns>
+        std::optional<CachedProbe> Find(const FileIdentity& file) const;
+
+        /// <summary>
+        /// Keeps a probe of a file, which replaces any previous one of the same path.
+        /// </summary>
+        void Store(const FileIdentity& file, const CachedProbe& probe);
+
+        /// <summary>
+        /// Writes the table with the probes kept since loaded (atomically), if there are any.
+        /// </summary>
+        /// <remarks>Throws <see cref="AppException"/> on failure.</remarks>
+        void Save();
+    };
+}
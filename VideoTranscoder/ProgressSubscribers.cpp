@@ -0,0 +1,247 @@
+#include "ProgressSubscribers.hpp"
+
+#include "AppException.hpp"
+#include "AtomicFile.hpp"
+#include "JsonWriter.hpp"
+#include "Utf8Path.hpp"
+
+#include <array>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace application
+{
+    using namespace std::chrono;
+
+    static std::string GetTimestamp(system_clock::time_point timePoint)
+    {
+        const time_t timeTicks = system_clock::to_time_t(timePoint);
+        std::array<char, 21> timestamp;
+        strftime(timestamp.data(), timestamp.size(), "%Y-%b-%d %H:%M:%S", localtime(&timeTicks));
+        return timestamp.data();
+    }
+
+    static const char* ToString(JobState state)
+    {
+        switch (state)
+        {
+        case JobState::Started:
+            return "started";
+        case JobState::Running:
+            return "running";
+        case JobState::Finished:
+            return "finished";
+        default:
+            return "failed";
+        }
+    }
+
+    static double ToSeconds(nanoseconds time)
+    {
+        return duration<double>(time).count();
+    }
+
+    ///////////////////////
+    // ConsoleProgressBar
+    ///////////////////////
+
+    void ConsoleProgressBar::OnProgress(const ProgressSample& sample)
+    {
+        // Amount of steps inside the progress bar
+        const int qtBarSteps(40);
+
+        switch (sample.state)
+        {
+        case JobState::Started:
+            m_startTime = system_clock::now();
+            std::cout << std::endl
+                << "Transcoding starting at " << GetTimestamp(m_startTime)
+                << std::endl << std::endl;
+            break;
+
+        case JobState::Running:
+        {
+            const int doneSteps = static_cast<int>(qtBarSteps * sample.progress);
+
+            std::cout << "\rProgress [";
+
+            for (int idx = 0; idx < doneSteps; ++idx)
+                std::cout << '#';
+
+            for (int idx = doneSteps; idx < qtBarSteps; ++idx)
+                std::cout << '_';
+
+            std::cout << "] " << static_cast<int>(sample.progress * 100) << " % done / "
+                << std::fixed << std::setprecision(1) << sample.framesPerSec << " fps, "
+                << sample.speed << "x";
+
+            if (sample.projectedSize != 0)
+            {
+                std::cout << " / " << sample.outputBitrate / 1e6 << " Mb/s, "
+                    << std::setprecision(0) << sample.projectedSize / 1e6 << " MB projected"
+                    << std::setprecision(1);
+            }
+
+            if (sample.eta)
+                std::cout << " / Remaining " << duration_cast<minutes>(*sample.eta).count() << " min";
+
+            std::cout << "  " << std::flush;
+            break;
+        }
+
+        case JobState::Finished:
+            std::cout
+                << "\rTranscoding finished at " << GetTimestamp(system_clock::now())
+                << " (total elapsed time was " << duration_cast<minutes>(sample.elapsedTime).count()
+                << " minutes)" << std::endl << std::endl;
+            break;
+
+        case JobState::Failed:
+            std::cout << std::endl;
+            break;
+        }
+    }
+
+    ////////////////////////////
+    // JsonLinesProgressWriter
+    ////////////////////////////
+
+    JsonLinesProgressWriter::JsonLinesProgressWriter(const std::string& outputFName)
+        : m_output(ToPath(outputFName), std::ios::out | std::ios::trunc)
+    {
+        if (!m_output)
+            throw AppException("Could not open file to write progress: " + outputFName);
+    }
+
+    void JsonLinesProgressWriter::OnProgress(const ProgressSample& sample)
+    {
+        JsonWriter json(false);
+        json.BeginObject()
+            .Write("job", sample.jobName)
+            .Write("state", ToString(sample.state))
+            .Write("progress", sample.progress)
+            .Write("position_s", ToSeconds(sample.mediaPosition))
+            .Write("duration_s", ToSeconds(sample.mediaDuration))
+            .Write("elapsed_s", ToSeconds(sample.elapsedTime))
+            .Write("fps", sample.framesPerSec)
+            .Write("speed", sample.speed)
+            .Write("bytes_written", sample.bytesWritten)
+            .Write("output_bitrate", sample.outputBitrate);
+
+        if (sample.projectedSize != 0)
+            json.Write("projected_bytes", sample.projectedSize);
+        else
+            json.WriteNull("projected_bytes");
+
+        if (sample.eta)
+            json.Write("eta_s", ToSeconds(*sample.eta));
+        else
+            json.WriteNull("eta_s");
+
+        // flush, so that readers can follow the file:
+        m_output << json.EndObject().GetText() << std::endl;
+    }
+
+    //////////////////////
+    // MetricsFileWriter
+    //////////////////////
+
+    MetricsFileWriter::MetricsFileWriter(const std::string& outputFName)
+        : m_outputFName(outputFName)
+    {
+    }
+
+    void MetricsFileWriter::OnProgress(const ProgressSample& sample)
+    {
+        m_lastSamples[sample.jobName] = sample;
+
+        const auto now = steady_clock::now();
+        if (sample.state == JobState::Running && now - m_lastWriteTime < minWriteInterval)
+            return;
+
+        m_lastWriteTime = now;
+        WriteFile();
+    }
+
+    void MetricsFileWriter::WriteFile() const
+    {
+        struct Metric
+        {
+            const char* name;
+            const char* help;
+            double (*value)(const ProgressSample&);
+        };
+
+        static const Metric metrics[] =
+        {
+            { "videotranscoder_job_progress_ratio", "Progress of the job within range [0,1]",
+                [](const ProgressSample& sample) { return sample.progress; } },
+            { "videotranscoder_job_running", "Whether the job is running",
+                [](const ProgressSample& sample) {
+                    return (sample.state == JobState::Started || sample.state == JobState::Running) ? 1.0 : 0.0; } },
+            { "videotranscoder_job_failed", "Whether the job has failed",
+                [](const ProgressSample& sample) { return sample.state == JobState::Failed ? 1.0 : 0.0; } },
+            { "videotranscoder_job_frames_per_second", "Encoded frames per second (smoothed)",
+                [](const ProgressSample& sample) { return sample.framesPerSec; } },
+            { "videotranscoder_job_speed_ratio", "Transcoding speed as a multiple of real time (smoothed)",
+                [](const ProgressSample& sample) { return sample.speed; } },
+            { "videotranscoder_job_written_bytes", "Size of the output so far",
+                [](const ProgressSample& sample) { return (double)sample.bytesWritten; } },
+            { "videotranscoder_job_output_bits_per_second", "Data rate of the output so far (bits per second of media)",
+                [](const ProgressSample& sample) { return sample.outputBitrate; } },
+            { "videotranscoder_job_projected_bytes", "Projected size of the output when finished (0 when unknown)",
+                [](const ProgressSample& sample) { return (double)sample.projectedSize; } },
+            { "videotranscoder_job_elapsed_seconds", "Time since the job has started",
+                [](const ProgressSample& sample) { return ToSeconds(sample.elapsedTime); } },
+            { "videotranscoder_job_eta_seconds", "Estimated time to finish (-1 when unknown)",
+                [](const ProgressSample& sample) { return sample.eta ? ToSeconds(*sample.eta) : -1.0; } },
+        };
+
+        std::ostringstream oss;
+        oss << std::fixed << std::setprecision(3);
+        for (const Metric& metric : metrics)
+        {
+            oss << "# HELP " << metric.name << ' ' << metric.help << '\n'
+                << "# TYPE " << metric.name << " gauge\n";
+
+            for (const auto& [jobName, sample] : m_lastSamples)
+                oss << metric.name << "{job=\"" << EscapeJson(jobName) << "\"} " << metric.value(sample) << '\n';
+        }
+
+        try
+        {
+            WriteFileAtomically(m_outputFName, oss.str());
+        }
+        catch (AppException& ex)
+        {
+            std::cerr << std::endl << ex.what() << std::endl;
+        }
+    }
+
+    void LastSampleKeeper::OnProgress(const ProgressSample& sample)
+    {
+        m_lastSamples[sample.jobName] = sample;
+    }
+
+    std::optional<ProgressSample> LastSampleKeeper::GetLastSample(const std::string& jobName) const
+    {
+        auto iter = m_lastSamples.find(jobName);
+        if (iter == m_lastSamples.end())
+            return std::nullopt;
+
+        return iter->second;
+    }
+
+    void SubscribeFileWriters(ProgressHub& hub,
+                              const std::string& progressJsonFName,
+                              const std::string& metricsFName)
+    {
+        if (!progressJsonFName.empty())
+            hub.Subscribe(std::make_shared<JsonLinesProgressWriter>(progressJsonFName));
+
+        if (!metricsFName.empty())
+            hub.Subscribe(std::make_shared<MetricsFileWriter>(metricsFName));
+    }
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "ProgressTelemetry.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <optional>
+#include <string>
+
+namespace application
+{
+    /// <summary>
+    /// Prints a progress bar in the console for a single job.
+    /// </summary>
+    class ConsoleProgressBar : public ProgressSubscriber
+    {
+    private:
+
+        std::chrono::system_clock::time_point m_startTime;
+
+    public:
+
+        void OnProgress(const ProgressSample& sample) override;
+    };
+
+    /// <summary>
+    /// Appends every sample as a JSON object in its own line.
+    /// </summary>
+    class JsonLinesProgressWriter : public ProgressSubscriber
+    {
+    private:
+
+        std::ofstream m_output;
+
+    public:
+
+        /// <summary>
+        /// Creates a new instance.
+        /// </summary>
+        /// <param name="outputFName">The output file (UTF-8 encoded), which gets overwritten.</param>
+        JsonLinesProgressWriter(const std::string& outputFName);
+
+        void OnProgress(const ProgressSample& sample) override;
+    };
+
+    /// <summary>
+    /// Keeps a file with the latest metrics of every job in the text format
+    /// of Prometheus, replaced atomically so that scrapers never see it partially written.
+    /// </summary>
+    class MetricsFileWriter : public ProgressSubscriber
+    {
+    private:
+
+        const std::string m_outputFName;
+        std::map<std::string, ProgressSample> m_lastSamples;
+        std::chrono::steady_clock::time_point m_lastWriteTime;
+
+        void WriteFile() const;
+
+    public:
+
+        /// <summary>
+        /// Least time between rewrites of the file, unless a job finishes.
+        /// </summary>
+        static constexpr std::chrono::seconds minWriteInterval = std::chrono::seconds(1);
+
+        /// <summary>
+        /// Creates a new instance.
+        /// </summary>
+        /// <param name="outputFName">The output file (UTF-8 encoded).</param>
+        MetricsFileWriter(const std::string& outputFName);
+
+        void OnProgress(const ProgressSample& sample) override;
+    };
+
+    /// <summary>
+    /// Keeps the last sample of every job, to measure jobs by the same clock as their progress.
+    /// </summary>
+    class LastSampleKeeper : public ProgressSubscriber
+    {
+    private:
+
+        std::map<std::string, ProgressSample> m_lastSamples;
+
+    public:
+
+        void OnProgress(const ProgressSample& sample) override;
+
+        /// <summary>
+        /// Gets the last sample of a job, which is only safe after <see cref="ProgressHub::Flush"/>.
+        /// </summary>
+        /// <returns>The sample, or nothing if the job published none.</returns>
+        std::optional<ProgressSample> GetLastSample(const std::string& jobName) const;
+    };
+
+    /// <summary>
+    /// Subscribes the writers of the files that were requested.
+    /// </summary>
+    /// <param name="hub">The hub to subscribe to.</param>
+    /// <param name="progressJsonFName">File for <see cref="JsonLinesProgressWriter"/>, if not empty.</param>
+    /// <param name="metricsFName">File for <see cref="MetricsFileWriter"/>, if not empty.</param>
+    void SubscribeFileWriters(ProgressHub& hub,
+                              const std::string& progressJsonFName,
+                              const std::string& metricsFName);
+}
@@ -0,0 +1,181 @@
+#include "ProgressTelemetry.hpp"
+
+#include <algorithm>
+
+namespace application
+{
+    using namespace std::chrono;
+
+    ProgressHub::ProgressHub()
+        : m_stopping(false)
+        , m_dispatcher(&ProgressHub::Dispatch, this)
+    {
+    }
+
+    ProgressHub::~ProgressHub()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_queueChanged.notify_all();
+        m_dispatcher.join();
+    }
+
+    void ProgressHub::Subscribe(std::shared_ptr<ProgressSubscriber> subscriber)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_subscribers.push_back(std::move(subscriber));
+    }
+
+    void ProgressHub::Publish(ProgressSample sample)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_subscribers.empty())
+                return;
+
+            m_queue.push_back(std::move(sample));
+        }
+        m_queueChanged.notify_all();
+    }
+
+    void ProgressHub::Flush()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_queueChanged.wait(lock, [this]() { return m_queue.empty(); });
+    }
+
+    void ProgressHub::Dispatch()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true)
+        {
+            m_queueChanged.wait(lock, [this]() { return m_stopping || !m_queue.empty(); });
+            if (m_queue.empty())
+                return;
+
+            // deliver outside the lock, so publishers are never held by subscribers:
+            const ProgressSample sample = std::move(m_queue.front());
+            lock.unlock();
+
+            for (const auto& subscriber : m_subscribers)
+                subscriber->OnProgress(sample);
+
+            lock.lock();
+            m_queue.pop_front();
+            m_queueChanged.notify_all();
+        }
+    }
+
+    ProgressTracker::ProgressTracker(const std::string& jobName,
+                                     nanoseconds mediaDuration,
+                                     double frameRate,
+                                     ProgressHub& hub)
+        : m_hub(hub)
+        , m_last{}
+        , m_frameRate(frameRate)
+        , m_hasRate(false)
+    {
+        m_last.jobName = jobName;
+        m_last.mediaDuration = mediaDuration;
+    }
+
+    ProgressSample ProgressTracker::MakeSample(JobState state,
+                                               nanoseconds mediaPosition,
+                                               nanoseconds elapsedTime,
+                                               uint64_t bytesWritten)
+    {
+        ProgressSample sample = m_last;
+        sample.state = state;
+        sample.mediaPosition = std::clamp(mediaPosition, nanoseconds(0), sample.mediaDuration);
+        sample.elapsedTime = elapsedTime;
+        sample.bytesWritten = bytesWritten;
+        sample.progress = sample.mediaDuration.count() > 0
+            ? (double)sample.mediaPosition.count() / sample.mediaDuration.count()
+            : 0.0;
+
+        // smooth the speed measured since the previous sample:
+        const auto mediaDelta = sample.mediaPosition - m_last.mediaPosition;
+        const auto timeDelta = sample.elapsedTime - m_last.elapsedTime;
+        if (timeDelta.count() > 0 && mediaDelta.count() >= 0)
+        {
+            const double speed = (double)mediaDelta.count() / timeDelta.count();
+            sample.speed = m_hasRate
+                ? smoothingFactor * speed + (1.0 - smoothingFactor) * m_last.speed
+                : speed;
+
+            m_hasRate = true;
+        }
+
+        sample.framesPerSec = sample.speed * m_frameRate;
+
+        const double mediaSecs = duration<double>(sample.mediaPosition).count();
+        sample.outputBitrate = (mediaSecs > 0.0 && bytesWritten > 0) ? 8.0 * bytesWritten / mediaSecs : 0.0;
+
+        if (state == JobState::Finished)
+            sample.projectedSize = bytesWritten;
+        else if (sample.progress >= minProjectionProgress && bytesWritten > 0)
+            sample.projectedSize = static_cast<uint64_t>(bytesWritten / sample.progress);
+        else
+            sample.projectedSize = 0;
+
+        if (state == JobState::Finished)
+            sample.eta = nanoseconds(0);
+        else if (sample.speed > 0.0)
+            sample.eta = duration_cast<nanoseconds>((sample.mediaDuration - sample.mediaPosition) / sample.speed);
+        else
+            sample.eta.reset();
+
+        return sample;
+    }
+
+    void ProgressTracker::SeedSpeed(double speed)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (speed <= 0.0)
+            return;
+
+        m_last.speed = speed;
+        m_last.framesPerSec = speed * m_frameRate;
+        m_hasRate = true;
+    }
+
+    void ProgressTracker::OnStarted()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_last = MakeSample(JobState::Started, nanoseconds(0), nanoseconds(0), 0);
+        m_hub.Publish(m_last);
+    }
+
+    void ProgressTracker::OnPosition(nanoseconds mediaPosition, nanoseconds elapsedTime, uint64_t bytesWritten)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_last.state == JobState::Finished || m_last.state == JobState::Failed)
+            return;
+
+        m_last = MakeSample(JobState::Running, mediaPosition, elapsedTime, bytesWritten);
+        m_hub.Publish(m_last);
+    }
+
+    void ProgressTracker::OnFinished(bool succeeded, uint64_t bytesWritten)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (succeeded)
+        {
+            m_last = MakeSample(JobState::Finished, m_last.mediaDuration, m_last.elapsedTime, bytesWritten);
+        }
+        else
+        {
+            m_last = MakeSample(JobState::Failed, m_last.mediaPosition, m_last.elapsedTime, bytesWritten);
+            m_last.eta.reset();
+        }
+        m_hub.Publish(m_last);
+    }
+
+    ProgressSample ProgressTracker::GetLastSample()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_last;
+    }
+}
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <chrono>
+#include <cinttypes>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace application
+{
+    enum class JobState { Started, Running, Finished, Failed };
+
+    /// <summary>
+    /// A snapshot of the progress of a job.
+    /// </summary>
+    struct ProgressSample
+    {
+        std::string jobName;
+        JobState state;
+
+        /// <summary>Progress within range [0,1].</summary>
+        double progress;
+
+        /// <summary>How much of the media has been transcoded.</summary>
+        std::chrono::nanoseconds mediaPosition;
+
+        /// <summary>How much media there is to transcode in total.</summary>
+        std::chrono::nanoseconds mediaDuration;
+
+        /// <summary>Time since the job has started.</summary>
+        std::chrono::nanoseconds elapsedTime;
+
+        /// <summary>Encoded frames per second (smoothed).</summary>
+        double framesPerSec;
+
+        /// <summary>Transcoding speed as a multiple of real time (smoothed).</summary>
+        double speed;
+
+        /// <summary>Size of the output so far.</summary>
+        uint64_t bytesWritten;
+
+        /// <summary>Data rate of the output so far (bits per second of media), or zero until there is output.</summary>
+        double outputBitrate;
+
+        /// <summary>
+        /// Size of the output when finished, extrapolated from its growth so far,
+        /// or zero until there is enough of it to tell.
+        /// </summary>
+        uint64_t projectedSize;
+
+        /// <summary>Estimated time to finish, if there is enough data to tell.</summary>
+        std::optional<std::chrono::nanoseconds> eta;
+    };
+
+    /// <summary>
+    /// Consumer of progress samples.
+    /// </summary>
+    class ProgressSubscriber
+    {
+    public:
+
+        virtual ~ProgressSubscriber() = default;
+
+        /// <summary>
+        /// Receives a sample (always in the dispatching thread of the hub).
+        /// </summary>
+        virtual void OnProgress(const ProgressSample& sample) = 0;
+    };
+
+    /// <summary>
+    /// Distributes progress samples to the subscribers in a dedicated thread,
+    /// so that publishing from the media pipeline never waits for output.
+    /// </summary>
+    class ProgressHub
+    {
+    private:
+
+        std::vector<std::shared_ptr<ProgressSubscriber>> m_subscribers;
+        std::deque<ProgressSample> m_queue;
+        std::mutex m_mutex;
+        std::condition_variable m_queueChanged;
+        bool m_stopping;
+        std::thread m_dispatcher;
+
+        void Dispatch();
+
+    public:
+
+        ProgressHub();
+
+        /// <summary>
+        /// Delivers the samples still queued and stops the dispatching thread.
+        /// </summary>
+        ~ProgressHub();
+
+        ProgressHub(const ProgressHub&) = delete;
+        ProgressHub& operator=(const ProgressHub&) = delete;
+
+        /// <summary>
+        /// Adds a subscriber, which must be done before publishing starts.
+        /// </summary>
+        void Subscribe(std::shared_ptr<ProgressSubscriber> subscriber);
+
+        bool HasSubscribers() const
+        {
+            return !m_subscribers.empty();
+        }
+
+        /// <summary>
+        /// Queues a sample for delivery.
+        /// </summary>
+        void Publish(ProgressSample sample);
+
+        /// <summary>
+        /// Blocks until all samples published so far have been delivered.
+        /// </summary>
+        void Flush();
+    };
+
+    /// <summary>
+    /// Turns the position reports of a job into progress samples,
+    /// with rates and time estimate smoothed by EWMA.
+    /// </summary>
+    /// <remarks>Thread-safe.</remarks>
+    class ProgressTracker
+    {
+    private:
+
+        ProgressHub& m_hub;
+        ProgressSample m_last;
+        const double m_frameRate;
+        std::mutex m_mutex;
+        bool m_hasRate;
+
+        ProgressSample MakeSample(JobState state,
+                                  std::chrono::nanoseconds mediaPosition,
+                                  std::chrono::nanoseconds elapsedTime,
+                                  uint64_t bytesWritten);
+
+    public:
+
+        /// <summary>
+        /// Weight of the newest measurement in the smoothed rates.
+        /// </summary>
+        static constexpr double smoothingFactor = 0.2;
+
+        /// <summary>
+        /// Progress before which the output size is not projected, because
+        /// the headers and the first frames weigh too much in it.
+        /// </summary>
+        static constexpr double minProjectionProgress = 0.05;
+
+        /// <summary>
+        /// Creates a new instance.
+        /// </summary>
+        /// <param name="jobName">How the job is identified to subscribers.</param>
+        /// <param name="mediaDuration">How much media the job has to transcode.</param>
+        /// <param name="frameRate">Frame rate of the video (frames/s).</param>
+        /// <param name="hub">Where samples are published.</param>
+        ProgressTracker(const std::string& jobName,
+                        std::chrono::nanoseconds mediaDuration,
+                        double frameRate,
+                        ProgressHub& hub);
+
+        /// <summary>
+        /// Seeds the smoothed speed with a prediction, so that the time estimate is
+        /// there from the start and measurements correct it as they come.
+        /// </summary>
+        /// <param name="speed">The predicted speed as a multiple of real time.</param>
+        void SeedSpeed(double speed);
+
+        void OnStarted();
+
+        /// <summary>
+        /// Takes a new position report.
+        /// </summary>
+        /// <param name="mediaPosition">How much of the media has been transcoded.</param>
+        /// <param name="elapsedTime">Time since the job has started.</param>
+        /// <param name="bytesWritten">Size of the output so far.</param>
+        void OnPosition(std::chrono::nanoseconds mediaPosition,
+                        std::chrono::nanoseconds elapsedTime,
+                        uint64_t bytesWritten);
+
+        void OnFinished(bool succeeded, uint64_t bytesWritten);
+
+        /// <summary>
+        /// Gets the last sample published.
+        /// </summary>
+        ProgressSample GetLastSample();
+    };
+}
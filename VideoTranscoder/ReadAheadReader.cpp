@@ -0,0 +1,237 @@
+#include "ReadAheadReader.hpp"
+#include "AppException.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace application
+{
+    ReadAheadReader::ReadAheadReader(std::shared_ptr<const InputFile> file, const ReadAheadOptions& options)
+        : m_file(std::move(file))
+        , m_blockSize(std::max<size_t>(options.blockSize, 4096))
+        , m_latency(options.latency)
+        , m_maxBlocks(std::max<uint64_t>(options.memoryCap / m_blockSize, 2))
+        , m_windowBlocks(std::min<uint64_t>((options.window + m_blockSize - 1) / m_blockSize, m_maxBlocks - 1))
+        , m_nextOffset(0)
+        , m_runStart(0)
+        , m_rampBlocks(0)
+        , m_bytesFetched(0)
+        , m_stopping(false)
+    {
+        if (m_windowBlocks > 0)
+            m_reader = std::thread(&ReadAheadReader::ReadInBackground, this);
+    }
+
+    ReadAheadReader::~ReadAheadReader()
+    {
+        if (!m_reader.joinable())
+            return;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_blocksChanged.notify_all();
+        m_reader.join();
+    }
+
+    size_t ReadAheadReader::ReadFile(uint64_t offset, void* buffer, size_t size)
+    {
+        if (m_latency.count() > 0)
+            std::this_thread::sleep_for(m_latency);
+
+        const size_t bytesRead = m_file->Read(offset, buffer, size);
+        m_bytesFetched += bytesRead;
+        return bytesRead;
+    }
+
+    void ReadAheadReader::ReadInBackground()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true)
+        {
+            m_blocksChanged.wait(lock, [this]() { return m_stopping || !m_queue.empty(); });
+            if (m_stopping)
+                return;
+
+            const uint64_t blockIdx = m_queue.front();
+            m_queue.pop_front();
+
+            const auto iter = m_blocks.find(blockIdx);
+            if (iter == m_blocks.end())
+                continue;
+
+            // read outside the lock, so that the demuxer takes what is ready meanwhile:
+            const std::shared_ptr<Block> block = iter->second;
+            block->state = BlockState::Reading;
+            lock.unlock();
+            try
+            {
+                block->size = ReadFile(blockIdx * m_blockSize, block->data.get(), m_blockSize);
+            }
+            catch (...)
+            {
+                block->error = std::current_exception();
+            }
+            lock.lock();
+
+            block->state = BlockState::Ready;
+            m_blocksChanged.notify_all();
+        }
+    }
+
+    bool ReadAheadReader::MakeRoom(uint64_t firstIdx, uint64_t lastIdx)
+    {
+        if (m_blocks.size() < m_maxBlocks)
+            return true;
+
+        // the blocks behind go first, then those left far ahead by a seek:
+        for (auto iter = m_blocks.begin(); iter != m_blocks.end() && iter->first < firstIdx; ++iter)
+        {
+            if (iter->second->state == BlockState::Ready)
+            {
+                m_blocks.erase(iter);
+                return true;
+            }
+        }
+
+        for (auto iter = m_blocks.rbegin(); iter != m_blocks.rend() && iter->first > lastIdx; ++iter)
+        {
+            if (iter->second->state == BlockState::Ready)
+            {
+                m_blocks.erase(std::next(iter).base());
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void ReadAheadReader::Schedule(uint64_t firstIdx, uint64_t lastIdx)
+    {
+        bool scheduled = false;
+        for (uint64_t blockIdx = firstIdx; blockIdx <= lastIdx && blockIdx * m_blockSize < m_file->GetSize(); ++blockIdx)
+        {
+            if (m_blocks.find(blockIdx) != m_blocks.end())
+                continue;
+
+            if (!MakeRoom(firstIdx, lastIdx))
+                break;
+
+            auto block = std::make_shared<Block>();
+            block->data = std::make_unique<uint8_t[]>(m_blockSize);
+            block->size = 0;
+            block->state = BlockState::Queued;
+            m_blocks.emplace(blockIdx, std::move(block));
+            m_queue.push_back(blockIdx);
+            scheduled = true;
+        }
+
+        if (scheduled)
+            m_blocksChanged.notify_all();
+    }
+
+    void ReadAheadReader::CancelQueued()
+    {
+        for (uint64_t blockIdx : m_queue)
+            m_blocks.erase(blockIdx);
+
+        if (!m_queue.empty())
+        {
+            m_queue.clear();
+            m_blocksChanged.notify_all();
+        }
+    }
+
+    size_t ReadAheadReader::Read(uint64_t offset, void* buffer, size_t size)
+    {
+        const uint64_t fileSize = m_file->GetSize();
+        if (offset >= fileSize)
+            return 0;
+
+        size = static_cast<size_t>(std::min<uint64_t>(size, fileSize - offset));
+        if (m_windowBlocks == 0 || size == 0)
+            return ReadFile(offset, buffer, size);
+
+        const uint64_t firstIdx = offset / m_blockSize;
+        const uint64_t lastIdx = (offset + size - 1) / m_blockSize;
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        // reads issued back to back may arrive out of order, hence some tolerance:
+        const bool continued = offset + m_blockSize >= m_nextOffset && offset <= m_nextOffset + m_blockSize;
+        if (continued)
+        {
+            m_nextOffset = std::max(m_nextOffset, offset + size);
+        }
+        else
+        {
+            CancelQueued();
+            m_rampBlocks = 0;
+            m_runStart = offset;
+            m_nextOffset = offset + size;
+        }
+
+        // the walk through the boxes of the container is made of short runs, which are not worth reading ahead:
+        if (m_nextOffset - m_runStart >= m_blockSize / 4)
+        {
+            m_rampBlocks = std::min(std::max<uint64_t>(m_rampBlocks * 2, 1), m_windowBlocks);
+            Schedule(firstIdx, lastIdx + m_rampBlocks);
+        }
+
+        auto target = static_cast<uint8_t*>(buffer);
+        size_t total = 0;
+        for (uint64_t blockIdx = firstIdx; blockIdx <= lastIdx; ++blockIdx)
+        {
+            const uint64_t blockStart = blockIdx * m_blockSize;
+            const uint64_t from = std::max(offset, blockStart);
+            const size_t length = static_cast<size_t>(std::min(offset + size, blockStart + m_blockSize) - from);
+
+            std::shared_ptr<Block> block;
+            const auto iter = m_blocks.find(blockIdx);
+            if (iter != m_blocks.end())
+            {
+                block = iter->second;
+                m_blocksChanged.wait(lock, [this, &block, blockIdx]()
+                {
+                    const auto current = m_blocks.find(blockIdx);
+                    return block->state == BlockState::Ready || current == m_blocks.end() || current->second != block;
+                });
+            }
+
+            size_t bytesRead;
+            if (block && block->state == BlockState::Ready)
+            {
+                if (block->error)
+                {
+                    // let the next read try again:
+                    const auto current = m_blocks.find(blockIdx);
+                    if (current != m_blocks.end() && current->second == block)
+                        m_blocks.erase(current);
+
+                    std::rethrow_exception(block->error);
+                }
+
+                // the data of a block ready does not change, so the lock is not needed to copy it:
+                const size_t blockPos = static_cast<size_t>(from - blockStart);
+                bytesRead = block->size > blockPos ? std::min(length, block->size - blockPos) : 0;
+                lock.unlock();
+                memcpy(target + total, block->data.get() + blockPos, bytesRead);
+                lock.lock();
+            }
+            else
+            {
+                // not in memory (seek, or no room), so read exactly what was asked:
+                lock.unlock();
+                bytesRead = ReadFile(from, target + total, length);
+                lock.lock();
+            }
+
+            total += bytesRead;
+            if (bytesRead < length)
+                break;
+        }
+
+        return total;
+    }
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include "InputFile.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace application
+{
+    /// <summary>
+    /// How a <see cref="ReadAheadReader"/> reads ahead.
+    /// </summary>
+    struct ReadAheadOptions
+    {
+        /// <summary>Size of the blocks read from the file in the background.</summary>
+        size_t blockSize = size_t(1) << 20;
+
+        /// <summary>How far ahead of the reading position to read, or zero not to read ahead.</summary>
+        uint64_t window = uint64_t(16) << 20;
+
+        /// <summary>
+        /// How much memory the blocks take at most, which keeps the blocks
+        /// just read around for short seeks back, as long as there is room.
+        /// </summary>
+        uint64_t memoryCap = uint64_t(32) << 20;
+
+        /// <summary>Delay added to every read of the file, to try out slow storage.</summary>
+        std::chrono::microseconds latency{ 0 };
+    };
+
+    /// <summary>
+    /// Reads a file for a demuxer, with a background thread that fills blocks ahead
+    /// of the reading position, so that reads do not stall when the storage is slow.
+    /// </summary>
+    /// <remarks>
+    /// Reading ahead starts once the reads follow each other, and its distance doubles
+    /// with every read up to the window. A seek drops what was scheduled for the old
+    /// position and is read just as requested, so that looking for the movie header
+    /// at the end of a file does not pull the blocks around it.
+    /// Reads are thread-safe.
+    /// </remarks>
+    class ReadAheadReader
+    {
+    private:
+
+        enum class BlockState { Queued, Reading, Ready };
+
+        struct Block
+        {
+            std::unique_ptr<uint8_t[]> data;
+            size_t size;
+            BlockState state;
+            std::exception_ptr error;
+        };
+
+        const std::shared_ptr<const InputFile> m_file;
+        const size_t m_blockSize;
+        const std::chrono::microseconds m_latency;
+        const uint64_t m_maxBlocks;
+        const uint64_t m_windowBlocks;
+
+        /// <summary>The blocks in memory or on their way, by index in the file.</summary>
+        std::map<uint64_t, std::shared_ptr<Block>> m_blocks;
+        std::deque<uint64_t> m_queue;
+
+        /// <summary>Where the reads are expected to go on, past the last one.</summary>
+        uint64_t m_nextOffset;
+
+        /// <summary>Where the reads started to follow each other, since the last seek.</summary>
+        uint64_t m_runStart;
+
+        /// <summary>How many blocks to keep scheduled ahead of the reads.</summary>
+        uint64_t m_rampBlocks;
+
+        std::atomic<uint64_t> m_bytesFetched;
+        bool m_stopping;
+        std::mutex m_mutex;
+        std::condition_variable m_blocksChanged;
+        std::thread m_reader;
+
+        size_t ReadFile(uint64_t offset, void* buffer, size_t size);
+
+        void ReadInBackground();
+
+        /// <summary>
+        /// Makes room for one more block, evicting a block outside of the given range.
+        /// </summary>
+        /// <returns>Whether there is room.</returns>
+        bool MakeRoom(uint64_t firstIdx, uint64_t lastIdx);
+
+        /// <summary>
+        /// Schedules the blocks of a range that are not in memory nor on their way.
+        /// </summary>
+        void Schedule(uint64_t firstIdx, uint64_t lastIdx);
+
+        /// <summary>
+        /// Drops the scheduled blocks that nobody started to read.
+        /// </summary>
+        void CancelQueued();
+
+    public:
+
+        /// <summary>
+        /// Creates a new instance, which starts the background reader unless reading ahead is off.
+        /// </summary>
+        /// <param name="file">The file to read.</param>
+        /// <param name="options">How to read ahead.</param>
+        ReadAheadReader(std::shared_ptr<const InputFile> file, const ReadAheadOptions& options);
+
+        ~ReadAheadReader();
+
+        ReadAheadReader(const ReadAheadReader&) = delete;
+        ReadAheadReader& operator=(const ReadAheadReader&) = delete;
+
+        const InputFile& GetFile() const
+        {
+            return *m_file;
+        }
+
+        /// <summary>
+        /// Reads from an offset of the file, waiting for the blocks already on their way.
+        /// </summary>
+        /// <returns>How much was read, which is less than requested only at the end of the file.</returns>
+        /// <remarks>Throws <see cref="AppException"/> on failure.</remarks>
+        size_t Read(uint64_t offset, void* buffer, size_t size);
+
+        /// <summary>
+        /// Gets how much has been read from the file, counting what was read ahead.
+        /// </summary>
+        uint64_t GetBytesFetched() const
+        {
+            return m_bytesFetched;
+        }
+    };
+}
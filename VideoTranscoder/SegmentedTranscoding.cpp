@@ -0,0 +1,447 @@
+#include "SegmentedTranscoding.hpp"
+
+#include "AppException.hpp"
+#include "EncoderCalibration.hpp"
+#include "JobConsole.hpp"
+#include "JobPrediction.hpp"
+#include "JobScheduler.hpp"
+#include "Mp4Probe.hpp"
+#include "ProgressSubscribers.hpp"
+#include "Mp4Concatenation.hpp"
+#include "Mp4Faststart.hpp"
+#include "TranscodeJob.hpp"
+#include "TranscodeReport.hpp"
+#include "Utf8Path.hpp"
+
+#include <MinCppXtra/traceable_exception.hpp>
+
+#include <algorithm>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace application
+{
+    using namespace std::chrono;
+
+    struct SegmentResult
+    {
+        bool succeeded;
+        bool hardwareAccelerated;
+        std::string videoEncoderName;
+        nanoseconds elapsedTime;
+        std::string errorMessage;
+        double sizeFactor;
+        uint32_t sizeRestartCount;
+    };
+
+    static std::string FormatTime(nanoseconds time)
+    {
+        const auto totalSecs = duration_cast<seconds>(time).count();
+        std::ostringstream oss;
+        oss << std::setfill('0')
+            << std::setw(2) << totalSecs / 3600 << ':'
+            << std::setw(2) << (totalSecs / 60) % 60 << ':'
+            << std::setw(2) << totalSecs % 60;
+        return oss.str();
+    }
+
+    std::vector<PresentationRange> PlanSegments(
+        const std::vector<nanoseconds>& keyframeTimes,
+        nanoseconds duration,
+        uint32_t segmentCount)
+    {
+        std::vector<nanoseconds> boundaries;
+        for (uint32_t idx = 1; idx < segmentCount; ++idx)
+        {
+            const nanoseconds idealTime = duration * idx / segmentCount;
+
+            // the key frame closest to the ideal split:
+            auto iter = std::lower_bound(keyframeTimes.begin(), keyframeTimes.end(), idealTime);
+            if (iter == keyframeTimes.end()
+                || (iter != keyframeTimes.begin() && idealTime - *(iter - 1) < *iter - idealTime))
+            {
+                if (iter == keyframeTimes.begin())
+                    continue;
+                --iter;
+            }
+
+            const nanoseconds boundary = *iter;
+            if (boundary.count() > 0 && boundary < duration
+                && (boundaries.empty() || boundary > boundaries.back()))
+            {
+                boundaries.push_back(boundary);
+            }
+        }
+
+        std::vector<PresentationRange> ranges;
+        nanoseconds start(0);
+        for (nanoseconds boundary : boundaries)
+        {
+            ranges.push_back(PresentationRange{ start, boundary });
+            start = boundary;
+        }
+        ranges.push_back(PresentationRange{ start, duration });
+        return ranges;
+    }
+
+    static std::string MakePartFName(const std::string& outputFName, size_t segmentIdx)
+    {
+        std::filesystem::path path = ToPath(outputFName);
+        path.replace_extension(".part" + std::to_string(segmentIdx + 1) + ".mp4");
+        return ToUtf8(path);
+    }
+
+    /// <summary>
+    /// How many times an overshooting segment is encoded again at most, counting both the restarts
+    /// once its size is projected beyond tolerance and the re-encodings once it is finished.
+    /// </summary>
+    static constexpr uint32_t maxSizeControlPasses = 2;
+
+    /// <summary>
+    /// Transcodes a segment with the video bitrates of the settings scaled to a size factor.
+    /// With a size tolerance, the session is aborted as soon as the part is projected beyond it
+    /// and restarted with the factor corrected by the projection, up to the restarts allowed.
+    /// </summary>
+    static SegmentResult RunSegment(MediaBackend& backend,
+                                    const CmdLineParams& params,
+                                    const TranscodeSettings& settings,
+                                    double sizeFactor,
+                                    uint32_t maxRestarts,
+                                    const PresentationRange& range,
+                                    const std::string& partFName,
+                                    ProgressHub& progressHub)
+    {
+        SegmentResult result = {};
+        result.sizeFactor = sizeFactor;
+        const auto startTime = steady_clock::now();
+
+        try
+        {
+            auto threadScope = backend.EnterThread();
+
+            // what the part takes at the decided settings, whatever the factor it is encoded with:
+            const bool sizeControlled =
+                params.sizeTolerancePct > 0.0 && !settings.streamCopy && settings.videoAvgBitrate != 0;
+            const uint64_t targetSize = static_cast<uint64_t>(
+                ((double)settings.videoAvgBitrate / 8 + settings.audioAvgBytesPerSec)
+                * duration<double>(range.stop - range.start).count());
+
+            while (true)
+            {
+                // the settings are not decided again, because the parts must have the same sample description:
+                TranscodeJob job(backend, params.inputFName, partFName,
+                                 RetargetVideoBitrates(settings, result.sizeFactor), range);
+
+                job.Track(progressHub, partFName);
+
+                // the last pass runs to the end, leaving the part to the check once finished:
+                if (sizeControlled && targetSize != 0 && result.sizeRestartCount < maxRestarts)
+                    job.LimitSize(static_cast<uint64_t>(targetSize * (1.0 + params.sizeTolerancePct / 100.0)));
+
+                job.Start();
+
+                try
+                {
+                    while (!job.Wait(hours(1)))
+                        continue;
+                }
+                catch (AppException& ex)
+                {
+                    const auto projectedSize = job.GetOversizeProjection();
+                    if (!projectedSize)
+                        throw;
+
+                    // what the segment is projected to get for what it was asked, as if the encoder were linear:
+                    result.sizeFactor = std::max(result.sizeFactor * targetSize / *projectedSize,
+                                                 settings.targetSizeFactor / 4);
+                    ++result.sizeRestartCount;
+
+                    std::ostringstream oss;
+                    oss << ex.what() << ", restarting with size factor " << std::setprecision(3) << result.sizeFactor;
+                    PrintJobMessage(oss.str());
+                    continue;
+                }
+
+                result.hardwareAccelerated = job.IsHardwareAccelerated();
+                result.videoEncoderName = job.GetVideoEncoderName();
+                break;
+            }
+
+            result.succeeded = true;
+        }
+        catch (mincpp::TraceableException& ex)
+        {
+            result.errorMessage = ex.what();
+            std::lock_guard<std::mutex> lock(GetConsoleMutex());
+            std::cerr << std::endl << ex.Serialize() << std::endl;
+        }
+        catch (std::exception& ex)
+        {
+            result.errorMessage = ex.what();
+        }
+
+        result.elapsedTime = steady_clock::now() - startTime;
+        return result;
+    }
+
+    /// <summary>
+    /// Re-encodes the finished segments whose video bitrate exceeds the target beyond tolerance,
+    /// which the projection while encoding did not foresee (as when the end of a part is harder
+    /// to encode than its beginning), with the size factor corrected by how much they overshot,
+    /// until they are within or out of passes. The parts start at key frames, so they are spliced
+    /// by concatenation, hence nothing changes in the settings but the video bitrates.
+    /// </summary>
+    /// <returns>How many segments were encoded more than once, restarts included.</returns>
+    static uint32_t ControlSegmentSizes(MediaBackend& backend,
+                                        const CmdLineParams& params,
+                                        const TranscodeSettings& settings,
+                                        const std::vector<PresentationRange>& ranges,
+                                        const std::vector<std::string>& partFNames,
+                                        const std::vector<SegmentResult>& results,
+                                        const JobScheduler& scheduler,
+                                        ProgressHub& progressHub)
+    {
+        const double maxBitrateRatio = 1.0 + params.sizeTolerancePct / 100.0;
+        std::vector<double> sizeFactors;
+        // passes taken by each segment, set by the workers concurrently:
+        std::vector<uint32_t> passes;
+        for (const SegmentResult& result : results)
+        {
+            sizeFactors.push_back(result.sizeFactor);
+            passes.push_back(result.sizeRestartCount);
+        }
+
+        for (uint32_t pass = 0; pass < maxSizeControlPasses; ++pass)
+        {
+            std::vector<size_t> overshooting;
+            for (size_t idx = 0; idx < ranges.size(); ++idx)
+            {
+                if (passes[idx] >= maxSizeControlPasses)
+                    continue;
+
+                const auto videoBitrate = ProbeVideoBitrate(partFNames[idx]);
+                if (!videoBitrate)
+                    continue;
+
+                const double bitrateRatio = (double)*videoBitrate / settings.videoAvgBitrate;
+                if (bitrateRatio <= maxBitrateRatio)
+                    continue;
+
+                // what the segment got for what it was asked, as if the encoder were linear:
+                sizeFactors[idx] = std::max(sizeFactors[idx] / bitrateRatio, settings.targetSizeFactor / 4);
+                overshooting.push_back(idx);
+
+                std::ostringstream oss;
+                oss << std::fixed << std::setprecision(0) << "over the target bitrate by "
+                    << (bitrateRatio - 1.0) * 100 << " %, re-encoding with size factor "
+                    << std::setprecision(3) << sizeFactors[idx];
+                PrintJobMessage(idx, ranges.size(), oss.str());
+            }
+
+            if (overshooting.empty())
+                break;
+
+            scheduler.Run(overshooting.size(),
+                [&](size_t overshootIdx)
+                {
+                    const size_t idx = overshooting[overshootIdx];
+                    JobConsoleScope consoleScope(idx, ranges.size());
+                    // the part is only replaced once the new one is complete:
+                    std::filesystem::path retryPath = ToPath(partFNames[idx]);
+                    retryPath.replace_extension(".retry.mp4");
+                    const std::string retryFName = ToUtf8(retryPath);
+
+                    const SegmentResult result = RunSegment(backend, params, settings, sizeFactors[idx],
+                        maxSizeControlPasses - passes[idx] - 1, ranges[idx], retryFName, progressHub);
+
+                    std::error_code error;
+                    if (result.succeeded)
+                        std::filesystem::rename(retryPath, ToPath(partFNames[idx]), error);
+
+                    if (!result.succeeded || error)
+                    {
+                        std::filesystem::remove(retryPath, error);
+                        PrintJobMessage(idx, ranges.size(), "failed to re-encode, keeping the previous one");
+                        return;
+                    }
+
+                    sizeFactors[idx] = result.sizeFactor;
+                    passes[idx] += 1 + result.sizeRestartCount;
+                    PrintJobMessage(idx, ranges.size(), "re-encoded");
+                });
+        }
+
+        return static_cast<uint32_t>(std::count_if(passes.begin(), passes.end(),
+            [](uint32_t segmentPasses) { return segmentPasses > 0; }));
+    }
+
+    static void RemoveParts(const std::vector<std::string>& partFNames)
+    {
+        for (const std::string& partFName : partFNames)
+        {
+            std::error_code error;
+            std::filesystem::remove(ToPath(partFName), error);
+        }
+    }
+
+    static void WriteReport(TranscodeReport& report, const CmdLineParams& params, nanoseconds wallTime)
+    {
+        if (!params.writeReport)
+            return;
+
+        report.wallTime = wallTime;
+        WriteTranscodeReport(report, GetTranscodeReportFName(params.reportPath, params.outputFName));
+    }
+
+    bool RunSegmentedTranscoding(MediaBackend& backend, const CmdLineParams& params)
+    {
+        const auto startTime = steady_clock::now();
+
+        TranscodeReport report = {};
+        report.inputFName = params.inputFName;
+        report.outputFName = params.outputFName;
+        report.videoEncoder = params.encoder;
+        report.requestedSizeFactor = params.tgtSize;
+
+        nanoseconds duration;
+        std::vector<PresentationRange> ranges;
+        {
+            auto input = backend.OpenInput(params.inputFName);
+            duration = input->GetDuration();
+            ranges = PlanSegments(input->GetKeyframeTimes(), duration, params.segmentCount);
+
+            report.sourceInfo = input->GetMediaInfo();
+            report.videoEncoder = GetEncoderSelection(backend, params).Select(*report.sourceInfo);
+            report.mediaDuration = duration;
+        }
+
+        if (params.predictExcerpts > 0)
+        {
+            std::cout << std::endl << "Encoding " << params.predictExcerpts
+                << " excerpts to predict the outcome..." << std::endl;
+
+            report.prediction = PredictJob(backend, params.inputFName, params.outputFName, report.videoEncoder,
+                                           params.tgtSize, params.predictExcerpts, params.GetTimeBudget());
+
+            std::cout << (report.prediction ? "Job " + DescribeJobPrediction(*report.prediction)
+                                            : std::string("Input too short or not to be encoded, no prediction"))
+                << std::endl;
+        }
+
+        // every segment decides the same from the same source:
+        report.settings = TranscodeJob::DecideSettings(backend, *report.sourceInfo, report.videoEncoder,
+            report.prediction ? report.prediction->correctedSizeFactor : params.tgtSize, milliseconds(0),
+            true, report.prediction ? report.prediction->videoQualityVsSpeed : 0);
+
+        // Hardware and software encoders write different parameter sets, which cannot be
+        // concatenated, hence all segments take the same path: on hardware, no more at the
+        // same time than the sessions the encoders admit, otherwise all in software.
+        const uint32_t hardwareSlots = report.settings->hardwareAllowed
+            ? backend.GetEncoderRegistry().GetHardwareSessionCapacity(report.videoEncoder) : 0;
+        const bool useHardware = hardwareSlots > 0;
+        report.settings->hardwareAllowed = useHardware;
+        const uint32_t maxParallelJobs =
+            params.maxParallelJobs != 0 ? params.maxParallelJobs : JobScheduler::GetDefaultConcurrency();
+
+        JobScheduler scheduler(useHardware ? std::min(maxParallelJobs, hardwareSlots) : maxParallelJobs);
+        std::cout << std::endl
+            << "Input media file is " << duration_cast<seconds>(duration).count()
+            << " seconds long, split at key frames in " << ranges.size()
+            << " segments, running up to " << scheduler.GetMaxConcurrentJobs()
+            << " at the same time" << (useHardware ? "" : " in software") << std::endl << std::endl;
+
+        // a single segment needs no concatenation:
+        std::vector<std::string> partFNames;
+        for (size_t idx = 0; idx < ranges.size(); ++idx)
+            partFNames.push_back(ranges.size() > 1 ? MakePartFName(params.outputFName, idx) : params.outputFName);
+
+        ProgressHub progressHub;
+        SubscribeFileWriters(progressHub, params.progressJsonFName, params.metricsFName);
+
+        std::vector<SegmentResult> results(ranges.size());
+        scheduler.Run(ranges.size(),
+            [&backend, &params, &report, &ranges, &partFNames, &results, &progressHub](size_t segmentIdx)
+            {
+                JobConsoleScope consoleScope(segmentIdx, ranges.size());
+                const PresentationRange& range = ranges[segmentIdx];
+                const std::string rangeText = FormatTime(range.start) + " - " + FormatTime(range.stop);
+                PrintJobMessage(segmentIdx, ranges.size(), "starting " + rangeText);
+
+                results[segmentIdx] = RunSegment(backend, params, *report.settings, report.settings->targetSizeFactor,
+                                                 maxSizeControlPasses, range, partFNames[segmentIdx], progressHub);
+
+                const SegmentResult& result = results[segmentIdx];
+                PrintJobMessage(segmentIdx, ranges.size(), result.succeeded
+                    ? "finished " + rangeText + " in " + std::to_string(duration_cast<seconds>(result.elapsedTime).count())
+                        + " s" + (result.hardwareAccelerated ? " (HW)" : "")
+                    : "failed " + rangeText + " (" + result.errorMessage + ')');
+            });
+
+        const bool succeeded = std::all_of(results.begin(), results.end(),
+            [](const SegmentResult& result) { return result.succeeded; });
+
+        report.hardwareAccelerated = std::all_of(results.begin(), results.end(),
+            [](const SegmentResult& result) { return result.hardwareAccelerated; });
+
+        // the encoder is the same for all segments, but not every one may know its name:
+        auto named = std::find_if(results.begin(), results.end(),
+            [](const SegmentResult& result) { return !result.videoEncoderName.empty(); });
+        if (named != results.end())
+            report.videoEncoderName = named->videoEncoderName;
+
+        if (!succeeded)
+        {
+            if (ranges.size() > 1)
+                RemoveParts(partFNames);
+
+            auto failure = std::find_if(results.begin(), results.end(),
+                [](const SegmentResult& result) { return !result.succeeded; });
+            report.errorMessage = failure->errorMessage;
+            WriteReport(report, params, steady_clock::now() - startTime);
+
+            std::cout << std::endl << "Transcoding has failed" << std::endl << std::endl;
+            return false;
+        }
+
+        if (params.sizeTolerancePct > 0.0 && !report.settings->streamCopy && report.settings->videoAvgBitrate != 0)
+        {
+            report.reencodedSegmentCount = ControlSegmentSizes(
+                backend, params, *report.settings, ranges, partFNames, results, scheduler, progressHub);
+        }
+
+        if (ranges.size() > 1 && !params.simulate)
+        {
+            std::cout << std::endl << "Concatenating segments into " << params.outputFName << std::endl;
+            try
+            {
+                ConcatenateMp4Files(partFNames, params.outputFName);
+            }
+            catch (std::exception& ex)
+            {
+                RemoveParts(partFNames);
+                report.errorMessage = ex.what();
+                WriteReport(report, params, steady_clock::now() - startTime);
+                throw;
+            }
+            RemoveParts(partFNames);
+        }
+
+        // concatenation already writes the movie in front:
+        if (ranges.size() == 1 && params.faststart && !params.simulate)
+            MoveMovieToFront(params.outputFName);
+
+        const nanoseconds wallTime = steady_clock::now() - startTime;
+        report.succeeded = true;
+        WriteReport(report, params, wallTime);
+
+        std::cout << std::endl
+            << "Transcoding finished in " << duration_cast<seconds>(wallTime).count() << " s"
+            << " (" << std::fixed << std::setprecision(1)
+            << (double)duration.count() / std::max<int64_t>(wallTime.count(), 1) << "x real time)"
+            << std::endl << std::endl;
+
+        return true;
+    }
+}
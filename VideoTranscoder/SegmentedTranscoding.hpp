@@ -0,0 +1,34 @@
+#pragma once
+
+#include "CommandLineParsing.hpp"
+#include "MediaBackend.hpp"
+
+#include <chrono>
+#include <vector>
+
+namespace application
+{
+    /// <summary>
+    /// Splits a presentation in ranges of about the same length, starting at key frames.
+    /// </summary>
+    /// <param name="keyframeTimes">Presentation times of the key frames, in ascending order.</param>
+    /// <param name="duration">The duration of the presentation.</param>
+    /// <param name="segmentCount">How many segments are desired.</param>
+    /// <returns>
+    /// Contiguous ranges covering the whole presentation, which can be fewer than
+    /// desired when there are not enough key frames (or none known at all).
+    /// </returns>
+    std::vector<PresentationRange> PlanSegments(
+        const std::vector<std::chrono::nanoseconds>& keyframeTimes,
+        std::chrono::nanoseconds duration,
+        uint32_t segmentCount);
+
+    /// <summary>
+    /// Transcodes a single input by splitting it at key frames in segments that are
+    /// transcoded with concurrent media sessions, then concatenates them into the output.
+    /// </summary>
+    /// <param name="backend">The media backend shared by all segments.</param>
+    /// <param name="params">The command line parameters in single input mode.</param>
+    /// <returns>Whether all segments have succeeded.</returns>
+    bool RunSegmentedTranscoding(MediaBackend& backend, const CmdLineParams& params);
+}
@@ -0,0 +1,331 @@
+#include "SimulatedBackend.hpp"
+#include "AppException.hpp"
+#include "Utf8Path.hpp"
+
+#include <array>
+#include <filesystem>
+
+namespace application
+{
+    using namespace std::chrono;
+
+    /// <summary>
+    /// FNV-1a hash (64 bits).
+    /// </summary>
+    static uint64_t HashName(const std::string& name)
+    {
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        for (char ch : name)
+        {
+            hash ^= static_cast<unsigned char>(ch);
+            hash *= 0x100000001b3ULL;
+        }
+        return hash;
+    }
+
+    class SimulatedSession : public TranscodeSession
+    {
+    private:
+
+        const PresentationRange m_range;
+        const bool m_hardwareAccelerated;
+        const bool m_streamCopy;
+        const double m_speedFactor;
+        const double m_outputBytesPerSec;
+        bool m_started;
+        bool m_aborted;
+        nanoseconds m_clock;
+        SessionObserver* m_observer;
+        nanoseconds m_observerInterval;
+        nanoseconds m_nextReport;
+
+        /// <summary>
+        /// When the session finishes, on the simulated clock.
+        /// </summary>
+        nanoseconds GetFinishTime() const
+        {
+            return duration_cast<nanoseconds>((m_range.stop - m_range.start) / m_speedFactor);
+        }
+
+    public:
+
+        SimulatedSession(const PresentationRange& range,
+                         const SimulatedBackend::Options& options,
+                         const TranscodeSettings& settings,
+                         uint32_t sourceVideoBitrate,
+                         bool hardwareAvailable)
+            : m_range(range)
+            , m_hardwareAccelerated(!settings.streamCopy && settings.hardwareAllowed && hardwareAvailable)
+            , m_streamCopy(settings.streamCopy)
+            , m_speedFactor(settings.streamCopy ? options.streamCopySpeedFactor
+                            : m_hardwareAccelerated ? options.speedFactor
+                            : options.softwareSpeedFactor)
+            , m_outputBytesPerSec(settings.streamCopy
+                ? (double)sourceVideoBitrate / 8 + settings.audioAvgBytesPerSec
+                : settings.videoAvgBitrate * options.bitrateRatio / 8 + settings.audioAvgBytesPerSec)
+            , m_started(false)
+            , m_aborted(false)
+            , m_clock(0)
+            , m_observer(nullptr)
+            , m_observerInterval(0)
+            , m_nextReport(0)
+        {
+        }
+
+        bool IsHardwareAccelerated() const override
+        {
+            return m_hardwareAccelerated;
+        }
+
+        std::string GetVideoEncoderName() const override
+        {
+            if (m_streamCopy)
+                return std::string();
+
+            return m_hardwareAccelerated ? "Simulated hardware encoder" : "Simulated software encoder";
+        }
+
+        void Observe(SessionObserver& observer, milliseconds interval) override
+        {
+            m_observer = &observer;
+            m_observerInterval = interval;
+        }
+
+        void Start() override
+        {
+            m_started = true;
+            if (m_observer != nullptr)
+            {
+                m_observer->OnStarted();
+                m_nextReport = m_observerInterval;
+            }
+        }
+
+        bool Wait(milliseconds timeout) override
+        {
+            if (!m_started)
+                throw AppException("Simulated session was not started");
+
+            if (m_aborted)
+                throw AppException("Simulated session was aborted");
+
+            const nanoseconds waitEnd = m_clock + timeout;
+            const nanoseconds finishTime = GetFinishTime();
+
+            // report on the simulated clock as it goes by:
+            while (m_observer != nullptr && m_observerInterval.count() > 0
+                   && m_nextReport <= waitEnd && m_nextReport < finishTime)
+            {
+                m_clock = m_nextReport;
+                m_observer->OnPosition(GetPosition(), m_clock);
+                m_nextReport += m_observerInterval;
+
+                if (m_aborted)
+                    throw AppException("Simulated session was aborted");
+            }
+
+            m_clock = std::min(waitEnd, std::max(finishTime, m_clock));
+            if (m_clock < finishTime)
+                return false;
+
+            if (m_observer != nullptr)
+                m_observer->OnPosition(GetPosition(), m_clock);
+
+            return true;
+        }
+
+        void Abort() override
+        {
+            m_aborted = true;
+        }
+
+        nanoseconds GetPosition() const override
+        {
+            if (m_clock >= GetFinishTime())
+                return m_range.stop;
+
+            const auto position = m_range.start + duration_cast<nanoseconds>(m_clock * m_speedFactor);
+            return std::min(position, m_range.stop);
+        }
+
+        uint64_t GetBytesWritten() const override
+        {
+            // nothing is written, but the output grows as it would at the configured bitrate:
+            return static_cast<uint64_t>(m_outputBytesPerSec * duration<double>(GetPosition() - m_range.start).count());
+        }
+    };
+
+    class SimulatedInput : public MediaInput
+    {
+    private:
+
+        const std::string m_inputFName;
+        const SimulatedBackend::Options m_options;
+        const EncoderRegistry& m_encoderRegistry;
+
+    public:
+
+        SimulatedInput(const std::string& inputFName,
+                       const SimulatedBackend::Options& options,
+                       const EncoderRegistry& encoderRegistry)
+            : m_inputFName(inputFName)
+            , m_options(options)
+            , m_encoderRegistry(encoderRegistry)
+        {
+        }
+
+        nanoseconds GetDuration() const override
+        {
+            return SimulatedBackend::SimulateDuration(m_inputFName);
+        }
+
+        MediaInfo GetMediaInfo() const override
+        {
+            return SimulatedBackend::SimulateMediaInfo(m_inputFName);
+        }
+
+        StreamLayout GetStreamLayout() const override
+        {
+            StreamLayout layout = {};
+            layout.videoCount = 1;
+            layout.audioCount = 1;
+            layout.choice.video = 0;
+            layout.choice.audio = 1;
+            return layout;
+        }
+
+        std::vector<nanoseconds> GetKeyframeTimes() const override
+        {
+            // fixed GOP of 2 s:
+            std::vector<nanoseconds> keyframeTimes;
+            for (nanoseconds time(0); time < GetDuration(); time += seconds(2))
+                keyframeTimes.push_back(time);
+
+            return keyframeTimes;
+        }
+
+        std::unique_ptr<TranscodeSession> CreateSession(
+            const MediaInfo& sourceInfo,
+            const TranscodeSettings& settings,
+            const std::string&,
+            const std::optional<PresentationRange>& range) override
+        {
+            const auto& frameSize = sourceInfo.videoProfile.frameSize;
+            return std::make_unique<SimulatedSession>(
+                range.value_or(PresentationRange{ nanoseconds(0), GetDuration() }),
+                m_options,
+                settings,
+                sourceInfo.videoProfile.avgBitrate,
+                m_encoderRegistry.HasHardwareEncoder(settings.videoEncoder, frameSize.width, frameSize.height));
+        }
+    };
+
+    /// <summary>
+    /// Makes up the encoders of a machine with software encoders for all codecs,
+    /// plus hardware ones for H.264 and HEVC up to 4K if enabled.
+    /// </summary>
+    static EncoderRegistry SimulateEncoderRegistry(const SimulatedBackend::Options& options)
+    {
+        std::vector<EncoderCapability> encoders;
+        for (Encoder codec : { Encoder::H264_AVC, Encoder::H265_HEVC, Encoder::AV1 })
+        {
+            if (options.hardwareAccelerated && codec != Encoder::AV1)
+            {
+                encoders.push_back(EncoderCapability{
+                    "Simulated hardware encoder", "{00000000-0000-0000-0000-000000000001}",
+                    codec, true, true, 4096, 2304 });
+            }
+
+            encoders.push_back(EncoderCapability{
+                "Simulated software encoder", "{00000000-0000-0000-0000-000000000002}",
+                codec, false, false, 0, 0 });
+        }
+
+        return EncoderRegistry(std::move(encoders), "simulated");
+    }
+
+    SimulatedBackend::SimulatedBackend()
+        : m_options()
+        , m_encoderRegistry(SimulateEncoderRegistry(m_options))
+    {
+    }
+
+    SimulatedBackend::SimulatedBackend(const Options& options)
+        : m_options(options)
+        , m_encoderRegistry(SimulateEncoderRegistry(options))
+    {
+        if (options.speedFactor <= 0.0 || options.softwareSpeedFactor <= 0.0 || options.streamCopySpeedFactor <= 0.0)
+            throw AppException("Speed of simulated backend must be positive");
+    }
+
+    MediaInfo SimulatedBackend::SimulateMediaInfo(const std::string& inputFName)
+    {
+        struct Format
+        {
+            uint32_t width;
+            uint32_t height;
+            uint32_t avgBitrate;
+        };
+
+        static const auto formats = std::to_array<Format>({
+            { 1280, 720, 5000000 },
+            { 1920, 1080, 12000000 },
+            { 3840, 2160, 45000000 }
+        });
+
+        static const auto frameRates = std::to_array<std::array<uint32_t, 2>>({
+            {{ 24000, 1001 }}, {{ 25, 1 }}, {{ 30000, 1001 }}, {{ 60, 1 }}
+        });
+
+        const uint64_t hash = HashName(inputFName);
+        const Format& format = formats[hash % formats.size()];
+        const auto& frameRate = frameRates[(hash >> 8) % frameRates.size()];
+
+        MediaInfo info = {};
+        info.videoProfile.frameSize.width = format.width;
+        info.videoProfile.frameSize.height = format.height;
+        info.videoProfile.frameRate.numerator = frameRate[0];
+        info.videoProfile.frameRate.denominator = frameRate[1];
+        // +/- 25% around the nominal bitrate:
+        info.videoProfile.avgBitrate =
+            static_cast<uint32_t>(format.avgBitrate * (0.75 + ((hash >> 16) % 51) / 100.0));
+        // one in three is HEVC:
+        info.videoProfile.format = ((hash >> 32) % 3 == 0) ? Encoder::H265_HEVC : Encoder::H264_AVC;
+
+        info.audioProfile.bitsPerSample = 16;
+        info.audioProfile.samplesPerSec = 48000;
+        info.audioProfile.numChannels = 2;
+        info.audioProfile.avgBytesPerSec = 24000;
+        info.audioProfile.isAac = true;
+
+        return info;
+    }
+
+    nanoseconds SimulatedBackend::SimulateDuration(const std::string& inputFName)
+    {
+        // between 30 s and 2 h:
+        const uint64_t hash = HashName(inputFName);
+        return seconds(30 + (hash >> 24) % (2 * 3600 - 30));
+    }
+
+    std::unique_ptr<MediaBackend::ThreadScope> SimulatedBackend::EnterThread() const
+    {
+        return std::make_unique<ThreadScope>();
+    }
+
+    std::unique_ptr<MediaInput> SimulatedBackend::OpenInput(const std::string& inputFName)
+    {
+        return std::make_unique<SimulatedInput>(inputFName, m_options, m_encoderRegistry);
+    }
+
+    const EncoderRegistry& SimulatedBackend::GetEncoderRegistry()
+    {
+        return m_encoderRegistry;
+    }
+
+    std::string SimulatedBackend::GetDataDirectory() const
+    {
+        // apart from the real one, so that simulated measurements never mix with it:
+        return ToUtf8(std::filesystem::temp_directory_path() / "VideoTranscoder-simulated");
+    }
+}
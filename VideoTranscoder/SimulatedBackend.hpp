@@ -0,0 +1,72 @@
+#pragma once
+
+#include "MediaBackend.hpp"
+
+namespace application
+{
+    /// <summary>
+    /// Deterministic media backend that does no actual media work.
+    /// </summary>
+    /// <remarks>
+    /// Input properties are derived from a hash of the file name, so the same
+    /// name always yields the same media. Sessions run on a simulated clock:
+    /// each call to <see cref="TranscodeSession::Wait"/> advances it by up to the
+    /// given timeout without sleeping, and the position moves according to
+    /// the configured speed. This allows to run and profile the job logic
+    /// (scheduling, estimations, progress) on any platform.
+    /// </remarks>
+    class SimulatedBackend : public MediaBackend
+    {
+    public:
+
+        struct Options
+        {
+            /// <summary>Transcoding speed as a multiple of real time.</summary>
+            double speedFactor = 8.0;
+
+            /// <summary>Transcoding speed as a multiple of real time when encoding on software.</summary>
+            double softwareSpeedFactor = 2.0;
+
+            /// <summary>Speed as a multiple of real time when streams are copied without re-encoding.</summary>
+            double streamCopySpeedFactor = 200.0;
+
+            /// <summary>
+            /// Achieved bitrate of the output video as a fraction of the target
+            /// (above 1 for an encoder that overshoots).
+            /// </summary>
+            double bitrateRatio = 1.0;
+
+            /// <summary>Whether there are (simulated) hardware encoders for H.264 and HEVC.</summary>
+            bool hardwareAccelerated = true;
+        };
+
+    private:
+
+        const Options m_options;
+        const EncoderRegistry m_encoderRegistry;
+
+    public:
+
+        SimulatedBackend();
+
+        explicit SimulatedBackend(const Options& options);
+
+        /// <summary>
+        /// Derives the properties of a simulated input from its file name.
+        /// </summary>
+        static MediaInfo SimulateMediaInfo(const std::string& inputFName);
+
+        /// <summary>
+        /// Derives the duration of a simulated input from its file name.
+        /// </summary>
+        static std::chrono::nanoseconds SimulateDuration(const std::string& inputFName);
+
+        std::unique_ptr<ThreadScope> EnterThread() const override;
+
+        std::unique_ptr<MediaInput> OpenInput(const std::string& inputFName) override;
+
+        const EncoderRegistry& GetEncoderRegistry() override;
+
+        std::string GetDataDirectory() const override;
+    };
+}
@@ -0,0 +1,119 @@
+#include "stdafx.h"
+#include "StreamChoiceSource.hpp"
+
+#include "AppException.hpp"
+
+#include <Shlwapi.h>
+
+namespace application
+{
+    StreamChoiceSource::StreamChoiceSource(const ComPtr<IMFMediaSource>& mfMediaSource,
+                                           const StreamChoice& streamChoice)
+        : m_mfMediaSource(mfMediaSource)
+        , m_refCount(0)
+    {
+        CHECK("create presentation descriptor",
+            m_mfMediaSource->CreatePresentationDescriptor(m_mfPresentationDescriptor.GetAddressOf()));
+
+        DWORD streamCount;
+        CHECK("get source stream count",
+            m_mfPresentationDescriptor->GetStreamDescriptorCount(&streamCount));
+
+        for (DWORD streamIdx = 0; streamIdx < streamCount; ++streamIdx)
+        {
+            if (streamChoice.video == streamIdx || streamChoice.audio == streamIdx)
+            {
+                CHECK("select source stream", m_mfPresentationDescriptor->SelectStream(streamIdx));
+            }
+            else
+            {
+                CHECK("deselect source stream", m_mfPresentationDescriptor->DeselectStream(streamIdx));
+            }
+        }
+    }
+
+    STDMETHODIMP StreamChoiceSource::QueryInterface(REFIID riid, void** ppv)
+    {
+        static const QITAB qit[] =
+        {
+            QITABENT(StreamChoiceSource, IMFMediaSource),
+            QITABENT(StreamChoiceSource, IMFMediaEventGenerator),
+            { 0 }
+        };
+        return QISearch(this, qit, riid, ppv);
+    }
+
+    STDMETHODIMP_(ULONG) StreamChoiceSource::AddRef()
+    {
+        return InterlockedIncrement(&m_refCount);
+    }
+
+    STDMETHODIMP_(ULONG) StreamChoiceSource::Release()
+    {
+        long refCount = InterlockedDecrement(&m_refCount);
+        if (refCount == 0)
+        {
+            delete this;
+        }
+        return refCount;
+    }
+
+    STDMETHODIMP StreamChoiceSource::GetEvent(DWORD flags, IMFMediaEvent** event)
+    {
+        return m_mfMediaSource->GetEvent(flags, event);
+    }
+
+    STDMETHODIMP StreamChoiceSource::BeginGetEvent(IMFAsyncCallback* callback, IUnknown* state)
+    {
+        return m_mfMediaSource->BeginGetEvent(callback, state);
+    }
+
+    STDMETHODIMP StreamChoiceSource::EndGetEvent(IMFAsyncResult* result, IMFMediaEvent** event)
+    {
+        return m_mfMediaSource->EndGetEvent(result, event);
+    }
+
+    STDMETHODIMP StreamChoiceSource::QueueEvent(MediaEventType type,
+                                                REFGUID extendedType,
+                                                HRESULT status,
+                                                const PROPVARIANT* value)
+    {
+        return m_mfMediaSource->QueueEvent(type, extendedType, status, value);
+    }
+
+    STDMETHODIMP StreamChoiceSource::GetCharacteristics(DWORD* characteristics)
+    {
+        return m_mfMediaSource->GetCharacteristics(characteristics);
+    }
+
+    STDMETHODIMP StreamChoiceSource::CreatePresentationDescriptor(IMFPresentationDescriptor** presentationDescriptor)
+    {
+        if (presentationDescriptor == nullptr)
+            return E_POINTER;
+
+        // a copy every time, as media sources do:
+        return m_mfPresentationDescriptor->Clone(presentationDescriptor);
+    }
+
+    STDMETHODIMP StreamChoiceSource::Start(IMFPresentationDescriptor* presentationDescriptor,
+                                           const GUID* timeFormat,
+                                           const PROPVARIANT* startPosition)
+    {
+        return m_mfMediaSource->Start(presentationDescriptor, timeFormat, startPosition);
+    }
+
+    STDMETHODIMP StreamChoiceSource::Stop()
+    {
+        return m_mfMediaSource->Stop();
+    }
+
+    STDMETHODIMP StreamChoiceSource::Pause()
+    {
+        return m_mfMediaSource->Pause();
+    }
+
+    STDMETHODIMP StreamChoiceSource::Shutdown()
+    {
+        return m_mfMediaSource->Shutdown();
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "StreamSelection.hpp"
+
+#include <Windows.h>
+#include <mfidl.h>
+#include <wrl.h>
+
+namespace application
+{
+    using namespace Microsoft::WRL;
+
+    /// <summary>
+    /// Media source that delegates to another one, but whose presentation has the chosen streams
+    /// selected and all others deselected, so that a topology built from it (such as the one of
+    /// MFCreateTranscodeTopologyFromByteStream) has branches for the chosen streams only.
+    /// </summary>
+    class StreamChoiceSource : public IMFMediaSource
+    {
+    private:
+
+        ComPtr<IMFMediaSource> m_mfMediaSource;
+        ComPtr<IMFPresentationDescriptor> m_mfPresentationDescriptor;
+        long m_refCount;
+
+    public:
+
+        /// <summary>
+        /// Creates a new instance.
+        /// </summary>
+        /// <param name="mfMediaSource">The source to delegate to.</param>
+        /// <param name="streamChoice">The streams to select, as indices in the presentation of the source.</param>
+        /// <remarks>Throws <see cref="AppException"/> on failure.</remarks>
+        StreamChoiceSource(const ComPtr<IMFMediaSource>& mfMediaSource, const StreamChoice& streamChoice);
+
+        virtual ~StreamChoiceSource() = default;
+
+        // IUnknown methods
+        STDMETHODIMP QueryInterface(REFIID riid, void** ppv);
+        STDMETHODIMP_(ULONG) AddRef();
+        STDMETHODIMP_(ULONG) Release();
+
+        // IMFMediaEventGenerator methods
+        STDMETHODIMP GetEvent(DWORD flags, IMFMediaEvent** event);
+        STDMETHODIMP BeginGetEvent(IMFAsyncCallback* callback, IUnknown* state);
+        STDMETHODIMP EndGetEvent(IMFAsyncResult* result, IMFMediaEvent** event);
+        STDMETHODIMP QueueEvent(MediaEventType type, REFGUID extendedType, HRESULT status, const PROPVARIANT* value);
+
+        // IMFMediaSource methods
+        STDMETHODIMP GetCharacteristics(DWORD* characteristics);
+        STDMETHODIMP CreatePresentationDescriptor(IMFPresentationDescriptor** presentationDescriptor);
+        STDMETHODIMP Start(IMFPresentationDescriptor* presentationDescriptor,
+                           const GUID* timeFormat,
+                           const PROPVARIANT* startPosition);
+        STDMETHODIMP Stop();
+        STDMETHODIMP Pause();
+        STDMETHODIMP Shutdown();
+    };
+}
@@ -0,0 +1,179 @@
+#include "StreamSelection.hpp"
+#include "AppException.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <string>
+
+namespace application
+{
+    static std::string ToLower(std::string text)
+    {
+        std::transform(text.begin(), text.end(), text.begin(),
+            [](unsigned char ch) { return static_cast<char>(std::tolower(ch)); });
+        return text;
+    }
+
+    /// <summary>
+    /// Gets the primary language subtag, mapping common ISO-639-2 codes to ISO-639-1.
+    /// </summary>
+    static std::string GetPrimaryLanguage(const std::string& language)
+    {
+        std::string primary = ToLower(language.substr(0, language.find_first_of("-_")));
+        if (primary.size() != 3)
+            return primary;
+
+        static const auto codes = std::to_array<std::array<const char*, 2>>({
+            {{ "eng", "en" }}, {{ "deu", "de" }}, {{ "ger", "de" }}, {{ "fra", "fr" }},
+            {{ "fre", "fr" }}, {{ "spa", "es" }}, {{ "ita", "it" }}, {{ "por", "pt" }},
+            {{ "nld", "nl" }}, {{ "dut", "nl" }}, {{ "rus", "ru" }}, {{ "jpn", "ja" }},
+            {{ "zho", "zh" }}, {{ "chi", "zh" }}, {{ "kor", "ko" }}, {{ "pol", "pl" }},
+            {{ "swe", "sv" }}, {{ "tur", "tr" }}, {{ "ara", "ar" }}, {{ "hin", "hi" }}
+        });
+
+        for (const auto& [iso6392, iso6391] : codes)
+        {
+            if (primary == iso6392)
+                return iso6391;
+        }
+        return primary;
+    }
+
+    StreamChoice ChooseStreams(const std::vector<SourceStream>& streams, const StreamSelectionPolicy& policy)
+    {
+        StreamChoice choice;
+        std::vector<size_t> audioStreams;
+
+        for (size_t idx = 0; idx < streams.size(); ++idx)
+        {
+            const SourceStream& stream = streams[idx];
+            if (stream.kind == SourceStream::Kind::Audio)
+            {
+                audioStreams.push_back(idx);
+            }
+            else if (stream.kind == SourceStream::Kind::Video)
+            {
+                if (!choice.video)
+                {
+                    choice.video = idx;
+                    continue;
+                }
+
+                const SourceStream& best = streams[*choice.video];
+                const uint64_t area = static_cast<uint64_t>(stream.width) * stream.height;
+                const uint64_t bestArea = static_cast<uint64_t>(best.width) * best.height;
+                if (area > bestArea || (area == bestArea && stream.bitrate > best.bitrate))
+                    choice.video = idx;
+            }
+        }
+
+        if (policy.audioTrack)
+        {
+            if (*policy.audioTrack >= audioStreams.size())
+            {
+                throw AppException("Source has no audio track #" + std::to_string(*policy.audioTrack)
+                    + " (it has " + std::to_string(audioStreams.size()) + ')');
+            }
+
+            choice.audio = audioStreams[*policy.audioTrack];
+            return choice;
+        }
+
+        if (!policy.audioLanguage.empty())
+        {
+            const std::string language = GetPrimaryLanguage(policy.audioLanguage);
+            auto iter = std::find_if(audioStreams.begin(), audioStreams.end(),
+                [&streams, &language](size_t idx)
+                {
+                    return !streams[idx].language.empty()
+                        && GetPrimaryLanguage(streams[idx].language) == language;
+                });
+
+            if (iter != audioStreams.end())
+            {
+                choice.audio = *iter;
+                return choice;
+            }
+        }
+
+        if (!audioStreams.empty())
+            choice.audio = audioStreams.front();
+
+        return choice;
+    }
+
+    static std::optional<size_t> MapStreamIndex(const std::vector<SourceStream>& streams,
+                                                std::optional<size_t> streamIdx,
+                                                const std::vector<SourceStream>& otherStreams,
+                                                bool byIdentifier)
+    {
+        if (!streamIdx)
+            return std::nullopt;
+
+        const SourceStream& stream = streams.at(*streamIdx);
+        if (byIdentifier)
+        {
+            auto iter = std::find_if(otherStreams.begin(), otherStreams.end(),
+                [&stream](const SourceStream& other) { return other.kind == stream.kind && other.id == stream.id; });
+
+            if (iter != otherStreams.end())
+                return static_cast<size_t>(iter - otherStreams.begin());
+        }
+        else
+        {
+            const auto ordinal = std::count_if(streams.begin(), streams.begin() + *streamIdx,
+                [&stream](const SourceStream& other) { return other.kind == stream.kind; });
+
+            for (size_t otherIdx = 0, count = 0; otherIdx < otherStreams.size(); ++otherIdx)
+            {
+                if (otherStreams[otherIdx].kind == stream.kind && count++ == static_cast<size_t>(ordinal))
+                    return otherIdx;
+            }
+        }
+
+        throw AppException("Chosen source stream #" + std::to_string(*streamIdx)
+            + " not found among the " + std::to_string(otherStreams.size()) + " streams of the media source");
+    }
+
+    StreamChoice MapStreamChoice(const std::vector<SourceStream>& streams,
+                                 const StreamChoice& choice,
+                                 const std::vector<SourceStream>& otherStreams)
+    {
+        // identifiers not shared by the demuxers? then fall back on the order of the streams
+        const bool byIdentifier = std::any_of(streams.begin(), streams.end(),
+            [&otherStreams](const SourceStream& stream)
+            {
+                return std::any_of(otherStreams.begin(), otherStreams.end(),
+                    [&stream](const SourceStream& other) { return other.id == stream.id; });
+            });
+
+        StreamChoice otherChoice;
+        otherChoice.video = MapStreamIndex(streams, choice.video, otherStreams, byIdentifier);
+        otherChoice.audio = MapStreamIndex(streams, choice.audio, otherStreams, byIdentifier);
+        return otherChoice;
+    }
+
+    StreamLayout DescribeStreamLayout(const std::vector<SourceStream>& streams, const StreamChoice& choice)
+    {
+        StreamLayout layout = {};
+        for (const SourceStream& stream : streams)
+        {
+            switch (stream.kind)
+            {
+            case SourceStream::Kind::Video:
+                ++layout.videoCount;
+                break;
+            case SourceStream::Kind::Audio:
+                ++layout.audioCount;
+                break;
+            default:
+                ++layout.otherCount;
+                break;
+            }
+        }
+
+        layout.choice = choice;
+        return layout;
+    }
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cinttypes>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace application
+{
+    /// <summary>
+    /// What is known about a stream of the source when choosing which ones to transcode.
+    /// </summary>
+    struct SourceStream
+    {
+        enum class Kind { Video, Audio, Other };
+
+        Kind kind;
+
+        /// <summary>
+        /// Identifier of the stream in the container (such as the MP4 track ID),
+        /// which stays the same whichever demuxer lists the streams.
+        /// </summary>
+        uint32_t id;
+
+        uint32_t width;
+        uint32_t height;
+
+        /// <summary>Average bitrate (bits/s), or zero when unknown.</summary>
+        uint32_t bitrate;
+
+        /// <summary>Language code (RFC 1766 or ISO-639-2), empty when unknown.</summary>
+        std::string language;
+    };
+
+    /// <summary>
+    /// How to choose the source streams to transcode (the other ones are dropped).
+    /// </summary>
+    struct StreamSelectionPolicy
+    {
+        /// <summary>Preferred audio language (such as "en" or "deu"), or empty for no preference.</summary>
+        std::string audioLanguage;
+
+        /// <summary>Zero-based index among the audio streams, which overrides the language.</summary>
+        std::optional<uint32_t> audioTrack;
+    };
+
+    /// <summary>
+    /// The streams chosen for transcoding, as indexes in the list of source streams.
+    /// </summary>
+    struct StreamChoice
+    {
+        std::optional<size_t> video;
+        std::optional<size_t> audio;
+    };
+
+    /// <summary>
+    /// How many streams of each kind a source has, and which ones are chosen among them.
+    /// </summary>
+    struct StreamLayout
+    {
+        uint32_t videoCount;
+        uint32_t audioCount;
+        uint32_t otherCount;
+        StreamChoice choice;
+    };
+
+    /// <summary>
+    /// Chooses the video stream with the largest picture (then the highest bitrate)
+    /// and the audio stream according to the policy, falling back to the first one.
+    /// </summary>
+    /// <remarks>Throws <see cref="AppException"/> if the requested audio track does not exist.</remarks>
+    StreamChoice ChooseStreams(const std::vector<SourceStream>& streams, const StreamSelectionPolicy& policy);
+
+    /// <summary>
+    /// Maps a choice of streams onto another list of the same streams (such as the one of another
+    /// demuxer), matching them by identifier, or by order among the streams of the same kind
+    /// when the identifiers differ.
+    /// </summary>
+    /// <param name="streams">The streams the choice indexes.</param>
+    /// <param name="choice">The choice to map.</param>
+    /// <param name="otherStreams">The streams to index with the returned choice.</param>
+    /// <remarks>Throws <see cref="AppException"/> if a chosen stream is not in the other list.</remarks>
+    StreamChoice MapStreamChoice(const std::vector<SourceStream>& streams,
+                                 const StreamChoice& choice,
+                                 const std::vector<SourceStream>& otherStreams);
+
+    /// <summary>
+    /// Describes the layout of the source streams, with the streams chosen among them.
+    /// </summary>
+    StreamLayout DescribeStreamLayout(const std::vector<SourceStream>& streams, const StreamChoice& choice);
+}
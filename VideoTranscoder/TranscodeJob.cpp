@@ -0,0 +1,224 @@
+#include "TranscodeJob.hpp"
+
+#include "AppException.hpp"
+
+#include <algorithm>
+#include <sstream>
+
+namespace application
+{
+    using namespace std::chrono;
+
+    /// <summary>
+    /// Feeds the session notifications into the progress tracker,
+    /// relative to the range being transcoded.
+    /// </summary>
+    class TranscodeJob::TrackingObserver : public SessionObserver
+    {
+    private:
+
+        TranscodeJob& m_job;
+        ProgressTracker& m_tracker;
+
+    public:
+
+        TrackingObserver(TranscodeJob& job, ProgressTracker& tracker)
+            : m_job(job)
+            , m_tracker(tracker)
+        {
+        }
+
+        void OnStarted() override
+        {
+            m_tracker.OnStarted();
+        }
+
+        void OnPosition(nanoseconds position, nanoseconds elapsedTime) override
+        {
+            m_tracker.OnPosition(position - m_job.GetRange().start, elapsedTime, m_job.GetBytesWritten());
+            m_job.CheckSize(m_tracker.GetLastSample());
+        }
+    };
+
+    TranscodeSettings TranscodeJob::DecideSettings(MediaBackend& backend,
+                                                   const MediaInfo& sourceInfo,
+                                                   const EncoderSelection& encoderSelection,
+                                                   double targetSizeFactor,
+                                                   milliseconds fragmentDuration,
+                                                   bool hardwareAllowed,
+                                                   uint32_t videoQualityVsSpeed)
+    {
+        const Encoder videoEncoder = encoderSelection.Select(sourceInfo);
+        TranscodeSettings settings =
+            DecideTranscodeSettings(sourceInfo, videoEncoder, targetSizeFactor, fragmentDuration);
+
+        const EncoderRegistry& registry = backend.GetEncoderRegistry();
+        const auto& frameSize = sourceInfo.videoProfile.frameSize;
+
+        // with nothing enumerated, the media session is left to decide by itself:
+        settings.hardwareAllowed = hardwareAllowed
+            && (!registry.Knows(videoEncoder)
+                || registry.HasHardwareEncoder(videoEncoder, frameSize.width, frameSize.height));
+
+        if (videoQualityVsSpeed != 0)
+            settings.videoQualityVsSpeed = std::clamp(videoQualityVsSpeed, 1U, 100U);
+
+        return settings;
+    }
+
+    TranscodeJob::TranscodeJob(
+        MediaBackend& backend,
+        const std::string& inputFName,
+        const std::string& outputFName,
+        const EncoderSelection& videoEncoder,
+        double targetSizeFactor,
+        const std::optional<PresentationRange>& range,
+        milliseconds fragmentDuration,
+        bool hardwareAllowed,
+        uint32_t videoQualityVsSpeed)
+        : m_input(backend.OpenInput(inputFName))
+        , m_duration(m_input->GetDuration())
+        , m_sourceInfo(m_input->GetMediaInfo())
+        , m_settings(DecideSettings(backend, m_sourceInfo, videoEncoder, targetSizeFactor,
+                                    fragmentDuration, hardwareAllowed, videoQualityVsSpeed))
+        , m_range(range)
+        , m_outputFName(outputFName)
+        , m_sizeLimit(0)
+        , m_oversizeProjection(0)
+        , m_observeInterval(0)
+    {
+    }
+
+    TranscodeJob::TranscodeJob(
+        MediaBackend& backend,
+        const std::string& inputFName,
+        const std::string& outputFName,
+        const TranscodeSettings& settings,
+        const std::optional<PresentationRange>& range)
+        : m_input(backend.OpenInput(inputFName))
+        , m_duration(m_input->GetDuration())
+        , m_sourceInfo(m_input->GetMediaInfo())
+        , m_settings(settings)
+        , m_range(range)
+        , m_outputFName(outputFName)
+        , m_sizeLimit(0)
+        , m_oversizeProjection(0)
+        , m_observeInterval(0)
+    {
+    }
+
+    // the session is declared last, hence destroyed before the observer:
+    TranscodeJob::~TranscodeJob() = default;
+
+    PresentationRange TranscodeJob::GetRange() const
+    {
+        return m_range.value_or(PresentationRange{ nanoseconds(0), m_duration });
+    }
+
+    uint64_t TranscodeJob::GetBytesWritten() const
+    {
+        return m_session ? m_session->GetBytesWritten() : 0;
+    }
+
+    void TranscodeJob::Track(ProgressHub& hub, const std::string& jobName, milliseconds interval)
+    {
+        const auto range = GetRange();
+        const auto& frameRate = m_sourceInfo.videoProfile.frameRate;
+
+        m_tracker = std::make_unique<ProgressTracker>(
+            jobName,
+            range.stop - range.start,
+            frameRate.denominator != 0 ? (double)frameRate.numerator / frameRate.denominator : 0.0,
+            hub);
+
+        m_observer = std::make_unique<TrackingObserver>(*this, *m_tracker);
+        m_observeInterval = interval;
+    }
+
+    void TranscodeJob::ExpectSpeed(double speed)
+    {
+        if (m_tracker)
+            m_tracker->SeedSpeed(speed);
+    }
+
+    uint64_t TranscodeJob::EstimateOutputSize(double targetSizeFactor) const
+    {
+        const TranscodeSettings settings =
+            DecideTranscodeSettings(m_sourceInfo, m_settings.videoEncoder, targetSizeFactor);
+        if (settings.streamCopy)
+            return 0;
+
+        const auto range = GetRange();
+        const double rangeSecs = duration<double>(range.stop - range.start).count();
+        return static_cast<uint64_t>(((double)settings.videoAvgBitrate / 8 + settings.audioAvgBytesPerSec) * rangeSecs);
+    }
+
+    void TranscodeJob::LimitSize(uint64_t maxSize)
+    {
+        m_sizeLimit = maxSize;
+    }
+
+    std::optional<uint64_t> TranscodeJob::GetOversizeProjection() const
+    {
+        const uint64_t projection = m_oversizeProjection;
+        return projection != 0 ? std::optional<uint64_t>(projection) : std::nullopt;
+    }
+
+    void TranscodeJob::CheckSize(const ProgressSample& sample)
+    {
+        // the projection is only there once enough of the output has been written:
+        if (m_sizeLimit == 0 || sample.projectedSize <= m_sizeLimit || m_oversizeProjection != 0)
+            return;
+
+        m_oversizeProjection = sample.projectedSize;
+        m_session->Abort();
+    }
+
+    void TranscodeJob::Start()
+    {
+        m_session = m_input->CreateSession(m_sourceInfo, m_settings, m_outputFName, m_range);
+        if (m_observer)
+            m_session->Observe(*m_observer, m_observeInterval);
+
+        m_session->Start();
+    }
+
+    bool TranscodeJob::Wait(milliseconds timeout)
+    {
+        bool finished;
+        try
+        {
+            finished = m_session->Wait(timeout);
+        }
+        catch (...)
+        {
+            if (m_tracker)
+                m_tracker->OnFinished(false, GetBytesWritten());
+
+            if (m_oversizeProjection == 0)
+                throw;
+
+            std::ostringstream oss;
+            oss << "Transcoding aborted at " << static_cast<int>(m_tracker->GetLastSample().progress * 100)
+                << " % because the output was projected to " << m_oversizeProjection / 1000000
+                << " MB, over the limit of " << m_sizeLimit / 1000000 << " MB";
+            throw AppException(oss.str());
+        }
+
+        if (finished && m_tracker)
+            m_tracker->OnFinished(true, GetBytesWritten());
+
+        return finished;
+    }
+
+    double TranscodeJob::GetProgress() const
+    {
+        const auto range = GetRange();
+        const auto length = range.stop - range.start;
+        if (length.count() <= 0 || !m_session)
+            return 0.0;
+
+        const auto position = m_session->GetPosition() - range.start;
+        return std::clamp((double)position.count() / length.count(), 0.0, 1.0);
+    }
+}
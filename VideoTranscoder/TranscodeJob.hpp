@@ -0,0 +1,210 @@
+#pragma once
+
+#include "EncoderSelection.hpp"
+#include "MediaBackend.hpp"
+#include "MediaInfo.hpp"
+#include "ProgressTelemetry.hpp"
+#include "TranscodeSettings.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string>
+
+namespace application
+{
+    /// <summary>
+    /// Everything it takes to transcode one input file into one output file.
+    /// </summary>
+    class TranscodeJob
+    {
+    private:
+
+        class TrackingObserver;
+
+        std::unique_ptr<MediaInput> m_input;
+        const std::chrono::nanoseconds m_duration;
+        const MediaInfo m_sourceInfo;
+        const TranscodeSettings m_settings;
+        const std::optional<PresentationRange> m_range;
+        const std::string m_outputFName;
+        uint64_t m_sizeLimit;
+        std::atomic<uint64_t> m_oversizeProjection;
+        std::unique_ptr<ProgressTracker> m_tracker;
+        std::unique_ptr<TrackingObserver> m_observer;
+        std::chrono::milliseconds m_observeInterval;
+
+        /// <summary>Built when starting, so that nothing is written before.</summary>
+        std::unique_ptr<TranscodeSession> m_session;
+
+        PresentationRange GetRange() const;
+
+        uint64_t GetBytesWritten() const;
+
+        void CheckSize(const ProgressSample& sample);
+
+    public:
+
+        /// <summary>
+        /// How many times a job aborted for size is restarted with a corrected target at most.
+        /// </summary>
+        static constexpr uint32_t maxSizeRetunes = 2;
+
+        /// <summary>
+        /// Decides the settings of a job as the constructor does, sending it to software
+        /// when no hardware encoder in the registry can take it.
+        /// </summary>
+        /// <remarks>See the constructor for the parameters.</remarks>
+        static TranscodeSettings DecideSettings(MediaBackend& backend,
+                                                const MediaInfo& sourceInfo,
+                                                const EncoderSelection& videoEncoder,
+                                                double targetSizeFactor,
+                                                std::chrono::milliseconds fragmentDuration,
+                                                bool hardwareAllowed,
+                                                uint32_t videoQualityVsSpeed);
+
+        /// <summary>
+        /// Creates a new instance, which opens the input and decides the settings
+        /// (the pipeline is only built when starting).
+        /// </summary>
+        /// <param name="backend">The media backend to use.</param>
+        /// <param name="inputFName">The input file (UTF-8 encoded).</param>
+        /// <param name="outputFName">The output MP4 file (UTF-8 encoded).</param>
+        /// <param name="videoEncoder">The video encoder to use, or how to select it for the source.</param>
+        /// <param name="targetSizeFactor">
+        /// The target size of the video output, as a fraction of the source data rate.
+        /// </param>
+        /// <param name="range">The range of the input to transcode, or nothing for the whole of it.</param>
+        /// <param name="fragmentDuration">
+        /// Duration of the fragments in the output, or zero for a regular (non-fragmented) MP4.
+        /// </param>
+        /// <param name="hardwareAllowed">
+        /// Whether the job may run on a hardware encoder, which it does only if
+        /// the machine has one that admits the frame size of the source.
+        /// </param>
+        /// <param name="videoQualityVsSpeed">
+        /// Quality vs speed of the video encoder in [1,100] overriding the decided one, or zero not to.
+        /// </param>
+        TranscodeJob(
+            MediaBackend& backend,
+            const std::string& inputFName,
+            const std::string& outputFName,
+            const EncoderSelection& videoEncoder,
+            double targetSizeFactor,
+            const std::optional<PresentationRange>& range = std::nullopt,
+            std::chrono::milliseconds fragmentDuration = std::chrono::milliseconds(0),
+            bool hardwareAllowed = true,
+            uint32_t videoQualityVsSpeed = 0);
+
+        /// <summary>
+        /// Creates a new instance with settings already decided, such as those shared by all
+        /// segments of one output (which must have the same sample description to be concatenated).
+        /// </summary>
+        /// <param name="backend">The media backend to use.</param>
+        /// <param name="inputFName">The input file (UTF-8 encoded).</param>
+        /// <param name="outputFName">The output MP4 file (UTF-8 encoded).</param>
+        /// <param name="settings">The settings to transcode with, as they are.</param>
+        /// <param name="range">The range of the input to transcode, or nothing for the whole of it.</param>
+        TranscodeJob(
+            MediaBackend& backend,
+            const std::string& inputFName,
+            const std::string& outputFName,
+            const TranscodeSettings& settings,
+            const std::optional<PresentationRange>& range = std::nullopt);
+
+        ~TranscodeJob();
+
+        std::chrono::nanoseconds GetDuration() const
+        {
+            return m_duration;
+        }
+
+        const MediaInfo& GetSourceInfo() const
+        {
+            return m_sourceInfo;
+        }
+
+        const TranscodeSettings& GetSettings() const
+        {
+            return m_settings;
+        }
+
+        /// <summary>
+        /// Tells whether the video is encoded on hardware, which is only
+        /// reliable once the job has started.
+        /// </summary>
+        bool IsHardwareAccelerated() const
+        {
+            return m_session && m_session->IsHardwareAccelerated();
+        }
+
+        /// <summary>
+        /// Gets the name of the video encoder in use once the job has started,
+        /// or an empty string if unknown or if there is none.
+        /// </summary>
+        std::string GetVideoEncoderName() const
+        {
+            return m_session ? m_session->GetVideoEncoderName() : std::string();
+        }
+
+        /// <summary>
+        /// Publishes the progress of this job as it goes, which must be set up before starting.
+        /// </summary>
+        /// <param name="hub">Where the progress samples are published.</param>
+        /// <param name="jobName">How the job is identified to subscribers.</param>
+        /// <param name="interval">How often the progress is reported.</param>
+        void Track(ProgressHub& hub,
+                   const std::string& jobName,
+                   std::chrono::milliseconds interval = std::chrono::milliseconds(500));
+
+        /// <summary>
+        /// Seeds the progress (hence its time estimate) with a predicted speed,
+        /// which can only be done after <see cref="Track"/>.
+        /// </summary>
+        /// <param name="speed">The predicted speed as a multiple of real time.</param>
+        void ExpectSpeed(double speed);
+
+        /// <summary>
+        /// Estimates the size of the output if encoded at a target size factor,
+        /// as a reference to limit its size.
+        /// </summary>
+        /// <returns>The estimate, or zero if the streams are copied without re-encoding.</returns>
+        uint64_t EstimateOutputSize(double targetSizeFactor) const;
+
+        /// <summary>
+        /// Aborts the job once the projected size of its output exceeds a limit,
+        /// which can only be set after <see cref="Track"/> and before starting.
+        /// </summary>
+        /// <param name="maxSize">The limit to the size of the output.</param>
+        void LimitSize(uint64_t maxSize);
+
+        /// <summary>
+        /// Gets the projected size of the output that made the job abort.
+        /// </summary>
+        /// <returns>The projected size, or nothing if the job has not been aborted for size.</returns>
+        std::optional<uint64_t> GetOversizeProjection() const;
+
+        /// <summary>
+        /// Builds the pipeline, which creates the output, and starts transcoding asynchronously.
+        /// </summary>
+        void Start();
+
+        /// <summary>
+        /// Waits for transcoding to finish.
+        /// </summary>
+        /// <param name="timeout">How long to wait at most.</param>
+        /// <returns>Whether transcoding is finished (otherwise timed out).</returns>
+        /// <remarks>
+        /// Throws <see cref="AppException"/> if transcoding has failed or has been aborted for size.
+        /// When tracked, the outcome is published as well.
+        /// </remarks>
+        bool Wait(std::chrono::milliseconds timeout);
+
+        /// <summary>
+        /// Gets the progress of transcoding.
+        /// </summary>
+        /// <returns>The progress within range [0,1], relative to the range to transcode.</returns>
+        double GetProgress() const;
+    };
+}
@@ -1,61 +1,19 @@
 #include "stdafx.h"
 #include "TranscodeProfile.hpp"
 
-#include <array>
 #include <codecapi.h>
 #include <iomanip>
-#include <iostream>
+#include <sstream>
 
 #include "AppException.hpp"
+#include "CodecLevels.hpp"
+#include "JobConsole.hpp"
 
 namespace application
 {
-    /// <summary>
-    /// Estimates a value for the "quality vs speed" configurable parameter for the encoders.
-    /// </summary>
-    /// <remarks>
-    /// In order to maintain good quality, the calculation has been based
-    /// on empirical data of real videos using the H.264 encoder.
-    /// </remarks>
-    /// <returns>An integer in [1,100] for the "quality vs speed" parameter.</returns>
-    static uint32_t EstimateBalanceQualityVsSpeed(
-        const MediaInfo::VideoProfile& videoInfo, double targetSizeFactor)
-    {
-        // calculate Bps/pixel:
-        const auto rpp =
-            static_cast<float> (videoInfo.avgBitrate / 8)
-            / (videoInfo.frameSize.width * videoInfo.frameSize.height);
-
-        // The smaller the output has to be, the greater is the encoding complexity to maintain quality.
-        // Moreover, take into consideration that when the input is already efficiently encoded (empiric
-        // data points to Bps/pixel around 0.5), the complexity is from start expected to be high:
-        _ASSERTE(targetSizeFactor > 0.0 && targetSizeFactor <= 1.0);
-        if (rpp > 0)
-        {
-            auto complexity = static_cast<uint32_t> (67 + (1 - targetSizeFactor) * 100 * rpp);
-            return std::min(100U, complexity);
-        }
-        else
-            return 80U;
-    }
-
-    static uint32_t CalculateAudioTargetBps(const MediaInfo::AudioProfile& sourceInfo)
-    {
-        // Find a possibly lower data rate for the audio stream:
-        const auto enumBpsVals = std::to_array<uint32_t>({ 12000, 16000, 20000, 24000 });
-        auto iterEnumBps =
-            std::lower_bound(enumBpsVals.begin(), enumBpsVals.end(), sourceInfo.avgBytesPerSec);
-
-        if (iterEnumBps != enumBpsVals.begin()
-            && (*iterEnumBps != sourceInfo.avgBytesPerSec || *iterEnumBps > 16000))
-        {
-            --iterEnumBps;
-        }
-
-        return *iterEnumBps;
-    }
-
-    static ComPtr<IMFAttributes> CreateAudioProfileAttributes(const MediaInfo::AudioProfile& sourceInfo)
+    static ComPtr<IMFAttributes> CreateAudioProfileAttributes(
+        const MediaInfo::AudioProfile& sourceInfo,
+        const TranscodeSettings& settings)
     {
         ComPtr<IMFAttributes> attributes;
 
@@ -77,27 +35,34 @@ namespace application
         CHECK("set audio block alignment",
             attributes->SetUINT32(MF_MT_AUDIO_BLOCK_ALIGNMENT, 1));
 
-        uint32_t avgBps = CalculateAudioTargetBps(sourceInfo);
         CHECK("set audio avg Bps",
-            attributes->SetUINT32(MF_MT_AUDIO_AVG_BYTES_PER_SECOND, avgBps));
+            attributes->SetUINT32(MF_MT_AUDIO_AVG_BYTES_PER_SECOND, settings.audioAvgBytesPerSec));
 
         CHECK("set audio quality vs speed",
             attributes->SetUINT32(MF_TRANSCODE_QUALITYVSSPEED, 80));
 
+        if (settings.audioCopy)
+        {
+            std::ostringstream oss;
+            oss << "Source audio is already AAC at "
+                << std::fixed << std::setprecision(1) << ((float)settings.audioAvgBytesPerSec / 1024)
+                << " KB/s: it will be copied without re-encoding";
+            PrintJobMessage(oss.str());
+        }
+
         return attributes;
     }
 
     static ComPtr<IMFAttributes> CreateVideoProfileAttributes(
         const MediaInfo::VideoProfile& sourceInfo,
-        Encoder encoder,
-        double targetSizeFactor)
+        const TranscodeSettings& settings)
     {
         ComPtr<IMFAttributes> attributes;
 
         CHECK("create attributes for video profile",
             MFCreateAttributes(attributes.GetAddressOf(), 6));
 
-        switch (encoder)
+        switch (settings.videoEncoder)
         {
         case Encoder::H264_AVC:
             CHECK("set video encoder", attributes->SetGUID(MF_MT_SUBTYPE, MFVideoFormat_H264));
@@ -110,7 +75,8 @@ namespace application
             CHECK("set video encoder", attributes->SetGUID(MF_MT_SUBTYPE, MFVideoFormat_HEVC));
 
             CHECK("set video encoder profile",
-                attributes->SetUINT32(MF_MT_VIDEO_PROFILE, eAVEncH265VProfile_Main_420_8));
+                attributes->SetUINT32(MF_MT_VIDEO_PROFILE,
+                    settings.videoBitDepth > 8 ? eAVEncH265VProfile_Main_420_10 : eAVEncH265VProfile_Main_420_8));
 
             CHECK("set video interlace mode",
                 attributes->SetUINT32(MF_MT_INTERLACE_MODE, MFVideoInterlace_Progressive));
@@ -120,13 +86,29 @@ namespace application
             CHECK("set video encoder", attributes->SetGUID(MF_MT_SUBTYPE, MFVideoFormat_AV1));
 
             CHECK("set video encoder profile",
-                attributes->SetUINT32(MF_MT_VIDEO_PROFILE, eAVEncAV1VProfile_Main_420_8));
+                attributes->SetUINT32(MF_MT_VIDEO_PROFILE,
+                    settings.videoBitDepth > 8 ? eAVEncAV1VProfile_Main_420_10 : eAVEncAV1VProfile_Main_420_8));
             break;
 
         default:
             throw AppException("Encoder is not supported!");
         }
 
+        if (settings.videoLevel != 0)
+        {
+            PrintJobMessage(std::string("Video encoder level set to ")
+                + GetCodecLevelName(settings.videoEncoder, settings.videoLevel));
+
+            // same attribute as MF_MT_MPEG2_LEVEL, in which H.264 levels are also set:
+            CHECK("set video encoder level",
+                attributes->SetUINT32(MF_MT_VIDEO_LEVEL, settings.videoLevel));
+        }
+
+        if (settings.videoBitDepth > 8)
+        {
+            PrintJobMessage("Source video has more than 8 bits per sample: encoding with a 10-bit profile");
+        }
+
         CHECK("set video frame size",
             MFSetAttributeSize(attributes.Get(), MF_MT_FRAME_SIZE,
                 sourceInfo.frameSize.width, sourceInfo.frameSize.height));
@@ -135,19 +117,35 @@ namespace application
             MFSetAttributeRatio(attributes.Get(), MF_MT_FRAME_RATE,
                 sourceInfo.frameRate.numerator, sourceInfo.frameRate.denominator));
 
-        const auto videoAvgBitrate =
-            static_cast<uint32_t> (sourceInfo.avgBitrate * targetSizeFactor);
+        const uint32_t videoAvgBitrate = settings.videoAvgBitrate;
 
-        std::cout << std::endl
-            << "Targeted video data rate is "
-            << std::fixed << std::setprecision(1) << ((float)videoAvgBitrate / (8 * 1024))
-            << " KB/s" << std::endl;
+        std::ostringstream oss;
+        oss << "Targeted video data rate is "
+            << std::fixed << std::setprecision(1) << ((float)videoAvgBitrate / (8 * 1024)) << " KB/s";
+        PrintJobMessage(oss.str());
 
         CHECK("set video bitrate",
             attributes->SetUINT32(MF_MT_AVG_BITRATE, videoAvgBitrate));
 
-        uint32_t qvs = EstimateBalanceQualityVsSpeed(sourceInfo, targetSizeFactor);
-        std::cout << std::endl << "Encoder 'quality vs. speed' set to " << qvs << '%' << std::endl;
+        if (settings.videoPeakBitrate != 0)
+        {
+            oss.str(std::string());
+            oss << "Peak video data rate limited to "
+                << std::fixed << std::setprecision(1) << ((float)settings.videoPeakBitrate / (8 * 1024)) << " KB/s";
+            PrintJobMessage(oss.str());
+
+            CHECK("set video peak bitrate",
+                attributes->SetUINT32(CODECAPI_AVEncCommonMaxBitRate, settings.videoPeakBitrate));
+        }
+
+        if (settings.videoGopSize != 0)
+        {
+            CHECK("set video GOP size",
+                attributes->SetUINT32(CODECAPI_AVEncMPVGOPSize, settings.videoGopSize));
+        }
+
+        const uint32_t qvs = settings.videoQualityVsSpeed;
+        PrintJobMessage("Encoder 'quality vs. speed' set to " + std::to_string(qvs) + '%');
         CHECK("set video quality vs speed",
             attributes->SetUINT32(MF_TRANSCODE_QUALITYVSSPEED, qvs));
 
@@ -156,20 +154,18 @@ namespace application
 
     TranscodeProfile::TranscodeProfile(
         const MediaInfo& sourceInfo,
-        Encoder videoEncoder,
-        double targetSizeFactor)
+        const TranscodeSettings& settings)
     {
         CHECK("create transcode profile",
             MFCreateTranscodeProfile(m_transcodeProfile.GetAddressOf()));
 
         ComPtr<IMFAttributes> audioAttrs =
-            CreateAudioProfileAttributes(sourceInfo.audioProfile);
+            CreateAudioProfileAttributes(sourceInfo.audioProfile, settings);
 
         CHECK("set audio profile", m_transcodeProfile->SetAudioAttributes(audioAttrs.Get()));
 
         ComPtr<IMFAttributes> videoAttrs =
-            CreateVideoProfileAttributes(
-                sourceInfo.videoProfile, videoEncoder, targetSizeFactor);
+            CreateVideoProfileAttributes(sourceInfo.videoProfile, settings);
 
         CHECK("set video profile", m_transcodeProfile->SetVideoAttributes(videoAttrs.Get()));
 
@@ -177,13 +173,29 @@ namespace application
         CHECK("create container attributes",
             MFCreateAttributes(container.GetAddressOf(), 1));
 
-        CHECK("set container type",
-            container->SetGUID(MF_TRANSCODE_CONTAINERTYPE, MFTranscodeContainerType_MPEG4));
+        if (settings.fragmentDuration.count() > 0)
+        {
+            std::ostringstream oss;
+            oss << "Output is fragmented MP4, with a fragment (and key frame) every "
+                << std::fixed << std::setprecision(1) << settings.fragmentDuration.count() / 1000.0 << " s";
+            PrintJobMessage(oss.str());
+
+            CHECK("set container type",
+                container->SetGUID(MF_TRANSCODE_CONTAINERTYPE, MFTranscodeContainerType_FMPEG4));
+        }
+        else
+        {
+            CHECK("set container type",
+                container->SetGUID(MF_TRANSCODE_CONTAINERTYPE, MFTranscodeContainerType_MPEG4));
+        }
 
-        // allow hardware acceleration:
+        // allow hardware acceleration, unless the job has been placed on software:
         CHECK("set topology mode",
             container->SetUINT32(
-                MF_TRANSCODE_TOPOLOGYMODE, MF_TRANSCODE_TOPOLOGYMODE_HARDWARE_ALLOWED));
+                MF_TRANSCODE_TOPOLOGYMODE,
+                settings.hardwareAllowed
+                    ? MF_TRANSCODE_TOPOLOGYMODE_HARDWARE_ALLOWED
+                    : MF_TRANSCODE_TOPOLOGYMODE_SOFTWARE_ONLY));
 
         CHECK("set container", m_transcodeProfile->SetContainerAttributes(container.Get()));
     }
@@ -2,8 +2,8 @@
 
 #include <wrl.h>
 
-#include "Encoder.hpp"
 #include "MediaInfo.hpp"
+#include "TranscodeSettings.hpp"
 
 namespace application
 {
@@ -24,14 +24,10 @@ namespace application
 		/// Create new instance.
 		/// </summary>
 		/// <param name="sourceInfo">Media source information.</param>
-		/// <param name="videoEncoder">The video encoder to use.</param>
-		/// <param name="targetSizeFactor">
-		/// The target size of the video output, as a fraction of the source data rate.
-		/// </param>
+		/// <param name="settings">The encoding parameters decided for the job.</param>
 		TranscodeProfile(
 			const MediaInfo& sourceInfo,
-			Encoder videoEncoder,
-			double targetSizeFactor);
+			const TranscodeSettings& settings);
 
 		const ComPtr<IMFTranscodeProfile>& GetMfObject() const
 		{
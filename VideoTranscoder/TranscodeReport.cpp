@@ -0,0 +1,236 @@
+#include "TranscodeReport.hpp"
+
+#include "AtomicFile.hpp"
+#include "CodecLevels.hpp"
+#include "JsonWriter.hpp"
+#include "Mp4Probe.hpp"
+#include "Utf8Path.hpp"
+
+#ifdef _WIN32
+#   define WIN32_LEAN_AND_MEAN
+#   define NOMINMAX
+#   include <windows.h>
+#   include <psapi.h>
+#else
+#   include <sys/resource.h>
+#endif
+
+#include <filesystem>
+
+namespace application
+{
+    using namespace std::chrono;
+
+    /// <summary>
+    /// Gets the peak of memory usage by this process so far (in bytes), or zero if unknown.
+    /// </summary>
+    static uint64_t GetPeakResidentSetSize()
+    {
+#ifdef _WIN32
+        PROCESS_MEMORY_COUNTERS counters;
+        if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof counters))
+            return 0;
+
+        return counters.PeakWorkingSetSize;
+#else
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) != 0)
+            return 0;
+
+#   ifdef __APPLE__
+        return usage.ru_maxrss;
+#   else
+        return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#   endif
+#endif
+    }
+
+    static std::optional<uint64_t> GetFileSize(const std::string& fileName)
+    {
+        std::error_code error;
+        const auto fileSize = std::filesystem::file_size(ToPath(fileName), error);
+        if (error)
+            return std::nullopt;
+
+        return fileSize;
+    }
+
+    static double ToSeconds(nanoseconds time)
+    {
+        return duration<double>(time).count();
+    }
+
+    static void WriteFileSize(JsonWriter& json, const char* key, const std::optional<uint64_t>& fileSize)
+    {
+        if (fileSize)
+            json.Write(key, *fileSize);
+        else
+            json.WriteNull(key);
+    }
+
+    static void WriteSourceInfo(JsonWriter& json, const MediaInfo& sourceInfo)
+    {
+        const auto& video = sourceInfo.videoProfile;
+        const auto& audio = sourceInfo.audioProfile;
+
+        json.BeginObject("source");
+
+        json.BeginObject("video")
+            .Write("format", video.format ? GetEncoderName(*video.format) : "other")
+            .Write("width", video.frameSize.width)
+            .Write("height", video.frameSize.height)
+            .Write("frame_rate", video.frameRate.denominator != 0
+                ? (double)video.frameRate.numerator / video.frameRate.denominator : 0.0)
+            .Write("avg_bitrate", video.avgBitrate)
+            .Write("peak_bitrate", video.peakBitrate);
+
+        if (video.coding)
+        {
+            json.BeginObject("coding")
+                .Write("profile_idc", video.coding->profileIdc)
+                .Write("level_idc", video.coding->levelIdc)
+                .Write("high_tier", video.coding->highTier)
+                .Write("chroma_format_idc", video.coding->chromaFormatIdc)
+                .Write("bit_depth_luma", video.coding->bitDepthLuma)
+                .Write("bit_depth_chroma", video.coding->bitDepthChroma)
+                .Write("progressive", video.coding->progressive)
+                .Write("transfer_characteristics", video.coding->transferCharacteristics)
+                .EndObject();
+        }
+        json.EndObject();
+
+        json.BeginObject("audio")
+            .Write("aac", audio.isAac)
+            .Write("bits_per_sample", audio.bitsPerSample)
+            .Write("samples_per_sec", audio.samplesPerSec)
+            .Write("num_channels", audio.numChannels)
+            .Write("avg_bytes_per_sec", audio.avgBytesPerSec)
+            .EndObject();
+
+        json.EndObject();
+    }
+
+    static void WriteSettings(JsonWriter& json, const TranscodeSettings& settings)
+    {
+        json.BeginObject("settings")
+            .Write("stream_copy", settings.streamCopy)
+            .Write("audio_copy", settings.audioCopy)
+            .Write("video_avg_bitrate", settings.videoAvgBitrate)
+            .Write("video_peak_bitrate", settings.videoPeakBitrate)
+            .Write("quality_vs_speed", settings.videoQualityVsSpeed)
+            .Write("audio_avg_bytes_per_sec", settings.audioAvgBytesPerSec)
+            .Write("fragment_duration_s", settings.fragmentDuration.count() / 1000.0)
+            .Write("video_gop_size", settings.videoGopSize)
+            .Write("video_bit_depth", settings.videoBitDepth)
+            .Write("video_level", settings.videoLevel != 0
+                ? GetCodecLevelName(settings.videoEncoder, settings.videoLevel) : "auto")
+            .EndObject();
+    }
+
+    static void WritePrediction(JsonWriter& json, const JobPrediction& prediction)
+    {
+        json.BeginObject("prediction")
+            .Write("excerpt_count", prediction.excerptCount)
+            .Write("bitrate_ratio", prediction.bitrateRatio)
+            .Write("speed", prediction.speed)
+            .Write("corrected_size_factor", prediction.correctedSizeFactor)
+            .Write("quality_vs_speed", prediction.videoQualityVsSpeed)
+            .Write("output_size_bytes", prediction.outputSize)
+            .Write("compression_ratio", prediction.compressionRatio)
+            .Write("encode_time_s", ToSeconds(prediction.encodeTime))
+            .Write("misses_size_target", prediction.missesSizeTarget)
+            .Write("misses_time_budget", prediction.missesTimeBudget)
+            .EndObject();
+    }
+
+    std::string GetTranscodeReportFName(const std::string& reportPath, const std::string& outputFName)
+    {
+        const std::filesystem::path outputPath = ToPath(outputFName);
+        std::filesystem::path reportFName = outputPath.stem();
+        reportFName += ".report.json";
+
+        if (reportPath.empty())
+            return ToUtf8(outputPath.parent_path() / reportFName);
+
+        std::error_code error;
+        if (std::filesystem::is_directory(ToPath(reportPath), error))
+            return ToUtf8(ToPath(reportPath) / reportFName);
+
+        return reportPath;
+    }
+
+    void WriteTranscodeReport(const TranscodeReport& report, const std::string& reportFName)
+    {
+        const std::optional<uint64_t> inputSize = GetFileSize(report.inputFName);
+        std::optional<uint64_t> outputSize;
+        if (report.succeeded)
+            outputSize = GetFileSize(report.outputFName);
+
+        JsonWriter json(true);
+        json.BeginObject()
+            .Write("input", report.inputFName)
+            .Write("output", report.outputFName)
+            .Write("succeeded", report.succeeded);
+
+        if (report.succeeded)
+            json.WriteNull("error");
+        else
+            json.Write("error", report.errorMessage);
+
+        json.Write("encoder", GetEncoderName(report.videoEncoder))
+            .Write("hardware_accelerated", report.hardwareAccelerated);
+
+        if (report.videoEncoderName.empty())
+            json.WriteNull("video_encoder_name");
+        else
+            json.Write("video_encoder_name", report.videoEncoderName);
+
+        json.Write("requested_size_factor", report.requestedSizeFactor)
+            .Write("reencoded_segments", report.reencodedSegmentCount)
+            .Write("size_retunes", report.sizeRetuneCount)
+            .Write("from_output_cache", report.fromOutputCache);
+
+        // achieved by the video stream, as requested:
+        const auto outputVideoBitrate =
+            report.succeeded ? ProbeVideoBitrate(report.outputFName) : std::nullopt;
+
+        if (outputVideoBitrate && report.sourceInfo && report.sourceInfo->videoProfile.avgBitrate != 0)
+            json.Write("achieved_size_factor", (double)*outputVideoBitrate / report.sourceInfo->videoProfile.avgBitrate);
+        else
+            json.WriteNull("achieved_size_factor");
+
+        WriteFileSize(json, "input_size_bytes", inputSize);
+        WriteFileSize(json, "output_size_bytes", outputSize);
+
+        if (inputSize && outputSize && *inputSize != 0)
+            json.Write("output_to_input_size_ratio", (double)*outputSize / *inputSize);
+        else
+            json.WriteNull("output_to_input_size_ratio");
+
+        json.Write("media_duration_s", ToSeconds(report.mediaDuration))
+            .Write("wall_time_s", ToSeconds(report.wallTime));
+
+        if (report.succeeded && report.wallTime.count() > 0)
+            json.Write("speed", (double)report.mediaDuration.count() / report.wallTime.count());
+        else
+            json.WriteNull("speed");
+
+        // of the whole process, so shared by the jobs running concurrently:
+        json.Write("peak_rss_bytes", GetPeakResidentSetSize());
+
+        if (report.sourceInfo)
+            WriteSourceInfo(json, *report.sourceInfo);
+
+        if (report.settings)
+            WriteSettings(json, *report.settings);
+
+        if (report.prediction)
+            WritePrediction(json, *report.prediction);
+        else
+            json.WriteNull("prediction");
+
+        json.EndObject();
+
+        WriteFileAtomically(reportFName, json.GetText() + '\n');
+    }
+}
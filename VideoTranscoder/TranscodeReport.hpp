@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Encoder.hpp"
+#include "JobPrediction.hpp"
+#include "MediaInfo.hpp"
+#include "TranscodeSettings.hpp"
+
+#include <chrono>
+#include <optional>
+#include <string>
+
+namespace application
+{
+    /// <summary>
+    /// The outcome of a job, to be reported in machine-readable form.
+    /// </summary>
+    struct TranscodeReport
+    {
+        std::string inputFName;
+        std::string outputFName;
+        Encoder videoEncoder;
+        double requestedSizeFactor;
+
+        bool succeeded;
+        std::string errorMessage;
+
+        /// <summary>Information about the source, if the job got that far.</summary>
+        std::optional<MediaInfo> sourceInfo;
+
+        /// <summary>The decided encoding parameters, if the job got that far.</summary>
+        std::optional<TranscodeSettings> settings;
+
+        /// <summary>How many segments were re-encoded for exceeding the target bitrate.</summary>
+        uint32_t reencodedSegmentCount;
+
+        /// <summary>How many times the job was restarted with a corrected target for exceeding the size guard.</summary>
+        uint32_t sizeRetuneCount;
+
+        /// <summary>Whether the output was taken from the output cache instead of transcoding.</summary>
+        bool fromOutputCache;
+
+        /// <summary>What was predicted from excerpts before the job, if requested and possible.</summary>
+        std::optional<JobPrediction> prediction;
+
+        bool hardwareAccelerated;
+
+        /// <summary>The video encoder in use, or empty if unknown or if there was none.</summary>
+        std::string videoEncoderName;
+
+        std::chrono::nanoseconds mediaDuration;
+        std::chrono::nanoseconds wallTime;
+    };
+
+    /// <summary>
+    /// Decides where to write the report of a job.
+    /// </summary>
+    /// <param name="reportPath">
+    /// Requested location: empty for next to the output, a directory, or a file.
+    /// </param>
+    /// <param name="outputFName">The output of the job (UTF-8 encoded).</param>
+    /// <returns>The report file (UTF-8 encoded).</returns>
+    std::string GetTranscodeReportFName(const std::string& reportPath, const std::string& outputFName);
+
+    /// <summary>
+    /// Writes the report of a job as a JSON file, replaced atomically. Besides the given
+    /// data, it has the sizes of input and output, the size factor achieved by the output
+    /// video stream and the peak memory usage of the process.
+    /// </summary>
+    /// <param name="report">The outcome of the job.</param>
+    /// <param name="reportFName">The report file (UTF-8 encoded).</param>
+    /// <remarks>Throws <see cref="AppException"/> on failure.</remarks>
+    void WriteTranscodeReport(const TranscodeReport& report, const std::string& reportFName);
+}
@@ -0,0 +1,194 @@
+#include "TranscodeSettings.hpp"
+#include "CodecLevels.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+
+namespace application
+{
+    /// <summary>
+    /// Estimates a value for the "quality vs speed" configurable parameter for the encoders.
+    /// </summary>
+    /// <remarks>
+    /// In order to maintain good quality, the calculation has been based
+    /// on empirical data of real videos using the H.264 encoder.
+    /// </remarks>
+    /// <returns>An integer in [1,100] for the "quality vs speed" parameter.</returns>
+    static uint32_t EstimateBalanceQualityVsSpeed(
+        const MediaInfo::VideoProfile& videoInfo, double targetSizeFactor)
+    {
+        // calculate Bps/pixel:
+        const auto rpp =
+            static_cast<float> (videoInfo.avgBitrate / 8)
+            / (videoInfo.frameSize.width * videoInfo.frameSize.height);
+
+        // The smaller the output has to be, the greater is the encoding complexity to maintain quality.
+        // Moreover, take into consideration that when the input is already efficiently encoded (empiric
+        // data points to Bps/pixel around 0.5), the complexity is from start expected to be high:
+        assert(targetSizeFactor > 0.0 && targetSizeFactor <= 1.0);
+        if (rpp > 0)
+        {
+            auto complexity = static_cast<uint32_t> (67 + (1 - targetSizeFactor) * 100 * rpp);
+            return std::min(100U, complexity);
+        }
+        else
+            return 80U;
+    }
+
+    static uint32_t CalculateAudioTargetBps(const MediaInfo::AudioProfile& sourceInfo)
+    {
+        // Find a possibly lower data rate for the audio stream:
+        const auto enumBpsVals = std::to_array<uint32_t>({ 12000, 16000, 20000, 24000 });
+        auto iterEnumBps =
+            std::lower_bound(enumBpsVals.begin(), enumBpsVals.end(), sourceInfo.avgBytesPerSec);
+
+        if (iterEnumBps == enumBpsVals.end())
+            --iterEnumBps;
+        else if (iterEnumBps != enumBpsVals.begin()
+            && (*iterEnumBps != sourceInfo.avgBytesPerSec || *iterEnumBps > 16000))
+        {
+            --iterEnumBps;
+        }
+
+        return *iterEnumBps;
+    }
+
+    /// <summary>
+    /// Chooses the bit depth of the output, keeping the high bit depth of a source
+    /// when the encoder has a profile for it (HEVC Main 10, AV1 Main).
+    /// </summary>
+    static uint32_t DecideVideoBitDepth(const MediaInfo::VideoProfile& videoInfo, Encoder videoEncoder)
+    {
+        if (!videoInfo.coding || videoInfo.coding->bitDepthLuma <= 8 || videoEncoder == Encoder::H264_AVC)
+            return 8;
+
+        return 10;
+    }
+
+    /// <summary>
+    /// Tells whether the coding of the source (when known) is within what the encoder would produce:
+    /// 4:2:0 chroma in progressive frames, with a bit depth the output profile has.
+    /// </summary>
+    static bool IsCodingLikeOutput(const MediaInfo::VideoProfile& videoInfo, const TranscodeSettings& settings)
+    {
+        if (!videoInfo.coding)
+            return true;
+
+        const auto& coding = *videoInfo.coding;
+        return coding.chromaFormatIdc == 1
+            && coding.progressive
+            && coding.bitDepthLuma <= settings.videoBitDepth
+            && coding.bitDepthChroma <= settings.videoBitDepth;
+    }
+
+    /// <summary>
+    /// Data rate per pixel of a video that is already efficiently encoded (Bps/pixel),
+    /// from the same empirical data as <see cref="EstimateBalanceQualityVsSpeed"/>.
+    /// </summary>
+    static constexpr double efficientBytesPerSecPerPixel = 0.5;
+
+    /// <summary>
+    /// Gets the absolute target of the video bitrate: the target size factor applied to the bitrate
+    /// of an efficient encoding of the picture, rather than to the bitrate of the source.
+    /// </summary>
+    static double GetAbsoluteVideoTarget(const MediaInfo::VideoProfile& videoInfo, double targetSizeFactor)
+    {
+        const double pixelCount = (double)videoInfo.frameSize.width * videoInfo.frameSize.height;
+        return 8 * efficientBytesPerSecPerPixel * pixelCount * targetSizeFactor;
+    }
+
+    /// <summary>
+    /// Tells whether the source already is what re-encoding would produce.
+    /// </summary>
+    static bool IsStreamCopyEnough(const MediaInfo& sourceInfo, const TranscodeSettings& settings)
+    {
+        const auto& videoInfo = sourceInfo.videoProfile;
+        const auto& audioInfo = sourceInfo.audioProfile;
+
+        // Besides video in the requested format, the source must be within the requested size
+        // or already under the absolute target, as re-encoding a video that lean only loses quality.
+        // The audio can be none or AAC (as MP4 needs):
+        return videoInfo.format == settings.videoEncoder
+            && IsCodingLikeOutput(videoInfo, settings)
+            && videoInfo.avgBitrate != 0
+            && (videoInfo.avgBitrate <= settings.videoAvgBitrate
+                || videoInfo.avgBitrate <= GetAbsoluteVideoTarget(videoInfo, settings.targetSizeFactor))
+            && (audioInfo.numChannels == 0 || audioInfo.isAac);
+    }
+
+    TranscodeSettings DecideTranscodeSettings(
+        const MediaInfo& sourceInfo,
+        Encoder videoEncoder,
+        double targetSizeFactor,
+        std::chrono::milliseconds fragmentDuration)
+    {
+        TranscodeSettings settings = {};
+        settings.videoEncoder = videoEncoder;
+        settings.targetSizeFactor = targetSizeFactor;
+        settings.hardwareAllowed = true;
+
+        settings.videoAvgBitrate =
+            static_cast<uint32_t> (sourceInfo.videoProfile.avgBitrate * targetSizeFactor);
+
+        // keep the burstiness of the source, scaled to the target:
+        const auto& videoInfo = sourceInfo.videoProfile;
+        if (videoInfo.peakBitrate > videoInfo.avgBitrate)
+        {
+            settings.videoPeakBitrate =
+                static_cast<uint32_t> (videoInfo.peakBitrate * targetSizeFactor);
+        }
+
+        // the lowest level that admits the stream, so the encoder neither rejects it nor over-allocates:
+        if (videoInfo.frameRate.denominator != 0)
+        {
+            const LevelDemand demand{
+                videoInfo.frameSize.width,
+                videoInfo.frameSize.height,
+                (double)videoInfo.frameRate.numerator / videoInfo.frameRate.denominator,
+                std::max(settings.videoAvgBitrate, settings.videoPeakBitrate)
+            };
+            settings.videoLevel = SelectCodecLevel(videoEncoder, demand);
+        }
+
+        settings.videoQualityVsSpeed =
+            EstimateBalanceQualityVsSpeed(sourceInfo.videoProfile, targetSizeFactor);
+
+        const auto& audioInfo = sourceInfo.audioProfile;
+        settings.audioAvgBytesPerSec = CalculateAudioTargetBps(audioInfo);
+
+        if (audioInfo.isAac && audioInfo.avgBytesPerSec != 0
+            && audioInfo.avgBytesPerSec <= settings.audioAvgBytesPerSec)
+        {
+            settings.audioCopy = true;
+            settings.audioAvgBytesPerSec = audioInfo.avgBytesPerSec;
+        }
+
+        settings.videoBitDepth = DecideVideoBitDepth(videoInfo, videoEncoder);
+        settings.streamCopy = IsStreamCopyEnough(sourceInfo, settings);
+
+        // fragments can only end at key frames, so place one at every fragment boundary:
+        settings.fragmentDuration = fragmentDuration;
+        const auto& frameRate = videoInfo.frameRate;
+        if (fragmentDuration.count() > 0 && frameRate.denominator != 0)
+        {
+            const double framesPerFragment =
+                fragmentDuration.count() * (double)frameRate.numerator / (1000.0 * frameRate.denominator);
+
+            settings.videoGopSize = std::max(1U, static_cast<uint32_t> (framesPerFragment + 0.5));
+        }
+
+        return settings;
+    }
+
+    TranscodeSettings RetargetVideoBitrates(const TranscodeSettings& settings, double targetSizeFactor)
+    {
+        TranscodeSettings retargeted = settings;
+        retargeted.targetSizeFactor = targetSizeFactor;
+
+        const double scale = targetSizeFactor / settings.targetSizeFactor;
+        retargeted.videoAvgBitrate = static_cast<uint32_t> (settings.videoAvgBitrate * scale);
+        retargeted.videoPeakBitrate = static_cast<uint32_t> (settings.videoPeakBitrate * scale);
+        return retargeted;
+    }
+}
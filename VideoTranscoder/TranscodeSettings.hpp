@@ -0,0 +1,93 @@
+#pragma once
+
+#include "Encoder.hpp"
+#include "MediaInfo.hpp"
+
+#include <chrono>
+#include <cinttypes>
+
+namespace application
+{
+    /// <summary>
+    /// The encoding parameters decided for a job, independently of the media backend.
+    /// </summary>
+    struct TranscodeSettings
+    {
+        Encoder videoEncoder;
+        double targetSizeFactor;
+
+        /// <summary>
+        /// Whether the streams are copied into the output as they are, because re-encoding
+        /// would not make the video smaller, or the source is already leaner than the target
+        /// applied to an efficient encoding of the picture (so the encoding parameters below do not apply).
+        /// </summary>
+        bool streamCopy;
+
+        /// <summary>Average bitrate of the output video stream (bits/s).</summary>
+        uint32_t videoAvgBitrate;
+
+        /// <summary>Peak bitrate allowed to the output video stream (bits/s), or zero for no constraint.</summary>
+        uint32_t videoPeakBitrate;
+
+        /// <summary>The "quality vs speed" parameter for the video encoder, in [1,100].</summary>
+        uint32_t videoQualityVsSpeed;
+
+        /// <summary>Average data rate of the output audio stream (bytes/s).</summary>
+        uint32_t audioAvgBytesPerSec;
+
+        /// <summary>
+        /// Whether the audio stream is copied as it is, because the source
+        /// already is AAC with data rate not above the target.
+        /// </summary>
+        bool audioCopy;
+
+        /// <summary>
+        /// Duration of the fragments of the output (fragmented MP4), or zero for a regular MP4.
+        /// </summary>
+        std::chrono::milliseconds fragmentDuration;
+
+        /// <summary>Frames between video key frames, or zero to leave it to the encoder.</summary>
+        uint32_t videoGopSize;
+
+        /// <summary>Bits per sample of the output video (8 or 10).</summary>
+        uint32_t videoBitDepth;
+
+        /// <summary>
+        /// Level of the output video (as coded in the bitstream), or zero to leave it to the encoder.
+        /// </summary>
+        uint32_t videoLevel;
+
+        /// <summary>Whether the pipeline may use hardware encoders (otherwise software only).</summary>
+        bool hardwareAllowed;
+    };
+
+    /// <summary>
+    /// Decides the encoding parameters for a job.
+    /// </summary>
+    /// <param name="sourceInfo">Media source information.</param>
+    /// <param name="videoEncoder">The video encoder to use.</param>
+    /// <param name="targetSizeFactor">
+    /// The target size of the video output, as a fraction of the source data rate.
+    /// </param>
+    /// <param name="fragmentDuration">
+    /// Duration of the fragments in the output, or zero for a regular (non-fragmented) MP4.
+    /// </param>
+    /// <returns>The parameters to build the transcode profile.</returns>
+    TranscodeSettings DecideTranscodeSettings(
+        const MediaInfo& sourceInfo,
+        Encoder videoEncoder,
+        double targetSizeFactor,
+        std::chrono::milliseconds fragmentDuration = std::chrono::milliseconds(0));
+
+    /// <summary>
+    /// Retargets the settings of a job to another size factor, changing only the video bitrates,
+    /// so that the output keeps the sample description (level included) of the original settings
+    /// and can be concatenated with outputs made with them.
+    /// </summary>
+    /// <param name="settings">The settings decided for the job.</param>
+    /// <param name="targetSizeFactor">
+    /// The new target size, which should not be above the original one, because the level was chosen for that.
+    /// </param>
+    /// <returns>The retargeted settings.</returns>
+    TranscodeSettings RetargetVideoBitrates(const TranscodeSettings& settings, double targetSizeFactor);
+}
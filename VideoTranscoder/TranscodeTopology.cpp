@@ -1,44 +1,124 @@
 #include "stdafx.h"
 #include "TranscodeTopology.hpp"
 #include "AppException.hpp"
+#include "MfEncoderRegistry.hpp"
+#include "StreamChoiceSource.hpp"
 
-#include <MinCppXtra/win32_api_strings.hpp>
-
-#include <Mferror.h>
+#include <vector>
 
 namespace application
 {
-	static bool HasHardwareAcceleration(const ComPtr<IMFTopologyNode>& mfTopoNode)
+	static GUID GetMajorType(const ComPtr<IMFStreamDescriptor>& mfStreamDescriptor)
 	{
-		const size_t bufferSize = 128;
-		wchar_t buffer[bufferSize];
-		HRESULT hr = mfTopoNode->GetString(
-			MFT_ENUM_HARDWARE_URL_Attribute, buffer, bufferSize, nullptr);
-
-		if (hr == S_OK)
-			return true;
-		else if (hr == MF_E_ATTRIBUTENOTFOUND)
-			return false;
-		else
-			throw AppException(hr,
-				"Failed to read attribute from topology node",
-				NAMEOF(IMFTopologyNode::GetString));
+		ComPtr<IMFMediaTypeHandler> mediaTypeHandler;
+		CHECK("get media type handler for source stream",
+			mfStreamDescriptor->GetMediaTypeHandler(mediaTypeHandler.GetAddressOf()));
+
+		GUID majorType;
+		CHECK("get major type of source stream", mediaTypeHandler->GetMajorType(&majorType));
+		return majorType;
+	}
+
+	/// <summary>
+	/// Removes the transforms (decoder and encoder) from the audio branch
+	/// of the topology, so the source stream goes straight to the sink.
+	/// </summary>
+	static void BypassAudioTransforms(const ComPtr<IMFTopology>& mfTopology)
+	{
+		ComPtr<IMFCollection> sourceNodes;
+		CHECK("get topology source nodes",
+			mfTopology->GetSourceNodeCollection(sourceNodes.GetAddressOf()));
+
+		DWORD sourceNodeCount;
+		CHECK("get topology source nodes count", sourceNodes->GetElementCount(&sourceNodeCount));
+		for (DWORD idxSourceNode = 0; idxSourceNode < sourceNodeCount; ++idxSourceNode)
+		{
+			ComPtr<IUnknown> element;
+			CHECK("get topology source node", sourceNodes->GetElement(idxSourceNode, element.GetAddressOf()));
+
+			ComPtr<IMFTopologyNode> sourceNode;
+			CHECK("get IMFTopologyNode interface", element.As(&sourceNode));
+
+			ComPtr<IMFStreamDescriptor> mfStreamDescriptor;
+			CHECK("get stream descriptor of topology node",
+				sourceNode->GetUnknown(MF_TOPONODE_STREAM_DESCRIPTOR,
+					IID_PPV_ARGS(mfStreamDescriptor.GetAddressOf())));
+
+			if (GetMajorType(mfStreamDescriptor) != MFMediaType_Audio)
+				continue;
+
+			// follow the branch down to the output node:
+			std::vector<ComPtr<IMFTopologyNode>> transformNodes;
+			ComPtr<IMFTopologyNode> outputNode = sourceNode;
+			MF_TOPOLOGY_TYPE type;
+			do
+			{
+				ComPtr<IMFTopologyNode> downstreamNode;
+				DWORD downstreamInputIdx;
+				CHECK("get downstream topology node",
+					outputNode->GetOutput(0, downstreamNode.GetAddressOf(), &downstreamInputIdx));
+
+				CHECK("get topology node type", downstreamNode->GetNodeType(&type));
+				if (type == MF_TOPOLOGY_TRANSFORM_NODE)
+					transformNodes.push_back(downstreamNode);
+
+				outputNode = downstreamNode;
+			} while (type != MF_TOPOLOGY_OUTPUT_NODE);
+
+			for (const auto& transformNode : transformNodes)
+			{
+				CHECK("disconnect audio transform", transformNode->DisconnectOutput(0));
+				CHECK("remove audio transform from topology", mfTopology->RemoveNode(transformNode.Get()));
+			}
+
+			CHECK("connect audio source to output",
+				sourceNode->ConnectOutput(0, outputNode.Get(), 0));
+
+			// when the sink is already instantiated, make it take the format of the source:
+			ComPtr<IUnknown> sinkObject;
+			CHECK("get object of topology output node", outputNode->GetObject(sinkObject.GetAddressOf()));
+
+			ComPtr<IMFStreamSink> mfStreamSink;
+			if (SUCCEEDED(sinkObject.As(&mfStreamSink)))
+			{
+				ComPtr<IMFMediaTypeHandler> sourceTypeHandler, sinkTypeHandler;
+				CHECK("get media type handler for source stream",
+					mfStreamDescriptor->GetMediaTypeHandler(sourceTypeHandler.GetAddressOf()));
+
+				ComPtr<IMFMediaType> sourceType;
+				CHECK("get media type of source stream",
+					sourceTypeHandler->GetCurrentMediaType(sourceType.GetAddressOf()));
+
+				CHECK("get media type handler for stream sink",
+					mfStreamSink->GetMediaTypeHandler(sinkTypeHandler.GetAddressOf()));
+
+				CHECK("set audio format of stream sink",
+					sinkTypeHandler->SetCurrentMediaType(sourceType.Get()));
+			}
+		}
 	}
 
 	TranscodeTopology::TranscodeTopology(
 		const ComPtr<IMFMediaSource>& mfMediaSource,
+		const StreamChoice& streamChoice,
 		const ComPtr<IMFTranscodeProfile>& mfTranscodeProfile,
-		const std::string& outputFilePath)
+		const ComPtr<IMFByteStream>& mfOutputStream,
+		bool copyAudio)
 		: m_hasHardwareAcceleration(false)
 	{
-		std::wstring wOutFilePath = mincpp::Win32ApiStrings::ToUtf16(outputFilePath);
+		// the topology gets a branch for each stream selected in the presentation of the source:
+		ComPtr<IMFMediaSource> mfChosenSource(new StreamChoiceSource(mfMediaSource, streamChoice));
+
 		CHECK("create transcode topology",
-			MFCreateTranscodeTopology(
-				mfMediaSource.Get(),
-				wOutFilePath.c_str(),
+			MFCreateTranscodeTopologyFromByteStream(
+				mfChosenSource.Get(),
+				mfOutputStream.Get(),
 				mfTranscodeProfile.Get(),
 				m_mfTopology.GetAddressOf()));
 
+		if (copyAudio)
+			BypassAudioTransforms(m_mfTopology);
+
 		WORD nodeCount;
 		CHECK("get topology nodes count", m_mfTopology->GetNodeCount(&nodeCount));
 		for (WORD idxNode = 0; idxNode < nodeCount; ++idxNode)
@@ -51,12 +131,164 @@ namespace application
 			if (type != MF_TOPOLOGY_TRANSFORM_NODE)
 				continue;
 
-			// this detection is currently giving false negatives
-			if (HasHardwareAcceleration(mfTopoNode))
+			// in this partial topology, nodes hold the activation objects of the transforms:
+			ComPtr<IUnknown> object;
+			if (SUCCEEDED(mfTopoNode->GetObject(object.GetAddressOf())) && IsHardwareTransform(object))
 			{
 				m_hasHardwareAcceleration = true;
-				break;;
+				break;
+			}
+		}
+	}
+
+	/// <summary>
+	/// Adds a branch to the topology, from a source stream directly to a stream sink.
+	/// </summary>
+	static void AddPassthroughBranch(
+		const ComPtr<IMFTopology>& mfTopology,
+		const ComPtr<IMFMediaSource>& mfMediaSource,
+		const ComPtr<IMFPresentationDescriptor>& mfPresentationDescriptor,
+		const ComPtr<IMFStreamDescriptor>& mfStreamDescriptor,
+		const ComPtr<IMFStreamSink>& mfStreamSink)
+	{
+		ComPtr<IMFTopologyNode> sourceNode;
+		CHECK("create topology source node",
+			MFCreateTopologyNode(MF_TOPOLOGY_SOURCESTREAM_NODE, sourceNode.GetAddressOf()));
+
+		CHECK("set media source in topology node",
+			sourceNode->SetUnknown(MF_TOPONODE_SOURCE, mfMediaSource.Get()));
+
+		CHECK("set presentation descriptor in topology node",
+			sourceNode->SetUnknown(MF_TOPONODE_PRESENTATION_DESCRIPTOR, mfPresentationDescriptor.Get()));
+
+		CHECK("set stream descriptor in topology node",
+			sourceNode->SetUnknown(MF_TOPONODE_STREAM_DESCRIPTOR, mfStreamDescriptor.Get()));
+
+		ComPtr<IMFTopologyNode> outputNode;
+		CHECK("create topology output node",
+			MFCreateTopologyNode(MF_TOPOLOGY_OUTPUT_NODE, outputNode.GetAddressOf()));
+
+		CHECK("set stream sink in topology node", outputNode->SetObject(mfStreamSink.Get()));
+
+		CHECK("add source node to topology", mfTopology->AddNode(sourceNode.Get()));
+		CHECK("add output node to topology", mfTopology->AddNode(outputNode.Get()));
+		CHECK("connect source node to output node", sourceNode->ConnectOutput(0, outputNode.Get(), 0));
+	}
+
+	TranscodeTopology::TranscodeTopology(
+		const ComPtr<IMFMediaSource>& mfMediaSource,
+		const StreamChoice& streamChoice,
+		const ComPtr<IMFByteStream>& mfOutputStream,
+		bool fragmented)
+		: m_hasHardwareAcceleration(false)
+	{
+		ComPtr<IMFPresentationDescriptor> mfPresentationDescriptor;
+		CHECK("create presentation descriptor",
+			mfMediaSource->CreatePresentationDescriptor(mfPresentationDescriptor.GetAddressOf()));
+
+		DWORD streamCount;
+		CHECK("get source stream count",
+			mfPresentationDescriptor->GetStreamDescriptorCount(&streamCount));
+
+		// keep the chosen video and audio streams, deselect the others:
+		ComPtr<IMFStreamDescriptor> videoStream, audioStream;
+		ComPtr<IMFMediaType> videoType, audioType;
+		for (DWORD streamIdx = 0; streamIdx < streamCount; ++streamIdx)
+		{
+			BOOL selected;
+			ComPtr<IMFStreamDescriptor> mfStreamDescriptor;
+			CHECK("get source stream descriptor",
+				mfPresentationDescriptor->GetStreamDescriptorByIndex(
+					streamIdx, &selected, mfStreamDescriptor.GetAddressOf()));
+
+			ComPtr<IMFMediaTypeHandler> mediaTypeHandler;
+			CHECK("get media type handler for source stream",
+				mfStreamDescriptor->GetMediaTypeHandler(mediaTypeHandler.GetAddressOf()));
+
+			ComPtr<IMFMediaType>* mediaType = nullptr;
+			if (streamChoice.video == streamIdx)
+			{
+				videoStream = mfStreamDescriptor;
+				mediaType = &videoType;
+			}
+			else if (streamChoice.audio == streamIdx)
+			{
+				audioStream = mfStreamDescriptor;
+				mediaType = &audioType;
+			}
+
+			if (mediaType == nullptr)
+			{
+				CHECK("deselect source stream", mfPresentationDescriptor->DeselectStream(streamIdx));
+				continue;
 			}
+
+			CHECK("get media type of source stream",
+				mediaTypeHandler->GetCurrentMediaType(mediaType->GetAddressOf()));
+
+			CHECK("select source stream", mfPresentationDescriptor->SelectStream(streamIdx));
+		}
+
+		if (!videoStream)
+			throw AppException("Source has no video stream to copy");
+
+		ComPtr<IMFMediaSink> mfMediaSink;
+		if (fragmented)
+		{
+			CHECK("create fragmented MPEG-4 media sink",
+				MFCreateFMPEG4MediaSink(
+					mfOutputStream.Get(), videoType.Get(), audioType.Get(), mfMediaSink.GetAddressOf()));
+		}
+		else
+		{
+			CHECK("create MPEG-4 media sink",
+				MFCreateMPEG4MediaSink(
+					mfOutputStream.Get(), videoType.Get(), audioType.Get(), mfMediaSink.GetAddressOf()));
+		}
+
+		CHECK("create topology", MFCreateTopology(m_mfTopology.GetAddressOf()));
+
+		// match the stream sinks with the source streams by major type:
+		DWORD sinkCount;
+		CHECK("get stream sink count", mfMediaSink->GetStreamSinkCount(&sinkCount));
+		for (DWORD sinkIdx = 0; sinkIdx < sinkCount; ++sinkIdx)
+		{
+			ComPtr<IMFStreamSink> mfStreamSink;
+			CHECK("get stream sink", mfMediaSink->GetStreamSinkByIndex(sinkIdx, mfStreamSink.GetAddressOf()));
+
+			ComPtr<IMFMediaTypeHandler> mediaTypeHandler;
+			CHECK("get media type handler for stream sink",
+				mfStreamSink->GetMediaTypeHandler(mediaTypeHandler.GetAddressOf()));
+
+			GUID majorType;
+			CHECK("get major type of stream sink", mediaTypeHandler->GetMajorType(&majorType));
+
+			const auto& mfStreamDescriptor = (majorType == MFMediaType_Video) ? videoStream : audioStream;
+			if (mfStreamDescriptor)
+			{
+				AddPassthroughBranch(m_mfTopology, mfMediaSource,
+					mfPresentationDescriptor, mfStreamDescriptor, mfStreamSink);
+			}
+		}
+	}
+
+	void TranscodeTopology::SetStopPosition(std::chrono::nanoseconds stopPosition)
+	{
+		WORD nodeCount;
+		CHECK("get topology nodes count", m_mfTopology->GetNodeCount(&nodeCount));
+		for (WORD idxNode = 0; idxNode < nodeCount; ++idxNode)
+		{
+			ComPtr<IMFTopologyNode> mfTopoNode;
+			CHECK("get topology node", m_mfTopology->GetNode(idxNode, mfTopoNode.GetAddressOf()));
+
+			MF_TOPOLOGY_TYPE type;
+			CHECK("get topology node type", mfTopoNode->GetNodeType(&type));
+			if (type != MF_TOPOLOGY_SOURCESTREAM_NODE)
+				continue;
+
+			// stop position in units of 100 ns:
+			CHECK("set stop position in topology source node",
+				mfTopoNode->SetUINT64(MF_TOPONODE_MEDIASTOP, stopPosition.count() / 100));
 		}
 	}
 }
@@ -1,9 +1,11 @@
 #pragma once
 
+#include "StreamSelection.hpp"
+
 #include <mfobjects.h>
 #include <wrl.h>
 
-#include <string>
+#include <chrono>
 
 namespace application
 {
@@ -19,19 +21,55 @@ namespace application
 
 	public:
 
+		/// <summary>
+		/// Creates a topology that transcodes the source according to the profile.
+		/// </summary>
+		/// <param name="streamChoice">The source streams to transcode (the others are deselected).</param>
+		/// <param name="mfOutputStream">Where the sink writes the output.</param>
+		/// <param name="copyAudio">
+		/// Whether the audio stream skips decoding and encoding, to be copied as it is.
+		/// </param>
 		TranscodeTopology(
 			const ComPtr<IMFMediaSource>& mfMediaSource,
+			const StreamChoice& streamChoice,
 			const ComPtr<IMFTranscodeProfile>& mfTranscodeProfile,
-			const std::string& outputFilePath);
+			const ComPtr<IMFByteStream>& mfOutputStream,
+			bool copyAudio);
+
+		/// <summary>
+		/// Creates a topology that remuxes the chosen video and audio streams
+		/// into an MP4 file as they are, without any transform node.
+		/// </summary>
+		/// <param name="mfOutputStream">Where the sink writes the output.</param>
+		/// <param name="fragmented">
+		/// Whether to write fragmented MP4, with fragments starting at the key frames of the source.
+		/// </param>
+		TranscodeTopology(
+			const ComPtr<IMFMediaSource>& mfMediaSource,
+			const StreamChoice& streamChoice,
+			const ComPtr<IMFByteStream>& mfOutputStream,
+			bool fragmented);
 
 		const ComPtr<IMFTopology>& GetMfObject() const
 		{
 			return m_mfTopology;
 		}
 
+		/// <summary>
+		/// Tells whether the transforms in this (partial) topology run on hardware.
+		/// </summary>
+		/// <remarks>
+		/// The topology loader may still choose other transforms, hence what the
+		/// media session resolves the topology to is what tells for sure.
+		/// </remarks>
 		const bool IsHardwareAccelerated() const
 		{
 			return m_hasHardwareAcceleration;
 		}
+
+		/// <summary>
+		/// Makes the presentation end at the given position of the source, rather than at its end.
+		/// </summary>
+		void SetStopPosition(std::chrono::nanoseconds stopPosition);
 	};
 }
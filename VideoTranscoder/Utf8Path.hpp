@@ -0,0 +1,29 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+
+namespace application
+{
+    /// <summary>
+    /// Converts a UTF-8 encoded string into a file system path.
+    /// </summary>
+    /// <remarks>
+    /// Constructing a path directly from std::string would interpret
+    /// the text with the ANSI code page on Windows.
+    /// </remarks>
+    inline std::filesystem::path ToPath(const std::string& utf8str)
+    {
+        return std::filesystem::path(
+            std::u8string(utf8str.begin(), utf8str.end()));
+    }
+
+    /// <summary>
+    /// Converts a file system path into a UTF-8 encoded string.
+    /// </summary>
+    inline std::string ToUtf8(const std::filesystem::path& path)
+    {
+        const std::u8string utf8str = path.u8string();
+        return std::string(utf8str.begin(), utf8str.end());
+    }
+}
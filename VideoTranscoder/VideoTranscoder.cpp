@@ -3,87 +3,165 @@
 
 #include "stdafx.h"
 
+#include "AppException.hpp"
+#include "BatchTranscoding.hpp"
 #include "CommandLineParsing.hpp"
-#include "MediaSession.hpp"
-#include "MediaSource.hpp"
-#include "MmfLibScope.hpp"
-#include "TranscodeProfile.hpp"
-#include "TranscodeTopology.hpp"
+#include "ContentFingerprint.hpp"
+#include "EncoderCalibration.hpp"
+#include "JobPrediction.hpp"
+#include "MfBackend.hpp"
+#include "Mp4Faststart.hpp"
+#include "OutputCache.hpp"
+#include "ProgressSubscribers.hpp"
+#include "SegmentedTranscoding.hpp"
+#include "SimulatedBackend.hpp"
+#include "TranscodeJob.hpp"
+#include "TranscodeReport.hpp"
 
 #include <MinCppXtra/call_stack_access_scope.hpp>
 #include <MinCppXtra/seh_translation_scope.hpp>
 #include <MinCppXtra/traceable_exception.hpp>
 #include <MinCppXtra/win32_api_strings.hpp>
 
-#include <array>
 #include <chrono>
 #include <iostream>
+#include <memory>
 #include <stdexcept>
 
-using TimePoint = std::chrono::time_point<std::chrono::system_clock>;
-
 namespace application
 {
-    static const char* GetTimestamp(const time_t timeTicks)
-    {
-        static std::array<char, 21> timestamp;
-        strftime(timestamp.data(), timestamp.size(), "%Y-%b-%d %H:%M:%S", localtime(&timeTicks));
-        return timestamp.data();
-    }
-
     /// <summary>
-    /// Prints a progress bar given the progress.
+    /// Transcodes a single input file into a single output file.
     /// </summary>
-    /// <param name="progress">Progress of transcoding within range [0,1].</param>
-    static void PrintProgressBar(double progress, const TimePoint startTime)
+    /// <param name="report">Receives the outcome of the job.</param>
+    static void RunTranscoding(MediaBackend& backend, const CmdLineParams& params, TranscodeReport& report)
     {
-        using std::chrono::minutes;
+        using namespace std::chrono;
 
-        // Amount of steps inside the progress bar
-        const int qtBarSteps(40);
+        // declared before the job, so that it outlives the job:
+        ProgressHub progressHub;
+        progressHub.Subscribe(std::make_shared<ConsoleProgressBar>());
+        SubscribeFileWriters(progressHub, params.progressJsonFName, params.metricsFName);
 
-        static int donePercentage(0);
-        static int doneSteps(0);
+        const EncoderSelection encoderSelection = GetEncoderSelection(backend, params);
 
-        // Only update the progress bar if there is a change:
-        int updatePercentage = static_cast<int>(progress * 100);
-        if (updatePercentage == donePercentage)
-            return;
-        else
+        if (params.predictExcerpts > 0)
         {
-            donePercentage = updatePercentage;
-            doneSteps = static_cast<int>(qtBarSteps * progress);
+            std::cout << std::endl << "Encoding " << params.predictExcerpts
+                << " excerpts to predict the outcome..." << std::endl;
+
+            report.prediction = PredictJob(backend, params.inputFName, params.outputFName, encoderSelection,
+                                           params.tgtSize, params.predictExcerpts, params.GetTimeBudget());
+
+            std::cout << (report.prediction ? "Job " + DescribeJobPrediction(*report.prediction)
+                                            : std::string("Input too short or not to be encoded, no prediction"))
+                << std::endl;
         }
 
-        using std::chrono::system_clock;
-        using std::chrono::duration_cast;
+        std::unique_ptr<OutputCache> outputCache;
+        if (params.UseOutputCache())
+            outputCache = std::make_unique<OutputCache>(params.outputCacheDir, params.GetOutputCacheLimits());
 
-        const minutes eta = duration_cast<minutes>(
-            (system_clock::now() - startTime) * (1.0 - progress) / progress
-        );
+        // the output is cached under the job as first decided, whatever the retunes:
+        std::string outputCacheKey;
 
-        // Print the progress bar:
-        if (progress < 1.0)
+        double sizeFactor = report.prediction ? report.prediction->correctedSizeFactor : params.tgtSize;
+        while (true)
         {
-            std::cout << "\rProgress [";
-
-            for (int idx = 0; idx < doneSteps; ++idx)
-                std::cout << '#';
+            TranscodeJob transcodeJob(
+                backend,
+                params.inputFName,
+                params.outputFName,
+                encoderSelection,
+                sizeFactor,
+                std::nullopt,
+                params.GetFragmentDuration(),
+                true,
+                report.prediction ? report.prediction->videoQualityVsSpeed : 0
+            );
+
+            report.mediaDuration = transcodeJob.GetDuration();
+            report.sourceInfo = transcodeJob.GetSourceInfo();
+            report.settings = transcodeJob.GetSettings();
+            report.videoEncoder = transcodeJob.GetSettings().videoEncoder;
 
-            int remaining = qtBarSteps - doneSteps;
-            for (int idx = 0; idx < remaining; ++idx)
-                std::cout << '_';
+            std::cout << std::endl
+                << "Input media file is "
+                << duration_cast<seconds>(transcodeJob.GetDuration()).count()
+                << " seconds long" << std::endl;
+
+            if (outputCache && outputCacheKey.empty())
+            {
+                outputCacheKey = OutputCache::MakeKey(FingerprintFile(params.inputFName),
+                    transcodeJob.GetSettings(), params.streamSelection, params.faststart);
+
+                if (outputCache->Fetch(outputCacheKey, params.outputFName))
+                {
+                    std::cout << "Output taken from cache, as it was transcoded before" << std::endl << std::endl;
+                    report.fromOutputCache = true;
+                    break;
+                }
+            }
+
+            transcodeJob.Track(progressHub, params.inputFName);
+            if (report.prediction)
+                transcodeJob.ExpectSpeed(report.prediction->speed);
+
+            // the limit is relative to the requested target, however corrected:
+            const uint64_t targetSize = transcodeJob.EstimateOutputSize(params.tgtSize);
+            if (params.sizeGuardPct > 0.0 && targetSize != 0)
+                transcodeJob.LimitSize(static_cast<uint64_t>(targetSize * (1.0 + params.sizeGuardPct / 100)));
+
+            transcodeJob.Start();
+
+            try
+            {
+                // progress is printed by the subscribers as the session reports it:
+                while (!transcodeJob.Wait(hours(1)))
+                    continue;
+            }
+            catch (AppException& ex)
+            {
+                const auto projectedSize = transcodeJob.GetOversizeProjection();
+                if (!projectedSize || !params.sizeRetune || report.sizeRetuneCount >= TranscodeJob::maxSizeRetunes)
+                    throw;
+
+                sizeFactor *= (double)targetSize / *projectedSize;
+                ++report.sizeRetuneCount;
+
+                std::cout << ex.what() << std::endl
+                    << "Restarting with target size factor " << sizeFactor << std::endl;
+                continue;
+            }
+
+            // known for sure only once the session has resolved the topology:
+            report.hardwareAccelerated = transcodeJob.IsHardwareAccelerated();
+            report.videoEncoderName = transcodeJob.GetVideoEncoderName();
+            break;
+        }
 
-            std::cout << "] " << donePercentage << " % done";
-            std::cout << " / Remaining " << eta.count() << " min  " << std::flush;
+        if (report.fromOutputCache)
+        {
+            report.succeeded = true;
             return;
         }
 
-        const minutes totalTime = duration_cast<minutes>(system_clock::now() - startTime);
-        std::cout
-            << "\rTranscoding finished at " << GetTimestamp(time(nullptr))
-            << " (total elapsed time was " << totalTime.count() << " minutes)"
-            << std::endl << std::endl;
+        if (params.faststart && !params.simulate && MoveMovieToFront(params.outputFName))
+            std::cout << "Movie header moved in front of the media data" << std::endl << std::endl;
+
+        if (outputCache)
+        {
+            try
+            {
+                outputCache->Store(outputCacheKey, params.outputFName);
+            }
+            catch (AppException& ex)
+            {
+                std::cerr << ex.what() << std::endl << std::endl;
+            }
+        }
+
+        report.succeeded = true;
     }
 
 }// end of namespace application
@@ -95,7 +173,6 @@ namespace application
 int main(int argc, char *argv[])
 {
     using namespace std::chrono;
-    using namespace Microsoft::WRL;
 
     try
     {
@@ -107,61 +184,60 @@ int main(int argc, char *argv[])
 
         mincpp::CallStackAccessScope callStackAccessScope;
         mincpp::SehTranslationScope sehTranslationScope;
-        application::MmfLibScope mmfLibScope;
-
-        application::MediaSource mediaSource(
-            mincpp::Win32ApiStrings::ToUtf16(params.inputFName)
-        );
-
-        auto duration = mediaSource.GetDuration();
-        std::cout << std::endl
-            << "Input media file is "
-            << duration_cast<seconds>(duration).count()
-            << " seconds long" << std::endl;
-
-        application::TranscodeProfile transcodeProfile(
-            mediaSource.GetMediaInfo(),
-            params.encoder,
-            params.tgtSize
-        );
-
-        application::TranscodeTopology transcodeTopology(
-            mediaSource.GetMfObject(),
-            transcodeProfile.GetMfObject(),
-            params.outputFName
-        );
-
-        if (transcodeTopology.IsHardwareAccelerated())
-        {
-            std::cout << std::endl
-                << "Hardware accelerated transcoding detected 👍"
-                << std::endl;
-        }
 
-        const TimePoint startTime = system_clock::now();
-        std::cout << std::endl
-            << "Transcoding starting at "
-            << application::GetTimestamp(system_clock::to_time_t(startTime))
-            << std::endl << std::endl;
+        std::unique_ptr<application::MediaBackend> backend;
+        if (params.simulate)
+            backend = std::make_unique<application::SimulatedBackend>();
+        else
+            backend = std::make_unique<application::MfBackend>(
+                params.streamSelection, params.GetWriteBufferOptions(), params.GetReadAheadOptions());
+
+        if (params.calibrate)
+            return application::RunEncoderCalibration(*backend, params) ? EXIT_SUCCESS : EXIT_FAILURE;
 
-        ComPtr<application::MediaSession> mediaSession(new application::MediaSession());
-        mediaSession->StartEncodingSession(transcodeTopology.GetMfObject());
+        if (params.IsBatch())
+            return application::RunBatchTranscoding(*backend, params) ? EXIT_SUCCESS : EXIT_FAILURE;
 
-        application::PrintProgressBar(0.0, startTime);
+        if (params.segmentCount > 1)
+            return application::RunSegmentedTranscoding(*backend, params) ? EXIT_SUCCESS : EXIT_FAILURE;
 
-        // Loop for transcoding:
-        HRESULT asyncResult;
-        while ((asyncResult = mediaSession->Wait(milliseconds(500))) == E_PENDING)
+        application::TranscodeReport report = {};
+        report.inputFName = params.inputFName;
+        report.outputFName = params.outputFName;
+        report.videoEncoder = params.encoder;
+        report.requestedSizeFactor = params.tgtSize;
+
+        const auto startTime = steady_clock::now();
+        auto writeReport = [&params, &report, startTime]()
+        {
+            report.wallTime = steady_clock::now() - startTime;
+            if (params.writeReport)
+            {
+                application::WriteTranscodeReport(report,
+                    application::GetTranscodeReportFName(params.reportPath, params.outputFName));
+            }
+        };
+
+        try
+        {
+            application::RunTranscoding(*backend, params, report);
+        }
+        catch (std::exception& ex)
         {
-            decltype(duration) position = mediaSession->GetEncodingPosition();
-            double progress = (double)position.count() / duration.count();
-            application::PrintProgressBar(progress, startTime);
+            report.errorMessage = ex.what();
+            writeReport();
+            throw;
         }
 
-        if (FAILED(asyncResult))
-            return EXIT_FAILURE;
+        // printed once the progress subscribers are gone, so as not to mix with them:
+        if (!report.videoEncoderName.empty())
+        {
+            std::cout << "Video encoded by " << report.videoEncoderName
+                << (report.hardwareAccelerated ? " (hardware accelerated 👍)" : "")
+                << std::endl << std::endl;
+        }
 
-        application::PrintProgressBar(1.0, startTime);
+        writeReport();
     }
     catch (mincpp::TraceableException &ex)
     {
@@ -0,0 +1,87 @@
+#include "BufferedFileWriter.hpp"
+#include "OutputFile.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <filesystem>
+#include <random>
+#include <vector>
+
+namespace application::benchmarks
+{
+    static const uint64_t s_outputSize = uint64_t(64) << 20;
+
+    /// <summary>
+    /// Sizes of the writes of a muxer: samples of a few KB, with box headers of a few bytes in between.
+    /// </summary>
+    static const std::vector<uint32_t>& GetWriteSizes()
+    {
+        static const std::vector<uint32_t> sizes = []()
+        {
+            std::mt19937 random(7);
+            std::vector<uint32_t> sizes;
+            uint64_t total = 0;
+            while (total < s_outputSize)
+            {
+                sizes.push_back(random() % 4 == 0 ? 8 : 200 + random() % 6000);
+                total += sizes.back();
+            }
+            return sizes;
+        }();
+
+        return sizes;
+    }
+
+    static std::string GetOutputFileName()
+    {
+        return (std::filesystem::temp_directory_path() / "VideoTranscoderBenchmark.bin").string();
+    }
+
+    /// <summary>
+    /// Every write of the muxer goes straight to the file.
+    /// </summary>
+    static void BM_DirectSmallWrites(benchmark::State& state)
+    {
+        const std::vector<uint8_t> data(8192, 0x5a);
+        const std::string fileName = GetOutputFileName();
+        for (auto _ : state)
+        {
+            OutputFile file(fileName);
+            uint64_t position = 0;
+            for (uint32_t size : GetWriteSizes())
+            {
+                file.Write(position, data.data(), size);
+                position += size;
+            }
+            file.Close();
+        }
+
+        state.SetBytesProcessed(state.iterations() * s_outputSize);
+        std::filesystem::remove(fileName);
+    }
+
+    /// <summary>
+    /// The writes of the muxer are coalesced in buffers of as many MB as the argument.
+    /// </summary>
+    static void BM_BufferedSmallWrites(benchmark::State& state)
+    {
+        const std::vector<uint8_t> data(8192, 0x5a);
+        const std::string fileName = GetOutputFileName();
+        const WriteBufferOptions options{ static_cast<size_t>(state.range(0)) << 20, 3 };
+        for (auto _ : state)
+        {
+            BufferedFileWriter writer(fileName, options, s_outputSize);
+            for (uint32_t size : GetWriteSizes())
+                writer.Write(data.data(), size);
+
+            writer.Close();
+        }
+
+        state.SetBytesProcessed(state.iterations() * s_outputSize);
+        std::filesystem::remove(fileName);
+    }
+
+    // in real time, for the buffered writes go to the file in a background thread:
+    BENCHMARK(BM_DirectSmallWrites)->Unit(benchmark::kMillisecond)->UseRealTime();
+    BENCHMARK(BM_BufferedSmallWrites)->Arg(1)->Arg(4)->Arg(16)->Unit(benchmark::kMillisecond)->UseRealTime();
+}
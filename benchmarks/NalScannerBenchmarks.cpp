@@ -0,0 +1,95 @@
+#include "NalScanner.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <vector>
+
+namespace application::benchmarks
+{
+    /// <summary>
+    /// Makes an Annex B byte stream of 64 MB with NAL units of about 30 KB,
+    /// whose payload has as many zeros as a real slice (which slow down a naive scan).
+    /// </summary>
+    static const std::vector<uint8_t>& GetAnnexBStream()
+    {
+        static const std::vector<uint8_t> stream = []()
+        {
+            std::mt19937 random(11);
+            std::vector<uint8_t> data;
+            data.reserve(size_t(64) << 20);
+            while (data.size() < (size_t(64) << 20))
+            {
+                data.insert(data.end(), { 0, 0, 0, 1, 0x41 });
+                const size_t nalSize = 20000 + random() % 20000;
+                for (size_t idx = 0; idx < nalSize; ++idx)
+                {
+                    const auto byte = static_cast<uint8_t>(random() % 8 == 0 ? 0 : random());
+                    const size_t length = data.size();
+                    if (byte <= 3 && data[length - 1] == 0 && data[length - 2] == 0)
+                        data.push_back(3);
+                    data.push_back(byte);
+                }
+                data.push_back(0x80);
+            }
+            return data;
+        }();
+
+        return stream;
+    }
+
+    static SimdLevel ToSimdLevel(benchmark::State& state)
+    {
+        const auto level = static_cast<SimdLevel>(state.range(0));
+        if (level != SimdLevel::Scalar && level != GetSupportedSimdLevel()
+            && !(level == SimdLevel::Sse2 && GetSupportedSimdLevel() == SimdLevel::Avx2))
+        {
+            state.SkipWithError("instruction set not supported by this CPU");
+        }
+        state.SetLabel(GetSimdLevelName(level));
+        return level;
+    }
+
+    static void BM_ScanAnnexB(benchmark::State& state)
+    {
+        const SimdLevel level = ToSimdLevel(state);
+        const auto& stream = GetAnnexBStream();
+        for (auto _ : state)
+        {
+            if (state.error_occurred())
+                break;
+
+            benchmark::DoNotOptimize(ScanAnnexB(stream.data(), stream.size(), Encoder::H264_AVC, level));
+        }
+
+        state.SetBytesProcessed(state.iterations() * stream.size());
+    }
+
+    /// <summary>
+    /// Removal of emulation prevention bytes from a large NAL unit.
+    /// </summary>
+    static void BM_ExtractRbsp(benchmark::State& state)
+    {
+        const SimdLevel level = ToSimdLevel(state);
+        const auto& stream = GetAnnexBStream();
+        const size_t size = size_t(4) << 20;
+        for (auto _ : state)
+        {
+            if (state.error_occurred())
+                break;
+
+            benchmark::DoNotOptimize(ExtractRbsp(stream.data() + 4, size, level));
+        }
+
+        state.SetBytesProcessed(state.iterations() * size);
+    }
+
+    static void ApplySimdLevels(benchmark::internal::Benchmark* benchmark)
+    {
+        for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::Sse2, SimdLevel::Avx2, SimdLevel::Neon })
+            benchmark->Arg(static_cast<int64_t>(level));
+    }
+
+    BENCHMARK(BM_ScanAnnexB)->Apply(ApplySimdLevels);
+    BENCHMARK(BM_ExtractRbsp)->Apply(ApplySimdLevels);
+}
@@ -0,0 +1,71 @@
+#include "ProgressTelemetry.hpp"
+#include "TranscodeSettings.hpp"
+
+#include <benchmark/benchmark.h>
+
+namespace application::benchmarks
+{
+    using namespace std::chrono;
+
+    /// <summary>
+    /// Discards the samples it receives.
+    /// </summary>
+    class NullSubscriber : public ProgressSubscriber
+    {
+    public:
+
+        void OnProgress(const ProgressSample& sample) override
+        {
+            benchmark::DoNotOptimize(sample.progress);
+        }
+    };
+
+    /// <summary>
+    /// Cost of a position report: smoothing of rates, time estimate and size projection,
+    /// then publishing to the hub (with or without a subscriber to dispatch to).
+    /// </summary>
+    static void BM_ProgressEstimator(benchmark::State& state)
+    {
+        ProgressHub hub;
+        if (state.range(0) != 0)
+            hub.Subscribe(std::make_shared<NullSubscriber>());
+
+        ProgressTracker tracker("job", hours(2), 29.97, hub);
+        tracker.OnStarted();
+
+        int64_t tick = 0;
+        for (auto _ : state)
+        {
+            ++tick;
+            tracker.OnPosition(milliseconds(tick * 40), milliseconds(tick * 10), tick * 5000);
+        }
+        hub.Flush();
+
+        state.SetItemsProcessed(state.iterations());
+    }
+    BENCHMARK(BM_ProgressEstimator)->Arg(0)->Arg(1);
+
+    /// <summary>
+    /// Cost of deciding the settings of a job (bitrates, level, quality vs speed, audio).
+    /// </summary>
+    static void BM_DecideTranscodeSettings(benchmark::State& state)
+    {
+        MediaInfo sourceInfo = {};
+        sourceInfo.videoProfile.frameSize = { 1920, 1080 };
+        sourceInfo.videoProfile.frameRate = { 30000, 1001 };
+        sourceInfo.videoProfile.avgBitrate = 12000000;
+        sourceInfo.videoProfile.peakBitrate = 30000000;
+        sourceInfo.videoProfile.format = Encoder::H264_AVC;
+        sourceInfo.audioProfile = { 16, 48000, 2, 24000, true };
+
+        double targetSizeFactor = 0.3;
+        for (auto _ : state)
+        {
+            targetSizeFactor = (targetSizeFactor < 0.9) ? targetSizeFactor + 0.01 : 0.3;
+            benchmark::DoNotOptimize(DecideTranscodeSettings(sourceInfo, Encoder::H265_HEVC, targetSizeFactor));
+        }
+
+        state.SetItemsProcessed(state.iterations());
+    }
+    BENCHMARK(BM_DecideTranscodeSettings);
+}
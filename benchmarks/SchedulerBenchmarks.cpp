@@ -0,0 +1,79 @@
+#include "JobScheduler.hpp"
+#include "ProgressTelemetry.hpp"
+#include "SimulatedBackend.hpp"
+#include "TranscodeJob.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <string>
+
+namespace application::benchmarks
+{
+    using namespace std::chrono;
+
+    /// <summary>
+    /// Cost of dispatching jobs that do nothing, which is the overhead of the scheduler.
+    /// </summary>
+    static void BM_JobSchedulerDispatch(benchmark::State& state)
+    {
+        const JobScheduler scheduler(static_cast<uint32_t>(state.range(0)));
+        const size_t jobCount = 1000;
+        std::atomic<size_t> done(0);
+        for (auto _ : state)
+            scheduler.Run(jobCount, [&done](size_t) { ++done; });
+
+        state.SetItemsProcessed(state.iterations() * jobCount);
+    }
+    BENCHMARK(BM_JobSchedulerDispatch)->Arg(1)->Arg(4)->Arg(16)->UseRealTime();
+
+    /// <summary>
+    /// Cost of dispatching jobs with placement on hardware slots.
+    /// </summary>
+    static void BM_JobSchedulerHardwarePlacement(benchmark::State& state)
+    {
+        const JobScheduler scheduler(8);
+        const size_t jobCount = 1000;
+        std::atomic<size_t> onHardware(0);
+        for (auto _ : state)
+        {
+            scheduler.Run(jobCount, 2, [&onHardware](size_t, bool useHardware)
+            {
+                if (useHardware)
+                    ++onHardware;
+            });
+        }
+
+        state.SetItemsProcessed(state.iterations() * jobCount);
+    }
+    BENCHMARK(BM_JobSchedulerHardwarePlacement)->UseRealTime();
+
+    /// <summary>
+    /// Throughput of whole jobs (settings decided, session run and tracked) on the simulated backend,
+    /// so only the job logic is measured.
+    /// </summary>
+    static void BM_SimulatedBatch(benchmark::State& state)
+    {
+        SimulatedBackend backend;
+        const JobScheduler scheduler(static_cast<uint32_t>(state.range(0)));
+        const size_t jobCount = 64;
+        ProgressHub hub;
+
+        for (auto _ : state)
+        {
+            scheduler.Run(jobCount, [&](size_t jobIdx)
+            {
+                const std::string inputFName = "input" + std::to_string(jobIdx) + ".mp4";
+                TranscodeJob job(backend, inputFName, "output.mp4", Encoder::H265_HEVC, 0.5);
+                job.Track(hub, inputFName, milliseconds(500));
+                job.Start();
+                while (!job.Wait(hours(1)))
+                {
+                }
+            });
+        }
+
+        state.SetItemsProcessed(state.iterations() * jobCount);
+    }
+    BENCHMARK(BM_SimulatedBatch)->Arg(1)->Arg(4)->UseRealTime();
+}
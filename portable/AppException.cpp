@@ -0,0 +1,47 @@
+#include "AppException.hpp"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+
+// Counterpart of VideoTranscoder/AppException.cpp where there is no COM:
+// results follow the same convention (negative means failure), with no system message.
+
+namespace application
+{
+	static std::string CreateErrorMessage(int32_t hr, const char* what, const char* where)
+	{
+		std::ostringstream oss;
+		oss << "Failed to " << what << " (HRESULT 0x" << std::hex << static_cast<uint32_t>(hr)
+			<< ") in " << where;
+
+		return oss.str();
+	}
+
+	AppException::AppException(int32_t hr, const char* what, const char* where)
+		: TraceableException(CreateErrorMessage(hr, what, where))
+		, m_hresult(hr)
+	{
+	}
+
+	AppException::AppException(const std::string& what)
+		: TraceableException(what)
+	{
+	}
+
+	void AppException::CheckResult(
+		int32_t hr,
+		const char* what,
+		const char* where,
+		bool throwOnError)
+	{
+		if (hr < 0)
+		{
+			AppException exception(hr, what, where);
+			if (throwOnError)
+				throw exception;
+
+			std::cerr << exception.Serialize();
+		}
+	}
+}
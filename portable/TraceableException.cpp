@@ -0,0 +1,68 @@
+#include <MinCppXtra/traceable_exception.hpp>
+
+// MinCppXtra is distributed as a library for Windows only (see dependencies/MinCppXtra/lib),
+// so where the portable core is built without it, exceptions carry no stack trace.
+
+namespace mincpp
+{
+    class TraceableException::Impl
+    {
+    public:
+
+        std::string callStackTrace;
+        std::optional<std::exception> innerException;
+    };
+
+    bool TraceableException::s_useColorsOnStackTrace = false;
+
+    void TraceableException::UseColorsOnStackTrace(bool enable)
+    {
+        s_useColorsOnStackTrace = enable;
+    }
+
+    TraceableException::TraceableException(
+        const std::string& message,
+        std::optional<std::exception>&& innerException)
+        : std::runtime_error(message)
+        , m_pimpl(std::make_shared<Impl>())
+    {
+        m_pimpl->innerException = std::move(innerException);
+    }
+
+    TraceableException::TraceableException(
+        const std::string& message,
+        const void*,
+        bool)
+        : std::runtime_error(message)
+        , m_pimpl(std::make_shared<Impl>())
+    {
+    }
+
+    TraceableException::~TraceableException()
+    {
+    }
+
+    std::string_view TraceableException::GetTypeName() const
+    {
+        return "TraceableException";
+    }
+
+    const std::string& TraceableException::GetCallStackTrace() const
+    {
+        return m_pimpl->callStackTrace;
+    }
+
+    const std::optional<std::exception>& TraceableException::GetInnerException() const
+    {
+        return m_pimpl->innerException;
+    }
+
+    std::string TraceableException::Serialize() const
+    {
+        std::string text(GetTypeName());
+        text += ": ";
+        text += what();
+        text += '\n';
+        return text;
+    }
+}
@@ -0,0 +1,62 @@
+#include "BatchManifest.hpp"
+#include "AppException.hpp"
+#include "SyntheticMp4.hpp"
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+
+namespace application::tests
+{
+    static void Touch(const std::string& fileName)
+    {
+        std::ofstream(fileName, std::ios::binary);
+    }
+
+    TEST(BatchManifestTests, ListsVideoFilesOfDirectory)
+    {
+        TemporaryDirectory input;
+        TemporaryDirectory output;
+        Touch(input / "b.mov");
+        Touch(input / "a.mkv");
+        Touch(input / "notes.txt");
+
+        const std::vector<BatchEntry> entries = LoadBatch(input.GetPath().string(), output.GetPath().string());
+        ASSERT_EQ(entries.size(), 2U);
+        EXPECT_EQ(entries[0].inputFName, input / "a.mkv");
+        EXPECT_EQ(entries[0].outputFName, output / "a.mp4");
+        EXPECT_EQ(entries[1].inputFName, input / "b.mov");
+        EXPECT_EQ(entries[1].outputFName, output / "b.mp4");
+    }
+
+    TEST(BatchManifestTests, RejectsJobsWritingTheSameOutput)
+    {
+        TemporaryDirectory input;
+        TemporaryDirectory output;
+        Touch(input / "a.mov");
+        Touch(input / "a.mkv");
+
+        EXPECT_THROW(LoadBatch(input.GetPath().string(), output.GetPath().string()), AppException);
+
+        // also when the manifest names the same output twice:
+        const std::string manifestFName = input / "manifest.txt";
+        std::ofstream(manifestFName) << input / "a.mov" << '|' << "x.mp4\n" << input / "a.mkv" << '|' << "x.mp4\n";
+        EXPECT_THROW(LoadBatch(manifestFName, output.GetPath().string()), AppException);
+    }
+
+    TEST(BatchManifestTests, RejectsJobsOverwritingInput)
+    {
+        TemporaryDirectory directory;
+        Touch(directory / "a.mp4");
+
+        // placed next to the input, "a.mp4" is transcoded to itself:
+        EXPECT_THROW(LoadBatch(directory.GetPath().string(), directory.GetPath().string()), AppException);
+
+        // or the output of a job can be the input of another:
+        TemporaryDirectory output;
+        const std::string manifestFName = directory / "manifest.txt";
+        std::ofstream(manifestFName) << directory / "a.mp4" << '|' << "b.mp4\n"
+                                     << directory / "c.mov" << '|' << directory / "a.mp4" << '\n';
+        EXPECT_THROW(LoadBatch(manifestFName, output.GetPath().string()), AppException);
+    }
+}
@@ -0,0 +1,83 @@
+#include "BufferedFileWriter.hpp"
+#include "AppException.hpp"
+#include "SyntheticMp4.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <random>
+
+namespace application::tests
+{
+    TEST(BufferedFileWriterTests, SmallWritesAndPatchesReachTheFile)
+    {
+        TemporaryDirectory directory;
+        const std::string fileName = directory / "output.bin";
+        std::mt19937 random(1);
+        std::vector<uint8_t> expected;
+
+        BufferedFileWriter writer(fileName, WriteBufferOptions{ 1 << 16, 3 }, 10 << 20);
+        uint64_t position = 0;
+        for (int count = 0; count < 3000; ++count)
+        {
+            std::vector<uint8_t> data(random() % 3000 + 1);
+            for (auto& byte : data)
+                byte = static_cast<uint8_t>(random());
+
+            const uint64_t boxStart = position;
+            writer.Write(data.data(), data.size());
+            expected.resize(std::max<size_t>(expected.size(), position + data.size()));
+            std::copy(data.begin(), data.end(), expected.begin() + position);
+            position += data.size();
+
+            // patch the size of a box just written, sometimes in a buffer already submitted:
+            if (count % 7 == 0)
+            {
+                const uint64_t patchAt = (boxStart > 100000 && count % 14 == 0) ? boxStart - 100000 : boxStart;
+                const uint8_t patch[4] = { 1, 2, 3, 4 };
+                writer.Seek(patchAt);
+                writer.Write(patch, sizeof patch);
+                std::copy(patch, patch + 4, expected.begin() + patchAt);
+                writer.Seek(position);
+            }
+        }
+
+        EXPECT_EQ(writer.GetLength(), expected.size());
+        writer.Close();
+        EXPECT_EQ(ReadFile(fileName), expected);
+    }
+
+    TEST(BufferedFileWriterTests, TruncatesPreallocationOnClose)
+    {
+        TemporaryDirectory directory;
+        const std::string fileName = directory / "output.bin";
+        {
+            BufferedFileWriter writer(fileName, WriteBufferOptions{}, 8 << 20);
+            const std::vector<uint8_t> data(1000, 7);
+            writer.Write(data.data(), data.size());
+            writer.Close();
+            writer.Close();
+        }
+        EXPECT_EQ(std::filesystem::file_size(fileName), 1000U);
+    }
+
+    TEST(BufferedFileWriterTests, SetLengthCutsTheFile)
+    {
+        TemporaryDirectory directory;
+        const std::string fileName = directory / "output.bin";
+        {
+            BufferedFileWriter writer(fileName, WriteBufferOptions{ 4096, 2 });
+            const std::vector<uint8_t> data(10000, 7);
+            writer.Write(data.data(), data.size());
+            writer.SetLength(5000);
+        }
+        EXPECT_EQ(std::filesystem::file_size(fileName), 5000U);
+    }
+
+    TEST(BufferedFileWriterTests, FailsToCreateInMissingDirectory)
+    {
+        TemporaryDirectory directory;
+        EXPECT_THROW(BufferedFileWriter(directory / "missing/output.bin", WriteBufferOptions{}), AppException);
+    }
+}
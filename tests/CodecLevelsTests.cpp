@@ -0,0 +1,57 @@
+#include "CodecLevels.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+namespace application::tests
+{
+    TEST(CodecLevelsTests, SelectsLowestH264LevelAdmittingTheStream)
+    {
+        EXPECT_EQ(SelectCodecLevel(Encoder::H264_AVC, { 1920, 1080, 30, 8000000 }), 40U);
+        EXPECT_EQ(SelectCodecLevel(Encoder::H264_AVC, { 1920, 1080, 60, 8000000 }), 42U);
+        EXPECT_EQ(SelectCodecLevel(Encoder::H264_AVC, { 1280, 720, 30, 5000000 }), 31U);
+        EXPECT_EQ(SelectCodecLevel(Encoder::H264_AVC, { 3840, 2160, 60, 40000000 }), 52U);
+    }
+
+    TEST(CodecLevelsTests, BitrateRaisesTheLevel)
+    {
+        // High profile admits 1.25 times the bitrate of Table A-1:
+        EXPECT_EQ(SelectCodecLevel(Encoder::H264_AVC, { 1920, 1080, 30, 25000000 }), 40U);
+        EXPECT_EQ(SelectCodecLevel(Encoder::H264_AVC, { 1920, 1080, 30, 25000001 }), 41U);
+    }
+
+    TEST(CodecLevelsTests, HighProfileLimitsTheVideoCodingLayer)
+    {
+        // MaxBR of level 5.1 times cpbBrVclFactor (1250), with levels 5.2 and 6 admitting no more:
+        EXPECT_EQ(SelectCodecLevel(Encoder::H264_AVC, { 3840, 2160, 30, 300000000 }), 51U);
+        EXPECT_EQ(SelectCodecLevel(Encoder::H264_AVC, { 3840, 2160, 30, 300000001 }), 61U);
+
+        // what cpbBrNalFactor (1500) would still admit in level 5.1:
+        EXPECT_EQ(SelectCodecLevel(Encoder::H264_AVC, { 3840, 2160, 30, 360000000 }), 61U);
+
+        // Main tier of HEVC level 4 takes MaxBR as it is (CpbBrVclFactor of 1000):
+        EXPECT_EQ(SelectCodecLevel(Encoder::H265_HEVC, { 1920, 1080, 30, 12000000 }), 120U);
+        EXPECT_EQ(SelectCodecLevel(Encoder::H265_HEVC, { 1920, 1080, 30, 12000001 }), 123U);
+    }
+
+    TEST(CodecLevelsTests, SelectsLowestHevcLevelAdmittingTheStream)
+    {
+        EXPECT_EQ(SelectCodecLevel(Encoder::H265_HEVC, { 1920, 1080, 30, 8000000 }), 120U);
+        EXPECT_EQ(SelectCodecLevel(Encoder::H265_HEVC, { 3840, 2160, 60, 40000000 }), 153U);
+        EXPECT_EQ(SelectCodecLevel(Encoder::H265_HEVC, { 1280, 720, 60, 3000000 }), 120U);
+    }
+
+    TEST(CodecLevelsTests, NoLevelWhenNoneAdmitsTheStream)
+    {
+        EXPECT_EQ(SelectCodecLevel(Encoder::H264_AVC, { 16384, 8704, 30, 1000000 }), 0U);
+        EXPECT_EQ(SelectCodecLevel(Encoder::AV1, { 1920, 1080, 30, 1 }), 0U);
+    }
+
+    TEST(CodecLevelsTests, NamesLevelsAsInTheSpec)
+    {
+        EXPECT_EQ(std::string(GetCodecLevelName(Encoder::H264_AVC, 41)), "4.1");
+        EXPECT_EQ(std::string(GetCodecLevelName(Encoder::H265_HEVC, 153)), "5.1");
+        EXPECT_EQ(std::string(GetCodecLevelName(Encoder::H264_AVC, 7)), "unknown");
+    }
+}
@@ -0,0 +1,114 @@
+#include "EncoderRegistry.hpp"
+#include "SyntheticMp4.hpp"
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <sstream>
+
+namespace application::tests
+{
+    static std::vector<EncoderCapability> MakeEncoders()
+    {
+        return {
+            { "H264 Encoder MFT", "{6CA50344-051A-4DED-9779-A43305165E35}", Encoder::H264_AVC, false, false, 0, 0 },
+            { "NVIDIA HEVC Encoder MFT", "{966F107C-8EA2-425D-B822-E4A71BEF01D7}", Encoder::H265_HEVC, true, true, 8192, 8192 },
+            { "AV1 Encoder MFT", "{3B1F2A5C-0000-4D8E-9C1A-7A5B2E6F0D11}", Encoder::AV1, true, true, 0, 0 }
+        };
+    }
+
+    static std::string ReadText(const std::string& fileName)
+    {
+        std::ifstream file(fileName, std::ios::binary);
+        std::ostringstream content;
+        content << file.rdbuf();
+        return content.str();
+    }
+
+    static void WriteText(const std::string& fileName, const std::string& text)
+    {
+        std::ofstream(fileName, std::ios::binary) << text;
+    }
+
+    TEST(EncoderRegistryTests, RoundTripsThroughSerialization)
+    {
+        const EncoderRegistry registry(MakeEncoders(), "os 10.0.22631; driver 31.0.15.5222");
+        const auto restored = EncoderRegistry::Deserialize(
+            registry.Serialize(registry.GetSystemFingerprint()), registry.GetSystemFingerprint());
+
+        ASSERT_TRUE(restored.has_value());
+        EXPECT_EQ(restored->GetSystemFingerprint(), registry.GetSystemFingerprint());
+        ASSERT_EQ(restored->GetEncoders().size(), registry.GetEncoders().size());
+        for (size_t idx = 0; idx < registry.GetEncoders().size(); ++idx)
+        {
+            const EncoderCapability& expected = registry.GetEncoders()[idx];
+            const EncoderCapability& actual = restored->GetEncoders()[idx];
+            EXPECT_EQ(actual.name, expected.name);
+            EXPECT_EQ(actual.clsid, expected.clsid);
+            EXPECT_EQ(actual.codec, expected.codec);
+            EXPECT_EQ(actual.hardware, expected.hardware);
+            EXPECT_EQ(actual.async, expected.async);
+            EXPECT_EQ(actual.maxWidth, expected.maxWidth);
+            EXPECT_EQ(actual.maxHeight, expected.maxHeight);
+        }
+
+        // an empty registry also makes a valid cache:
+        EXPECT_TRUE(EncoderRegistry::Deserialize(EncoderRegistry().Serialize("os"), "os").has_value());
+    }
+
+    TEST(EncoderRegistryTests, RejectsCacheOfAnotherSystem)
+    {
+        const EncoderRegistry registry(MakeEncoders(), "driver 1");
+        EXPECT_FALSE(EncoderRegistry::Deserialize(registry.Serialize("driver 1"), "driver 2").has_value());
+
+        TemporaryDirectory directory;
+        const std::string cacheFName = (directory.GetPath() / "cache" / "encoders.txt").string();
+        int enumerations = 0;
+        const auto enumerate = [&enumerations]() { ++enumerations; return MakeEncoders(); };
+
+        // made, then found:
+        EXPECT_EQ(LoadEncoderRegistry(cacheFName, "driver 1", enumerate).GetEncoders().size(), 3U);
+        EXPECT_EQ(LoadEncoderRegistry(cacheFName, "driver 1", enumerate).GetEncoders().size(), 3U);
+        EXPECT_EQ(enumerations, 1);
+
+        // stale after a driver update, so made again for the new one:
+        const EncoderRegistry updated = LoadEncoderRegistry(cacheFName, "driver 2", enumerate);
+        EXPECT_EQ(enumerations, 2);
+        EXPECT_EQ(updated.GetSystemFingerprint(), "driver 2");
+        EXPECT_TRUE(EncoderRegistry::Deserialize(ReadText(cacheFName), "driver 2").has_value());
+    }
+
+    TEST(EncoderRegistryTests, RejectsTruncatedOrCorruptCache)
+    {
+        const std::string text = EncoderRegistry(MakeEncoders(), "driver 1").Serialize("driver 1");
+        for (size_t size = 0; size < text.size(); ++size)
+        {
+            EXPECT_FALSE(EncoderRegistry::Deserialize(text.substr(0, size), "driver 1").has_value())
+                << "truncated to " << size << " bytes";
+        }
+
+        const auto corrupt = [&text](const std::string& from, const std::string& to)
+        {
+            std::string corrupted = text;
+            corrupted.replace(corrupted.find(from), from.size(), to);
+            return EncoderRegistry::Deserialize(corrupted, "driver 1").has_value();
+        };
+
+        EXPECT_FALSE(corrupt("encoder registry", "encoder registri"));
+        EXPECT_FALSE(corrupt("\thevc\t", "\tvp9\t"));
+        EXPECT_FALSE(corrupt("\t8192\t", "\twide\t"));
+        EXPECT_FALSE(corrupt("end\n", "end\nencoder\n"));
+
+        TemporaryDirectory directory;
+        const std::string cacheFName = directory / "encoders.txt";
+        WriteText(cacheFName, text.substr(0, text.size() / 2));
+
+        int enumerations = 0;
+        const EncoderRegistry registry = LoadEncoderRegistry(cacheFName, "driver 1",
+            [&enumerations]() { ++enumerations; return MakeEncoders(); });
+
+        EXPECT_EQ(enumerations, 1);
+        EXPECT_EQ(registry.GetEncoders().size(), 3U);
+        EXPECT_EQ(ReadText(cacheFName), text);
+    }
+}
@@ -0,0 +1,182 @@
+#include "IsoBmff.hpp"
+#include "Mp4Probe.hpp"
+#include "SyntheticMp4.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+namespace application::tests
+{
+    using namespace std::chrono;
+
+    /// <summary>
+    /// Calculates the peak bitrate over a window of 1 s the slow way.
+    /// </summary>
+    static uint64_t CalculatePeakBitrate(const SyntheticMp4Options& options, const std::vector<uint32_t>& sizes)
+    {
+        const uint32_t framesPerWindow = options.timescale / options.frameDuration;
+        uint64_t peakBytes = 0;
+        for (size_t first = 0; first < sizes.size(); ++first)
+        {
+            uint64_t bytes = 0;
+            for (size_t idx = first; idx < std::min<size_t>(first + framesPerWindow, sizes.size()); ++idx)
+                bytes += sizes[idx];
+            peakBytes = std::max(peakBytes, bytes);
+        }
+        return peakBytes * 8;
+    }
+
+    TEST(IsoBmffTests, ParsesMovieStructure)
+    {
+        SyntheticMp4Options options;
+        const auto mp4 = MakeSyntheticMp4(options);
+
+        ASSERT_TRUE(IsIsoBmff(mp4.data.data(), mp4.data.size()));
+        const IsoBmffMovie movie = ParseIsoBmff(mp4.data.data(), mp4.data.size());
+        EXPECT_FALSE(movie.isFragmented);
+        ASSERT_EQ(movie.tracks.size(), 2U);
+
+        const IsoBmffTrack& video = movie.tracks[0];
+        EXPECT_EQ(video.handlerType, MakeFourCC("vide"));
+        EXPECT_EQ(video.codec, MakeFourCC("avc1"));
+        EXPECT_EQ(video.timescale, options.timescale);
+        EXPECT_EQ(video.sampleCount, options.frameCount);
+        EXPECT_EQ(video.width, 1920);
+        EXPECT_EQ(video.decoderConfig.type, MakeFourCC("avcC"));
+
+        const IsoBmffTrack& audio = movie.tracks[1];
+        EXPECT_EQ(audio.handlerType, MakeFourCC("soun"));
+        EXPECT_EQ(audio.codec, MakeFourCC("mp4a"));
+        EXPECT_EQ(audio.objectTypeIndication, 0x40);
+        EXPECT_EQ(audio.sampleCount, mp4.audioSampleCount);
+    }
+
+    TEST(IsoBmffTests, ExpandsSampleTables)
+    {
+        for (bool largeChunkOffsets : { false, true })
+        {
+            SyntheticMp4Options options;
+            options.largeChunkOffsets = largeChunkOffsets;
+            options.moovFirst = largeChunkOffsets;
+            const auto mp4 = MakeSyntheticMp4(options);
+            const IsoBmffMovie movie = ParseIsoBmff(mp4.data.data(), mp4.data.size());
+            EXPECT_EQ(movie.tracks[0].hasLargeChunkOffsets, largeChunkOffsets);
+
+            const auto samples = GetSamples(movie.tracks[0]);
+            ASSERT_EQ(samples.size(), options.frameCount);
+            for (size_t idx = 0; idx < samples.size(); ++idx)
+            {
+                EXPECT_EQ(samples[idx].size, mp4.videoSampleSizes[idx]);
+                EXPECT_EQ(samples[idx].decodeTime, idx * options.frameDuration);
+                EXPECT_EQ(samples[idx].isSync, idx % options.gopSize == 0);
+
+                // every sample starts with the length of its first NAL unit, inside the file:
+                ASSERT_LE(samples[idx].offset + samples[idx].size, mp4.data.size());
+                const uint8_t* data = mp4.data.data() + samples[idx].offset;
+                const uint32_t firstLength = (data[0] << 24) | (data[1] << 16) | (data[2] << 8) | data[3];
+                EXPECT_LT(firstLength, samples[idx].size);
+            }
+        }
+    }
+
+    TEST(IsoBmffTests, RejectsOtherFiles)
+    {
+        const std::vector<uint8_t> notMp4(100, 0x47);
+        EXPECT_FALSE(IsIsoBmff(notMp4.data(), notMp4.size()));
+
+        TemporaryDirectory directory;
+        WriteFile(directory / "not.mp4", notMp4);
+        EXPECT_FALSE(ProbeMp4File(directory / "not.mp4", StreamSelectionPolicy{}));
+        EXPECT_FALSE(ProbeMp4File(directory / "missing.mp4", StreamSelectionPolicy{}));
+    }
+
+    TEST(Mp4ProbeTests, CalculatesExactBitrates)
+    {
+        TemporaryDirectory directory;
+        SyntheticMp4Options options;
+        const auto mp4 = WriteSyntheticMp4(directory / "input.mp4", options);
+
+        const auto probe = ProbeMp4File(directory / "input.mp4", StreamSelectionPolicy{});
+        ASSERT_TRUE(probe);
+
+        const auto& video = probe->info.videoProfile;
+        const uint64_t duration = static_cast<uint64_t>(options.frameCount) * options.frameDuration;
+        EXPECT_EQ(video.avgBitrate, mp4.videoBytes * 8 * options.timescale / duration);
+        EXPECT_EQ(video.peakBitrate, CalculatePeakBitrate(options, mp4.videoSampleSizes));
+        EXPECT_EQ(video.frameRate.numerator, 25U);
+        EXPECT_EQ(video.frameRate.denominator, 1U);
+        EXPECT_EQ(video.format, Encoder::H264_AVC);
+        ASSERT_TRUE(video.coding);
+        EXPECT_EQ(video.coding->levelIdc, options.levelIdc);
+        EXPECT_EQ(probe->duration, seconds(10));
+
+        const auto& audio = probe->info.audioProfile;
+        EXPECT_TRUE(audio.isAac);
+        EXPECT_EQ(audio.numChannels, 2U);
+        EXPECT_EQ(audio.samplesPerSec, 48000U);
+        EXPECT_EQ(audio.avgBytesPerSec, 16000U); // declared in 'esds'
+    }
+
+    TEST(Mp4ProbeTests, CalculatesBitrateOfLongPcmWithoutExpandingTables)
+    {
+        TemporaryDirectory directory;
+        SyntheticMp4Options options;
+        options.audio = SyntheticAudio::Pcm;
+        options.pcmSampleCount = 3'000'000'000; // 24 GB of sample times if expanded
+        WriteSyntheticMp4(directory / "input.mov", options);
+
+        const auto start = steady_clock::now();
+        const auto probe = ProbeMp4File(directory / "input.mov", StreamSelectionPolicy{});
+        ASSERT_TRUE(probe);
+        EXPECT_LT(steady_clock::now() - start, seconds(1));
+
+        const auto& audio = probe->info.audioProfile;
+        EXPECT_FALSE(audio.isAac);
+        EXPECT_EQ(audio.avgBytesPerSec, 48000U); // a byte per sample in the tables
+        EXPECT_EQ(probe->info.videoProfile.frameRate.numerator, 25U);
+    }
+
+    TEST(Mp4ProbeTests, ListsKeyframes)
+    {
+        TemporaryDirectory directory;
+        SyntheticMp4Options options;
+        options.codec = Encoder::H265_HEVC;
+        options.levelIdc = 120;
+        options.profileIdc = 1;
+        options.moovFirst = true;
+        WriteSyntheticMp4(directory / "input.mp4", options);
+
+        const auto probe = ProbeMp4File(directory / "input.mp4", StreamSelectionPolicy{});
+        ASSERT_TRUE(probe);
+        EXPECT_EQ(probe->info.videoProfile.format, Encoder::H265_HEVC);
+        ASSERT_EQ(probe->keyframeTimes.size(), 10U);
+        for (size_t idx = 0; idx < probe->keyframeTimes.size(); ++idx)
+            EXPECT_EQ(probe->keyframeTimes[idx], seconds(idx));
+    }
+
+    TEST(Mp4ProbeTests, DescribesStreamLayout)
+    {
+        TemporaryDirectory directory;
+        WriteSyntheticMp4(directory / "input.mp4", SyntheticMp4Options());
+
+        const auto probe = ProbeMp4File(directory / "input.mp4", StreamSelectionPolicy{});
+        ASSERT_TRUE(probe);
+        EXPECT_EQ(probe->layout.videoCount, 1U);
+        EXPECT_EQ(probe->layout.audioCount, 1U);
+        EXPECT_EQ(probe->layout.choice.video, 0U);
+        EXPECT_EQ(probe->layout.choice.audio, 1U);
+    }
+
+    TEST(Mp4ProbeTests, ProbesVideoBitrateOfOutput)
+    {
+        TemporaryDirectory directory;
+        SyntheticMp4Options options;
+        options.audio = SyntheticAudio::None;
+        const auto mp4 = WriteSyntheticMp4(directory / "output.mp4", options);
+
+        const auto bitrate = ProbeVideoBitrate(directory / "output.mp4");
+        ASSERT_TRUE(bitrate);
+        EXPECT_EQ(*bitrate, mp4.videoBytes * 8 / 10);
+    }
+}
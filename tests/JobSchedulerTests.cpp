@@ -0,0 +1,125 @@
+#include "JobScheduler.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace application::tests
+{
+    /// <summary>
+    /// Keeps the highest count reached by a counter of running jobs.
+    /// </summary>
+    class ConcurrencyMeter
+    {
+    private:
+
+        std::atomic<uint32_t> m_running{ 0 };
+        std::atomic<uint32_t> m_highest{ 0 };
+
+    public:
+
+        void Enter()
+        {
+            const uint32_t running = ++m_running;
+            uint32_t highest = m_highest;
+            while (running > highest && !m_highest.compare_exchange_weak(highest, running))
+            {
+            }
+        }
+
+        void Leave()
+        {
+            --m_running;
+        }
+
+        uint32_t GetHighest() const
+        {
+            return m_highest;
+        }
+    };
+
+    TEST(JobSchedulerTests, RunsEveryJobOnce)
+    {
+        JobScheduler scheduler(3);
+        std::vector<std::atomic<int>> runs(50);
+        scheduler.Run(runs.size(), [&runs](size_t jobIdx) { ++runs[jobIdx]; });
+
+        for (const auto& count : runs)
+            EXPECT_EQ(count, 1);
+    }
+
+    TEST(JobSchedulerTests, CapsConcurrentJobs)
+    {
+        JobScheduler scheduler(3);
+        ConcurrencyMeter meter;
+        scheduler.Run(12, [&meter](size_t)
+        {
+            meter.Enter();
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            meter.Leave();
+        });
+
+        EXPECT_LE(meter.GetHighest(), 3U);
+        EXPECT_GE(meter.GetHighest(), 2U);
+    }
+
+    TEST(JobSchedulerTests, DefaultConcurrencyIsBounded)
+    {
+        EXPECT_GE(JobScheduler::GetDefaultConcurrency(), 1U);
+        EXPECT_LE(JobScheduler::GetDefaultConcurrency(), 4U);
+        EXPECT_EQ(JobScheduler(0).GetMaxConcurrentJobs(), JobScheduler::GetDefaultConcurrency());
+    }
+
+    TEST(JobSchedulerTests, PlacesJobsOnHardwareWhileThereAreSlots)
+    {
+        JobScheduler scheduler(6);
+        ConcurrencyMeter hardwareMeter;
+        std::atomic<uint32_t> hardwareJobs(0);
+        scheduler.Run(12, 2, [&](size_t, bool useHardware)
+        {
+            if (useHardware)
+            {
+                hardwareMeter.Enter();
+                ++hardwareJobs;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            if (useHardware)
+                hardwareMeter.Leave();
+        });
+
+        EXPECT_EQ(hardwareMeter.GetHighest(), 2U);
+        EXPECT_GE(hardwareJobs, 2U);
+    }
+
+    TEST(JobSchedulerTests, NoHardwareSlotsMeansSoftwareOnly)
+    {
+        JobScheduler scheduler(4);
+        std::atomic<uint32_t> hardwareJobs(0);
+        scheduler.Run(8, 0, [&hardwareJobs](size_t, bool useHardware)
+        {
+            if (useHardware)
+                ++hardwareJobs;
+        });
+
+        EXPECT_EQ(hardwareJobs, 0U);
+    }
+
+    TEST(JobSchedulerTests, RethrowsFirstFailureAfterRunningAll)
+    {
+        JobScheduler scheduler(2);
+        std::atomic<uint32_t> runs(0);
+        EXPECT_THROW(scheduler.Run(10, [&runs](size_t jobIdx)
+        {
+            ++runs;
+            if (jobIdx % 3 == 0)
+                throw std::runtime_error("job failed");
+        }), std::runtime_error);
+
+        EXPECT_EQ(runs, 10U);
+    }
+}
@@ -0,0 +1,69 @@
+#include "Mp4Concatenation.hpp"
+#include "AppException.hpp"
+#include "IsoBmff.hpp"
+#include "NalScanner.hpp"
+#include "SyntheticMp4.hpp"
+
+#include <gtest/gtest.h>
+
+namespace application::tests
+{
+    /// <summary>
+    /// Makes the key frame that starts the video of a synthetic MP4 a picture that depends on others,
+    /// while the sync sample table still says otherwise.
+    /// </summary>
+    static void BreakFirstKeyframe(SyntheticMp4& mp4, Encoder codec)
+    {
+        const IsoBmffMovie movie = ParseIsoBmff(mp4.data.data(), mp4.data.size());
+        const IsoBmffSample sample = GetSamples(movie.tracks.front()).front();
+        uint8_t* const sampleData = mp4.data.data() + sample.offset;
+
+        for (const NalUnit& nal : ScanLengthPrefixed(sampleData, sample.size, 4, codec))
+        {
+            if (IsRandomAccessNal(nal.type, codec))
+                sampleData[nal.offset] = codec == Encoder::H264_AVC ? 0x41 : 1 << 1;
+        }
+    }
+
+    TEST(Mp4ConcatenationTests, JoinsPartsStartingWithKeyframes)
+    {
+        for (Encoder codec : { Encoder::H264_AVC, Encoder::H265_HEVC })
+        {
+            TemporaryDirectory directory;
+            SyntheticMp4Options options;
+            options.codec = codec;
+            options.frameCount = 50;
+            WriteSyntheticMp4(directory / "part1.mp4", options);
+            options.seed = 2;
+            WriteSyntheticMp4(directory / "part2.mp4", options);
+
+            ConcatenateMp4Files({ directory / "part1.mp4", directory / "part2.mp4" }, directory / "output.mp4");
+
+            const std::vector<uint8_t> output = ReadFile(directory / "output.mp4");
+            const IsoBmffMovie movie = ParseIsoBmff(output.data(), output.size());
+            ASSERT_EQ(movie.tracks.size(), 2U);
+            EXPECT_EQ(movie.tracks.front().sampleCount, 100U) << GetEncoderName(codec);
+        }
+    }
+
+    TEST(Mp4ConcatenationTests, RejectsPartNotStartingWithKeyframe)
+    {
+        for (Encoder codec : { Encoder::H264_AVC, Encoder::H265_HEVC })
+        {
+            TemporaryDirectory directory;
+            SyntheticMp4Options options;
+            options.codec = codec;
+            options.frameCount = 50;
+            WriteSyntheticMp4(directory / "part1.mp4", options);
+
+            options.seed = 2;
+            SyntheticMp4 part2 = MakeSyntheticMp4(options);
+            BreakFirstKeyframe(part2, codec);
+            WriteFile(directory / "part2.mp4", part2.data);
+
+            EXPECT_THROW(ConcatenateMp4Files({ directory / "part1.mp4", directory / "part2.mp4" },
+                                             directory / "output.mp4"),
+                         AppException) << GetEncoderName(codec);
+        }
+    }
+}
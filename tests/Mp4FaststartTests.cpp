@@ -0,0 +1,73 @@
+#include "Mp4Faststart.hpp"
+#include "IsoBmff.hpp"
+#include "SyntheticMp4.hpp"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+
+namespace application::tests
+{
+    /// <summary>
+    /// Reads the data of every sample in every track, as the sample tables locate it.
+    /// </summary>
+    static std::vector<std::vector<uint8_t>> ReadAllSamples(const std::vector<uint8_t>& file)
+    {
+        const IsoBmffMovie movie = ParseIsoBmff(file.data(), file.size());
+        std::vector<std::vector<uint8_t>> samples;
+        for (const IsoBmffTrack& track : movie.tracks)
+        {
+            for (const IsoBmffSample& sample : GetSamples(track))
+            {
+                EXPECT_LE(sample.offset + sample.size, file.size());
+                samples.emplace_back(file.begin() + sample.offset, file.begin() + sample.offset + sample.size);
+            }
+        }
+        return samples;
+    }
+
+    static std::vector<uint32_t> ListTopLevelBoxes(const std::vector<uint8_t>& file)
+    {
+        std::vector<uint32_t> types;
+        BigEndianReader reader(file.data(), file.size());
+        IsoBmffBox box;
+        while (ReadNextBox(reader, box))
+            types.push_back(box.type);
+
+        return types;
+    }
+
+    TEST(Mp4FaststartTests, MovesMovieInFrontOfMediaData)
+    {
+        TemporaryDirectory directory;
+        const auto mp4 = WriteSyntheticMp4(directory / "output.mp4", SyntheticMp4Options());
+
+        ASSERT_TRUE(MoveMovieToFront(directory / "output.mp4"));
+        const std::vector<uint8_t> moved = ReadFile(directory / "output.mp4");
+
+        EXPECT_EQ(moved.size(), mp4.data.size());
+        EXPECT_EQ(ListTopLevelBoxes(moved),
+                  (std::vector<uint32_t>{ MakeFourCC("ftyp"), MakeFourCC("moov"), MakeFourCC("mdat") }));
+        EXPECT_EQ(ReadAllSamples(moved), ReadAllSamples(mp4.data));
+
+        EXPECT_FALSE(MoveMovieToFront(directory / "output.mp4"));
+    }
+
+    TEST(Mp4FaststartTests, PadsMovieThatShrinksWithSmallerChunkOffsets)
+    {
+        // 'co64' with offsets that fit in 32 bits becomes 'stco', which makes the movie smaller:
+        TemporaryDirectory directory;
+        SyntheticMp4Options options;
+        options.largeChunkOffsets = true;
+        const auto mp4 = WriteSyntheticMp4(directory / "output.mp4", options);
+
+        ASSERT_TRUE(MoveMovieToFront(directory / "output.mp4"));
+        const std::vector<uint8_t> moved = ReadFile(directory / "output.mp4");
+
+        EXPECT_EQ(moved.size(), mp4.data.size());
+        EXPECT_EQ(ListTopLevelBoxes(moved),
+                  (std::vector<uint32_t>{ MakeFourCC("ftyp"), MakeFourCC("moov"), MakeFourCC("free"), MakeFourCC("mdat") }));
+        EXPECT_FALSE(ParseIsoBmff(moved.data(), moved.size()).tracks.front().hasLargeChunkOffsets);
+        EXPECT_EQ(ReadAllSamples(moved), ReadAllSamples(mp4.data));
+    }
+}
@@ -0,0 +1,159 @@
+#include "NalScanner.hpp"
+#include "AppException.hpp"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+namespace application::tests
+{
+    /// <summary>
+    /// Gets the instruction sets this CPU can scan with.
+    /// </summary>
+    static std::vector<SimdLevel> GetSupportedLevels()
+    {
+        std::vector<SimdLevel> levels{ SimdLevel::Scalar };
+        switch (GetSupportedSimdLevel())
+        {
+        case SimdLevel::Avx2:
+            levels.push_back(SimdLevel::Sse2);
+            levels.push_back(SimdLevel::Avx2);
+            break;
+        case SimdLevel::Sse2:
+        case SimdLevel::Neon:
+            levels.push_back(GetSupportedSimdLevel());
+            break;
+        default:
+            break;
+        }
+        return levels;
+    }
+
+    /// <summary>
+    /// A byte stream with NAL units of random sizes (which contain no start codes),
+    /// delimited by start codes of 3 and 4 bytes.
+    /// </summary>
+    struct AnnexBStream
+    {
+        std::vector<uint8_t> data;
+        std::vector<NalUnit> nalUnits;
+    };
+
+    static AnnexBStream MakeAnnexBStream(uint32_t nalCount, uint32_t seed)
+    {
+        std::mt19937 random(seed);
+        AnnexBStream stream;
+        for (uint32_t idx = 0; idx < nalCount; ++idx)
+        {
+            if (random() % 2)
+                stream.data.push_back(0);
+            stream.data.insert(stream.data.end(), { 0, 0, 1 });
+
+            const uint64_t offset = stream.data.size();
+            const uint8_t type = static_cast<uint8_t>(1 + random() % 23);
+            stream.data.push_back(type);
+            const uint32_t size = 1 + random() % 300;
+            for (uint32_t count = 1; count < size; ++count)
+            {
+                // no 00 00 0X inside (as after emulation prevention), but plenty of zeros:
+                const auto byte = static_cast<uint8_t>(random() % 4 == 0 ? 0 : random());
+                const size_t length = stream.data.size();
+                if (byte <= 3 && stream.data[length - 1] == 0 && stream.data[length - 2] == 0)
+                    stream.data.push_back(3);
+                stream.data.push_back(byte);
+            }
+
+            // a NAL unit never ends with a zero byte:
+            if (stream.data.back() == 0)
+                stream.data.push_back(0x80);
+
+            stream.nalUnits.push_back(NalUnit{ offset, stream.data.size() - offset, type });
+        }
+        return stream;
+    }
+
+    TEST(NalScannerTests, FindsAllNalUnitsInAnnexB)
+    {
+        const auto stream = MakeAnnexBStream(2000, 7);
+        for (SimdLevel level : GetSupportedLevels())
+        {
+            SCOPED_TRACE(GetSimdLevelName(level));
+            const auto nalUnits = ScanAnnexB(stream.data.data(), stream.data.size(), Encoder::H264_AVC, level);
+            ASSERT_EQ(nalUnits.size(), stream.nalUnits.size());
+            for (size_t idx = 0; idx < nalUnits.size(); ++idx)
+            {
+                EXPECT_EQ(nalUnits[idx].offset, stream.nalUnits[idx].offset);
+                EXPECT_EQ(nalUnits[idx].size, stream.nalUnits[idx].size);
+                EXPECT_EQ(nalUnits[idx].type, stream.nalUnits[idx].type);
+            }
+        }
+    }
+
+    TEST(NalScannerTests, FindsStartCodesAtEveryAlignment)
+    {
+        for (SimdLevel level : GetSupportedLevels())
+        {
+            SCOPED_TRACE(GetSimdLevelName(level));
+            for (size_t position = 0; position < 70; ++position)
+            {
+                std::vector<uint8_t> data(80, 0xAB);
+                data[position] = 0;
+                data[position + 1] = 0;
+                data[position + 2] = 1;
+                data[position + 3] = 0x65;
+
+                const auto nalUnits = ScanAnnexB(data.data(), data.size(), Encoder::H264_AVC, level);
+                ASSERT_EQ(nalUnits.size(), 1U) << "start code at " << position;
+                EXPECT_EQ(nalUnits[0].offset, position + 3);
+                EXPECT_EQ(nalUnits[0].size, data.size() - position - 3);
+                EXPECT_EQ(nalUnits[0].type, 5);
+            }
+        }
+    }
+
+    TEST(NalScannerTests, ScansLengthPrefixedSamples)
+    {
+        const std::vector<uint8_t> sample{
+            0, 0, 0, 3, 0x67, 1, 2,
+            0, 0, 0, 2, 0x68, 3,
+            0, 0, 0, 4, 0x65, 4, 5, 6 };
+
+        const auto nalUnits = ScanLengthPrefixed(sample.data(), sample.size(), 4, Encoder::H264_AVC);
+        ASSERT_EQ(nalUnits.size(), 3U);
+        EXPECT_EQ(nalUnits[0].offset, 4U);
+        EXPECT_EQ(nalUnits[0].type, 7);
+        EXPECT_EQ(nalUnits[1].size, 2U);
+        EXPECT_EQ(nalUnits[2].type, 5);
+        EXPECT_TRUE(IsParameterSetNal(nalUnits[0].type, Encoder::H264_AVC));
+        EXPECT_TRUE(IsRandomAccessNal(nalUnits[2].type, Encoder::H264_AVC));
+    }
+
+    TEST(NalScannerTests, RejectsLengthPastTheEnd)
+    {
+        const std::vector<uint8_t> sample{ 0, 0, 0, 9, 0x65, 1 };
+        EXPECT_THROW(ScanLengthPrefixed(sample.data(), sample.size(), 4, Encoder::H264_AVC), AppException);
+        EXPECT_THROW(ScanLengthPrefixed(sample.data(), sample.size(), 3, Encoder::H264_AVC), AppException);
+    }
+
+    TEST(NalScannerTests, TellsHevcTypes)
+    {
+        EXPECT_EQ(GetNalType(0x40, Encoder::H265_HEVC), 32);
+        EXPECT_EQ(GetNalType(0x26, Encoder::H265_HEVC), 19);
+        EXPECT_TRUE(IsRandomAccessNal(19, Encoder::H265_HEVC));
+        EXPECT_TRUE(IsRandomAccessNal(21, Encoder::H265_HEVC));
+        EXPECT_FALSE(IsRandomAccessNal(1, Encoder::H265_HEVC));
+        EXPECT_TRUE(IsParameterSetNal(34, Encoder::H265_HEVC));
+    }
+
+    TEST(NalScannerTests, RemovesEmulationPrevention)
+    {
+        const std::vector<uint8_t> nal{ 0x67, 0, 0, 3, 1, 5, 0, 0, 3, 0, 0, 3 };
+        const std::vector<uint8_t> expected{ 0x67, 0, 0, 1, 5, 0, 0, 0, 0 };
+        for (SimdLevel level : GetSupportedLevels())
+        {
+            SCOPED_TRACE(GetSimdLevelName(level));
+            EXPECT_EQ(ExtractRbsp(nal.data(), nal.size(), level), expected);
+        }
+    }
+}
@@ -0,0 +1,90 @@
+#include "OutputCache.hpp"
+#include "ContentFingerprint.hpp"
+#include "OutputFile.hpp"
+#include "SyntheticMp4.hpp"
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <thread>
+
+namespace application::tests
+{
+    static void WriteText(const std::string& fileName, const std::string& text)
+    {
+        std::ofstream(fileName, std::ios::binary) << text;
+    }
+
+    static std::string ReadText(const std::string& fileName)
+    {
+        std::ifstream file(fileName, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    TEST(OutputCacheTests, KeyDependsOnWhatChangesTheOutput)
+    {
+        TemporaryDirectory directory;
+        WriteText(directory / "input", "input");
+        const std::string fingerprint = FingerprintFile(directory / "input");
+
+        TranscodeSettings settings = {};
+        const StreamSelectionPolicy policy;
+        const auto key = OutputCache::MakeKey(fingerprint, settings, policy, false);
+        EXPECT_NE(key, OutputCache::MakeKey(fingerprint, settings, policy, true));
+
+        // where it is encoded does not change what is asked of the output:
+        settings.hardwareAllowed = !settings.hardwareAllowed;
+        EXPECT_EQ(key, OutputCache::MakeKey(fingerprint, settings, policy, false));
+
+        settings.videoAvgBitrate = 5;
+        EXPECT_NE(key, OutputCache::MakeKey(fingerprint, settings, policy, false));
+
+        WriteText(directory / "input", "other input");
+        EXPECT_NE(fingerprint, FingerprintFile(directory / "input"));
+    }
+
+    TEST(OutputCacheTests, FetchesWhatWasStored)
+    {
+        TemporaryDirectory directory;
+        OutputCache cache(directory / "cache", OutputCacheLimits{});
+        EXPECT_FALSE(cache.Fetch("key", directory / "output"));
+
+        WriteText(directory / "output", "0123456789");
+        cache.Store("key", directory / "output");
+
+        // rewriting the output in place must not alter the cached one:
+        {
+            OutputFile file(directory / "output");
+            file.Write(0, "zz", 2);
+        }
+
+        ASSERT_TRUE(cache.Fetch("key", directory / "copy"));
+        EXPECT_EQ(ReadText(directory / "copy"), "0123456789");
+    }
+
+    TEST(OutputCacheTests, EvictsLeastRecentlyUsed)
+    {
+        TemporaryDirectory directory;
+        OutputCacheLimits limits;
+        limits.maxSize = 25;
+        OutputCache cache(directory / "cache", limits);
+
+        WriteText(directory / "output1", "0123456789");
+        cache.Store("key1", directory / "output1");
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        WriteText(directory / "output2", "abcdefghij");
+        cache.Store("key2", directory / "output2");
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        ASSERT_TRUE(cache.Fetch("key1", directory / "copy"));
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+        // exceeds the limit, so the output used least recently goes:
+        WriteText(directory / "output3", "ABCDEFGHIJ");
+        cache.Store("key3", directory / "output3");
+
+        EXPECT_TRUE(cache.Fetch("key1", directory / "copy"));
+        EXPECT_FALSE(cache.Fetch("key2", directory / "copy"));
+        EXPECT_TRUE(cache.Fetch("key3", directory / "copy"));
+        EXPECT_EQ(ReadText(directory / "copy"), "ABCDEFGHIJ");
+    }
+}
@@ -0,0 +1,81 @@
+#include "ParameterSets.hpp"
+#include "SyntheticMp4.hpp"
+
+#include <gtest/gtest.h>
+
+namespace application::tests
+{
+    TEST(ParameterSetsTests, ParsesH264SequenceParameterSet)
+    {
+        SyntheticMp4Options options;
+        options.width = 1920;
+        options.height = 1080;
+        options.profileIdc = 100;
+        options.levelIdc = 41;
+        const auto nal = MakeSequenceParameterSet(options);
+
+        const auto sps = ParseSequenceParameterSet(nal.data(), nal.size(), Encoder::H264_AVC);
+        EXPECT_EQ(sps.profileIdc, 100U);
+        EXPECT_EQ(sps.levelIdc, 41U);
+        EXPECT_EQ(sps.chromaFormatIdc, 1U);
+        EXPECT_EQ(sps.bitDepthLuma, 8U);
+        EXPECT_TRUE(sps.progressive);
+        EXPECT_EQ(sps.width, 1920U);
+        EXPECT_EQ(sps.height, 1080U);
+        EXPECT_EQ(sps.numUnitsInTick, options.frameDuration);
+        EXPECT_EQ(sps.timeScale, options.timescale * 2);
+        EXPECT_FALSE(sps.highTier);
+    }
+
+    TEST(ParameterSetsTests, ParsesHevcParameterSets)
+    {
+        SyntheticMp4Options options;
+        options.codec = Encoder::H265_HEVC;
+        options.width = 1280;
+        options.height = 720;
+        options.profileIdc = 1;
+        options.levelIdc = 93;
+
+        const auto spsNal = MakeSequenceParameterSet(options);
+        const auto sps = ParseSequenceParameterSet(spsNal.data(), spsNal.size(), Encoder::H265_HEVC);
+        EXPECT_EQ(sps.profileIdc, 1U);
+        EXPECT_EQ(sps.levelIdc, 93U);
+        EXPECT_EQ(sps.width, 1280U);
+        EXPECT_EQ(sps.height, 720U);
+        EXPECT_EQ(sps.chromaFormatIdc, 1U);
+
+        const auto vpsNal = MakeVideoParameterSet(options);
+        const auto vps = ParseVideoParameterSet(vpsNal.data(), vpsNal.size());
+        EXPECT_EQ(vps.id, 0U);
+        EXPECT_EQ(vps.maxSubLayers, 1U);
+
+        const auto ppsNal = MakePictureParameterSet(Encoder::H265_HEVC);
+        const auto pps = ParsePictureParameterSet(ppsNal.data(), ppsNal.size(), Encoder::H265_HEVC);
+        EXPECT_EQ(pps.spsId, 0U);
+        EXPECT_FALSE(pps.tilesEnabled);
+    }
+
+    TEST(ParameterSetsTests, ParsesH264PictureParameterSet)
+    {
+        const auto nal = MakePictureParameterSet(Encoder::H264_AVC);
+        const auto pps = ParsePictureParameterSet(nal.data(), nal.size(), Encoder::H264_AVC);
+        EXPECT_EQ(pps.id, 0U);
+        EXPECT_EQ(pps.spsId, 0U);
+        EXPECT_TRUE(pps.cabac);
+    }
+
+    TEST(ParameterSetsTests, CropsToOddHeight)
+    {
+        SyntheticMp4Options options;
+        options.width = 1280;
+        options.height = 718;
+        const auto nal = MakeSequenceParameterSet(options);
+        EXPECT_EQ(ParseSequenceParameterSet(nal.data(), nal.size(), Encoder::H264_AVC).height, 718U);
+    }
+
+    TEST(ParameterSetsTests, RejectsTruncatedSequenceParameterSet)
+    {
+        const auto nal = MakeSequenceParameterSet(SyntheticMp4Options());
+        EXPECT_ANY_THROW(ParseSequenceParameterSet(nal.data(), 4, Encoder::H264_AVC));
+    }
+}
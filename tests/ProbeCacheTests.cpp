@@ -0,0 +1,132 @@
+#include "ProbeCache.hpp"
+#include "SyntheticMp4.hpp"
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+
+namespace application::tests
+{
+    using namespace std::chrono;
+
+    static FileIdentity MakeIdentity(int idx)
+    {
+        return FileIdentity{ "/library/movie" + std::to_string(idx) + ".mp4", uint64_t(idx) * 1000 + 7, int64_t(idx) * 3 };
+    }
+
+    static CachedProbe MakeProbe(int idx)
+    {
+        CachedProbe probe = {};
+        probe.duration = seconds(idx);
+        probe.info.videoProfile.frameSize = { 1920, 1080 };
+        probe.info.videoProfile.format = static_cast<Encoder>(idx % 3);
+        if (idx % 2)
+        {
+            MediaInfo::VideoProfile::Coding coding = {};
+            coding.levelIdc = idx % 200;
+            probe.info.videoProfile.coding = coding;
+        }
+        probe.layout.videoCount = 1;
+        probe.layout.audioCount = idx % 4;
+        probe.layout.choice.video = 0;
+        if (idx % 4)
+            probe.layout.choice.audio = 1;
+
+        return probe;
+    }
+
+    TEST(ProbeCacheTests, FindsWhatWasSaved)
+    {
+        TemporaryDirectory directory;
+        const std::string fileName = directory / "probe.cache";
+        const int count = 5000;
+        {
+            ProbeCache cache(fileName, StreamSelectionPolicy{});
+            for (int idx = 0; idx < count; ++idx)
+                cache.Store(MakeIdentity(idx), MakeProbe(idx));
+
+            // found before saving too:
+            EXPECT_TRUE(cache.Find(MakeIdentity(3)));
+            cache.Save();
+        }
+
+        ProbeCache cache(fileName, StreamSelectionPolicy{});
+        for (int idx = 0; idx < count; ++idx)
+        {
+            const auto probe = cache.Find(MakeIdentity(idx));
+            ASSERT_TRUE(probe);
+            EXPECT_EQ(probe->duration, seconds(idx));
+            EXPECT_EQ(probe->info.videoProfile.format, static_cast<Encoder>(idx % 3));
+            ASSERT_EQ(probe->info.videoProfile.coding.has_value(), idx % 2 == 1);
+            if (probe->info.videoProfile.coding)
+                EXPECT_EQ(probe->info.videoProfile.coding->levelIdc, uint32_t(idx % 200));
+            EXPECT_EQ(probe->layout.audioCount, uint32_t(idx % 4));
+            EXPECT_EQ(probe->layout.choice.audio.has_value(), idx % 4 != 0);
+        }
+    }
+
+    TEST(ProbeCacheTests, MissesChangedFilesAndOtherPolicies)
+    {
+        TemporaryDirectory directory;
+        const std::string fileName = directory / "probe.cache";
+        {
+            ProbeCache cache(fileName, StreamSelectionPolicy{});
+            cache.Store(MakeIdentity(5), MakeProbe(5));
+            cache.Save();
+        }
+
+        ProbeCache cache(fileName, StreamSelectionPolicy{});
+        FileIdentity changed = MakeIdentity(5);
+        ++changed.lastWriteTime;
+        EXPECT_FALSE(cache.Find(changed));
+        changed = MakeIdentity(5);
+        ++changed.size;
+        EXPECT_FALSE(cache.Find(changed));
+
+        StreamSelectionPolicy otherPolicy;
+        otherPolicy.audioLanguage = "de";
+        EXPECT_FALSE(ProbeCache(fileName, otherPolicy).Find(MakeIdentity(5)));
+    }
+
+    TEST(ProbeCacheTests, MergesUpdatesIntoTable)
+    {
+        TemporaryDirectory directory;
+        const std::string fileName = directory / "probe.cache";
+        {
+            ProbeCache cache(fileName, StreamSelectionPolicy{});
+            cache.Store(MakeIdentity(7), MakeProbe(7));
+            cache.Store(MakeIdentity(8), MakeProbe(8));
+            cache.Save();
+        }
+        {
+            ProbeCache cache(fileName, StreamSelectionPolicy{});
+            cache.Store(MakeIdentity(7), MakeProbe(700));
+            cache.Save();
+        }
+
+        ProbeCache cache(fileName, StreamSelectionPolicy{});
+        EXPECT_EQ(cache.Find(MakeIdentity(7))->duration, seconds(700));
+        EXPECT_EQ(cache.Find(MakeIdentity(8))->duration, seconds(8));
+    }
+
+    TEST(ProbeCacheTests, IgnoresMalformedFile)
+    {
+        TemporaryDirectory directory;
+        const std::string fileName = directory / "probe.cache";
+        std::ofstream(fileName, std::ios::binary) << "garbage";
+
+        ProbeCache cache(fileName, StreamSelectionPolicy{});
+        EXPECT_FALSE(cache.Find(MakeIdentity(1)));
+    }
+
+    TEST(ProbeCacheTests, IdentifiesFiles)
+    {
+        TemporaryDirectory directory;
+        WriteFile(directory / "input.mp4", std::vector<uint8_t>(1234, 0));
+
+        const auto identity = GetFileIdentity(directory / "input.mp4");
+        ASSERT_TRUE(identity);
+        EXPECT_EQ(identity->size, 1234U);
+        EXPECT_FALSE(GetFileIdentity(directory / "missing.mp4"));
+    }
+}
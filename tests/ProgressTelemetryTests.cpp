@@ -0,0 +1,132 @@
+#include "ProgressTelemetry.hpp"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+namespace application::tests
+{
+    using namespace std::chrono;
+
+    /// <summary>
+    /// Keeps every sample it receives.
+    /// </summary>
+    class SampleRecorder : public ProgressSubscriber
+    {
+    private:
+
+        std::vector<ProgressSample> m_samples;
+        std::mutex m_mutex;
+
+    public:
+
+        void OnProgress(const ProgressSample& sample) override
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_samples.push_back(sample);
+        }
+
+        std::vector<ProgressSample> GetSamples()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_samples;
+        }
+    };
+
+    TEST(ProgressTelemetryTests, HubDeliversInOrder)
+    {
+        ProgressHub hub;
+        auto recorder = std::make_shared<SampleRecorder>();
+        hub.Subscribe(recorder);
+
+        for (int idx = 0; idx < 100; ++idx)
+        {
+            ProgressSample sample = {};
+            sample.bytesWritten = idx;
+            hub.Publish(sample);
+        }
+        hub.Flush();
+
+        const auto samples = recorder->GetSamples();
+        ASSERT_EQ(samples.size(), 100U);
+        for (size_t idx = 0; idx < samples.size(); ++idx)
+            EXPECT_EQ(samples[idx].bytesWritten, idx);
+    }
+
+    TEST(ProgressTelemetryTests, TrackerMeasuresSpeedAndEstimatesTime)
+    {
+        ProgressHub hub;
+        auto recorder = std::make_shared<SampleRecorder>();
+        hub.Subscribe(recorder);
+
+        ProgressTracker tracker("job", seconds(100), 25.0, hub);
+        tracker.OnStarted();
+
+        // twice as fast as real time:
+        tracker.OnPosition(seconds(20), seconds(10), 2000000);
+        auto sample = tracker.GetLastSample();
+        EXPECT_EQ(sample.state, JobState::Running);
+        EXPECT_DOUBLE_EQ(sample.progress, 0.2);
+        EXPECT_DOUBLE_EQ(sample.speed, 2.0);
+        EXPECT_DOUBLE_EQ(sample.framesPerSec, 50.0);
+        EXPECT_DOUBLE_EQ(sample.outputBitrate, 800000.0);
+        EXPECT_EQ(sample.projectedSize, 10000000U);
+        ASSERT_TRUE(sample.eta.has_value());
+        EXPECT_EQ(duration_cast<seconds>(*sample.eta), seconds(40));
+
+        // then at real time, which the smoothing takes in by its weight:
+        tracker.OnPosition(seconds(30), seconds(20), 3000000);
+        sample = tracker.GetLastSample();
+        const double expectedSpeed = ProgressTracker::smoothingFactor * 1.0
+            + (1.0 - ProgressTracker::smoothingFactor) * 2.0;
+        EXPECT_DOUBLE_EQ(sample.speed, expectedSpeed);
+
+        tracker.OnFinished(true, 9000000);
+        sample = tracker.GetLastSample();
+        EXPECT_EQ(sample.state, JobState::Finished);
+        EXPECT_DOUBLE_EQ(sample.progress, 1.0);
+        EXPECT_EQ(sample.projectedSize, 9000000U);
+        EXPECT_EQ(sample.eta, nanoseconds(0));
+
+        hub.Flush();
+        EXPECT_EQ(recorder->GetSamples().size(), 4U);
+    }
+
+    TEST(ProgressTelemetryTests, NoProjectionTooEarly)
+    {
+        ProgressHub hub;
+        ProgressTracker tracker("job", seconds(100), 25.0, hub);
+        tracker.OnStarted();
+        tracker.OnPosition(seconds(1), seconds(1), 500000);
+        EXPECT_EQ(tracker.GetLastSample().projectedSize, 0U);
+    }
+
+    TEST(ProgressTelemetryTests, SeededSpeedGivesEarlyEstimate)
+    {
+        ProgressHub hub;
+        ProgressTracker tracker("job", seconds(100), 25.0, hub);
+        tracker.SeedSpeed(4.0);
+        tracker.OnStarted();
+
+        const auto sample = tracker.GetLastSample();
+        ASSERT_TRUE(sample.eta.has_value());
+        EXPECT_EQ(duration_cast<seconds>(*sample.eta), seconds(25));
+    }
+
+    TEST(ProgressTelemetryTests, IgnoresPositionsAfterFailure)
+    {
+        ProgressHub hub;
+        ProgressTracker tracker("job", seconds(100), 25.0, hub);
+        tracker.OnStarted();
+        tracker.OnPosition(seconds(10), seconds(5), 100);
+        tracker.OnFinished(false, 100);
+        tracker.OnPosition(seconds(50), seconds(6), 200);
+
+        const auto sample = tracker.GetLastSample();
+        EXPECT_EQ(sample.state, JobState::Failed);
+        EXPECT_EQ(sample.mediaPosition, seconds(10));
+        EXPECT_FALSE(sample.eta.has_value());
+    }
+}
@@ -0,0 +1,163 @@
+#include "ReadAheadReader.hpp"
+#include "SyntheticMp4.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <thread>
+
+namespace application::tests
+{
+    class ReadAheadReaderTests : public ::testing::Test
+    {
+    protected:
+
+        TemporaryDirectory m_directory;
+        std::vector<uint8_t> m_content;
+        std::shared_ptr<const InputFile> m_file;
+
+        void SetUp() override
+        {
+            m_content.resize((size_t(8) << 20) + 12345);
+            std::mt19937 random(3);
+            for (auto& byte : m_content)
+                byte = static_cast<uint8_t>(random());
+
+            WriteFile(m_directory / "input.bin", m_content);
+            m_file = std::make_shared<const InputFile>(m_directory / "input.bin");
+        }
+
+        /// <summary>
+        /// Reads a range and tells whether it matches the content of the file.
+        /// </summary>
+        bool ReadsAsExpected(ReadAheadReader& reader, uint64_t offset, size_t size)
+        {
+            std::vector<uint8_t> buffer(size);
+            const size_t read = reader.Read(offset, buffer.data(), size);
+            const size_t expected = offset >= m_content.size()
+                ? 0 : static_cast<size_t>(std::min<uint64_t>(size, m_content.size() - offset));
+
+            return read == expected && std::memcmp(buffer.data(), m_content.data() + offset, read) == 0;
+        }
+    };
+
+    TEST_F(ReadAheadReaderTests, ReadsRunsAndSeeks)
+    {
+        ReadAheadOptions options;
+        options.blockSize = 1 << 16;
+        options.window = 1 << 19;
+        options.memoryCap = 1 << 20;
+        ReadAheadReader reader(m_file, options);
+
+        std::mt19937 random(5);
+        for (int run = 0; run < 300; ++run)
+        {
+            uint64_t offset = random() % m_content.size();
+            const int readCount = random() % 20;
+            for (int count = 0; count < readCount; ++count)
+            {
+                const size_t size = random() % 100000 + 1;
+                ASSERT_TRUE(ReadsAsExpected(reader, offset, size)) << "at " << offset;
+                offset += size;
+            }
+        }
+
+        EXPECT_TRUE(ReadsAsExpected(reader, m_content.size() - 10, 100));
+        EXPECT_TRUE(ReadsAsExpected(reader, m_content.size() + 5, 10));
+    }
+
+    TEST_F(ReadAheadReaderTests, ReadsConcurrently)
+    {
+        ReadAheadReader reader(m_file, ReadAheadOptions{});
+        std::atomic<uint64_t> nextOffset(0);
+        std::atomic<bool> allAsExpected(true);
+
+        std::vector<std::thread> threads;
+        for (int idx = 0; idx < 4; ++idx)
+        {
+            threads.emplace_back([&]()
+            {
+                uint64_t offset;
+                while ((offset = nextOffset.fetch_add(65536)) < m_content.size())
+                {
+                    if (!ReadsAsExpected(reader, offset, 65536))
+                        allAsExpected = false;
+                }
+            });
+        }
+
+        for (auto& thread : threads)
+            thread.join();
+
+        EXPECT_TRUE(allAsExpected);
+        EXPECT_LE(reader.GetBytesFetched(), m_content.size() + ReadAheadOptions{}.blockSize);
+    }
+
+    TEST_F(ReadAheadReaderTests, WorksWithoutReadingAhead)
+    {
+        ReadAheadOptions options;
+        options.window = 0;
+        ReadAheadReader reader(m_file, options);
+
+        for (uint64_t offset = 0; offset < m_content.size(); offset += 1 << 20)
+            ASSERT_TRUE(ReadsAsExpected(reader, offset, 70000));
+
+        EXPECT_EQ(reader.GetBytesFetched(), 8 * 70000U + 12345);
+    }
+
+    /// <summary>
+    /// Reads the whole file in small sequential reads, as a demuxer does, and tells how long it took.
+    /// </summary>
+    static std::chrono::milliseconds ReadSequentially(ReadAheadReader& reader, uint64_t fileSize)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        std::vector<uint8_t> buffer(1 << 16);
+        for (uint64_t offset = 0; offset < fileSize; offset += buffer.size())
+            reader.Read(offset, buffer.data(), buffer.size());
+
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    }
+
+    TEST_F(ReadAheadReaderTests, HidesLatencyOfSequentialReads)
+    {
+        ReadAheadOptions options;
+        options.latency = std::chrono::milliseconds(4);
+
+        options.window = 0;
+        ReadAheadReader directReader(m_file, options);
+        const auto directTime = ReadSequentially(directReader, m_content.size());
+
+        options.window = ReadAheadOptions{}.window;
+        ReadAheadReader readerAhead(m_file, options);
+        const auto timeAhead = ReadSequentially(readerAhead, m_content.size());
+
+        // 129 reads of 64 KB wait at least 516 ms, whereas 9 blocks of 1 MB take 36 ms
+        // (plus the few reads before reading ahead starts)
+        EXPECT_GE(directTime.count(), 129 * 4);
+        EXPECT_LT(timeAhead.count() * 4, directTime.count())
+            << "read ahead in " << timeAhead.count() << " ms, directly in " << directTime.count() << " ms";
+        EXPECT_LE(readerAhead.GetBytesFetched(), m_content.size() + options.blockSize);
+    }
+
+    TEST_F(ReadAheadReaderTests, LooksUpBoxesWithoutFetchingAround)
+    {
+        ReadAheadOptions options;
+        options.latency = std::chrono::milliseconds(4);
+        ReadAheadReader reader(m_file, options);
+
+        // Box headers at the start, then a seek to a movie box at the end, as a demuxer does
+        uint64_t offset = 0;
+        for (int idx = 0; idx < 3; ++idx, offset += 3 << 20)
+            ASSERT_TRUE(ReadsAsExpected(reader, offset, 8));
+
+        const uint64_t moovOffset = m_content.size() - 200000;
+        ASSERT_TRUE(ReadsAsExpected(reader, moovOffset, 8));
+        ASSERT_TRUE(ReadsAsExpected(reader, moovOffset + 8, 200000 - 8));
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        EXPECT_LT(reader.GetBytesFetched(), uint64_t(4) * options.blockSize);
+    }
+}
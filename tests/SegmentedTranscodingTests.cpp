@@ -0,0 +1,258 @@
+#include "SegmentedTranscoding.hpp"
+#include "AppException.hpp"
+#include "IsoBmff.hpp"
+#include "SyntheticMp4.hpp"
+
+#include <gtest/gtest.h>
+
+#include <mutex>
+
+namespace application::tests
+{
+    using namespace std::chrono;
+
+    /// <summary>
+    /// Backend whose sessions write a synthetic MP4 with the level of the settings in its parameter
+    /// sets, as an encoder does, and whose first part overshoots the target bitrate.
+    /// </summary>
+    class PartWritingBackend : public MediaBackend
+    {
+    public:
+
+        /// <summary>How much the encodings of the first part exceed the target bitrate.</summary>
+        static constexpr double firstPartOvershoot = 1.3;
+
+        /// <summary>
+        /// Whether the sessions report their progress halfway, which shows the overshoot while
+        /// encoding, otherwise it is only seen in the finished part.
+        /// </summary>
+        bool reportsProgress = false;
+
+        std::mutex mutex;
+        std::vector<std::pair<std::string, TranscodeSettings>> sessions;
+
+    private:
+
+        class Session : public TranscodeSession
+        {
+        private:
+
+            PartWritingBackend& m_backend;
+            const TranscodeSettings m_settings;
+            const std::string m_outputFName;
+            const PresentationRange m_range;
+            SessionObserver* m_observer = nullptr;
+            bool m_aborted = false;
+            uint64_t m_bytesWritten = 0;
+
+            double GetBitrate() const
+            {
+                const bool overshoots = m_outputFName.ends_with(".part1.mp4");
+                return m_settings.videoAvgBitrate * (overshoots ? firstPartOvershoot : 1.0);
+            }
+
+        public:
+
+            Session(PartWritingBackend& backend,
+                    const TranscodeSettings& settings,
+                    const std::string& outputFName,
+                    const PresentationRange& range)
+                : m_backend(backend)
+                , m_settings(settings)
+                , m_outputFName(outputFName)
+                , m_range(range)
+            {
+            }
+
+            bool IsHardwareAccelerated() const override { return false; }
+            std::string GetVideoEncoderName() const override { return "Part writer"; }
+            void Observe(SessionObserver& observer, milliseconds) override { m_observer = &observer; }
+            void Start() override {}
+            void Abort() override { m_aborted = true; }
+            nanoseconds GetPosition() const override { return m_range.stop; }
+            uint64_t GetBytesWritten() const override { return m_bytesWritten; }
+
+            bool Wait(milliseconds) override
+            {
+                const double bitrate = GetBitrate();
+                if (m_backend.reportsProgress && m_observer != nullptr)
+                {
+                    const nanoseconds halfway = (m_range.stop - m_range.start) / 2;
+                    m_bytesWritten = static_cast<uint64_t>(bitrate / 8 * duration<double>(halfway).count());
+                    m_observer->OnPosition(m_range.start + halfway, halfway);
+
+                    if (m_aborted)
+                    {
+                        std::lock_guard<std::mutex> lock(m_backend.mutex);
+                        m_backend.sessions.emplace_back(m_outputFName, m_settings);
+                        throw AppException("Part writer was aborted");
+                    }
+                }
+
+                SyntheticMp4Options options;
+                options.levelIdc = m_settings.videoLevel;
+                options.audio = SyntheticAudio::None;
+                options.frameCount = static_cast<uint32_t>(duration_cast<milliseconds>(m_range.stop - m_range.start).count() / 40);
+                options.gopSize = options.frameCount;
+
+                // a second of 25 frames, with the key frame as large as 4 of them:
+                options.frameSize = static_cast<uint32_t>(bitrate / 8 / (25 + 3));
+                WriteSyntheticMp4(m_outputFName, options);
+
+                std::lock_guard<std::mutex> lock(m_backend.mutex);
+                m_backend.sessions.emplace_back(m_outputFName, m_settings);
+                return true;
+            }
+        };
+
+        class Input : public MediaInput
+        {
+        private:
+
+            PartWritingBackend& m_backend;
+
+        public:
+
+            explicit Input(PartWritingBackend& backend)
+                : m_backend(backend)
+            {
+            }
+
+            nanoseconds GetDuration() const override
+            {
+                return seconds(2);
+            }
+
+            MediaInfo GetMediaInfo() const override
+            {
+                // 1080p30 at a bitrate whose target is just above what H.264 level 4.0 admits:
+                MediaInfo info = {};
+                info.videoProfile.format = Encoder::H264_AVC;
+                info.videoProfile.frameSize = { 1920, 1080 };
+                info.videoProfile.frameRate = { 30, 1 };
+                info.videoProfile.avgBitrate = 40'000'000;
+                return info;
+            }
+
+            StreamLayout GetStreamLayout() const override
+            {
+                StreamLayout layout = {};
+                layout.videoCount = 1;
+                layout.choice.video = 0;
+                return layout;
+            }
+
+            std::vector<nanoseconds> GetKeyframeTimes() const override
+            {
+                return { seconds(0), seconds(1) };
+            }
+
+            std::unique_ptr<TranscodeSession> CreateSession(const MediaInfo&,
+                                                            const TranscodeSettings& settings,
+                                                            const std::string& outputFName,
+                                                            const std::optional<PresentationRange>& range) override
+            {
+                return std::make_unique<Session>(
+                    m_backend, settings, outputFName, range.value_or(PresentationRange{ seconds(0), GetDuration() }));
+            }
+        };
+
+        EncoderRegistry m_encoderRegistry;
+
+    public:
+
+        std::unique_ptr<ThreadScope> EnterThread() const override
+        {
+            return std::make_unique<ThreadScope>();
+        }
+
+        std::unique_ptr<MediaInput> OpenInput(const std::string&) override
+        {
+            return std::make_unique<Input>(*this);
+        }
+
+        const EncoderRegistry& GetEncoderRegistry() override
+        {
+            return m_encoderRegistry;
+        }
+
+        std::string GetDataDirectory() const override
+        {
+            return std::string();
+        }
+    };
+
+    TEST(SegmentedTranscodingTests, ConcatenatesPartReencodedForSize)
+    {
+        TemporaryDirectory directory;
+        CmdLineParams params = {};
+        params.encoder = Encoder::H264_AVC;
+        params.tgtSize = 0.7;
+        params.inputFName = directory / "input.mp4";
+        params.outputFName = directory / "output.mp4";
+        params.maxParallelJobs = 2;
+        params.segmentCount = 2;
+        params.sizeTolerancePct = 10;
+
+        PartWritingBackend backend;
+        ASSERT_TRUE(RunSegmentedTranscoding(backend, params));
+
+        // the re-encoded part has lower bitrates, which alone would call for level 4.0:
+        ASSERT_EQ(backend.sessions.size(), 3U);
+        const TranscodeSettings& settings = backend.sessions.front().second;
+        const auto retry = std::find_if(backend.sessions.begin(), backend.sessions.end(),
+            [](const auto& session) { return session.first.ends_with(".retry.mp4"); });
+        ASSERT_NE(retry, backend.sessions.end());
+        EXPECT_EQ(settings.videoLevel, 41U);
+        EXPECT_LT(retry->second.videoAvgBitrate, 25'000'000U);
+        EXPECT_LT(retry->second.targetSizeFactor, settings.targetSizeFactor);
+        EXPECT_EQ(retry->second.videoLevel, settings.videoLevel);
+        EXPECT_EQ(retry->second.videoQualityVsSpeed, settings.videoQualityVsSpeed);
+        EXPECT_EQ(retry->second.hardwareAllowed, settings.hardwareAllowed);
+
+        const std::vector<uint8_t> output = ReadFile(params.outputFName);
+        const IsoBmffMovie movie = ParseIsoBmff(output.data(), output.size());
+        ASSERT_EQ(movie.tracks.size(), 1U);
+        EXPECT_EQ(movie.tracks.front().sampleCount, 50U);
+        EXPECT_FALSE(std::filesystem::exists(directory / "output.part1.mp4"));
+    }
+
+    TEST(SegmentedTranscodingTests, RestartsPartProjectedOverSize)
+    {
+        TemporaryDirectory directory;
+        CmdLineParams params = {};
+        params.encoder = Encoder::H264_AVC;
+        params.tgtSize = 0.7;
+        params.inputFName = directory / "input.mp4";
+        params.outputFName = directory / "output.mp4";
+        params.maxParallelJobs = 2;
+        params.segmentCount = 2;
+        params.sizeTolerancePct = 10;
+
+        PartWritingBackend backend;
+        backend.reportsProgress = true;
+        ASSERT_TRUE(RunSegmentedTranscoding(backend, params));
+
+        // the first part is stopped halfway and encoded again in place, with no re-encoding once finished:
+        ASSERT_EQ(backend.sessions.size(), 3U);
+        std::vector<TranscodeSettings> firstPartSettings;
+        for (const auto& [outputFName, settings] : backend.sessions)
+        {
+            EXPECT_FALSE(outputFName.ends_with(".retry.mp4"));
+            if (outputFName.ends_with(".part1.mp4"))
+                firstPartSettings.push_back(settings);
+        }
+
+        ASSERT_EQ(firstPartSettings.size(), 2U);
+        const TranscodeSettings& restarted = firstPartSettings.back();
+        EXPECT_LT(restarted.videoAvgBitrate, firstPartSettings.front().videoAvgBitrate);
+        EXPECT_LE(restarted.videoAvgBitrate * PartWritingBackend::firstPartOvershoot,
+                  firstPartSettings.front().videoAvgBitrate * 1.1);
+        EXPECT_EQ(restarted.videoLevel, firstPartSettings.front().videoLevel);
+
+        const std::vector<uint8_t> output = ReadFile(params.outputFName);
+        const IsoBmffMovie movie = ParseIsoBmff(output.data(), output.size());
+        ASSERT_EQ(movie.tracks.size(), 1U);
+        EXPECT_EQ(movie.tracks.front().sampleCount, 50U);
+    }
+}
@@ -0,0 +1,73 @@
+#include "StreamSelection.hpp"
+#include "AppException.hpp"
+#include "Mp4Probe.hpp"
+#include "SyntheticMp4.hpp"
+
+#include <gtest/gtest.h>
+
+namespace application::tests
+{
+    static SourceStream MakeStream(SourceStream::Kind kind, uint32_t id, const std::string& language = "")
+    {
+        SourceStream stream = {};
+        stream.kind = kind;
+        stream.id = id;
+        stream.width = (kind == SourceStream::Kind::Video) ? 1920 : 0;
+        stream.height = (kind == SourceStream::Kind::Video) ? 1080 : 0;
+        stream.language = language;
+        return stream;
+    }
+
+    TEST(StreamSelectionTests, MapsChoiceByIdentifier)
+    {
+        using Kind = SourceStream::Kind;
+        const std::vector<SourceStream> streams = {
+            MakeStream(Kind::Video, 1), MakeStream(Kind::Audio, 2, "en"), MakeStream(Kind::Audio, 3, "de") };
+
+        StreamSelectionPolicy policy;
+        policy.audioLanguage = "deu";
+        const StreamChoice choice = ChooseStreams(streams, policy);
+        ASSERT_EQ(choice.audio, 2U);
+
+        // another demuxer lists the streams in another order, and skips one with no samples:
+        const std::vector<SourceStream> otherStreams = {
+            MakeStream(Kind::Audio, 3, "de"), MakeStream(Kind::Other, 4), MakeStream(Kind::Video, 1) };
+
+        const StreamChoice otherChoice = MapStreamChoice(streams, choice, otherStreams);
+        EXPECT_EQ(otherChoice.video, 2U);
+        EXPECT_EQ(otherChoice.audio, 0U);
+
+        EXPECT_THROW(MapStreamChoice(streams, ChooseStreams(streams, StreamSelectionPolicy{}), otherStreams),
+                     AppException);
+    }
+
+    TEST(StreamSelectionTests, MapsChoiceByOrderWithoutSharedIdentifiers)
+    {
+        using Kind = SourceStream::Kind;
+        const std::vector<SourceStream> streams = {
+            MakeStream(Kind::Video, 1), MakeStream(Kind::Audio, 2), MakeStream(Kind::Audio, 3) };
+
+        const std::vector<SourceStream> otherStreams = {
+            MakeStream(Kind::Audio, 100), MakeStream(Kind::Audio, 101), MakeStream(Kind::Video, 102) };
+
+        StreamChoice choice;
+        choice.video = 0;
+        choice.audio = 2;
+        const StreamChoice otherChoice = MapStreamChoice(streams, choice, otherStreams);
+        EXPECT_EQ(otherChoice.video, 2U);
+        EXPECT_EQ(otherChoice.audio, 1U);
+    }
+
+    TEST(StreamSelectionTests, ProbeIdentifiesStreamsByTrack)
+    {
+        TemporaryDirectory directory;
+        WriteSyntheticMp4(directory / "input.mp4", SyntheticMp4Options());
+
+        const auto probe = ProbeMp4File(directory / "input.mp4", StreamSelectionPolicy{});
+        ASSERT_TRUE(probe);
+        ASSERT_EQ(probe->streams.size(), 2U);
+        EXPECT_EQ(probe->streams[*probe->layout.choice.video].kind, SourceStream::Kind::Video);
+        EXPECT_EQ(probe->streams[*probe->layout.choice.video].id, 1U);
+        EXPECT_EQ(probe->streams[*probe->layout.choice.audio].id, 2U);
+    }
+}
@@ -0,0 +1,128 @@
+#include "TranscodeSettings.hpp"
+
+#include <gtest/gtest.h>
+
+namespace application::tests
+{
+    static MediaInfo MakeSourceInfo(uint32_t avgBitrate, uint32_t peakBitrate)
+    {
+        MediaInfo info = {};
+        auto& video = info.videoProfile;
+        video.frameSize.width = 1920;
+        video.frameSize.height = 1080;
+        video.frameRate.numerator = 30;
+        video.frameRate.denominator = 1;
+        video.avgBitrate = avgBitrate;
+        video.peakBitrate = peakBitrate;
+        video.format = Encoder::H264_AVC;
+
+        auto& audio = info.audioProfile;
+        audio.bitsPerSample = 16;
+        audio.samplesPerSec = 48000;
+        audio.numChannels = 2;
+        audio.avgBytesPerSec = 24000;
+        audio.isAac = true;
+        return info;
+    }
+
+    TEST(TranscodeSettingsTests, ScalesBitratesByTargetSize)
+    {
+        const auto settings = DecideTranscodeSettings(MakeSourceInfo(10000000, 16000000), Encoder::H265_HEVC, 0.5);
+
+        EXPECT_EQ(settings.videoEncoder, Encoder::H265_HEVC);
+        EXPECT_EQ(settings.videoAvgBitrate, 5000000U);
+        EXPECT_EQ(settings.videoPeakBitrate, 8000000U);
+        EXPECT_FALSE(settings.streamCopy);
+        EXPECT_TRUE(settings.hardwareAllowed);
+        EXPECT_GE(settings.videoQualityVsSpeed, 1U);
+        EXPECT_LE(settings.videoQualityVsSpeed, 100U);
+    }
+
+    TEST(TranscodeSettingsTests, NoPeakWhenSourceIsNotBursty)
+    {
+        const auto settings = DecideTranscodeSettings(MakeSourceInfo(10000000, 0), Encoder::H265_HEVC, 0.5);
+        EXPECT_EQ(settings.videoPeakBitrate, 0U);
+    }
+
+    TEST(TranscodeSettingsTests, LevelFollowsTheHighestBitrate)
+    {
+        // 30 Mb/s at peak needs H.264 level 4.1, while 20 Mb/s fits in 4:
+        EXPECT_EQ(DecideTranscodeSettings(MakeSourceInfo(20000000, 60000000), Encoder::H264_AVC, 0.5).videoLevel, 41U);
+        EXPECT_EQ(DecideTranscodeSettings(MakeSourceInfo(20000000, 0), Encoder::H264_AVC, 0.5).videoLevel, 40U);
+    }
+
+    TEST(TranscodeSettingsTests, CopiesStreamsWhenSourceAlreadyMeetsTarget)
+    {
+        const auto source = MakeSourceInfo(10000000, 0);
+        EXPECT_FALSE(DecideTranscodeSettings(source, Encoder::H264_AVC, 0.5).streamCopy);
+        EXPECT_TRUE(DecideTranscodeSettings(source, Encoder::H264_AVC, 1.0).streamCopy);
+
+        // but not into another format:
+        EXPECT_FALSE(DecideTranscodeSettings(source, Encoder::H265_HEVC, 1.0).streamCopy);
+    }
+
+    TEST(TranscodeSettingsTests, CopiesStreamsWhenSourceIsUnderAbsoluteTarget)
+    {
+        // at half the 8.3 Mb/s of an efficient encoding of 1080p, the target is about 4.1 Mb/s:
+        EXPECT_TRUE(DecideTranscodeSettings(MakeSourceInfo(4000000, 0), Encoder::H264_AVC, 0.5).streamCopy);
+        EXPECT_FALSE(DecideTranscodeSettings(MakeSourceInfo(4200000, 0), Encoder::H264_AVC, 0.5).streamCopy);
+        EXPECT_FALSE(DecideTranscodeSettings(MakeSourceInfo(4000000, 0), Encoder::H264_AVC, 0.4).streamCopy);
+        EXPECT_FALSE(DecideTranscodeSettings(MakeSourceInfo(4000000, 0), Encoder::H265_HEVC, 0.5).streamCopy);
+    }
+
+    TEST(TranscodeSettingsTests, CopiesAacAudioWithinTargetRate)
+    {
+        auto source = MakeSourceInfo(10000000, 0);
+        source.audioProfile.avgBytesPerSec = 16000;
+        auto settings = DecideTranscodeSettings(source, Encoder::H265_HEVC, 0.5);
+        EXPECT_TRUE(settings.audioCopy);
+        EXPECT_EQ(settings.audioAvgBytesPerSec, 16000U);
+
+        source.audioProfile.isAac = false;
+        settings = DecideTranscodeSettings(source, Encoder::H265_HEVC, 0.5);
+        EXPECT_FALSE(settings.audioCopy);
+        EXPECT_LE(settings.audioAvgBytesPerSec, 16000U);
+    }
+
+    TEST(TranscodeSettingsTests, AudioRateNeverGoesPastTheTable)
+    {
+        auto source = MakeSourceInfo(10000000, 0);
+        source.audioProfile.avgBytesPerSec = 192000;
+        source.audioProfile.isAac = false;
+        EXPECT_EQ(DecideTranscodeSettings(source, Encoder::H265_HEVC, 0.5).audioAvgBytesPerSec, 24000U);
+    }
+
+    TEST(TranscodeSettingsTests, KeepsHighBitDepthWhereTheProfileAllows)
+    {
+        auto source = MakeSourceInfo(10000000, 0);
+        MediaInfo::VideoProfile::Coding coding = {};
+        coding.chromaFormatIdc = 1;
+        coding.bitDepthLuma = 10;
+        coding.bitDepthChroma = 10;
+        coding.progressive = true;
+        source.videoProfile.coding = coding;
+
+        EXPECT_EQ(DecideTranscodeSettings(source, Encoder::H265_HEVC, 0.5).videoBitDepth, 10U);
+        EXPECT_EQ(DecideTranscodeSettings(source, Encoder::H264_AVC, 0.5).videoBitDepth, 8U);
+    }
+
+    TEST(TranscodeSettingsTests, PlacesKeyFramesAtFragmentBoundaries)
+    {
+        const auto source = MakeSourceInfo(10000000, 0);
+        EXPECT_EQ(DecideTranscodeSettings(source, Encoder::H265_HEVC, 0.5, std::chrono::milliseconds(2000)).videoGopSize, 60U);
+        EXPECT_EQ(DecideTranscodeSettings(source, Encoder::H265_HEVC, 0.5).videoGopSize, 0U);
+    }
+
+    TEST(TranscodeSettingsTests, RetargetingChangesOnlyTheVideoBitrates)
+    {
+        const auto settings = DecideTranscodeSettings(MakeSourceInfo(20000000, 60000000), Encoder::H264_AVC, 0.5);
+        const auto retargeted = RetargetVideoBitrates(settings, 0.25);
+
+        EXPECT_EQ(retargeted.targetSizeFactor, 0.25);
+        EXPECT_EQ(retargeted.videoAvgBitrate, settings.videoAvgBitrate / 2);
+        EXPECT_EQ(retargeted.videoPeakBitrate, settings.videoPeakBitrate / 2);
+        EXPECT_EQ(retargeted.videoLevel, settings.videoLevel);
+        EXPECT_EQ(retargeted.videoQualityVsSpeed, settings.videoQualityVsSpeed);
+        EXPECT_EQ(retargeted.audioAvgBytesPerSec, settings.audioAvgBytesPerSec);
+    }
+}
@@ -0,0 +1,870 @@
+#include "SyntheticMp4.hpp"
+#include "IsoBmff.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+
+namespace application::tests
+{
+    /// <summary>
+    /// Writer of the bit fields and Exp-Golomb codes of parameter sets.
+    /// </summary>
+    class BitWriter
+    {
+    private:
+
+        std::vector<uint8_t> m_bytes;
+        uint32_t m_bitCount = 0;
+
+    public:
+
+        void WriteBits(uint32_t count, uint64_t value)
+        {
+            for (uint32_t idx = count; idx > 0; --idx)
+            {
+                if (m_bitCount % 8 == 0)
+                    m_bytes.push_back(0);
+
+                if ((value >> (idx - 1)) & 1)
+                    m_bytes.back() |= static_cast<uint8_t>(0x80 >> (m_bitCount % 8));
+
+                ++m_bitCount;
+            }
+        }
+
+        void WriteFlag(bool value)
+        {
+            WriteBits(1, value ? 1 : 0);
+        }
+
+        void WriteUe(uint32_t value)
+        {
+            const uint64_t codeNum = static_cast<uint64_t>(value) + 1;
+            uint32_t length = 0;
+            while ((codeNum >> length) > 1)
+                ++length;
+
+            WriteBits(length, 0);
+            WriteBits(length + 1, codeNum);
+        }
+
+        void WriteSe(int32_t value)
+        {
+            WriteUe(value > 0 ? 2 * value - 1 : -2 * value);
+        }
+
+        /// <summary>
+        /// Writes the RBSP trailing bits and gets the payload.
+        /// </summary>
+        std::vector<uint8_t> Finish()
+        {
+            WriteFlag(true);
+            while (m_bitCount % 8 != 0)
+                WriteFlag(false);
+
+            return m_bytes;
+        }
+    };
+
+    /// <summary>
+    /// Makes a NAL unit from its header and payload, inserting emulation prevention bytes.
+    /// </summary>
+    static std::vector<uint8_t> MakeNalUnit(std::vector<uint8_t> header, const std::vector<uint8_t>& rbsp)
+    {
+        std::vector<uint8_t> nal = std::move(header);
+        uint32_t zeros = 0;
+        for (uint8_t byte : rbsp)
+        {
+            if (zeros >= 2 && byte <= 3)
+            {
+                nal.push_back(3);
+                zeros = 0;
+            }
+            nal.push_back(byte);
+            zeros = (byte == 0) ? zeros + 1 : 0;
+        }
+        return nal;
+    }
+
+    static void WriteProfileTierLevel(BitWriter& writer, const SyntheticMp4Options& options)
+    {
+        writer.WriteBits(2, 0); // profile space
+        writer.WriteFlag(false); // tier
+        writer.WriteBits(5, options.profileIdc);
+        writer.WriteBits(32, 0x60000000); // compatibility with Main and Main 10
+        writer.WriteFlag(true); // progressive
+        writer.WriteFlag(false); // interlaced
+        writer.WriteFlag(false); // non-packed constraint
+        writer.WriteFlag(true); // frame only
+        writer.WriteBits(32, 0);
+        writer.WriteBits(12, 0);
+        writer.WriteBits(8, options.levelIdc);
+    }
+
+    std::vector<uint8_t> MakeVideoParameterSet(const SyntheticMp4Options& options)
+    {
+        BitWriter writer;
+        writer.WriteBits(4, 0); // id
+        writer.WriteFlag(true);
+        writer.WriteFlag(true);
+        writer.WriteBits(6, 0); // max layers - 1
+        writer.WriteBits(3, 0); // max sub-layers - 1
+        writer.WriteFlag(true); // temporal id nesting
+        writer.WriteBits(16, 0xffff);
+        WriteProfileTierLevel(writer, options);
+        writer.WriteFlag(true); // sub-layer ordering info
+        writer.WriteUe(4);
+        writer.WriteUe(0);
+        writer.WriteUe(0);
+        writer.WriteBits(6, 0); // max layer id
+        writer.WriteUe(0); // layer sets - 1
+        writer.WriteFlag(true); // timing info
+        writer.WriteBits(32, options.frameDuration);
+        writer.WriteBits(32, options.timescale);
+        writer.WriteFlag(false); // POC proportional to timing
+        writer.WriteUe(0); // HRD parameters
+        writer.WriteFlag(false); // extension
+        return MakeNalUnit({ 0x40, 0x01 }, writer.Finish());
+    }
+
+    std::vector<uint8_t> MakeSequenceParameterSet(const SyntheticMp4Options& options)
+    {
+        BitWriter writer;
+        const uint32_t width = options.width;
+        const uint32_t height = options.height;
+
+        if (options.codec == Encoder::H265_HEVC)
+        {
+            writer.WriteBits(4, 0); // VPS id
+            writer.WriteBits(3, 0); // max sub-layers - 1
+            writer.WriteFlag(true); // temporal id nesting
+            WriteProfileTierLevel(writer, options);
+            writer.WriteUe(0); // id
+            writer.WriteUe(1); // 4:2:0
+            const uint32_t codedWidth = (width + 7) / 8 * 8;
+            const uint32_t codedHeight = (height + 7) / 8 * 8;
+            writer.WriteUe(codedWidth);
+            writer.WriteUe(codedHeight);
+            const bool cropped = codedWidth != width || codedHeight != height;
+            writer.WriteFlag(cropped);
+            if (cropped)
+            {
+                writer.WriteUe(0);
+                writer.WriteUe((codedWidth - width) / 2);
+                writer.WriteUe(0);
+                writer.WriteUe((codedHeight - height) / 2);
+            }
+            writer.WriteUe(0); // bit depth luma - 8
+            writer.WriteUe(0); // bit depth chroma - 8
+            writer.WriteUe(4); // log2 max POC LSB - 4
+            writer.WriteFlag(true); // sub-layer ordering info
+            writer.WriteUe(4);
+            writer.WriteUe(0);
+            writer.WriteUe(0);
+            writer.WriteUe(0); // log2 min coding block - 3
+            writer.WriteUe(3);
+            writer.WriteUe(0); // log2 min transform block - 2
+            writer.WriteUe(3);
+            writer.WriteUe(1); // max transform hierarchy depth inter
+            writer.WriteUe(1); // max transform hierarchy depth intra
+            writer.WriteFlag(false); // scaling lists
+            writer.WriteFlag(false); // AMP
+            writer.WriteFlag(true); // SAO
+            writer.WriteFlag(false); // PCM
+            writer.WriteUe(0); // short term reference picture sets
+            writer.WriteFlag(false); // long term reference pictures
+            writer.WriteFlag(true); // temporal MVP
+            writer.WriteFlag(true); // strong intra smoothing
+            writer.WriteFlag(true); // VUI
+            for (int idx = 0; idx < 8; ++idx)
+                writer.WriteFlag(false);
+            writer.WriteFlag(true); // timing info
+            writer.WriteBits(32, options.frameDuration);
+            writer.WriteBits(32, options.timescale);
+            writer.WriteFlag(false); // POC proportional to timing
+            writer.WriteFlag(false); // HRD parameters
+            writer.WriteFlag(false); // bitstream restriction
+            writer.WriteFlag(false); // extension
+            return MakeNalUnit({ 0x42, 0x01 }, writer.Finish());
+        }
+
+        writer.WriteBits(8, options.profileIdc);
+        writer.WriteBits(8, 0); // constraint flags
+        writer.WriteBits(8, options.levelIdc);
+        writer.WriteUe(0); // id
+        if (options.profileIdc >= 100)
+        {
+            writer.WriteUe(1); // 4:2:0
+            writer.WriteUe(0); // bit depth luma - 8
+            writer.WriteUe(0); // bit depth chroma - 8
+            writer.WriteFlag(false); // lossless
+            writer.WriteFlag(false); // scaling matrix
+        }
+        writer.WriteUe(4); // log2 max frame num - 4
+        writer.WriteUe(0); // POC type
+        writer.WriteUe(4); // log2 max POC LSB - 4
+        writer.WriteUe(4); // reference frames
+        writer.WriteFlag(false); // gaps in frame num
+        const uint32_t widthInMbs = (width + 15) / 16;
+        const uint32_t heightInMbs = (height + 15) / 16;
+        writer.WriteUe(widthInMbs - 1);
+        writer.WriteUe(heightInMbs - 1);
+        writer.WriteFlag(true); // frame MBs only
+        writer.WriteFlag(true); // direct 8x8 inference
+        const uint32_t cropBottom = (heightInMbs * 16 - height) / 2;
+        writer.WriteFlag(cropBottom != 0);
+        if (cropBottom != 0)
+        {
+            writer.WriteUe(0);
+            writer.WriteUe(0);
+            writer.WriteUe(0);
+            writer.WriteUe(cropBottom);
+        }
+        writer.WriteFlag(true); // VUI
+        for (int idx = 0; idx < 4; ++idx)
+            writer.WriteFlag(false);
+        writer.WriteFlag(true); // timing info
+        writer.WriteBits(32, options.frameDuration);
+        writer.WriteBits(32, options.timescale * 2);
+        writer.WriteFlag(true); // fixed frame rate
+        for (int idx = 0; idx < 4; ++idx)
+            writer.WriteFlag(false);
+        return MakeNalUnit({ 0x67 }, writer.Finish());
+    }
+
+    std::vector<uint8_t> MakePictureParameterSet(Encoder codec)
+    {
+        BitWriter writer;
+        if (codec == Encoder::H265_HEVC)
+        {
+            writer.WriteUe(0); // id
+            writer.WriteUe(0); // SPS id
+            writer.WriteBits(7, 0); // dependent slices, output flag, extra bits, sign hiding, CABAC init
+            writer.WriteUe(0); // reference indexes in list 0 - 1
+            writer.WriteUe(0); // reference indexes in list 1 - 1
+            writer.WriteSe(0); // initial QP - 26
+            writer.WriteBits(2, 0); // constrained intra prediction, transform skip
+            writer.WriteFlag(false); // QP delta
+            writer.WriteSe(0); // Cb QP offset
+            writer.WriteSe(0); // Cr QP offset
+            writer.WriteBits(4, 0); // slice chroma QP offsets, weighted prediction, transquant bypass
+            writer.WriteFlag(false); // tiles
+            writer.WriteFlag(false); // entropy coding sync
+            writer.WriteFlag(true); // loop filter across slices
+            writer.WriteFlag(false); // deblocking filter control
+            writer.WriteFlag(false); // scaling lists
+            writer.WriteFlag(false); // lists modification
+            writer.WriteUe(0); // log2 parallel merge level - 2
+            writer.WriteFlag(false); // slice segment header extension
+            writer.WriteFlag(false); // extension
+            return MakeNalUnit({ 0x44, 0x01 }, writer.Finish());
+        }
+
+        writer.WriteUe(0); // id
+        writer.WriteUe(0); // SPS id
+        writer.WriteFlag(true); // CABAC
+        writer.WriteFlag(false);
+        writer.WriteUe(0);
+        writer.WriteUe(0);
+        writer.WriteUe(0);
+        writer.WriteFlag(false);
+        writer.WriteBits(2, 0);
+        writer.WriteSe(0);
+        writer.WriteSe(0);
+        writer.WriteSe(0);
+        writer.WriteFlag(true);
+        writer.WriteFlag(false);
+        writer.WriteFlag(false);
+        return MakeNalUnit({ 0x68 }, writer.Finish());
+    }
+
+    static void WriteNalWithLength(BigEndianWriter& writer, const std::vector<uint8_t>& nal)
+    {
+        writer.WriteU32(static_cast<uint32_t>(nal.size()));
+        writer.WriteBytes(nal.data(), nal.size());
+    }
+
+    static std::vector<std::vector<uint8_t>> MakeVideoSamples(const SyntheticMp4Options& options, std::mt19937& random)
+    {
+        std::vector<std::vector<uint8_t>> parameterSets;
+        if (options.codec == Encoder::H265_HEVC)
+            parameterSets.push_back(MakeVideoParameterSet(options));
+        parameterSets.push_back(MakeSequenceParameterSet(options));
+        parameterSets.push_back(MakePictureParameterSet(options.codec));
+
+        std::uniform_int_distribution<uint32_t> sizes(options.frameSize / 2, options.frameSize * 3 / 2);
+        std::vector<std::vector<uint8_t>> samples;
+        samples.reserve(options.frameCount);
+        for (uint32_t idx = 0; idx < options.frameCount; ++idx)
+        {
+            const bool isKey = idx % options.gopSize == 0;
+            const uint32_t size = std::max(80U, sizes(random) * (isKey ? 4 : 1));
+
+            std::vector<uint8_t> nal;
+            if (options.codec == Encoder::H265_HEVC)
+                nal = { static_cast<uint8_t>((isKey ? 19 : 1) << 1), 1 };
+            else
+                nal = { static_cast<uint8_t>(isKey ? 0x65 : 0x41) };
+
+            for (int count = 0; count < 64; ++count)
+                nal.push_back(static_cast<uint8_t>(random()));
+
+            // an emulation prevention byte, then zeros:
+            nal.insert(nal.end(), { 0, 0, 3, 1 });
+            nal.resize(size, 0);
+
+            std::vector<uint8_t> sample;
+            BigEndianWriter writer(sample);
+            if (isKey)
+            {
+                for (const auto& parameterSet : parameterSets)
+                    WriteNalWithLength(writer, parameterSet);
+            }
+            WriteNalWithLength(writer, nal);
+            samples.push_back(std::move(sample));
+        }
+
+        return samples;
+    }
+
+    /// <summary>
+    /// Where the samples of a track are in the file, chunk by chunk.
+    /// </summary>
+    struct ChunkLayout
+    {
+        std::vector<uint64_t> offsets;
+        std::vector<uint32_t> samplesPerChunk;
+    };
+
+    static void WriteFullBoxU32s(BigEndianWriter& writer, const char (&type)[5], std::initializer_list<uint32_t> values)
+    {
+        const size_t box = writer.BeginFullBox(MakeFourCC(type), 0, 0);
+        for (uint32_t value : values)
+            writer.WriteU32(value);
+        writer.EndBox(box);
+    }
+
+    static void WriteMatrix(BigEndianWriter& writer)
+    {
+        for (uint32_t value : { 0x10000U, 0U, 0U, 0U, 0x10000U, 0U, 0U, 0U, 0x40000000U })
+            writer.WriteU32(value);
+    }
+
+    static void WriteTrackHeader(BigEndianWriter& writer, uint32_t trackId, uint32_t duration,
+                                 uint32_t width, uint32_t height, uint16_t volume)
+    {
+        const size_t tkhd = writer.BeginFullBox(MakeFourCC("tkhd"), 0, 3);
+        writer.WriteU32(0);
+        writer.WriteU32(0);
+        writer.WriteU32(trackId);
+        writer.WriteU32(0);
+        writer.WriteU32(duration);
+        writer.WriteU64(0);
+        writer.WriteU16(0);
+        writer.WriteU16(0);
+        writer.WriteU16(volume);
+        writer.WriteU16(0);
+        WriteMatrix(writer);
+        writer.WriteU32(width << 16);
+        writer.WriteU32(height << 16);
+        writer.EndBox(tkhd);
+    }
+
+    static uint16_t PackLanguage(const std::string& language)
+    {
+        uint16_t packed = 0;
+        for (size_t idx = 0; idx < 3; ++idx)
+        {
+            const char letter = idx < language.size() ? language[idx] : 'u';
+            packed = static_cast<uint16_t>((packed << 5) | ((letter - 0x60) & 0x1f));
+        }
+        return packed;
+    }
+
+    static void WriteMediaHeader(BigEndianWriter& writer, uint32_t timescale, uint64_t duration,
+                                 const std::string& language, const char (&handler)[5])
+    {
+        const size_t mdhd = writer.BeginFullBox(MakeFourCC("mdhd"), 1, 0);
+        writer.WriteU64(0);
+        writer.WriteU64(0);
+        writer.WriteU32(timescale);
+        writer.WriteU64(duration);
+        writer.WriteU16(PackLanguage(language));
+        writer.WriteU16(0);
+        writer.EndBox(mdhd);
+
+        const size_t hdlr = writer.BeginFullBox(MakeFourCC("hdlr"), 0, 0);
+        writer.WriteU32(0);
+        writer.WriteU32(MakeFourCC(handler));
+        for (int idx = 0; idx < 3; ++idx)
+            writer.WriteU32(0);
+        writer.WriteU8(0);
+        writer.EndBox(hdlr);
+    }
+
+    static void WriteDataInformation(BigEndianWriter& writer)
+    {
+        const size_t dinf = writer.BeginBox(MakeFourCC("dinf"));
+        const size_t dref = writer.BeginFullBox(MakeFourCC("dref"), 0, 0);
+        writer.WriteU32(1);
+        writer.EndBox(writer.BeginFullBox(MakeFourCC("url "), 0, 1));
+        writer.EndBox(dref);
+        writer.EndBox(dinf);
+    }
+
+    static void WriteChunkTables(BigEndianWriter& writer, const ChunkLayout& chunks, bool largeOffsets)
+    {
+        const size_t stsc = writer.BeginFullBox(MakeFourCC("stsc"), 0, 0);
+        const size_t entryCountPos = writer.GetPosition();
+        writer.WriteU32(0);
+        uint32_t entryCount = 0;
+        for (size_t idx = 0; idx < chunks.samplesPerChunk.size(); ++idx)
+        {
+            if (idx == 0 || chunks.samplesPerChunk[idx] != chunks.samplesPerChunk[idx - 1])
+            {
+                writer.WriteU32(static_cast<uint32_t>(idx + 1));
+                writer.WriteU32(chunks.samplesPerChunk[idx]);
+                writer.WriteU32(1);
+                ++entryCount;
+            }
+        }
+        writer.PatchU32(entryCountPos, entryCount);
+        writer.EndBox(stsc);
+
+        const size_t stco = writer.BeginFullBox(MakeFourCC(largeOffsets ? "co64" : "stco"), 0, 0);
+        writer.WriteU32(static_cast<uint32_t>(chunks.offsets.size()));
+        for (uint64_t offset : chunks.offsets)
+        {
+            if (largeOffsets)
+                writer.WriteU64(offset);
+            else
+                writer.WriteU32(static_cast<uint32_t>(offset));
+        }
+        writer.EndBox(stco);
+    }
+
+    static void WriteVideoSampleEntry(BigEndianWriter& writer,
+                                      const SyntheticMp4Options& options,
+                                      uint64_t videoBytes,
+                                      uint64_t duration)
+    {
+        const bool isHevc = options.codec == Encoder::H265_HEVC;
+        const size_t entry = writer.BeginBox(MakeFourCC(isHevc ? "hvc1" : "avc1"));
+        for (int idx = 0; idx < 6; ++idx)
+            writer.WriteU8(0);
+        writer.WriteU16(1); // data reference index
+        for (int idx = 0; idx < 4; ++idx)
+            writer.WriteU32(0);
+        writer.WriteU16(static_cast<uint16_t>(options.width));
+        writer.WriteU16(static_cast<uint16_t>(options.height));
+        writer.WriteU32(0x480000);
+        writer.WriteU32(0x480000);
+        writer.WriteU32(0);
+        writer.WriteU16(1); // frame count
+        for (int idx = 0; idx < 8; ++idx)
+            writer.WriteU32(0); // compressor name
+        writer.WriteU16(0x18);
+        writer.WriteU16(0xffff);
+
+        const auto sps = MakeSequenceParameterSet(options);
+        const auto pps = MakePictureParameterSet(options.codec);
+        if (isHevc)
+        {
+            const auto vps = MakeVideoParameterSet(options);
+            const size_t hvcC = writer.BeginBox(MakeFourCC("hvcC"));
+            writer.WriteU8(1);
+            writer.WriteU8(static_cast<uint8_t>(options.profileIdc));
+            writer.WriteU32(0x60000000);
+            writer.WriteU16(0x9000);
+            writer.WriteU32(0);
+            writer.WriteU8(static_cast<uint8_t>(options.levelIdc));
+            writer.WriteU16(0xf000);
+            writer.WriteU8(0xfc);
+            writer.WriteU8(0xfd);
+            writer.WriteU8(0xf8);
+            writer.WriteU8(0xf8);
+            writer.WriteU16(0);
+            writer.WriteU8(0x0f);
+            writer.WriteU8(3);
+            const std::pair<uint8_t, const std::vector<uint8_t>*> arrays[] = { { 32, &vps }, { 33, &sps }, { 34, &pps } };
+            for (const auto& [type, nal] : arrays)
+            {
+                writer.WriteU8(0x80 | type);
+                writer.WriteU16(1);
+                writer.WriteU16(static_cast<uint16_t>(nal->size()));
+                writer.WriteBytes(nal->data(), nal->size());
+            }
+            writer.EndBox(hvcC);
+        }
+        else
+        {
+            const size_t avcC = writer.BeginBox(MakeFourCC("avcC"));
+            writer.WriteU8(1);
+            writer.WriteU8(static_cast<uint8_t>(options.profileIdc));
+            writer.WriteU8(0);
+            writer.WriteU8(static_cast<uint8_t>(options.levelIdc));
+            writer.WriteU8(0xff);
+            writer.WriteU8(0xe1);
+            writer.WriteU16(static_cast<uint16_t>(sps.size()));
+            writer.WriteBytes(sps.data(), sps.size());
+            writer.WriteU8(1);
+            writer.WriteU16(static_cast<uint16_t>(pps.size()));
+            writer.WriteBytes(pps.data(), pps.size());
+            writer.EndBox(avcC);
+        }
+
+        if (options.bitrateBox)
+        {
+            const auto avgBitrate = static_cast<uint32_t>(videoBytes * 8 * options.timescale / duration);
+            const size_t btrt = writer.BeginBox(MakeFourCC("btrt"));
+            writer.WriteU32(0); // buffer size
+            writer.WriteU32(avgBitrate * 2);
+            writer.WriteU32(avgBitrate);
+            writer.EndBox(btrt);
+        }
+
+        writer.EndBox(entry);
+    }
+
+    /// <summary>
+    /// Writes the movie box, given where the media data starts.
+    /// </summary>
+    static void WriteMovie(BigEndianWriter& writer,
+                           const SyntheticMp4Options& options,
+                           const std::vector<std::vector<uint8_t>>& videoSamples,
+                           const std::vector<uint32_t>& audioSampleSizes,
+                           const ChunkLayout& videoChunks,
+                           const ChunkLayout& audioChunks,
+                           uint64_t videoBytes)
+    {
+        const uint64_t videoDuration = static_cast<uint64_t>(options.frameCount) * options.frameDuration;
+        const uint32_t movieTimescale = 1000;
+        const auto movieDuration = static_cast<uint32_t>(videoDuration * movieTimescale / options.timescale);
+
+        const size_t moov = writer.BeginBox(MakeFourCC("moov"));
+
+        const size_t mvhd = writer.BeginFullBox(MakeFourCC("mvhd"), 0, 0);
+        writer.WriteU32(0);
+        writer.WriteU32(0);
+        writer.WriteU32(movieTimescale);
+        writer.WriteU32(movieDuration);
+        writer.WriteU32(0x10000);
+        writer.WriteU16(0x100);
+        writer.WriteU16(0);
+        writer.WriteU64(0);
+        WriteMatrix(writer);
+        for (int idx = 0; idx < 6; ++idx)
+            writer.WriteU32(0);
+        writer.WriteU32(3);
+        writer.EndBox(mvhd);
+
+        // video track:
+        {
+            const size_t trak = writer.BeginBox(MakeFourCC("trak"));
+            WriteTrackHeader(writer, 1, movieDuration, options.width, options.height, 0);
+            const size_t mdia = writer.BeginBox(MakeFourCC("mdia"));
+            WriteMediaHeader(writer, options.timescale, videoDuration, "und", "vide");
+            const size_t minf = writer.BeginBox(MakeFourCC("minf"));
+            const size_t vmhd = writer.BeginFullBox(MakeFourCC("vmhd"), 0, 1);
+            writer.WriteU64(0);
+            writer.EndBox(vmhd);
+            WriteDataInformation(writer);
+            const size_t stbl = writer.BeginBox(MakeFourCC("stbl"));
+
+            const size_t stsd = writer.BeginFullBox(MakeFourCC("stsd"), 0, 0);
+            writer.WriteU32(1);
+            WriteVideoSampleEntry(writer, options, videoBytes, videoDuration);
+            writer.EndBox(stsd);
+
+            WriteFullBoxU32s(writer, "stts", { 1, options.frameCount, options.frameDuration });
+
+            const size_t stss = writer.BeginFullBox(MakeFourCC("stss"), 0, 0);
+            writer.WriteU32((options.frameCount + options.gopSize - 1) / options.gopSize);
+            for (uint32_t idx = 0; idx < options.frameCount; idx += options.gopSize)
+                writer.WriteU32(idx + 1);
+            writer.EndBox(stss);
+
+            const size_t stsz = writer.BeginFullBox(MakeFourCC("stsz"), 0, 0);
+            writer.WriteU32(0);
+            writer.WriteU32(options.frameCount);
+            for (const auto& sample : videoSamples)
+                writer.WriteU32(static_cast<uint32_t>(sample.size()));
+            writer.EndBox(stsz);
+
+            WriteChunkTables(writer, videoChunks, options.largeChunkOffsets);
+            writer.EndBox(stbl);
+            writer.EndBox(minf);
+            writer.EndBox(mdia);
+            writer.EndBox(trak);
+        }
+
+        if (options.audio == SyntheticAudio::None)
+        {
+            writer.EndBox(moov);
+            return;
+        }
+
+        const bool isPcm = options.audio == SyntheticAudio::Pcm;
+        const uint64_t audioSampleCount = isPcm ? options.pcmSampleCount : audioSampleSizes.size();
+        const uint32_t audioSampleDuration = isPcm ? 1 : 1024;
+        const uint64_t audioDuration = audioSampleCount * audioSampleDuration;
+
+        const size_t trak = writer.BeginBox(MakeFourCC("trak"));
+        WriteTrackHeader(writer, 2, movieDuration, 0, 0, 0x100);
+        const size_t mdia = writer.BeginBox(MakeFourCC("mdia"));
+        WriteMediaHeader(writer, 48000, audioDuration, options.audioLanguage, "soun");
+        const size_t minf = writer.BeginBox(MakeFourCC("minf"));
+        const size_t smhd = writer.BeginFullBox(MakeFourCC("smhd"), 0, 0);
+        writer.WriteU32(0);
+        writer.EndBox(smhd);
+        WriteDataInformation(writer);
+        const size_t stbl = writer.BeginBox(MakeFourCC("stbl"));
+
+        const size_t stsd = writer.BeginFullBox(MakeFourCC("stsd"), 0, 0);
+        writer.WriteU32(1);
+        const size_t entry = writer.BeginBox(MakeFourCC(isPcm ? "sowt" : "mp4a"));
+        for (int idx = 0; idx < 6; ++idx)
+            writer.WriteU8(0);
+        writer.WriteU16(1);
+        writer.WriteU64(0);
+        writer.WriteU16(2); // channels
+        writer.WriteU16(16); // bits per sample
+        writer.WriteU16(0);
+        writer.WriteU16(0);
+        writer.WriteU32(48000U << 16);
+        if (!isPcm)
+        {
+            const uint8_t decoderConfig[] = {
+                0x40, 0x15, 0, 0x18, 0, 0, 0x03, 0x0d, 0x40, 0, 0x01, 0xf4, 0, 5, 2, 0x11, 0x90 };
+            const size_t esds = writer.BeginFullBox(MakeFourCC("esds"), 0, 0);
+            writer.WriteU8(3);
+            writer.WriteU8(static_cast<uint8_t>(sizeof(decoderConfig) + 2 + 3 + 3));
+            writer.WriteU16(2);
+            writer.WriteU8(0);
+            writer.WriteU8(4);
+            writer.WriteU8(static_cast<uint8_t>(sizeof(decoderConfig)));
+            writer.WriteBytes(decoderConfig, sizeof(decoderConfig));
+            writer.WriteU8(6);
+            writer.WriteU8(1);
+            writer.WriteU8(2);
+            writer.EndBox(esds);
+        }
+        writer.EndBox(entry);
+        writer.EndBox(stsd);
+
+        WriteFullBoxU32s(writer, "stts", { 1, static_cast<uint32_t>(audioSampleCount), audioSampleDuration });
+
+        const size_t stsz = writer.BeginFullBox(MakeFourCC("stsz"), 0, 0);
+        writer.WriteU32(isPcm ? 1 : 0);
+        writer.WriteU32(static_cast<uint32_t>(audioSampleCount));
+        if (!isPcm)
+        {
+            for (uint32_t size : audioSampleSizes)
+                writer.WriteU32(size);
+        }
+        writer.EndBox(stsz);
+
+        WriteChunkTables(writer, audioChunks, options.largeChunkOffsets);
+        writer.EndBox(stbl);
+        writer.EndBox(minf);
+        writer.EndBox(mdia);
+        writer.EndBox(trak);
+
+        writer.EndBox(moov);
+    }
+
+    SyntheticMp4 MakeSyntheticMp4(const SyntheticMp4Options& options)
+    {
+        std::mt19937 random(options.seed);
+        const auto videoSamples = MakeVideoSamples(options, random);
+
+        SyntheticMp4 result = {};
+        for (const auto& sample : videoSamples)
+        {
+            result.videoSampleSizes.push_back(static_cast<uint32_t>(sample.size()));
+            result.videoBytes += sample.size();
+        }
+
+        std::vector<uint32_t> audioSampleSizes;
+        if (options.audio == SyntheticAudio::Aac)
+        {
+            const uint64_t count = static_cast<uint64_t>(options.frameCount) * options.frameDuration
+                * 48000 / options.timescale / 1024;
+
+            std::uniform_int_distribution<uint32_t> sizes(300, 400);
+            for (uint64_t idx = 0; idx < count; ++idx)
+            {
+                audioSampleSizes.push_back(sizes(random));
+                result.audioBytes += audioSampleSizes.back();
+            }
+        }
+        result.audioSampleCount = static_cast<uint32_t>(
+            options.audio == SyntheticAudio::Pcm ? options.pcmSampleCount : audioSampleSizes.size());
+
+        // one chunk of video per GOP, followed by a chunk with the audio until then:
+        const auto layMediaData = [&](uint64_t mediaDataStart, ChunkLayout& videoChunks, ChunkLayout& audioChunks)
+        {
+            videoChunks = {};
+            audioChunks = {};
+            uint64_t offset = mediaDataStart;
+            size_t audioIdx = 0;
+            const size_t gopCount = (options.frameCount + options.gopSize - 1) / options.gopSize;
+            for (size_t gopIdx = 0; gopIdx < gopCount; ++gopIdx)
+            {
+                const size_t first = gopIdx * options.gopSize;
+                const size_t last = std::min<size_t>(first + options.gopSize, videoSamples.size());
+                videoChunks.offsets.push_back(offset);
+                videoChunks.samplesPerChunk.push_back(static_cast<uint32_t>(last - first));
+                for (size_t idx = first; idx < last; ++idx)
+                    offset += videoSamples[idx].size();
+
+                const size_t audioEnd = (gopIdx + 1 == gopCount)
+                    ? audioSampleSizes.size()
+                    : audioSampleSizes.size() * (gopIdx + 1) / gopCount;
+
+                if (audioEnd > audioIdx)
+                {
+                    audioChunks.offsets.push_back(offset);
+                    audioChunks.samplesPerChunk.push_back(static_cast<uint32_t>(audioEnd - audioIdx));
+                    for (; audioIdx < audioEnd; ++audioIdx)
+                        offset += audioSampleSizes[audioIdx];
+                }
+            }
+
+            // the PCM samples are not in the file, for they would be too many:
+            if (options.audio == SyntheticAudio::Pcm)
+            {
+                audioChunks.offsets.push_back(offset);
+                audioChunks.samplesPerChunk.push_back(static_cast<uint32_t>(options.pcmSampleCount));
+            }
+        };
+
+        std::vector<uint8_t> ftyp;
+        {
+            BigEndianWriter writer(ftyp);
+            const size_t box = writer.BeginBox(MakeFourCC("ftyp"));
+            writer.WriteU32(MakeFourCC("isom"));
+            writer.WriteU32(0x200);
+            for (uint32_t brand : { MakeFourCC("isom"), MakeFourCC("iso2"), MakeFourCC("avc1"), MakeFourCC("mp41") })
+                writer.WriteU32(brand);
+            writer.EndBox(box);
+        }
+
+        const auto makeMovie = [&](uint64_t mediaDataStart)
+        {
+            ChunkLayout videoChunks, audioChunks;
+            layMediaData(mediaDataStart, videoChunks, audioChunks);
+            std::vector<uint8_t> movie;
+            BigEndianWriter writer(movie);
+            WriteMovie(writer, options, videoSamples, audioSampleSizes, videoChunks, audioChunks, result.videoBytes);
+            return movie;
+        };
+
+        const uint64_t mediaDataSize = 8 + result.videoBytes + result.audioBytes;
+        std::vector<uint8_t> movie;
+        uint64_t mediaDataStart = ftyp.size() + 8;
+        if (options.moovFirst)
+        {
+            mediaDataStart = ftyp.size() + makeMovie(0).size() + 8;
+            movie = makeMovie(mediaDataStart);
+        }
+        else
+            movie = makeMovie(mediaDataStart);
+
+        auto& data = result.data;
+        data.reserve(ftyp.size() + movie.size() + mediaDataSize);
+        data.insert(data.end(), ftyp.begin(), ftyp.end());
+        if (options.moovFirst)
+            data.insert(data.end(), movie.begin(), movie.end());
+
+        BigEndianWriter writer(data);
+        const size_t mdat = writer.BeginBox(MakeFourCC("mdat"));
+        ChunkLayout videoChunks, audioChunks;
+        layMediaData(mediaDataStart, videoChunks, audioChunks);
+        size_t videoIdx = 0;
+        size_t audioIdx = 0;
+        std::vector<std::pair<uint64_t, bool>> chunks;
+        for (size_t idx = 0; idx < videoChunks.offsets.size(); ++idx)
+            chunks.emplace_back(videoChunks.offsets[idx], true);
+        if (options.audio == SyntheticAudio::Aac)
+        {
+            for (size_t idx = 0; idx < audioChunks.offsets.size(); ++idx)
+                chunks.emplace_back(audioChunks.offsets[idx], false);
+        }
+        std::sort(chunks.begin(), chunks.end());
+        size_t videoChunkIdx = 0;
+        size_t audioChunkIdx = 0;
+        for (const auto& [offset, isVideo] : chunks)
+        {
+            if (isVideo)
+            {
+                for (uint32_t count = 0; count < videoChunks.samplesPerChunk[videoChunkIdx]; ++count)
+                {
+                    const auto& sample = videoSamples[videoIdx++];
+                    writer.WriteBytes(sample.data(), sample.size());
+                }
+                ++videoChunkIdx;
+            }
+            else
+            {
+                for (uint32_t count = 0; count < audioChunks.samplesPerChunk[audioChunkIdx]; ++count)
+                {
+                    for (uint32_t byteIdx = 0; byteIdx < audioSampleSizes[audioIdx]; ++byteIdx)
+                        writer.WriteU8(static_cast<uint8_t>(random()));
+                    ++audioIdx;
+                }
+                ++audioChunkIdx;
+            }
+        }
+        writer.EndBox(mdat);
+
+        if (!options.moovFirst)
+            data.insert(data.end(), movie.begin(), movie.end());
+
+        result.fileSize = data.size();
+        return result;
+    }
+
+    SyntheticMp4 WriteSyntheticMp4(const std::filesystem::path& fileName, const SyntheticMp4Options& options)
+    {
+        SyntheticMp4 mp4 = MakeSyntheticMp4(options);
+        WriteFile(fileName, mp4.data);
+        return mp4;
+    }
+
+    void WriteFile(const std::filesystem::path& fileName, const std::vector<uint8_t>& data)
+    {
+        std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+        if (!file)
+            throw std::runtime_error("could not write " + fileName.string());
+    }
+
+    std::vector<uint8_t> ReadFile(const std::filesystem::path& fileName)
+    {
+        std::ifstream file(fileName, std::ios::binary);
+        if (!file)
+            throw std::runtime_error("could not read " + fileName.string());
+
+        return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    TemporaryDirectory::TemporaryDirectory()
+    {
+        static std::atomic<uint32_t> counter(0);
+        std::random_device entropy;
+        m_path = std::filesystem::temp_directory_path()
+            / ("VideoTranscoderTests-" + std::to_string(entropy()) + "-" + std::to_string(++counter));
+
+        std::filesystem::create_directories(m_path);
+    }
+
+    TemporaryDirectory::~TemporaryDirectory()
+    {
+        std::error_code error;
+        std::filesystem::remove_all(m_path, error);
+    }
+}
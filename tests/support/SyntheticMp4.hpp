@@ -0,0 +1,154 @@
+#pragma once
+
+#include "Encoder.hpp"
+
+#include <cinttypes>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace application::tests
+{
+    /// <summary>
+    /// Audio track of a synthetic MP4.
+    /// </summary>
+    enum class SyntheticAudio
+    {
+        None,
+
+        /// <summary>AAC in frames of 1024 samples at 48 kHz, with sizes varying around 350 bytes.</summary>
+        Aac,
+
+        /// <summary>
+        /// 16-bit stereo PCM at 48 kHz in a QuickTime layout: constant sample size of 1
+        /// and one 'stts' entry with a sample per tick, so the tables do not grow with the samples.
+        /// </summary>
+        Pcm
+    };
+
+    /// <summary>
+    /// How a synthetic MP4 is made.
+    /// </summary>
+    struct SyntheticMp4Options
+    {
+        Encoder codec = Encoder::H264_AVC;
+        uint32_t width = 1920;
+        uint32_t height = 1080;
+
+        /// <summary>profile_idc (H.264) or general_profile_idc (HEVC) in the parameter sets.</summary>
+        uint32_t profileIdc = 100;
+
+        /// <summary>level_idc (H.264) or general_level_idc (HEVC) in the parameter sets.</summary>
+        uint32_t levelIdc = 40;
+
+        uint32_t frameCount = 250;
+
+        /// <summary>Frames between sync samples.</summary>
+        uint32_t gopSize = 25;
+
+        uint32_t timescale = 25000;
+
+        /// <summary>Duration of every frame in units of timescale.</summary>
+        uint32_t frameDuration = 1000;
+
+        /// <summary>Average size of the frames (key frames are 4 times larger).</summary>
+        uint32_t frameSize = 20000;
+
+        SyntheticAudio audio = SyntheticAudio::Aac;
+
+        /// <summary>How many PCM samples there are, which the file does not have to hold.</summary>
+        uint64_t pcmSampleCount = 0;
+
+        /// <summary>Language of the audio track (ISO-639-2/T).</summary>
+        std::string audioLanguage = "und";
+
+        /// <summary>Whether the video sample entry declares its bitrates in 'btrt'.</summary>
+        bool bitrateBox = false;
+
+        /// <summary>Whether chunk offsets are written in 'co64' (rather than 'stco').</summary>
+        bool largeChunkOffsets = false;
+
+        /// <summary>Whether the movie box comes before the media data.</summary>
+        bool moovFirst = false;
+
+        uint32_t seed = 1;
+    };
+
+    /// <summary>
+    /// What a synthetic MP4 holds.
+    /// </summary>
+    struct SyntheticMp4
+    {
+        uint64_t fileSize;
+        uint64_t videoBytes;
+        uint64_t audioBytes;
+        uint32_t audioSampleCount;
+
+        /// <summary>Size of every video sample, in decoding order.</summary>
+        std::vector<uint32_t> videoSampleSizes;
+
+        /// <summary>The whole file.</summary>
+        std::vector<uint8_t> data;
+    };
+
+    /// <summary>
+    /// Makes a sequence parameter set NAL unit (with header and emulation prevention).
+    /// </summary>
+    std::vector<uint8_t> MakeSequenceParameterSet(const SyntheticMp4Options& options);
+
+    /// <summary>
+    /// Makes a picture parameter set NAL unit (with header and emulation prevention).
+    /// </summary>
+    std::vector<uint8_t> MakePictureParameterSet(Encoder codec);
+
+    /// <summary>
+    /// Makes a video parameter set NAL unit (HEVC).
+    /// </summary>
+    std::vector<uint8_t> MakeVideoParameterSet(const SyntheticMp4Options& options);
+
+    /// <summary>
+    /// Makes an MP4 file in memory, with a video track of H.264 or HEVC (whose samples
+    /// are NAL units of random content) and optionally an audio track.
+    /// </summary>
+    SyntheticMp4 MakeSyntheticMp4(const SyntheticMp4Options& options);
+
+    /// <summary>
+    /// Makes an MP4 file as <see cref="MakeSyntheticMp4"/> does and writes it.
+    /// </summary>
+    SyntheticMp4 WriteSyntheticMp4(const std::filesystem::path& fileName, const SyntheticMp4Options& options);
+
+    void WriteFile(const std::filesystem::path& fileName, const std::vector<uint8_t>& data);
+
+    std::vector<uint8_t> ReadFile(const std::filesystem::path& fileName);
+
+    /// <summary>
+    /// A directory of its own for a test, removed with everything in it when done.
+    /// </summary>
+    class TemporaryDirectory
+    {
+    private:
+
+        std::filesystem::path m_path;
+
+    public:
+
+        TemporaryDirectory();
+        ~TemporaryDirectory();
+
+        TemporaryDirectory(const TemporaryDirectory&) = delete;
+        TemporaryDirectory& operator=(const TemporaryDirectory&) = delete;
+
+        const std::filesystem::path& GetPath() const
+        {
+            return m_path;
+        }
+
+        /// <summary>
+        /// Gets the path of a file in the directory.
+        /// </summary>
+        std::string operator/(const std::string& fileName) const
+        {
+            return (m_path / fileName).string();
+        }
+    };
+}